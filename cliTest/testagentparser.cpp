@@ -157,6 +157,20 @@ TEST_CASE("AgentParserFail", "Parsing errors")
         REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("Invalid starting location seed provided (foo). Should only contain digits"));
     }
 
+    SECTION("Non-numeric input to -aseed")
+    {
+        AgentParser parser;
+        ArgumentHolder ah{"prog", "-aseed", "foo"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-aseed must be a number >=0, got foo"));
+    }
+
+    SECTION("Non-numeric input to -at")
+    {
+        AgentParser parser;
+        ArgumentHolder ah{"prog", "-at", "-1"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-at must be a number >=0, got -1"));
+    }
+
     SECTION("Rubbish input to -aloc")
     {
         AgentParser parser;
@@ -359,6 +373,8 @@ TEST_CASE("AgentParserSuccess", "Read successfully")
         auto points = parser.getReleasePoints();
         REQUIRE(points.size() == 0);
         REQUIRE(parser.randomReleaseLocationSeed() == 0);
+        REQUIRE(parser.randomSeed() == -1);
+        REQUIRE(parser.getThreads() == 1);
     }
 
     SECTION("Random starting locations (points vector should be empty, seed 1)")
@@ -451,6 +467,15 @@ TEST_CASE("AgentParserSuccess", "Read successfully")
         REQUIRE(outputTypes[0] == AgentParser::OutputType::TRAILS);
     }
 
+    SECTION("Seed and threads")
+    {
+        ArgumentHolder ah{"prog", "-ats", ats.str(), "-arr", arr.str(), "-afov", afov.str(), "-asteps", asteps.str(), "-alife", alife.str(), "-alocseed", "0", "-aseed", "42", "-at", "4"};
+        parser.parse(ah.argc(), ah.argv());
+
+        REQUIRE(parser.randomSeed() == 42);
+        REQUIRE(parser.getThreads() == 4);
+    }
+
     SECTION("Set two output types")
     {
         ArgumentHolder ah{"prog", "-ats", ats.str(), "-arr", arr.str(), "-afov", afov.str(), "-asteps", asteps.str(), "-alife", alife.str(), "-alocseed", "0", "-ot", "graph", "-ot", "gatecounts"};
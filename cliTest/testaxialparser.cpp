@@ -33,6 +33,7 @@ TEST_CASE("Test mode and help")
                                 "   -xal Include local measures\n"\
                                 "   -xar Include RA, RRA and total depth\n"\
                                 "   -xaw <map attribute name> perform weighted analysis using this attribute\n"\
+                                "   -xat <threads> number of threads to run the analysis on (0 for all cores)\n"\
                                 "\n");
 
 }
@@ -51,6 +52,18 @@ TEST_CASE("Test Parsing Exceptions","")
         ArgumentHolder ah{"prog", "-xl"};
         REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-xl requires an argument" );
     }
+
+    SECTION("Threads missing")
+    {
+        ArgumentHolder ah{"prog", "-xa", "n", "-xat"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-xat requires an argument" );
+    }
+
+    SECTION("Threads not a number")
+    {
+        ArgumentHolder ah{"prog", "-xa", "n", "-xat", "-2"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-xat must be a number >=0, got -2" );
+    }
 }
 
 TEST_CASE("Test mode parsing", "")
@@ -125,6 +138,14 @@ TEST_CASE("Test mode parsing", "")
         REQUIRE_FALSE(parser.useChoice());
         REQUIRE(parser.useLocal());
     }
+    SECTION("Analysis + threads")
+    {
+        ArgumentHolder ah{"prog", "-xa", "n", "-xac", "-xat", "4"};
+        parser.parse(ah.argc(), ah.argv());
+        REQUIRE(parser.runAnalysis());
+        REQUIRE(parser.useChoice());
+        REQUIRE(parser.getThreads() == 4);
+    }
 
     SECTION("Multiple")
     {
@@ -179,10 +179,20 @@ TEST_CASE("Valid Parser","CheckValues"){
         REQUIRE(cmdP.isValid());
         REQUIRE(cmdP.simpleMode());
         REQUIRE(cmdP.getTimingFile() == "timings.csv");
+        REQUIRE_FALSE(cmdP.compressGraph());
         REQUIRE(parsers[0]->getHelp() == TestParser::formatTestHelpString(false, true));
         REQUIRE(parsers[1]->getHelp() == TestParser::formatTestHelpString(false, false));
     }
 
+    SECTION("Compressed output graph")
+    {
+        CommandLineParser cmdP(factoryMock.get());
+        ArgumentHolder ah{"prog", "-m", "TEST1", "-f", "inputfile.graph", "-o", "outputfile.graph", "-z"};
+        cmdP.parse(ah.argc(), ah.argv());
+        REQUIRE(cmdP.isValid());
+        REQUIRE(cmdP.compressGraph());
+    }
+
 }
 
 TEST_CASE("Run Tests","Check we only run if it's appropriate"){
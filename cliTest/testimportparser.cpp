@@ -33,5 +33,26 @@ TEST_CASE("Import args valid", "valid")
         REQUIRE(cmdP.getFilesToImport().size() == 2);
         REQUIRE(cmdP.getFilesToImport()[0] == "importfile1");
         REQUIRE(cmdP.getFilesToImport()[1] == "importfile2");
+        REQUIRE(cmdP.getThreads() == 1);
+    }
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "IMPORT", "-if", "importfile", "-ith", "4"};
+        ImportParser cmdP;
+        cmdP.parse(ah.argc(), ah.argv());
+        REQUIRE(cmdP.getThreads() == 4);
+    }
+}
+
+TEST_CASE("Import args invalid", "")
+{
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "IMPORT", "-ith"};
+        ImportParser cmdP;
+        REQUIRE_THROWS_WITH(cmdP.parse(ah.argc(), ah.argv()), Catch::Contains("-ith requires an argument"));
+    }
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "IMPORT", "-ith", "-2"};
+        ImportParser cmdP;
+        REQUIRE_THROWS_WITH(cmdP.parse(ah.argc(), ah.argv()), Catch::Contains("-ith must be a number >=0, got -2"));
     }
 }
@@ -60,6 +60,20 @@ TEST_CASE("MapConvertParserFail", "Error cases")
         REQUIRE_THROWS_WITH(parser.parse(int(ah.argc()), ah.argv()), Catch::Contains("-crsl must be a number >0, got -1"));
     }
 
+    SECTION("Missing argument to cot")
+    {
+        MapConvertParser parser;
+        ArgumentHolder ah{"prog", "-cot"};
+        REQUIRE_THROWS_WITH(parser.parse(int(ah.argc()), ah.argv()), Catch::Contains("-cot requires an argument"));
+    }
+
+    SECTION("Negative input to -cot")
+    {
+        MapConvertParser parser;
+        ArgumentHolder ah{"prog", "-cot", "-2"};
+        REQUIRE_THROWS_WITH(parser.parse(int(ah.argc()), ah.argv()), Catch::Contains("-cot must be a number >=0, got -2"));
+    }
+
     SECTION("rubbish input to -co")
     {
         MapConvertParser parser;
@@ -99,5 +113,14 @@ TEST_CASE("MapConvertParserSuccess", "Read successfully")
         parser.parse(int(ah.argc()), ah.argv());
         REQUIRE(parser.outputMapName() == "new_axial");
         REQUIRE(parser.outputMapType() == ShapeMap::AXIALMAP);
+        REQUIRE(parser.getThreads() == 1);
+    }
+
+    SECTION("Segment on several threads")
+    {
+        ArgumentHolder ah{"prog", "-co", "segment", "-con", "new_segment", "-cot", "4"};
+        parser.parse(int(ah.argc()), ah.argv());
+        REQUIRE(parser.outputMapType() == ShapeMap::SEGMENTMAP);
+        REQUIRE(parser.getThreads() == 4);
     }
 }
@@ -35,6 +35,7 @@ TEST_CASE("Test segment mode and help")
                                 "       angular\n"\
                                 "  -sic to include choice (only for Tulip)\n"\
                                 "  -stb <tulip bins> (4 to 1024, 1024 approximates full angular)\n"\
+                                "  -stt <threads> number of threads to run the analysis on (only for Tulip, 0 for all cores)\n"\
                                 "  -swa <map attribute name> perform weighted analysis using this attribute (only for Tulip)\n");
 
 }
@@ -131,6 +132,24 @@ TEST_CASE("Test Segment Parsing Exceptions","")
         ArgumentHolder ah{"prog", "-st", "tulip", "-sr", "n", "-srt", "steps", "-stb", "1025"};
         REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-stb must be a number between 4 and 1024, got 1025" );
     }
+
+    SECTION("Argument missing -stt")
+    {
+        ArgumentHolder ah{"prog", "-st", "tulip", "-sr", "n", "-srt", "steps", "-stb", "1024", "-stt"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-stt requires an argument" );
+    }
+
+    SECTION("Threads not a number")
+    {
+        ArgumentHolder ah{"prog", "-st", "tulip", "-sr", "n", "-srt", "steps", "-stb", "1024", "-stt", "-1"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-stt must be a number >=0, got -1" );
+    }
+
+    SECTION("Threads without tulip")
+    {
+        ArgumentHolder ah{"prog", "-st", "metric", "-sr", "n", "-stt", "4"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), "-stt can only be used with tulip analysis" );
+    }
 }
 
 TEST_CASE("Test segment mode parsing", "")
@@ -179,6 +198,14 @@ TEST_CASE("Test segment mode parsing", "")
         REQUIRE(parser.getRadiusType() == SegmentParser::RadiusType::SEGMENT_STEPS);
         REQUIRE(parser.getRadii().size() == 1);
         REQUIRE(int(parser.getRadii()[0]) == -1);
+        REQUIRE(parser.getThreads() == 1);
+    }
+    SECTION("Analysis Tulip with threads")
+    {
+        ArgumentHolder ah{"prog", "-st", "tulip", "-sr", "n", "-srt", "metric", "-stb", "1024", "-sic", "-stt", "0"};
+        parser.parse(ah.argc(), ah.argv());
+        REQUIRE(parser.getAnalysisType() == SegmentParser::AnalysisType::ANGULAR_TULIP);
+        REQUIRE(parser.getThreads() == 0);
     }
 
 }
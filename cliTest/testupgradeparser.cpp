@@ -0,0 +1,125 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <catch.hpp>
+#include "depthmapXcli/upgradeparser.h"
+#include "depthmapXcli/modeparserregistry.h"
+#include "argumentholder.h"
+#include "salalib/mgraph.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+namespace {
+    class NullPerformanceSink : public IPerformanceSink
+    {
+    public:
+        void addData(const std::string &, double) {}
+    };
+
+    int fileVersion(const std::string &filename)
+    {
+        std::ifstream stream(filename, std::ios::binary);
+        char header[3];
+        int version = -1;
+        stream.read(header, 3);
+        stream.read(reinterpret_cast<char *>(&version), sizeof(version));
+        return version;
+    }
+}
+
+TEST_CASE("UpgradeParser", "Parse options")
+{
+    SECTION("Defaults")
+    {
+        UpgradeParser parser;
+        ArgumentHolder ah{"prog"};
+        parser.parse(int(ah.argc()), ah.argv());
+        REQUIRE_FALSE(parser.isRecursive());
+    }
+
+    SECTION("Recursive")
+    {
+        UpgradeParser parser;
+        ArgumentHolder ah{"prog", "-ur"};
+        parser.parse(int(ah.argc()), ah.argv());
+        REQUIRE(parser.isRecursive());
+    }
+}
+
+TEST_CASE("UpgradeParser upgrades a directory of graph files", "")
+{
+    namespace fs = std::filesystem;
+    std::string testData(__FILE__);
+    testData = testData.substr(0, testData.find_last_of("/\\") + 1) + "../testdata/";
+
+    fs::path input("upgradetest_in");
+    fs::path output("upgradetest_out");
+    fs::remove_all(input);
+    fs::remove_all(output);
+    fs::create_directories(input / "sub");
+    {
+        // an axial map is stored in the same way in version 430, only the version number differs
+        std::ifstream current(testData + "barnsbury_axial.graph", std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(current)), std::istreambuf_iterator<char>());
+        int olderVersion = 430;
+        contents.replace(3, sizeof(olderVersion), reinterpret_cast<const char *>(&olderVersion), sizeof(olderVersion));
+        std::ofstream(input / "barnsbury_axial.graph", std::ios::binary) << contents;
+    }
+    fs::copy_file(testData + "gallery_empty.graph", input / "sub" / "gallery_empty.graph");
+    std::ofstream(input / "notes.txt") << "not a graph";
+    REQUIRE(fileVersion((input / "barnsbury_axial.graph").string()) < METAGRAPH_VERSION);
+
+    ModeParserRegistry registry;
+    NullPerformanceSink perfSink;
+
+    SECTION("Only the top directory")
+    {
+        CommandLineParser clp(registry);
+        ArgumentHolder ah{"prog", "-m", "UPGRADE", "-f", input.string(), "-o", output.string()};
+        clp.parse(ah.argc(), ah.argv());
+        clp.run(perfSink);
+        REQUIRE(fileVersion((output / "barnsbury_axial.graph").string()) == METAGRAPH_VERSION);
+        REQUIRE_FALSE(fs::exists(output / "sub"));
+        REQUIRE_FALSE(fs::exists(output / "notes.txt"));
+
+        MetaGraph upgraded;
+        REQUIRE(upgraded.readFromFile((output / "barnsbury_axial.graph").string()) == MetaGraph::OK);
+        MetaGraph original;
+        REQUIRE(original.readFromFile(testData + "barnsbury_axial.graph") == MetaGraph::OK);
+        REQUIRE(upgraded.getShapeGraphs().size() == original.getShapeGraphs().size());
+        REQUIRE(upgraded.getShapeGraphs()[0]->getShapeCount() == original.getShapeGraphs()[0]->getShapeCount());
+    }
+
+    SECTION("With the subdirectories")
+    {
+        CommandLineParser clp(registry);
+        ArgumentHolder ah{"prog", "-m", "UPGRADE", "-f", input.string(), "-o", output.string(), "-ur"};
+        clp.parse(ah.argc(), ah.argv());
+        clp.run(perfSink);
+        REQUIRE(fileVersion((output / "barnsbury_axial.graph").string()) == METAGRAPH_VERSION);
+        REQUIRE(fileVersion((output / "sub" / "gallery_empty.graph").string()) == METAGRAPH_VERSION);
+    }
+
+    SECTION("A directory without graph files")
+    {
+        CommandLineParser clp(registry);
+        ArgumentHolder ah{"prog", "-m", "UPGRADE", "-f", (input / "sub" / "..").string(), "-o", output.string()};
+        fs::remove(input / "barnsbury_axial.graph");
+        clp.parse(ah.argc(), ah.argv());
+        REQUIRE_THROWS_WITH(clp.run(perfSink), Catch::Contains("No graph files found"));
+    }
+
+    fs::remove_all(input);
+    fs::remove_all(output);
+}
@@ -62,6 +62,18 @@ TEST_CASE("VGA args invalid", "")
         VgaParser p;
         REQUIRE_THROWS_WITH(p.parse(ah.argc(), ah.argv()), Catch::Contains("Metric vga requires a radius, use -vr <radius>"));
     }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "metric", "-vr", "n", "-vt"};
+        VgaParser p;
+        REQUIRE_THROWS_WITH(p.parse(ah.argc(), ah.argv()), Catch::Contains("-vt requires an argument"));
+    }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "metric", "-vr", "n", "-vt", "-2"};
+        VgaParser p;
+        REQUIRE_THROWS_WITH(p.parse(ah.argc(), ah.argv()), Catch::Contains("-vt must be a number >=0, got -2"));
+    }
 }
 
 TEST_CASE("VGA args valid", "valid")
@@ -107,5 +119,21 @@ TEST_CASE("VGA args valid", "valid")
         REQUIRE(cmdP.getVgaMode() == VgaParser::VgaMode::THRU_VISION);
     }
 
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "metric", "-vr", "n"};
+        VgaParser cmdP;
+        cmdP.parse(ah.argc(), ah.argv());
+        REQUIRE(cmdP.getVgaMode() == VgaParser::VgaMode::METRIC);
+        REQUIRE(cmdP.getThreads() == 1);
+    }
+
+    {
+        ArgumentHolder ah{"prog", "-f", "infile", "-o", "outfile", "-m", "VGA", "-vm", "metric", "-vr", "n", "-vt", "4"};
+        VgaParser cmdP;
+        cmdP.parse(ah.argc(), ah.argv());
+        REQUIRE(cmdP.getVgaMode() == VgaParser::VgaMode::METRIC);
+        REQUIRE(cmdP.getThreads() == 4);
+    }
+
 
 }
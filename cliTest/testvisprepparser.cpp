@@ -39,6 +39,20 @@ TEST_CASE("VisPrepParserFail", "Error cases")
         REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-pf requires an argument"));
     }
 
+    SECTION("Missing argument to pt")
+    {
+        VisPrepParser parser;
+        ArgumentHolder ah{"prog", "-pm", "-pt"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-pt requires an argument"));
+    }
+
+    SECTION("Negative input to -pt")
+    {
+        VisPrepParser parser;
+        ArgumentHolder ah{"prog", "-pm", "-pt", "-2"};
+        REQUIRE_THROWS_WITH(parser.parse(ah.argc(), ah.argv()), Catch::Contains("-pt must be a number >=0, got -2"));
+    }
+
     SECTION("Non-numeric input to -pg")
     {
         VisPrepParser parser;
@@ -169,10 +183,11 @@ TEST_CASE("VisprepParserMakeSuccess", "Read successfully - Make")
         std::stringstream p2;
         p2 << x2 << "," << y2 << std::flush;
 
-        ArgumentHolder ah{"prog", "-pg", gstring.str(), "-pp", p1.str(), "-pp", p2.str(), "-pb", "-pr", "2.1", "-pm"};
+        ArgumentHolder ah{"prog", "-pg", gstring.str(), "-pp", p1.str(), "-pp", p2.str(), "-pb", "-pr", "2.1", "-pm", "-pt", "4"};
         parser.parse(ah.argc(), ah.argv());
         REQUIRE(parser.getBoundaryGraph());
         REQUIRE(parser.getMakeGraph());
+        REQUIRE(parser.getThreads() == 4);
         REQUIRE_FALSE(parser.getUnmakeGraph());
         REQUIRE_FALSE(parser.getRemoveLinksWhenUnmaking());
         REQUIRE(parser.getMaxVisibility() == Approx(2.1));
@@ -190,6 +205,7 @@ TEST_CASE("VisprepParserMakeSuccess", "Read successfully - Make")
         parser.parse(ah.argc(), ah.argv() );
         REQUIRE_FALSE(parser.getBoundaryGraph());
         REQUIRE_FALSE(parser.getMakeGraph());
+        REQUIRE(parser.getThreads() == 1);
         REQUIRE_FALSE(parser.getUnmakeGraph());
         REQUIRE_FALSE(parser.getRemoveLinksWhenUnmaking());
         REQUIRE(parser.getMaxVisibility() == Approx(-1.0));
@@ -650,14 +650,16 @@ void GLView::highlightHoveredPixels(const PointMap &map, const std::set<PixelRef
 
 void GLView::highlightHoveredShapes(const ShapeMap &map, const QtRegion &region) {
 
-    auto shapesInRegion = map.getShapesInRegion(region);
+    std::vector<size_t> shapesInRegion;
+    map.getShapesInRegion(region, shapesInRegion);
     if (!shapesInRegion.empty()) {
         std::vector<std::pair<SimpleLine, PafColor>> colouredLines;
         std::vector<std::pair<std::vector<Point2f>, PafColor>> colouredPolygons;
         std::vector<std::pair<Point2f, PafColor>> colouredPoints;
-        for (auto keyShape : shapesInRegion) {
-            AttributeKey key = AttributeKey(keyShape.first);
-            const SalaShape &shape = keyShape.second;
+        for (size_t index : shapesInRegion) {
+            auto keyShape = map.getShapeRefFromIndex(index);
+            AttributeKey key = AttributeKey(keyShape->first);
+            const SalaShape &shape = keyShape->second;
 
             const AttributeRow &row = map.getAttributeTable().getRow(key);
             PafColor colour = dXreimpl::getDisplayColor(key, row, map.getAttributeTableHandle(), true);
@@ -219,6 +219,28 @@ void AgentParser::parse(int argc, char *argv[])
                 throw CommandLineException(std::string("-alocseed must be a number between 0 and 10, got ") + argv[i]);
             }
         }
+        else if (std::strcmp(argv[i], "-aseed") == 0)
+        {
+            if (m_randomSeed >= 0)
+            {
+                throw CommandLineException("-aseed can only be used once");
+            }
+            ENFORCE_ARGUMENT("-aseed", i)
+            if (!has_only_digits(argv[i]))
+            {
+                throw CommandLineException(std::string("-aseed must be a number >=0, got ") + argv[i]);
+            }
+            m_randomSeed = std::atoi(argv[i]);
+        }
+        else if (std::strcmp(argv[i], "-at") == 0)
+        {
+            ENFORCE_ARGUMENT("-at", i)
+            if (!has_only_digits(argv[i]))
+            {
+                throw CommandLineException(std::string("-at must be a number >=0, got ") + argv[i]);
+            }
+            m_threads = std::atoi(argv[i]);
+        }
         else if (std::strcmp(argv[i], "-alocfile") == 0)
         {
             if (!points.empty())
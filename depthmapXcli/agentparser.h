@@ -54,6 +54,11 @@ public:
                   "-alocfile <agent starting points file>\n"\
                   "-aloc <single agent starting point coordinates> provided in csv (x1,y1) "\
                   "for example \"0.1,0.2\". Provide multiple times for multiple links\n"\
+                  "-aseed <seed> give every agent its own random numbers made from this seed, so that "\
+                  "a run can be repeated exactly with any number of threads\n"\
+                  "-at <threads> number of threads to move the agents on (0 for all cores, default 1). "\
+                  "With more than one thread the agents always use their own random numbers "\
+                  "(from seed 0 unless -aseed is given)\n"\
                   "-ot <output type> available output types (may use more than one):"\
                   "    graph (graph file, default)"\
                   "    gatecounts (csv with cells of grid with gate counts)"\
@@ -93,6 +98,8 @@ public:
     double releaseRate() const { return m_releaseRate; }
     int recordTrailsForAgents() const { return m_recordTrailsForAgents; }
     int randomReleaseLocationSeed() const { return m_randomReleaseLocationSeed; }
+    int randomSeed() const { return m_randomSeed; }
+    int getThreads() const { return m_threads; }
 
     int agentFOV() const { return m_agentFOV; }
     int agentStepsBeforeTurnDecision() const { return m_agentStepsBeforeTurnDecision; }
@@ -117,6 +124,9 @@ private:
     int m_randomReleaseLocationSeed = -1;
     std::vector<Point2f> m_releasePoints;
 
+    int m_randomSeed = -1;
+    int m_threads = 1;
+
     std::vector<OutputType> m_outputTypes;
 };
 
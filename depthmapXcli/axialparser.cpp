@@ -23,7 +23,7 @@
 
 using namespace depthmapX;
 
-AxialParser::AxialParser() :  m_runFewestLines(false), m_runAnalysis(false), m_choice(false), m_local(false), m_rra(false)
+AxialParser::AxialParser() :  m_runFewestLines(false), m_runAnalysis(false), m_choice(false), m_local(false), m_rra(false), m_threads(1)
 {
 
 }
@@ -47,6 +47,7 @@ std::string AxialParser::getHelp() const
             "   -xal Include local measures\n"\
             "   -xar Include RA, RRA and total depth\n"\
             "   -xaw <map attribute name> perform weighted analysis using this attribute\n"\
+            "   -xat <threads> number of threads to run the analysis on (0 for all cores)\n"\
             "\n";
 }
 
@@ -90,6 +91,15 @@ void AxialParser::parse(int argc, char **argv)
             ENFORCE_ARGUMENT("-xaw", i)
             m_attribute = argv[i];
         }
+        else if (std::strcmp(argv[i], "-xat") == 0)
+        {
+            ENFORCE_ARGUMENT("-xat", i)
+            if (!has_only_digits(argv[i]))
+            {
+                throw CommandLineException(std::string("-xat must be a number >=0, got ") + argv[i]);
+            }
+            m_threads = std::atoi(argv[i]);
+        }
     }
 
     if (!runAllLines() && !runFewestLines() && !runUnlink() && !runAnalysis())
@@ -59,6 +59,7 @@ public:
     bool useChoice() const { return m_choice; }
     bool useLocal() const { return m_local; }
     bool calculateRRA() const { return m_rra; }
+    int getThreads() const { return m_threads; }
 
     const std::vector<double>& getRadii() const { return m_radii;}
     const std::string getAttribute() const { return m_attribute;}
@@ -72,4 +73,5 @@ private:
     bool m_local;
     bool m_rra;
     std::string m_attribute;
+    int m_threads;
 };
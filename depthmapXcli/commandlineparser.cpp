@@ -25,12 +25,13 @@
 using namespace depthmapX;
 
 void CommandLineParser::printHelp(){
-    std::cout << "Usage: depthmapXcli -m <mode> -f <filename> -o <output file> [-s] [-t <times.csv>] [-p] [mode options]\n"
+    std::cout << "Usage: depthmapXcli -m <mode> -f <filename> -o <output file> [-s] [-t <times.csv>] [-p] [-z] [mode options]\n"
               << "       depthmapXcli -v prints the current version\n"
               << "       depthmapXcli -h prints this help text\n"
               << "-s enables simple mode\n"
               << "-t <times.csv> enables output of runtimes as csv file\n"
               << "-p enables text progress printing\n"
+              << "-z compresses the output graph file (depthmapX reads compressed and plain graph files alike)\n"
 
               << "Possible modes are:\n";
               std::for_each(_parserFactory.getModeParsers().begin(), _parserFactory.getModeParsers().end(), [](const ModeParserVec::value_type &p)->void{ std::cout << "  " << p->getModeName() << "\n"; });
@@ -45,7 +46,7 @@ void CommandLineParser::printVersion(){
 
 
 CommandLineParser::CommandLineParser(const IModeParserFactory &parserFactory)
-    :  m_simpleMode(false), _parserFactory(parserFactory), _modeParser(0)
+    :  m_simpleMode(false), m_compressGraph(false), _parserFactory(parserFactory), _modeParser(0)
 {}
 
 void CommandLineParser::parse(size_t argc, char *argv[])
@@ -113,6 +114,10 @@ void CommandLineParser::parse(size_t argc, char *argv[])
         {
             m_printProgress = true;
         }
+        else if ( std::strcmp("-z", argv[i]) == 0)
+        {
+            m_compressGraph = true;
+        }
         ++i;
     }
 
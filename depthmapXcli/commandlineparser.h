@@ -37,6 +37,7 @@ public:
     bool printVersionMode() const { return m_printVersionMode; }
     bool simpleMode() const { return m_simpleMode; }
     bool printProgress() const { return m_printProgress; }
+    bool compressGraph() const { return m_compressGraph; }
     const IModeParser& modeOptions() const{ return *_modeParser;};
 
 
@@ -53,6 +54,7 @@ private:
     bool m_printVersionMode;
     bool m_simpleMode;
     bool m_printProgress;
+    bool m_compressGraph;
 
     const IModeParserFactory &_parserFactory;
     IModeParser * _modeParser;
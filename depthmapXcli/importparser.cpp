@@ -49,6 +49,14 @@ void ImportParser::parse(int argc, char *argv[])
         } else if ( strcmp ("-iaa", argv[i]) == 0)
         {
             m_importAsAttributes = true;
+        } else if ( strcmp ("-ith", argv[i]) == 0)
+        {
+            ENFORCE_ARGUMENT("-ith", i)
+            if (!has_only_digits(argv[i]))
+            {
+                throw CommandLineException(std::string("-ith must be a number >=0, got ") + argv[i]);
+            }
+            m_threads = std::atoi(argv[i]);
         }
     }
 }
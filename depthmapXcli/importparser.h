@@ -39,7 +39,8 @@ public:
                 "       Possible map types:\n"\
                 "         - drawing (default, does not preserve attributes, typically for dxf files)\n"\
                 "         - data (preserves attributes, typically for csv and tsv files)\n"\
-                "   -iaa will import and attach attributes to an existing map\n";
+                "   -iaa will import and attach attributes to an existing map\n"\
+                "   -ith <threads> number of threads to use for parsing and importing dxf files (0 for all cores, default 1)\n";
     }
 
 public:
@@ -49,9 +50,11 @@ public:
     const std::vector<std::string> & getFilesToImport() const { return m_filesToImport; }
     const bool toImportAsAttrbiutes() const { return m_importAsAttributes; }
     const depthmapX::ImportType getImportMapType() const { return m_importMapType; }
+    int getThreads() const { return m_threads; }
 
 private:
     depthmapX::ImportType m_importMapType = depthmapX::ImportType::DRAWINGMAP;
     std::vector<std::string> m_filesToImport;
     bool m_importAsAttributes = false;
+    int m_threads = 1;
 };
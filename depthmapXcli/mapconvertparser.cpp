@@ -84,6 +84,15 @@ void MapConvertParser::parse(int argc, char **argv)
                 throw CommandLineException(std::string("-crsl must be a number >0, got ") + argv[i]);
             }
         }
+        else if (std::strcmp(argv[i], "-cot") == 0)
+        {
+            ENFORCE_ARGUMENT("-cot", i)
+            if (!has_only_digits(argv[i]))
+            {
+                throw CommandLineException(std::string("-cot must be a number >=0, got ") + argv[i]);
+            }
+            m_threads = std::atoi(argv[i]);
+        }
     }
 
     if (m_outMapType == ShapeMap::EMPTYMAP)
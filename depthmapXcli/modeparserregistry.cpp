@@ -25,6 +25,7 @@
 #include "exportparser.h"
 #include "stepdepthparser.h"
 #include "mapconvertparser.h"
+#include "upgradeparser.h"
 #include "modules/segmentshortestpaths/cli/segmentshortestpathparser.h"
 
 
@@ -42,6 +43,7 @@ void ModeParserRegistry::populateParsers()
     REGISTER_PARSER(ImportParser);
     REGISTER_PARSER(StepDepthParser);
     REGISTER_PARSER(MapConvertParser);
+    REGISTER_PARSER(UpgradeParser);
     REGISTER_PARSER(SegmentShortestPathParser);
     // *********
 }
@@ -21,6 +21,8 @@
 #include "exceptions.h"
 #include "simpletimer.h"
 #include "printcommunicator.h"
+#include <algorithm>
+#include <filesystem>
 #include <memory>
 #include <sstream>
 #include <vector>
@@ -30,10 +32,10 @@
 
 namespace dm_runmethods
 {
-    std::unique_ptr<MetaGraph> loadGraph(const std::string& filename, IPerformanceSink &perfWriter) {
+    std::unique_ptr<MetaGraph> loadGraph(const std::string& filename, IPerformanceSink &perfWriter, int readflags) {
         std::unique_ptr<MetaGraph> mgraph(new MetaGraph);
         std::cout << "Loading graph " << filename << std::flush;
-        DO_TIMED( "Load graph file", auto result = mgraph->readFromFile(filename);)
+        DO_TIMED( "Load graph file", auto result = mgraph->readFromFile(filename, readflags);)
         if ( result != MetaGraph::OK)
         {
             std::stringstream message;
@@ -73,7 +75,6 @@ namespace dm_runmethods
         {
             // not a graph, try to import the file
             std::string ext = cmdP.getFileName().substr(cmdP.getFileName().length() - 4, cmdP.getFileName().length() - 1);
-            std::ifstream file(cmdP.getFileName());
 
             depthmapX::ImportFileType importFileType = depthmapX::ImportFileType::TSV;
             if(dXstring::toLower(ext) == ".csv") {
@@ -82,12 +83,13 @@ namespace dm_runmethods
                 importFileType = depthmapX::ImportFileType::DXF;
             }
 
-            depthmapX::importFile(*mgraph,
-                                  file,
-                                  getCommunicator(cmdP).get(),
-                                  cmdP.getFileName(),
-                                  parser.getImportMapType(),
-                                  importFileType);
+            DO_TIMED("Importing file", depthmapX::importFile(*mgraph,
+                                                             cmdP.getFileName(),
+                                                             getCommunicator(cmdP).get(),
+                                                             cmdP.getFileName(),
+                                                             parser.getImportMapType(),
+                                                             importFileType,
+                                                             parser.getThreads());)
         } else if ( result == MetaGraph::OK) {
             if(parser.toImportAsAttrbiutes()) {
 
@@ -110,7 +112,7 @@ namespace dm_runmethods
                 }
             }
         }
-        DO_TIMED("Writing graph", mgraph->write(cmdP.getOuputFile().c_str(),METAGRAPH_VERSION, false);)
+        DO_TIMED("Writing graph", mgraph->write(cmdP.getOuputFile().c_str(),METAGRAPH_VERSION, false, cmdP.compressGraph());)
     }
 
     void linkGraph(const CommandLineParser &cmdP, const LinkParser &parser, IPerformanceSink &perfWriter)
@@ -221,7 +223,7 @@ namespace dm_runmethods
         }
 
         perfWriter.addData("Linking graph", t.getTimeInSeconds());
-        DO_TIMED("Writing graph", mgraph->write(cmdP.getOuputFile().c_str(),METAGRAPH_VERSION, false);)
+        DO_TIMED("Writing graph", mgraph->write(cmdP.getOuputFile().c_str(),METAGRAPH_VERSION, false, cmdP.compressGraph());)
     }
 
     void runVga(const CommandLineParser &cmdP, const VgaParser &vgaP, const IRadiusConverter &converter, IPerformanceSink &perfWriter)
@@ -237,6 +239,7 @@ namespace dm_runmethods
                 options->output_type = Options::OUTPUT_VISUAL;
                 options->local = vgaP.localMeasures();
                 options->global = vgaP.globalMeasures();
+                options->threads = vgaP.getThreads();
                 if (options->global )
                 {
                     options->radius = converter.ConvertForVisibility(vgaP.getRadius());
@@ -245,9 +248,11 @@ namespace dm_runmethods
             case VgaParser::VgaMode::METRIC:
                 options->output_type = Options::OUTPUT_METRIC;
                 options->radius = converter.ConvertForMetric(vgaP.getRadius());
+                options->threads = vgaP.getThreads();
                 break;
             case VgaParser::VgaMode::ANGULAR:
                 options->output_type = Options::OUTPUT_ANGULAR;
+                options->threads = vgaP.getThreads();
                 break;
             case VgaParser::VgaMode::ISOVIST:
                 options->output_type = Options::OUTPUT_ISOVIST;
@@ -262,7 +267,7 @@ namespace dm_runmethods
 
         DO_TIMED("Run VGA", mgraph->analyseGraph(getCommunicator(cmdP).get(), *options, cmdP.simpleMode() ))
         std::cout << " ok\nWriting out result..." << std::flush;
-        DO_TIMED("Writing graph", mgraph->write(cmdP.getOuputFile().c_str(),METAGRAPH_VERSION, false))
+        DO_TIMED("Writing graph", mgraph->write(cmdP.getOuputFile().c_str(),METAGRAPH_VERSION, false, cmdP.compressGraph()))
         std::cout << " ok" << std::endl;
     }
 
@@ -284,6 +289,7 @@ namespace dm_runmethods
             bool makeGraph,
             bool unmakeGraph,
             bool removeLinksWhenUnmaking,
+            int threads,
             IPerformanceSink &perfWriter)
     {
         auto mGraph = loadGraph(clp.getFileName().c_str(),perfWriter);
@@ -331,12 +337,12 @@ namespace dm_runmethods
             }
             if(makeGraph) {
                 std::cout << "ok\nMaking graph... " << std::flush;
-                DO_TIMED("Making graph", mGraph->makeGraph(getCommunicator(clp).get(), boundaryGraph ? 1 : 0, maxVisibility))
+                DO_TIMED("Making graph", mGraph->makeGraph(getCommunicator(clp).get(), boundaryGraph ? 1 : 0, maxVisibility, threads))
             }
         }
 
         std::cout << " ok\nWriting out result..." << std::flush;
-        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false))
+        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false, clp.compressGraph()))
                 std::cout << " ok" << std::endl;
     }
 
@@ -382,6 +388,7 @@ namespace dm_runmethods
             options.local = ap.useLocal();
             options.fulloutput = ap.calculateRRA();
             options.weighted_measure_col = -1;
+            options.threads = ap.getThreads();
 
             if(!ap.getAttribute().empty()) {
                 const ShapeGraph& map = mGraph->getDisplayedShapeGraph();
@@ -401,7 +408,7 @@ namespace dm_runmethods
 
         }
         std::cout << "Writing out result..." << std::flush;
-        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false))
+        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false, clp.compressGraph()))
         std::cout << " ok" << std::endl;
 
     }
@@ -419,6 +426,7 @@ namespace dm_runmethods
         options.choice = sp.includeChoice();
         options.tulip_bins = sp.getTulipBins();
         options.weighted_measure_col = -1;
+        options.threads = sp.getThreads();
 
         if(!sp.getAttribute().empty()) {
             const ShapeGraph& map = mGraph->getDisplayedShapeGraph();
@@ -475,7 +483,7 @@ namespace dm_runmethods
         std::cout << "ok\n" << std::flush;
 
         std::cout << "Writing out result..." << std::flush;
-        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false))
+        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false, clp.compressGraph()))
         std::cout << " ok" << std::endl;
 
     }
@@ -557,6 +565,9 @@ namespace dm_runmethods
         // there thus it is skipped for now
         // eng.m_gatelayer = m_gatelayer;
 
+        eng.m_random_seed = agentP.randomSeed();
+        eng.m_threads = agentP.getThreads();
+
         // note, trails currently per run, but output per engine
         if (agentP.recordTrailsForAgents() == 0) {
             eng.m_record_trails = true;
@@ -575,7 +586,7 @@ namespace dm_runmethods
             // if no choice was made for an output type assume the user just
             // wants a graph file
 
-            DO_TIMED("Writing graph", mgraph->write(cmdP.getOuputFile().c_str(),METAGRAPH_VERSION, false))
+            DO_TIMED("Writing graph", mgraph->write(cmdP.getOuputFile().c_str(),METAGRAPH_VERSION, false, cmdP.compressGraph()))
         }
         else if(resultTypes.size() == 1)
         {
@@ -586,7 +597,7 @@ namespace dm_runmethods
             switch(resultTypes[0]) {
                 case AgentParser::OutputType::GRAPH:
                 {
-                    DO_TIMED("Writing graph", mgraph->write(cmdP.getOuputFile().c_str(),METAGRAPH_VERSION, false))
+                    DO_TIMED("Writing graph", mgraph->write(cmdP.getOuputFile().c_str(),METAGRAPH_VERSION, false, cmdP.compressGraph()))
                     break;
                 }
                 case AgentParser::OutputType::GATECOUNTS:
@@ -615,7 +626,7 @@ namespace dm_runmethods
 
             if(std::find(resultTypes.begin(), resultTypes.end(), AgentParser::OutputType::GRAPH) != resultTypes.end()) {
                 std::string outFile = cmdP.getOuputFile() + ".graph";
-                DO_TIMED("Writing graph", mgraph->write(outFile.c_str(),METAGRAPH_VERSION, false))
+                DO_TIMED("Writing graph", mgraph->write(outFile.c_str(),METAGRAPH_VERSION, false, cmdP.compressGraph()))
             }
             if(std::find(resultTypes.begin(), resultTypes.end(), AgentParser::OutputType::GATECOUNTS) != resultTypes.end()) {
                 std::string outFile = cmdP.getOuputFile() + "_gatecounts.csv";
@@ -642,13 +653,20 @@ namespace dm_runmethods
                 mGraph->makeIsovist(getCommunicator(clp).get(), isovist.getLocation(), isovist.getLeftAngle(), isovist.getRightAngle(), clp.simpleMode());
             }))
         std::cout << " ok\nWriting out result..." << std::flush;
-        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false))
+        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false, clp.compressGraph()))
         std::cout << " ok" << std::endl;
     }
 
     void exportData(const CommandLineParser &cmdP, const ExportParser &exportP, IPerformanceSink &perfWriter ) {
 
-        auto mgraph = loadGraph(cmdP.getFileName().c_str(), perfWriter);
+        // only the point map connections and links need the visibility graph, which
+        // is most of the file for a processed point map
+        int readflags = MetaGraph::SKIP_VISIBILITY_GRAPHS;
+        if (exportP.getExportMode() == ExportParser::POINTMAP_CONNECTIONS_CSV
+                || exportP.getExportMode() == ExportParser::POINTMAP_LINKS_CSV) {
+            readflags = MetaGraph::READ_ALL;
+        }
+        auto mgraph = loadGraph(cmdP.getFileName().c_str(), perfWriter, readflags);
 
         switch(exportP.getExportMode()) {
             case ExportParser::POINTMAP_DATA_CSV:
@@ -773,7 +791,7 @@ namespace dm_runmethods
         DO_TIMED("Calculating step-depth", mGraph->analyseGraph( getCommunicator(clp).get(), options, false))
 
         std::cout << " ok\nWriting out result..." << std::flush;
-        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false))
+        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false, clp.compressGraph()))
                 std::cout << " ok" << std::endl;
     }
 
@@ -830,13 +848,13 @@ namespace dm_runmethods
             switch(currentMapType) {
             case ShapeMap::DRAWINGMAP: {
                 DO_TIMED("Converting from drawing to axial",
-                         mGraph->convertDrawingToAxial(getCommunicator(clp).get(), mcp.outputMapName()));
+                         mGraph->convertDrawingToAxial(getCommunicator(clp).get(), mcp.outputMapName(), mcp.getThreads()));
                 break;
             }
             case ShapeMap::DATAMAP: {
                 DO_TIMED("Converting from data to axial",
                          mGraph->convertDataToAxial(getCommunicator(clp).get(), mcp.outputMapName(),
-                                                    !mcp.removeInputMap(), mcp.copyAttributes()));
+                                                    !mcp.removeInputMap(), mcp.copyAttributes(), mcp.getThreads()));
                 break;
             }
             default: {
@@ -849,7 +867,7 @@ namespace dm_runmethods
             switch(currentMapType) {
             case ShapeMap::DRAWINGMAP: {
                 DO_TIMED("Converting from drawing to segment",
-                         mGraph->convertDrawingToSegment(getCommunicator(clp).get(), mcp.outputMapName()));
+                         mGraph->convertDrawingToSegment(getCommunicator(clp).get(), mcp.outputMapName(), mcp.getThreads()));
                 break;
             }
             case ShapeMap::AXIALMAP: {
@@ -861,7 +879,7 @@ namespace dm_runmethods
             case ShapeMap::DATAMAP: {
                 DO_TIMED("Converting from data to segment",
                          mGraph->convertDataToSegment(getCommunicator(clp).get(), mcp.outputMapName(),
-                                                      !mcp.removeInputMap(), mcp.copyAttributes()));
+                                                      !mcp.removeInputMap(), mcp.copyAttributes(), mcp.getThreads()));
                 break;
             }
             default: {
@@ -888,7 +906,69 @@ namespace dm_runmethods
         }
 
         std::cout << " ok\nWriting out result..." << std::flush;
-        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false))
+        DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(),METAGRAPH_VERSION, false, clp.compressGraph()))
                 std::cout << " ok" << std::endl;
     }
+
+    void runUpgrade(const CommandLineParser &clp, const UpgradeParser &up, IPerformanceSink &perfWriter)
+    {
+        namespace fs = std::filesystem;
+        fs::path input(clp.getFileName());
+        fs::path output(clp.getOuputFile());
+
+        // loading upgrades the graph, writing saves it in the current version
+        auto upgrade = [&perfWriter, &clp](const std::string &from, const std::string &to) {
+            auto mGraph = loadGraph(from, perfWriter);
+            std::cout << "Writing out result..." << std::flush;
+            DO_TIMED("Writing graph", auto result = mGraph->write(to, METAGRAPH_VERSION, false, clp.compressGraph()))
+            if (result != MetaGraph::OK) {
+                std::stringstream message;
+                message << "Failed to write graph to file " << to << ", error " << result << std::flush;
+                throw depthmapX::RuntimeException(message.str().c_str());
+            }
+            std::cout << " ok" << std::endl;
+        };
+
+        if (!fs::is_directory(input)) {
+            upgrade(input.string(), output.string());
+            return;
+        }
+
+        std::vector<fs::path> graphFiles;
+        auto addIfGraphFile = [&graphFiles](const fs::directory_entry &entry) {
+            std::string extension = entry.path().extension().string();
+            if (entry.is_regular_file() && dXstring::toLower(extension) == ".graph") {
+                graphFiles.push_back(entry.path());
+            }
+        };
+        if (up.isRecursive()) {
+            std::for_each(fs::recursive_directory_iterator(input), fs::recursive_directory_iterator(), addIfGraphFile);
+        } else {
+            std::for_each(fs::directory_iterator(input), fs::directory_iterator(), addIfGraphFile);
+        }
+        if (graphFiles.empty()) {
+            throw depthmapX::RuntimeException("No graph files found in " + input.string());
+        }
+        std::sort(graphFiles.begin(), graphFiles.end());
+
+        // one file that fails to upgrade does not stop the others
+        size_t failed = 0;
+        for (const fs::path &graphFile : graphFiles) {
+            fs::path upgradedFile = output / fs::relative(graphFile, input);
+            try {
+                fs::create_directories(upgradedFile.parent_path());
+                upgrade(graphFile.string(), upgradedFile.string());
+            } catch (const std::exception &e) {
+                std::cout << "\n" << e.what() << std::endl;
+                failed++;
+            }
+        }
+        std::cout << "Upgraded " << graphFiles.size() - failed << " of " << graphFiles.size() << " graph files"
+                  << std::endl;
+        if (failed != 0) {
+            std::stringstream message;
+            message << failed << " graph files could not be upgraded" << std::flush;
+            throw depthmapX::RuntimeException(message.str().c_str());
+        }
+    }
 }
@@ -24,7 +24,7 @@
 using namespace depthmapX;
 
 SegmentParser::SegmentParser() :  m_analysisType(AnalysisType::NONE), m_radiusType(RadiusType::NONE), m_includeChoice(false),
-    m_tulipBins(0)
+    m_tulipBins(0), m_threads(1)
 {
 
 }
@@ -49,6 +49,7 @@ std::string SegmentParser::getHelp() const
             "       angular\n"\
             "  -sic to include choice (only for Tulip)\n"\
             "  -stb <tulip bins> (4 to 1024, 1024 approximates full angular)\n"\
+            "  -stt <threads> number of threads to run the analysis on (only for Tulip, 0 for all cores)\n"\
             "  -swa <map attribute name> perform weighted analysis using this attribute (only for Tulip)\n";
 }
 
@@ -131,6 +132,15 @@ void SegmentParser::parse(int argc, char **argv)
                 throw CommandLineException(std::string("-stb must be a number between 4 and 1024, got ") + argv[i]);
             }
         }
+        else if (std::strcmp(argv[i], "-stt") == 0)
+        {
+            ENFORCE_ARGUMENT("-stt", i)
+            if (!has_only_digits(argv[i]))
+            {
+                throw CommandLineException(std::string("-stt must be a number >=0, got ") + argv[i]);
+            }
+            m_threads = std::atoi(argv[i]);
+        }
         else if (std::strcmp(argv[i], "-swa") == 0)
         {
             ENFORCE_ARGUMENT("-swa", i)
@@ -163,6 +173,11 @@ void SegmentParser::parse(int argc, char **argv)
     {
         throw CommandLineException("-stb, -srt and -sic can only be used with tulip analysis");
     }
+
+    if (getAnalysisType() != AnalysisType::ANGULAR_TULIP && getThreads() != 1)
+    {
+        throw CommandLineException("-stt can only be used with tulip analysis");
+    }
 }
 
 void SegmentParser::run(const CommandLineParser &clp, IPerformanceSink &perfWriter) const
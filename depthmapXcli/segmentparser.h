@@ -53,6 +53,8 @@ public:
 
     int getTulipBins() const { return m_tulipBins; }
 
+    int getThreads() const { return m_threads; }
+
     const std::vector<double> getRadii() const { return m_radii;}
 
     const std::string getAttribute() const { return m_attribute;}
@@ -62,6 +64,7 @@ private:
     RadiusType m_radiusType;
     bool m_includeChoice;
     int m_tulipBins;
+    int m_threads;
     std::vector<double> m_radii;
     std::string m_attribute;
 };
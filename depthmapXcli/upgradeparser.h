@@ -0,0 +1,46 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "imodeparser.h"
+
+class UpgradeParser : public IModeParser
+{
+public:
+    UpgradeParser() : m_recursive(false)
+    {}
+
+    // IModeParser interface
+public:
+    std::string getModeName() const
+    {
+        return "UPGRADE";
+    }
+
+    std::string getHelp() const
+    {
+        return  "Mode options for UPGRADE (graph files saved by older versions):\n"\
+                "  -f can be a graph file or a directory. For a directory every .graph file\n"\
+                "     in it is upgraded and written with the same name into the -o directory\n"\
+                "  -ur Also upgrade the graph files in the subdirectories of the -f directory\n"\
+                "      (the subdirectories are made again under the -o directory)\n\n";
+    }
+    void parse(int argc, char **argv);
+    void run(const CommandLineParser &clp, IPerformanceSink &perfWriter) const;
+
+    bool isRecursive() const { return m_recursive; }
+
+private:
+    bool m_recursive;
+};
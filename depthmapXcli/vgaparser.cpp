@@ -23,7 +23,7 @@
 using namespace depthmapX;
 
 
-VgaParser::VgaParser() : m_vgaMode(VgaMode::NONE), m_localMeasures(false), m_globalMeasures(false)
+VgaParser::VgaParser() : m_vgaMode(VgaMode::NONE), m_localMeasures(false), m_globalMeasures(false), m_threads(1)
 {}
 
 void VgaParser::parse(int argc, char *argv[])
@@ -76,6 +76,15 @@ void VgaParser::parse(int argc, char *argv[])
             ENFORCE_ARGUMENT("-vr", i)
             m_radius = argv[i];
         }
+        else if (std::strcmp(argv[i], "-vt") == 0)
+        {
+            ENFORCE_ARGUMENT("-vt", i)
+            if (!has_only_digits(argv[i]))
+            {
+                throw CommandLineException(std::string("-vt must be a number >=0, got ") + argv[i]);
+            }
+            m_threads = std::atoi(argv[i]);
+        }
         ++i;
     }
 
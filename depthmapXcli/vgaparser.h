@@ -33,7 +33,8 @@ public:
                   "-vm <vga mode> one of isovist, visiblity, metric, angular, thruvision\n"\
                   "-vg turn on global measures for visibility, requires radius between 1 and 99 or n\n"\
                   "-vl turn on local measures for visibility\n"\
-                  "-vr set visibility radius\n";
+                  "-vr set visibility radius\n"\
+                  "-vt <threads> number of threads to use for isovist, local visibility, metric and angular analysis (0 for all cores, default 1)\n";
     }
 
 public:
@@ -55,11 +56,13 @@ public:
     bool localMeasures() const { return m_localMeasures; }
     bool globalMeasures() const { return m_globalMeasures; }
     const std::string & getRadius() const { return m_radius; }
+    int getThreads() const { return m_threads; }
 private:
     // vga options
     VgaMode m_vgaMode;
     bool m_localMeasures;
     bool m_globalMeasures;
     std::string m_radius;
+    int m_threads;
 };
 
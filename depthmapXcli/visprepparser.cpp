@@ -123,6 +123,15 @@ void VisPrepParser::parse(int argc, char ** argv)
         {
             m_removeLinksWhenUnmaking = true;
         }
+        else if ( std::strcmp("-pt", argv[i]) == 0 )
+        {
+            ENFORCE_ARGUMENT("-pt", i)
+            if (!has_only_digits(argv[i]))
+            {
+                throw CommandLineException(std::string("-pt must be a number >=0, got ") + argv[i]);
+            }
+            m_threads = std::atoi(argv[i]);
+        }
     }
 
     if(!getMakeGraph() && !getUnmakeGraph() && m_grid <= 0 && pointFile.empty() && points.empty())
@@ -173,5 +182,5 @@ void VisPrepParser::parse(int argc, char ** argv)
 
 void VisPrepParser::run(const CommandLineParser &clp, IPerformanceSink &perfWriter) const
 {
-    dm_runmethods::runVisualPrep(clp, m_grid, m_fillPoints, m_maxVisibility, m_boundaryGraph, m_makeGraph, m_unmakeGraph, m_removeLinksWhenUnmaking, perfWriter);
+    dm_runmethods::runVisualPrep(clp, m_grid, m_fillPoints, m_maxVisibility, m_boundaryGraph, m_makeGraph, m_unmakeGraph, m_removeLinksWhenUnmaking, m_threads, perfWriter);
 }
@@ -22,7 +22,7 @@
 class VisPrepParser : public IModeParser
 {
 public:
-    VisPrepParser() : m_grid(-1.0), m_maxVisibility(-1.0), m_boundaryGraph(false), m_makeGraph(false), m_unmakeGraph(false), m_removeLinksWhenUnmaking(false)
+    VisPrepParser() : m_grid(-1.0), m_maxVisibility(-1.0), m_boundaryGraph(false), m_makeGraph(false), m_unmakeGraph(false), m_removeLinksWhenUnmaking(false), m_threads(1)
     {}
 
     virtual std::string getModeName() const
@@ -41,7 +41,8 @@ public:
                "  -pb Make boundary graph\n" \
                "  -pm Make graph\n" \
                "  -pu Unmake graph\n" \
-               "  -pl Remove links when unmaking\n";
+               "  -pl Remove links when unmaking\n" \
+               "  -pt <threads> Number of threads to make the graph with (0 for all cores, default 1)\n";
     }
 
     virtual void parse(int argc, char** argv);
@@ -55,6 +56,7 @@ public:
     bool getMakeGraph() const { return m_makeGraph; }
     bool getUnmakeGraph() const { return m_unmakeGraph; }
     bool getRemoveLinksWhenUnmaking() const { return m_removeLinksWhenUnmaking; }
+    int getThreads() const { return m_threads; }
 
 private:
     double m_grid;
@@ -64,6 +66,7 @@ private:
     bool m_makeGraph;
     bool m_unmakeGraph;
     bool m_removeLinksWhenUnmaking;
+    int m_threads;
 };
 
 
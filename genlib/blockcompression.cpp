@@ -0,0 +1,322 @@
+// genlib - a component of the depthmapX - spatial network analysis platform
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "blockcompression.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace depthmapX {
+
+    namespace blockcodec {
+
+        // Blocks are in the LZ4 block format, so the reference lz4 library can read them.
+        // A sequence is a token byte with the number of literals in the high nibble and
+        // the match length less MIN_MATCH in the low one, where 15 in either means that
+        // more of the length follows in bytes of 255 and a last byte below 255. Then come
+        // the literals and, unless the block ends with them, the two byte offset of the match
+        // and the rest of the match length. As LZ4 requires, the last match starts at least
+        // MATCH_LIMIT bytes before the end of the block and the last LAST_LITERALS bytes
+        // are always literals
+        const size_t MIN_MATCH = 4;
+        const size_t MAX_OFFSET = 65535;
+        const size_t MATCH_LIMIT = 12;
+        const size_t LAST_LITERALS = 5;
+        const int HASH_BITS = 16;
+
+        static uint32_t read32(const char *p) {
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        static uint32_t hash(uint32_t sequence) { return (sequence * 2654435761u) >> (32 - HASH_BITS); }
+
+        static void writeLength(std::vector<char> &out, size_t length) {
+            while (length >= 255) {
+                out.push_back(char(255));
+                length -= 255;
+            }
+            out.push_back(char(length));
+        }
+
+        // matchLength is 0 for the literals at the end of the block
+        static void writeSequence(std::vector<char> &out, const char *literals, size_t literalCount, size_t offset,
+                                  size_t matchLength) {
+            size_t literalNibble = std::min(literalCount, size_t(15));
+            size_t matchNibble = matchLength == 0 ? 0 : std::min(matchLength - MIN_MATCH, size_t(15));
+            out.push_back(char((literalNibble << 4) | matchNibble));
+            if (literalNibble == 15) {
+                writeLength(out, literalCount - 15);
+            }
+            out.insert(out.end(), literals, literals + literalCount);
+            if (matchLength != 0) {
+                out.push_back(char(offset & 0xff));
+                out.push_back(char(offset >> 8));
+                if (matchNibble == 15) {
+                    writeLength(out, matchLength - MIN_MATCH - 15);
+                }
+            }
+        }
+
+        void compress(const char *data, size_t size, std::vector<char> &out) {
+            // the last position each hash was seen at, plus one so that 0 is empty
+            std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+            size_t anchor = 0;
+            size_t pos = 0;
+            while (size > MATCH_LIMIT && pos <= size - MATCH_LIMIT) {
+                uint32_t sequence = read32(data + pos);
+                uint32_t &entry = table[hash(sequence)];
+                size_t candidate = entry;
+                entry = uint32_t(pos + 1);
+                if (candidate != 0 && pos - (candidate - 1) <= MAX_OFFSET && read32(data + candidate - 1) == sequence) {
+                    size_t match = candidate - 1;
+                    size_t length = MIN_MATCH;
+                    while (pos + length < size - LAST_LITERALS && data[match + length] == data[pos + length]) {
+                        length++;
+                    }
+                    writeSequence(out, data + anchor, pos - anchor, pos - match, length);
+                    pos += length;
+                    anchor = pos;
+                } else {
+                    pos++;
+                }
+            }
+            // the last sequence is only literals, and there is always one, even for no data
+            writeSequence(out, data + anchor, size - anchor, 0, 0);
+        }
+
+        static bool readLength(const unsigned char *data, size_t compressedSize, size_t &ip, size_t &length) {
+            unsigned char byte;
+            do {
+                if (ip >= compressedSize) {
+                    return false;
+                }
+                byte = data[ip++];
+                length += byte;
+            } while (byte == 255);
+            return true;
+        }
+
+        bool decompress(const char *compressed, size_t compressedSize, char *out, size_t size) {
+            const unsigned char *data = reinterpret_cast<const unsigned char *>(compressed);
+            size_t ip = 0;
+            size_t op = 0;
+            while (ip < compressedSize) {
+                unsigned char token = data[ip++];
+                size_t literalCount = token >> 4;
+                if (literalCount == 15 && !readLength(data, compressedSize, ip, literalCount)) {
+                    return false;
+                }
+                if (literalCount > compressedSize - ip || literalCount > size - op) {
+                    return false;
+                }
+                std::memcpy(out + op, data + ip, literalCount);
+                ip += literalCount;
+                op += literalCount;
+                if (ip == compressedSize) {
+                    break;
+                }
+
+                if (compressedSize - ip < 2) {
+                    return false;
+                }
+                size_t offset = size_t(data[ip]) | (size_t(data[ip + 1]) << 8);
+                ip += 2;
+                size_t matchLength = token & 15;
+                if (matchLength == 15 && !readLength(data, compressedSize, ip, matchLength)) {
+                    return false;
+                }
+                matchLength += MIN_MATCH;
+                if (offset == 0 || offset > op || matchLength > size - op) {
+                    return false;
+                }
+                if (offset >= matchLength) {
+                    std::memcpy(out + op, out + op - offset, matchLength);
+                } else {
+                    // the match overlaps itself, which repeats the last offset bytes
+                    for (size_t i = 0; i < matchLength; i++) {
+                        out[op + i] = out[op + i - offset];
+                    }
+                }
+                op += matchLength;
+            }
+            return op == size;
+        }
+    } // namespace blockcodec
+
+    // "grz", the format version and the block size
+    static const size_t HEADER_SIZE = 3 + sizeof(int) + sizeof(uint32_t);
+    static const size_t BLOCK_SIZE_OFFSET = 3 + sizeof(int);
+    // the size and the compressed size
+    static const size_t BLOCK_HEADER_SIZE = 2 * sizeof(uint32_t);
+    static const size_t NO_BLOCK = size_t(-1);
+
+    BlockCompressedWriteBuf::BlockCompressedWriteBuf(std::ostream &out, uint32_t blockSize)
+        : m_out(out), m_block(blockSize) {
+        int version = blockstream::FORMAT_VERSION;
+        m_out.write(blockstream::MAGIC, 3);
+        m_out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+        m_out.write(reinterpret_cast<const char *>(&blockSize), sizeof(blockSize));
+        setp(m_block.data(), m_block.data() + m_block.size());
+    }
+
+    BlockCompressedWriteBuf::~BlockCompressedWriteBuf() { writeBlock(); }
+
+    void BlockCompressedWriteBuf::writeBlock() {
+        uint32_t size = uint32_t(pptr() - pbase());
+        if (size == 0) {
+            return;
+        }
+        m_compressed.clear();
+        blockcodec::compress(pbase(), size, m_compressed);
+        // blocks that do not get any smaller are stored as they are
+        const char *stored = pbase();
+        uint32_t storedSize = size;
+        if (m_compressed.size() < size) {
+            stored = m_compressed.data();
+            storedSize = uint32_t(m_compressed.size());
+        }
+        m_out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+        m_out.write(reinterpret_cast<const char *>(&storedSize), sizeof(storedSize));
+        m_out.write(stored, storedSize);
+        setp(m_block.data(), m_block.data() + m_block.size());
+    }
+
+    BlockCompressedWriteBuf::int_type BlockCompressedWriteBuf::overflow(int_type ch) {
+        writeBlock();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return m_out.good() ? traits_type::not_eof(ch) : traits_type::eof();
+    }
+
+    int BlockCompressedWriteBuf::sync() {
+        writeBlock();
+        return m_out.good() ? 0 : -1;
+    }
+
+    BlockCompressedReadBuf::BlockCompressedReadBuf(const char *data, size_t size)
+        : m_data(data), m_currentBlock(NO_BLOCK) {
+        m_blockStarts.push_back(0);
+        setg(nullptr, nullptr, nullptr);
+        if (!blockstream::isCompressed(data, size) || size < HEADER_SIZE) {
+            return;
+        }
+        int version;
+        std::memcpy(&version, data + 3, sizeof(version));
+        if (version != blockstream::FORMAT_VERSION) {
+            return;
+        }
+        uint32_t maxBlockSize;
+        std::memcpy(&maxBlockSize, data + BLOCK_SIZE_OFFSET, sizeof(maxBlockSize));
+        size_t pos = HEADER_SIZE;
+        while (pos < size) {
+            uint32_t blockSize, storedSize;
+            if (size - pos < BLOCK_HEADER_SIZE) {
+                return;
+            }
+            std::memcpy(&blockSize, data + pos, sizeof(blockSize));
+            std::memcpy(&storedSize, data + pos + sizeof(blockSize), sizeof(storedSize));
+            // no block is bigger than the block size the stream was written with, so a
+            // damaged size can not ask for more memory than that when the block is read,
+            // and none is empty, as an empty block would leave nothing to read
+            if (blockSize == 0 || blockSize > maxBlockSize || storedSize > blockSize ||
+                storedSize > size - pos - BLOCK_HEADER_SIZE) {
+                return;
+            }
+            m_blockData.push_back(pos);
+            m_blockStarts.push_back(m_blockStarts.back() + blockSize);
+            pos += BLOCK_HEADER_SIZE + storedSize;
+        }
+        m_valid = true;
+    }
+
+    bool BlockCompressedReadBuf::loadBlock(size_t block) {
+        const char *header = m_data + m_blockData[block];
+        uint32_t blockSize, storedSize;
+        std::memcpy(&blockSize, header, sizeof(blockSize));
+        std::memcpy(&storedSize, header + sizeof(blockSize), sizeof(storedSize));
+        const char *stored = header + BLOCK_HEADER_SIZE;
+        char *begin;
+        if (storedSize == blockSize) {
+            // read a stored block straight out of the data, it is never written to
+            begin = const_cast<char *>(stored);
+        } else {
+            m_buffer.resize(blockSize);
+            if (!blockcodec::decompress(stored, storedSize, m_buffer.data(), blockSize)) {
+                m_currentBlock = NO_BLOCK;
+                setg(nullptr, nullptr, nullptr);
+                return false;
+            }
+            begin = m_buffer.data();
+        }
+        m_currentBlock = block;
+        setg(begin, begin, begin + blockSize);
+        return true;
+    }
+
+    BlockCompressedReadBuf::int_type BlockCompressedReadBuf::underflow() {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        if (!m_valid) {
+            return traits_type::eof();
+        }
+        // move on past any block that leaves nothing to read
+        do {
+            size_t next = m_currentBlock == NO_BLOCK ? 0 : m_currentBlock + 1;
+            if (next >= m_blockData.size() || !loadBlock(next)) {
+                return traits_type::eof();
+            }
+        } while (gptr() == egptr());
+        return traits_type::to_int_type(*gptr());
+    }
+
+    BlockCompressedReadBuf::pos_type BlockCompressedReadBuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                                     std::ios_base::openmode which) {
+        if (!m_valid || !(which & std::ios_base::in)) {
+            return pos_type(off_type(-1));
+        }
+        off_type base = 0;
+        if (dir == std::ios_base::cur) {
+            base = m_currentBlock == NO_BLOCK ? 0 : off_type(m_blockStarts[m_currentBlock]) + (gptr() - eback());
+        } else if (dir == std::ios_base::end) {
+            base = off_type(size());
+        }
+        off_type position = base + off;
+        if (position < 0 || uint64_t(position) > size()) {
+            return pos_type(off_type(-1));
+        }
+        if (m_blockData.empty()) {
+            return pos_type(position);
+        }
+        // the block holding the position, or the last block for the end of the stream
+        size_t block = size_t(std::upper_bound(m_blockStarts.begin(), m_blockStarts.end(), uint64_t(position)) -
+                              m_blockStarts.begin()) -
+                       1;
+        block = std::min(block, m_blockData.size() - 1);
+        if (block != m_currentBlock && !loadBlock(block)) {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), eback() + (position - off_type(m_blockStarts[block])), egptr());
+        return pos_type(position);
+    }
+
+    BlockCompressedReadBuf::pos_type BlockCompressedReadBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+} // namespace depthmapX
@@ -0,0 +1,102 @@
+// genlib - a component of the depthmapX - spatial network analysis platform
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace depthmapX {
+
+    // A compressor and decompressor for the LZ4 block format: each sequence is a run of
+    // literal bytes followed by a copy of up to 64KB back in the block, which is quick to
+    // undo and does well on the long repeated runs of graph files. Blocks written here can
+    // be read by the lz4 library and the other way round, so the codec could be swapped
+    // for it without changing the file format
+    namespace blockcodec {
+        // appends the compressed form of the block to out
+        void compress(const char *data, size_t size, std::vector<char> &out);
+        // returns false if the compressed data is damaged or does not give exactly size bytes
+        bool decompress(const char *data, size_t compressedSize, char *out, size_t size);
+    } // namespace blockcodec
+
+    // A stream cut into blocks that are compressed one by one, so that a reader can find
+    // any position by decompressing a single block. The stream starts with the magic
+    // "grz", a format version and the block size, then every block is its size, its
+    // compressed size (equal to the size where it is stored as it is) and its data
+    namespace blockstream {
+        const char MAGIC[3] = {'g', 'r', 'z'};
+        const int FORMAT_VERSION = 1;
+        const uint32_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+        // true if the data starts with the magic of a block compressed stream
+        inline bool isCompressed(const char *data, size_t size) {
+            return size >= 3 && data[0] == MAGIC[0] && data[1] == MAGIC[1] && data[2] == MAGIC[2];
+        }
+    } // namespace blockstream
+
+    // Writes a block compressed stream to out. Flushing the stream ends the current block
+    // early, use that to start a part of the stream that a reader may want to seek to on
+    // a new block. The last block is written when the buffer is destroyed
+    class BlockCompressedWriteBuf : public std::streambuf {
+      public:
+        explicit BlockCompressedWriteBuf(std::ostream &out, uint32_t blockSize = blockstream::DEFAULT_BLOCK_SIZE);
+        ~BlockCompressedWriteBuf() override;
+        BlockCompressedWriteBuf(const BlockCompressedWriteBuf &) = delete;
+        BlockCompressedWriteBuf &operator=(const BlockCompressedWriteBuf &) = delete;
+
+      protected:
+        int_type overflow(int_type ch) override;
+        int sync() override;
+
+      private:
+        std::ostream &m_out;
+        std::vector<char> m_block;
+        std::vector<char> m_compressed;
+        void writeBlock();
+    };
+
+    // Reads a block compressed stream held in memory (usually a MemoryMappedFile). The
+    // block headers are indexed when the buffer is made and a block is only decompressed
+    // when something in it is read, so seeking past blocks costs nothing. isValid() is
+    // false if the data is not a block compressed stream, and a damaged block reads as the
+    // end of the stream
+    class BlockCompressedReadBuf : public std::streambuf {
+      public:
+        BlockCompressedReadBuf(const char *data, size_t size);
+
+        bool isValid() const { return m_valid; }
+        // the size of the stream once decompressed
+        uint64_t size() const { return m_blockStarts.back(); }
+
+      protected:
+        int_type underflow() override;
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+      private:
+        bool m_valid = false;
+        const char *m_data;
+        // where each block starts in the data and in the decompressed stream (the last
+        // entry of m_blockStarts is the size of the stream)
+        std::vector<size_t> m_blockData;
+        std::vector<uint64_t> m_blockStarts;
+        size_t m_currentBlock;
+        std::vector<char> m_buffer;
+        bool loadBlock(size_t block);
+    };
+} // namespace depthmapX
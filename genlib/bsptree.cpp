@@ -180,3 +180,55 @@ BSPTree::makeLines(Communicator *, time_t, const std::vector<TaggedLine> &lines,
 
     return std::make_pair(leftlines, rightlines);
 }
+
+/* Copies the tree under root into a FlatBSPTree. Nodes are numbered in pre-order
+ * (node, left subtree, right subtree), again without recursion so that deep trees
+ * can be flattened. The bounds of every subtree are gathered afterwards.
+ */
+
+FlatBSPTree BSPTree::flatten(const BSPNode &root) {
+    FlatBSPTree tree;
+
+    struct Pending {
+        const BSPNode *node;
+        int parent;
+        bool right;
+    };
+    std::stack<Pending> nodeStack;
+    nodeStack.push(Pending{&root, -1, false});
+
+    while (!nodeStack.empty()) {
+        Pending pending = nodeStack.top();
+        nodeStack.pop();
+
+        int index = static_cast<int>(tree.nodes.size());
+        const Line &line = pending.node->getLine();
+        tree.nodes.push_back(FlatBSPTree::Node{line, pending.node->getTag(), -1, -1, QtRegion(line.start(), line.start())});
+        tree.nodes.back().bounds.encompass(line.end());
+        if (pending.parent != -1) {
+            FlatBSPTree::Node &parent = tree.nodes[static_cast<size_t>(pending.parent)];
+            (pending.right ? parent.right : parent.left) = index;
+        }
+        // the right is pushed first so that the left subtree is copied first
+        if (pending.node->m_right) {
+            nodeStack.push(Pending{pending.node->m_right.get(), index, true});
+        }
+        if (pending.node->m_left) {
+            nodeStack.push(Pending{pending.node->m_left.get(), index, false});
+        }
+    }
+
+    // children always come after their parent, so going backwards each subtree is complete before its parent
+    for (size_t i = tree.nodes.size(); i-- > 0;) {
+        FlatBSPTree::Node &node = tree.nodes[i];
+        for (int child : {node.left, node.right}) {
+            if (child != -1) {
+                const QtRegion &childBounds = tree.nodes[static_cast<size_t>(child)].bounds;
+                node.bounds.encompass(childBounds.bottom_left);
+                node.bounds.encompass(childBounds.top_right);
+            }
+        }
+    }
+
+    return tree;
+}
@@ -20,6 +20,7 @@
 #include "genlib/p2dpoly.h"
 
 #include <memory>
+#include <vector>
 
 // Binary Space Partition
 
@@ -40,10 +41,11 @@ struct BSPNode {
         m_tag = -1;
     }
     bool isLeaf() { return m_left == nullptr && m_right == nullptr; }
-    int classify(const Point2f &p) {
-        Point2f v0 = m_line.end() - m_line.start();
+    int classify(const Point2f &p) const { return classify(m_line, p); }
+    static int classify(const Line &line, const Point2f &p) {
+        Point2f v0 = line.end() - line.start();
         v0.normalise();
-        Point2f v1 = p - m_line.start();
+        Point2f v1 = p - line.start();
         v1.normalise();
         if (det(v0, v1) >= 0) {
             return BSPLEFT;
@@ -57,9 +59,28 @@ struct BSPNode {
     void setTag(const int tag) { m_tag = tag; }
 };
 
+// The same tree stored in one contiguous array with the root at index 0 and children
+// referenced by index (-1 when absent). It is never modified once made, so several
+// threads can walk it at the same time. Each node also keeps the bounding box of its
+// own line and all the lines below it, so that a walk can skip whole subtrees.
+
+struct FlatBSPTree {
+    struct Node {
+        Line line;
+        int tag;
+        int left;
+        int right;
+        QtRegion bounds;
+        int classify(const Point2f &p) const { return BSPNode::classify(line, p); }
+    };
+    std::vector<Node> nodes;
+    bool empty() const { return nodes.empty(); }
+};
+
 namespace BSPTree {
     void make(Communicator *communicator, time_t atime, const std::vector<TaggedLine> &lines, BSPNode *root);
     int pickMidpointLine(const std::vector<TaggedLine> &lines, BSPNode *par);
     std::pair<std::vector<TaggedLine>, std::vector<TaggedLine>>
     makeLines(Communicator *communicator, time_t atime, const std::vector<TaggedLine> &lines, BSPNode *base);
+    FlatBSPTree flatten(const BSPNode &root);
 } // namespace BSPTree
@@ -0,0 +1,123 @@
+// genlib - a component of the depthmapX - spatial network analysis platform
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "memorymappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace depthmapX {
+
+#ifdef _WIN32
+    MemoryMappedFile::MemoryMappedFile(const std::string &filename) {
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            return;
+        }
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            CloseHandle(file);
+            return;
+        }
+        void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == NULL) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return;
+        }
+        m_file = file;
+        m_mapping = mapping;
+        m_data = static_cast<const char *>(data);
+        m_size = size_t(size.QuadPart);
+    }
+
+    MemoryMappedFile::~MemoryMappedFile() {
+        if (m_data != nullptr) {
+            UnmapViewOfFile(m_data);
+            CloseHandle(m_mapping);
+            CloseHandle(m_file);
+        }
+    }
+#else
+    MemoryMappedFile::MemoryMappedFile(const std::string &filename) {
+        int file = open(filename.c_str(), O_RDONLY);
+        if (file == -1) {
+            return;
+        }
+        struct stat status;
+        if (fstat(file, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size == 0) {
+            close(file);
+            return;
+        }
+        void *data = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        // the mapping stays valid after the file is closed
+        close(file);
+        if (data == MAP_FAILED) {
+            return;
+        }
+        // the file is mostly read from start to end
+        madvise(data, size_t(status.st_size), MADV_SEQUENTIAL);
+        m_data = static_cast<const char *>(data);
+        m_size = size_t(status.st_size);
+    }
+
+    MemoryMappedFile::~MemoryMappedFile() {
+        if (m_data != nullptr) {
+            munmap(const_cast<char *>(m_data), m_size);
+        }
+    }
+#endif
+
+    MemoryStreamBuf::MemoryStreamBuf(const char *data, size_t size) {
+        // the get area is never written to, streambuf only wants a char *
+        char *begin = const_cast<char *>(data);
+        setg(begin, begin, begin + size);
+    }
+
+    MemoryStreamBuf::pos_type MemoryStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                       std::ios_base::openmode which) {
+        if (!(which & std::ios_base::in)) {
+            return pos_type(off_type(-1));
+        }
+        off_type base = 0;
+        if (dir == std::ios_base::cur) {
+            base = gptr() - eback();
+        } else if (dir == std::ios_base::end) {
+            base = egptr() - eback();
+        }
+        off_type position = base + off;
+        if (position < 0 || position > egptr() - eback()) {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), eback() + position, egptr());
+        return pos_type(position);
+    }
+
+    MemoryStreamBuf::pos_type MemoryStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+} // namespace depthmapX
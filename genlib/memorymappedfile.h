@@ -0,0 +1,59 @@
+// genlib - a component of the depthmapX - spatial network analysis platform
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <streambuf>
+#include <string>
+
+namespace depthmapX {
+
+    // A whole file mapped read-only into memory. The operating system pages the file in as
+    // it is read, so nothing is copied up front and skipping over a part of the file costs
+    // nothing. isOpen() is false if the file could not be mapped (it does not exist, is
+    // empty or the platform has no mapping), in which case the caller should fall back to
+    // reading the file through a std::ifstream
+    class MemoryMappedFile {
+      public:
+        explicit MemoryMappedFile(const std::string &filename);
+        ~MemoryMappedFile();
+        MemoryMappedFile(const MemoryMappedFile &) = delete;
+        MemoryMappedFile &operator=(const MemoryMappedFile &) = delete;
+
+        bool isOpen() const { return m_data != nullptr; }
+        const char *data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+      private:
+        const char *m_data = nullptr;
+        size_t m_size = 0;
+#ifdef _WIN32
+        void *m_file = nullptr;
+        void *m_mapping = nullptr;
+#endif
+    };
+
+    // A read-only streambuf over a block of memory, to read a MemoryMappedFile through a
+    // std::istream. Reads copy straight out of the block and seeks only move the position
+    class MemoryStreamBuf : public std::streambuf {
+      public:
+        MemoryStreamBuf(const char *data, size_t size);
+
+      protected:
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+    };
+} // namespace depthmapX
@@ -0,0 +1,185 @@
+// genlib - a component of the depthmapX - spatial network analysis platform
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "genlib/p2dpoly.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+namespace depthmapX {
+
+    // A static R-tree over a set of bounding boxes, bulk loaded once with the
+    // Sort-Tile-Recursive method: the boxes are sorted into vertical slices by the x of
+    // their centre, each slice is sorted by the y of the centre and runs of NODE_SIZE
+    // boxes make up the leaves. The levels above group runs of NODE_SIZE consecutive
+    // nodes of the level below, which keeps neighbouring leaves together.
+    // All the levels are kept in one array, leaves first and the root last, so a node
+    // finds its children by position and there are no pointers to follow.
+    // The tree cannot be changed after it is built, make a new one instead.
+    class PackedRTree {
+      public:
+        static const size_t NODE_SIZE = 16;
+
+        PackedRTree() {}
+        // item i of the tree is the box at position i
+        explicit PackedRTree(const std::vector<QtRegion> &boxes) {
+            m_itemCount = boxes.size();
+            if (boxes.empty()) {
+                return;
+            }
+            std::vector<size_t> order(boxes.size());
+            for (size_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+            auto centreX = [&](size_t i) { return boxes[i].bottom_left.x + boxes[i].top_right.x; };
+            auto centreY = [&](size_t i) { return boxes[i].bottom_left.y + boxes[i].top_right.y; };
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return centreX(a) < centreX(b); });
+            size_t leafCount = (boxes.size() + NODE_SIZE - 1) / NODE_SIZE;
+            size_t sliceSize = size_t(std::ceil(std::sqrt(double(leafCount)))) * NODE_SIZE;
+            for (size_t start = 0; start < order.size(); start += sliceSize) {
+                auto end = order.begin() + long(std::min(start + sliceSize, order.size()));
+                std::stable_sort(order.begin() + long(start), end,
+                                 [&](size_t a, size_t b) { return centreY(a) < centreY(b); });
+            }
+
+            m_items = order;
+            m_boxes.reserve(boxes.size() + boxes.size() / (NODE_SIZE - 1) + 1);
+            for (size_t item : order) {
+                m_boxes.push_back(boxes[item]);
+            }
+            m_levelEnds.push_back(m_boxes.size());
+            size_t levelStart = 0;
+            while (m_boxes.size() - levelStart > 1) {
+                size_t levelEnd = m_boxes.size();
+                for (size_t child = levelStart; child < levelEnd; child += NODE_SIZE) {
+                    QtRegion box = m_boxes[child];
+                    for (size_t next = child + 1; next < std::min(child + NODE_SIZE, levelEnd); next++) {
+                        box = runion(box, m_boxes[next]);
+                    }
+                    m_boxes.push_back(box);
+                }
+                m_levelEnds.push_back(m_boxes.size());
+                levelStart = levelEnd;
+            }
+        }
+
+        bool empty() const { return m_itemCount == 0; }
+        size_t size() const { return m_itemCount; }
+        const QtRegion &getBounds() const { return m_boxes.back(); }
+
+        // calls visit(item) for every item with a box that touches the region (grown by the
+        // tolerance), in no particular order
+        template <typename Visit> void search(const QtRegion &region, Visit visit, double tolerance = 0.0) const {
+            if (empty()) {
+                return;
+            }
+            // every level leaves at most NODE_SIZE - 1 siblings on the stack, and a tree
+            // with more than 16 levels would not fit in memory
+            size_t stack[NODE_SIZE * 16];
+            size_t stackSize = 0;
+            stack[stackSize++] = m_boxes.size() - 1;
+            while (stackSize != 0) {
+                size_t node = stack[--stackSize];
+                if (!intersect_region(m_boxes[node], region, tolerance)) {
+                    continue;
+                }
+                if (node < m_levelEnds[0]) {
+                    visit(m_items[node]);
+                } else {
+                    size_t level = levelOf(node);
+                    size_t childStart = levelStart(level - 1) + (node - levelStart(level)) * NODE_SIZE;
+                    size_t childEnd = std::min(childStart + NODE_SIZE, m_levelEnds[level - 1]);
+                    for (size_t child = childStart; child < childEnd; child++) {
+                        stack[stackSize++] = child;
+                    }
+                }
+            }
+        }
+
+        // returns the item for which distance(item) is smallest, or -1 if distance(item)
+        // is negative for every item (use that to leave items out). distance(item) must never
+        // be less than the distance from the point to the box of the item. Where two items are
+        // equally close the one with the lower number is returned
+        template <typename Distance> int nearest(const Point2f &p, Distance distance) const {
+            if (empty()) {
+                return -1;
+            }
+            // entries are (distance, node) for a box or (distance, -1 - item) for an item
+            typedef std::pair<double, long> Entry;
+            std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+            queue.push(Entry(boxDistance(m_boxes.back(), p), long(m_boxes.size() - 1)));
+            int best = -1;
+            double bestDistance = 0.0;
+            while (!queue.empty()) {
+                Entry entry = queue.top();
+                if (best != -1 && entry.first > bestDistance) {
+                    break;
+                }
+                queue.pop();
+                if (entry.second < 0) {
+                    int item = int(-1 - entry.second);
+                    if (best == -1 || entry.first < bestDistance || item < best) {
+                        best = item;
+                        bestDistance = entry.first;
+                    }
+                    continue;
+                }
+                size_t node = size_t(entry.second);
+                if (node < m_levelEnds[0]) {
+                    double d = distance(m_items[node]);
+                    if (d >= 0.0) {
+                        queue.push(Entry(d, -1 - long(m_items[node])));
+                    }
+                } else {
+                    size_t level = levelOf(node);
+                    size_t childStart = levelStart(level - 1) + (node - levelStart(level)) * NODE_SIZE;
+                    size_t childEnd = std::min(childStart + NODE_SIZE, m_levelEnds[level - 1]);
+                    for (size_t child = childStart; child < childEnd; child++) {
+                        queue.push(Entry(boxDistance(m_boxes[child], p), long(child)));
+                    }
+                }
+            }
+            return best;
+        }
+
+        static double boxDistance(const QtRegion &box, const Point2f &p) {
+            double dx = std::max(std::max(box.bottom_left.x - p.x, p.x - box.top_right.x), 0.0);
+            double dy = std::max(std::max(box.bottom_left.y - p.y, p.y - box.top_right.y), 0.0);
+            return std::sqrt(dx * dx + dy * dy);
+        }
+
+      private:
+        size_t m_itemCount = 0;
+        // the boxes of all the levels, leaves first
+        std::vector<QtRegion> m_boxes;
+        // the item of each leaf box
+        std::vector<size_t> m_items;
+        // the position after the last box of each level
+        std::vector<size_t> m_levelEnds;
+
+        size_t levelStart(size_t level) const { return level == 0 ? 0 : m_levelEnds[level - 1]; }
+        size_t levelOf(size_t node) const {
+            size_t level = 0;
+            while (node >= m_levelEnds[level]) {
+                level++;
+            }
+            return level;
+        }
+    };
+} // namespace depthmapX
@@ -53,6 +53,50 @@ unsigned int pafrand(int set) // = 0
     return (unsigned int)((g_rand[set] >> 32) & PAF_RAND_MAX);
 }
 
+uint64_t pafrandstate(int set) // = 0
+{
+    return g_rand[set];
+}
+
+void pafsetrandstate(uint64_t state, int set) // = 0
+{
+    g_rand[set] = state;
+}
+
+unsigned int pafrandnext(uint64_t &state)
+{
+    state = g_mult * state + g_const;
+
+    return (unsigned int)((state >> 32) & PAF_RAND_MAX);
+}
+
+// n steps of x -> a x + c are x -> A x + C, found by squaring the single step
+uint64_t pafrandskip(uint64_t state, uint64_t n)
+{
+    uint64_t mult = g_mult, add = g_const;
+    uint64_t total_mult = 1, total_add = 0;
+    while (n != 0) {
+        if (n & 1) {
+            total_mult = mult * total_mult;
+            total_add = mult * total_add + add;
+        }
+        add = (mult + 1) * add;
+        mult = mult * mult;
+        n >>= 1;
+    }
+    return total_mult * state + total_add;
+}
+
+// the splitmix64 mix of seed + (stream + 1) * golden ratio, which scatters neighbouring
+// streams across the period of the generator
+uint64_t pafrandstream(uint64_t seed, uint64_t stream)
+{
+    uint64_t z = seed + (stream + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 double poisson(int x, double lambda) {
@@ -27,6 +27,7 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 
 #ifndef M_PI
 #define M_PI 3.1415926535897932384626433832795
@@ -48,6 +49,18 @@ const unsigned int PAF_RAND_MAX = 0x0FFFFFFF;
 void pafsrand(unsigned int seed, int set = 0);
 unsigned int pafrand(int set = 0);
 
+// The generator state behind pafrand, so that a sequence can be continued elsewhere:
+// pafrandnext(state) returns what pafrand would and advances the state the same way,
+// and pafrandskip gives the state after n such calls without making them
+uint64_t pafrandstate(int set = 0);
+void pafsetrandstate(uint64_t state, int set = 0);
+unsigned int pafrandnext(uint64_t &state);
+uint64_t pafrandskip(uint64_t state, uint64_t n);
+// A state to start the stream-th of many independent pafrandnext sequences from, found
+// by hashing the seed and the stream number rather than by drawing, so any stream can be
+// started without the ones before it
+uint64_t pafrandstream(uint64_t seed, uint64_t stream);
+
 // a random number from 0 to 1
 inline double prandom(int set = 0) { return double(pafrand(set)) / double(PAF_RAND_MAX); }
 
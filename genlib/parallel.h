@@ -0,0 +1,235 @@
+// genlib - a component of the depthmapX - spatial network analysis platform
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "genlib/comm.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace depthmapX {
+
+    // A requested thread count of 0 (or less) means "use all available cores"
+    inline int resolveThreadCount(int requested) {
+        if (requested > 0)
+            return requested;
+        unsigned int available = std::thread::hardware_concurrency();
+        return available == 0 ? 1 : static_cast<int>(available);
+    }
+
+    // How parallelFor shares the items out between the workers
+    enum class Schedule {
+        // every worker starts on its own contiguous range of the items, so that neighbouring
+        // items (which tend to touch the same data) are done by the same worker, and once its
+        // range is done it takes the back half of the largest range another worker has left
+        STEAL,
+        // the items are handed out one at a time from the front, so that they are started in
+        // order, for callers that hold on to results until all the items before them are done
+        IN_ORDER
+    };
+
+    namespace detail {
+        // the items [begin, end) a worker has left
+        struct alignas(64) WorkRange {
+            std::mutex mutex;
+            size_t begin = 0;
+            size_t end = 0;
+        };
+
+        class WorkQueue {
+          public:
+            WorkQueue(size_t count, int nthreads, Schedule schedule)
+                : m_schedule(schedule), m_count(count), m_next(0) {
+                if (m_schedule == Schedule::STEAL) {
+                    m_ranges = std::vector<WorkRange>(static_cast<size_t>(nthreads));
+                    for (size_t i = 0; i < m_ranges.size(); i++) {
+                        m_ranges[i].begin = count * i / m_ranges.size();
+                        m_ranges[i].end = count * (i + 1) / m_ranges.size();
+                    }
+                }
+            }
+
+            // sets item to the next item for the worker, returns false once there are none left
+            bool next(int worker, size_t &item) {
+                if (m_schedule == Schedule::IN_ORDER) {
+                    item = m_next++;
+                    return item < m_count;
+                }
+                WorkRange &own = m_ranges[static_cast<size_t>(worker)];
+                {
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    if (own.begin < own.end) {
+                        item = own.begin++;
+                        return true;
+                    }
+                }
+                while (true) {
+                    size_t victim = m_ranges.size();
+                    size_t most = 0;
+                    for (size_t i = 0; i < m_ranges.size(); i++) {
+                        std::lock_guard<std::mutex> lock(m_ranges[i].mutex);
+                        if (m_ranges[i].end - m_ranges[i].begin > most) {
+                            most = m_ranges[i].end - m_ranges[i].begin;
+                            victim = i;
+                        }
+                    }
+                    if (most == 0) {
+                        return false;
+                    }
+                    size_t stolenBegin, stolenEnd;
+                    {
+                        std::lock_guard<std::mutex> lock(m_ranges[victim].mutex);
+                        size_t left = m_ranges[victim].end - m_ranges[victim].begin;
+                        if (left == 0) {
+                            // somebody else got there first
+                            continue;
+                        }
+                        stolenEnd = m_ranges[victim].end;
+                        stolenBegin = stolenEnd - (left + 1) / 2;
+                        m_ranges[victim].end = stolenBegin;
+                    }
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    own.begin = stolenBegin + 1;
+                    own.end = stolenEnd;
+                    item = stolenBegin;
+                    return true;
+                }
+            }
+
+          private:
+            Schedule m_schedule;
+            size_t m_count;
+            std::atomic<size_t> m_next;
+            std::vector<WorkRange> m_ranges;
+        };
+    } // namespace detail
+
+    // Calls task(worker, item) for every item in [0, count) where worker is in [0, nthreads).
+    // The items are shared out as set by the schedule, so the order in which they are processed
+    // is undefined and a task may only write to state owned by its worker or by its item.
+    // The calling thread does not process items itself when more than one thread is requested;
+    // instead it posts progress (the number of completed items) to the communicator and
+    // checks for cancellation, throwing Communicator::CancelledException once the workers
+    // have stopped. Exceptions thrown by a task are rethrown on the calling thread.
+    // With a single thread the items are processed in order on the calling thread.
+    template <typename Task>
+    void parallelFor(Communicator *comm, size_t count, int nthreads, Task task, Schedule schedule = Schedule::STEAL) {
+        time_t atime = 0;
+        if (comm) {
+            qtimer(atime, 0);
+        }
+
+        nthreads = resolveThreadCount(nthreads);
+        if (nthreads == 1 || count <= 1) {
+            for (size_t item = 0; item < count; item++) {
+                task(0, item);
+                if (comm && qtimer(atime, 500)) {
+                    if (comm->IsCancelled()) {
+                        throw Communicator::CancelledException();
+                    }
+                    comm->CommPostMessage(Communicator::CURRENT_RECORD, static_cast<int>(item + 1));
+                }
+            }
+            return;
+        }
+
+        detail::WorkQueue queue(count, nthreads, schedule);
+        std::atomic<size_t> completed(0);
+        std::atomic<bool> stop(false);
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+        int running = nthreads;
+
+        auto worker = [&](int index) {
+            try {
+                size_t item;
+                while (!stop && queue.next(index, item)) {
+                    task(index, item);
+                    completed++;
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                stop = true;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+            finished.notify_one();
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(static_cast<size_t>(nthreads));
+        for (int i = 0; i < nthreads; i++) {
+            threads.emplace_back(worker, i);
+        }
+
+        bool cancelled = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (running > 0) {
+                finished.wait_for(lock, std::chrono::milliseconds(100));
+                if (comm && !cancelled && qtimer(atime, 500)) {
+                    if (comm->IsCancelled()) {
+                        cancelled = true;
+                        stop = true;
+                    } else {
+                        comm->CommPostMessage(Communicator::CURRENT_RECORD, static_cast<int>(completed));
+                    }
+                }
+            }
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (cancelled) {
+            throw Communicator::CancelledException();
+        }
+    }
+
+    // As parallelFor, but calls task(scratch, item) where scratch belongs to the worker and is
+    // made by makeScratch() on the worker's own thread before its first item, so a search can
+    // keep its working state there instead of on the shared map. The scratch is kept for all
+    // the items of the worker and destroyed at the end
+    template <typename MakeScratch, typename Task>
+    void parallelForWithScratch(Communicator *comm, size_t count, int nthreads, MakeScratch makeScratch, Task task,
+                                Schedule schedule = Schedule::STEAL) {
+        typedef decltype(makeScratch()) Scratch;
+        nthreads = resolveThreadCount(nthreads);
+        std::vector<std::unique_ptr<Scratch>> scratches(static_cast<size_t>(nthreads));
+        parallelFor(
+            comm, count, nthreads,
+            [&](int worker, size_t item) {
+                std::unique_ptr<Scratch> &scratch = scratches[static_cast<size_t>(worker)];
+                if (!scratch) {
+                    scratch = std::unique_ptr<Scratch>(new Scratch(makeScratch()));
+                }
+                task(*scratch, item);
+            },
+            schedule);
+    }
+} // namespace depthmapX
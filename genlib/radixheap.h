@@ -0,0 +1,119 @@
+// genlib - a component of the depthmapX - spatial network analysis platform
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace depthmapX {
+
+    // A monotone priority queue for Dijkstra-like searches over non-negative float keys.
+    // The key of an item is found through a free function queueKey(const T &) and items
+    // are popped in ascending key order, with ties broken by the item's operator<, so
+    // that they come out in the same order as they would from a std::set<T>. Unlike a
+    // std::set duplicates are kept. Every pushed key must be at least as large as the
+    // key that was popped last, which is always the case when expanding a search from
+    // the item that was just popped with a non-negative step cost.
+    // Buckets are plain vectors that keep their capacity through clear(), so a queue
+    // that is reused for many searches stops allocating after the first few.
+    template <typename T> class RadixHeap {
+      public:
+        bool empty() const { return m_size == 0; }
+        size_t size() const { return m_size; }
+
+        void push(const T &item) {
+            size_t bucket = bucketIndex(keyBits(item));
+            m_buckets[bucket].push_back(item);
+            if (bucket == 0) {
+                std::push_heap(m_buckets[0].begin(), m_buckets[0].end(), greater);
+            }
+            m_size++;
+        }
+
+        // removes and returns the smallest item, the queue must not be empty
+        T pop() {
+            if (m_buckets[0].empty()) {
+                refill();
+            }
+            std::pop_heap(m_buckets[0].begin(), m_buckets[0].end(), greater);
+            T item = m_buckets[0].back();
+            m_buckets[0].pop_back();
+            m_size--;
+            return item;
+        }
+
+        void clear() {
+            for (auto &bucket : m_buckets) {
+                bucket.clear();
+            }
+            m_last = 0;
+            m_size = 0;
+        }
+
+      private:
+        static const size_t BUCKETS = 33;
+        std::vector<T> m_buckets[BUCKETS];
+        uint32_t m_last = 0;
+        size_t m_size = 0;
+
+        static bool greater(const T &a, const T &b) { return b < a; }
+
+        // the bit pattern of a non-negative float sorts the same way as the float itself
+        static uint32_t keyBits(const T &item) {
+            float key = queueKey(item);
+            uint32_t bits;
+            std::memcpy(&bits, &key, sizeof(bits));
+            return bits;
+        }
+
+        // bucket 0 holds the items equal to the last popped key, bucket i the items whose
+        // highest bit that differs from the last popped key is bit i - 1
+        size_t bucketIndex(uint32_t bits) const {
+            uint32_t diff = bits ^ m_last;
+#if defined(__GNUC__) || defined(__clang__)
+            return diff == 0 ? 0 : static_cast<size_t>(32 - __builtin_clz(diff));
+#else
+            size_t bucket = 0;
+            while (diff != 0) {
+                diff >>= 1;
+                bucket++;
+            }
+            return bucket;
+#endif
+        }
+
+        void refill() {
+            size_t from = 1;
+            while (m_buckets[from].empty()) {
+                from++;
+            }
+            std::vector<T> &bucket = m_buckets[from];
+            uint32_t minBits = keyBits(bucket.front());
+            for (const T &item : bucket) {
+                minBits = std::min(minBits, keyBits(item));
+            }
+            m_last = minBits;
+            // all of these land in buckets below the one they come from
+            for (const T &item : bucket) {
+                m_buckets[bucketIndex(keyBits(item))].push_back(item);
+            }
+            bucket.clear();
+            std::make_heap(m_buckets[0].begin(), m_buckets[0].end(), greater);
+        }
+    };
+} // namespace depthmapX
@@ -0,0 +1,176 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "genlib/blockcompression.h"
+
+#include <cstring>
+#include <istream>
+#include <random>
+#include <sstream>
+
+static std::string roundTrip(const std::string &data, size_t &compressedSize) {
+    std::vector<char> compressed;
+    depthmapX::blockcodec::compress(data.data(), data.size(), compressed);
+    compressedSize = compressed.size();
+    std::string decompressed(data.size(), '\0');
+    REQUIRE(depthmapX::blockcodec::decompress(compressed.data(), compressed.size(), &decompressed[0], data.size()));
+    return decompressed;
+}
+
+TEST_CASE("Block codec round trips") {
+    std::mt19937 random(1);
+    size_t compressedSize;
+
+    SECTION("Empty and tiny blocks") {
+        for (std::string data : {std::string(), std::string("a"), std::string("abcd"), std::string("abcdabcd")}) {
+            REQUIRE(roundTrip(data, compressedSize) == data);
+        }
+    }
+
+    SECTION("Random bytes do not compress") {
+        std::string data;
+        for (int i = 0; i < 100000; i++) {
+            data.push_back(char(random()));
+        }
+        REQUIRE(roundTrip(data, compressedSize) == data);
+        REQUIRE(compressedSize > data.size());
+    }
+
+    SECTION("Runs compress to a fraction") {
+        // a single repeated byte makes a match that overlaps itself
+        std::string data(70000, 'x');
+        REQUIRE(roundTrip(data, compressedSize) == data);
+        REQUIRE(compressedSize < 400);
+
+        std::string records;
+        for (int i = 0; i < 20000; i++) {
+            int record[3] = {i % 7, 12345, -1};
+            records.append(reinterpret_cast<const char *>(record), sizeof(record));
+            records.push_back(char(random() % 4));
+        }
+        REQUIRE(roundTrip(records, compressedSize) == records);
+        REQUIRE(compressedSize < records.size() / 2);
+    }
+
+    SECTION("Damaged data is found out") {
+        std::string data(1000, 'y');
+        std::vector<char> compressed;
+        depthmapX::blockcodec::compress(data.data(), data.size(), compressed);
+        std::string out(data.size(), '\0');
+        // too short, too long or cut off
+        REQUIRE_FALSE(depthmapX::blockcodec::decompress(compressed.data(), compressed.size(), &out[0], 999));
+        std::string longer(1001, '\0');
+        REQUIRE_FALSE(depthmapX::blockcodec::decompress(compressed.data(), compressed.size(), &longer[0], 1001));
+        REQUIRE_FALSE(depthmapX::blockcodec::decompress(compressed.data(), compressed.size() - 1, &out[0], 1000));
+        // a match before the start of the block
+        const char badOffset[] = {0x10, 'a', 0x05, 0x00};
+        REQUIRE_FALSE(depthmapX::blockcodec::decompress(badOffset, sizeof(badOffset), &out[0], 5));
+    }
+
+    SECTION("Blocks are in the LZ4 block format") {
+        // "abcd", a match of 8 bytes 4 back and the last 5 literals, as lz4 writes it
+        const char block[] = {0x44, 'a', 'b', 'c', 'd', 0x04, 0x00, 0x50, 'e', 'f', 'g', 'h', 'i'};
+        std::string out(17, '\0');
+        REQUIRE(depthmapX::blockcodec::decompress(block, sizeof(block), &out[0], out.size()));
+        REQUIRE(out == "abcdabcdabcdefghi");
+
+        // lz4 needs the block to end in at least 5 literals
+        std::string data(70000, 'x');
+        std::vector<char> compressed;
+        depthmapX::blockcodec::compress(data.data(), data.size(), compressed);
+        REQUIRE(compressed.size() > 6);
+        REQUIRE(std::string(compressed.end() - 6, compressed.end()) == "\x50xxxxx");
+    }
+}
+
+TEST_CASE("Block compressed streams") {
+    std::string data;
+    for (int i = 0; i < 10000; i++) {
+        data += "line " + std::to_string(i % 100) + "\n";
+    }
+    std::stringstream file;
+    {
+        // small blocks so that the data spans many of them
+        depthmapX::BlockCompressedWriteBuf buffer(file, 4096);
+        std::ostream out(&buffer);
+        out.write(data.data(), 1000);
+        // a flush starts a new block
+        out.flush();
+        out.write(data.data() + 1000, std::streamsize(data.size() - 1000));
+    }
+    std::string compressed = file.str();
+    REQUIRE(depthmapX::blockstream::isCompressed(compressed.data(), compressed.size()));
+    REQUIRE(compressed.size() < data.size() / 4);
+
+    depthmapX::BlockCompressedReadBuf buffer(compressed.data(), compressed.size());
+    REQUIRE(buffer.isValid());
+    REQUIRE(buffer.size() == data.size());
+    std::istream in(&buffer);
+
+    SECTION("Read through") {
+        std::string read(data.size(), '\0');
+        in.read(&read[0], std::streamsize(read.size()));
+        REQUIRE(in.gcount() == std::streamsize(data.size()));
+        REQUIRE(read == data);
+        REQUIRE(in.get() == EOF);
+    }
+
+    SECTION("Seek across blocks") {
+        char c[8];
+        for (size_t position : {size_t(999), size_t(1000), size_t(50000), size_t(5), data.size() - 8}) {
+            in.seekg(std::streamoff(position));
+            in.read(c, 8);
+            REQUIRE(std::string(c, 8) == data.substr(position, 8));
+            REQUIRE(in.tellg() == std::streampos(position + 8));
+        }
+        in.seekg(-50000, std::ios::cur);
+        in.read(c, 8);
+        REQUIRE(std::string(c, 8) == data.substr(data.size() - 50000, 8));
+        in.seekg(0, std::ios::end);
+        REQUIRE(in.tellg() == std::streampos(data.size()));
+        REQUIRE(in.get() == EOF);
+    }
+
+    SECTION("Not a block compressed stream") {
+        std::string plain = "grf and then some";
+        depthmapX::BlockCompressedReadBuf notCompressed(plain.data(), plain.size());
+        REQUIRE_FALSE(notCompressed.isValid());
+        // a block that runs past the end of the data
+        depthmapX::BlockCompressedReadBuf cutOff(compressed.data(), compressed.size() - 1);
+        REQUIRE_FALSE(cutOff.isValid());
+        // a block bigger than the block size in the header
+        std::string smallBlocks = compressed;
+        uint32_t blockSize = 999;
+        std::memcpy(&smallBlocks[3 + sizeof(int)], &blockSize, sizeof(blockSize));
+        depthmapX::BlockCompressedReadBuf tooBig(smallBlocks.data(), smallBlocks.size());
+        REQUIRE_FALSE(tooBig.isValid());
+    }
+
+    SECTION("An empty block") {
+        // the header of a stream with 4096 byte blocks, then a block of no bytes
+        std::string empty(compressed.data(), 3 + sizeof(int) + sizeof(uint32_t));
+        empty.append(2 * sizeof(uint32_t), '\0');
+        depthmapX::BlockCompressedReadBuf emptyBlock(empty.data(), empty.size());
+        REQUIRE_FALSE(emptyBlock.isValid());
+        std::istream emptyIn(&emptyBlock);
+        REQUIRE(emptyIn.get() == EOF);
+
+        // and the same in front of a real block
+        std::string first = empty + compressed.substr(empty.size() - 2 * sizeof(uint32_t));
+        depthmapX::BlockCompressedReadBuf emptyFirst(first.data(), first.size());
+        REQUIRE_FALSE(emptyFirst.isValid());
+        std::istream emptyFirstIn(&emptyFirst);
+        REQUIRE(emptyFirstIn.get() == EOF);
+    }
+}
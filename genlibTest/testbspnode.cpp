@@ -217,3 +217,56 @@ TEST_CASE("BSPTree::make (all vertical lines)", "split tree")
     REQUIRE(node->m_right->m_left->m_left == nullptr);
     REQUIRE(node->m_right->m_left->m_right == nullptr);
 }
+
+static size_t compareFlattened(const BSPNode &node, const FlatBSPTree &tree, int index, float epsilon)
+{
+    REQUIRE(index >= 0);
+    const FlatBSPTree::Node &flat = tree.nodes[static_cast<size_t>(index)];
+    compareLines(node.getLine(), flat.line, epsilon);
+    REQUIRE(node.getTag() == flat.tag);
+    REQUIRE((node.m_left == nullptr) == (flat.left == -1));
+    REQUIRE((node.m_right == nullptr) == (flat.right == -1));
+    size_t count = 1;
+    if (node.m_left) {
+        // pre-order, so the left child always follows its parent
+        REQUIRE(flat.left == index + 1);
+        count += compareFlattened(*node.m_left, tree, flat.left, epsilon);
+    }
+    if (node.m_right) {
+        count += compareFlattened(*node.m_right, tree, flat.right, epsilon);
+    }
+    return count;
+}
+
+TEST_CASE("BSPTree::flatten", "same tree in one array")
+{
+    const float EPSILON = 0.001f;
+
+    std::vector<TaggedLine> lines;
+    lines.push_back(TaggedLine(Line(Point2f(1.5, 1), Point2f(1.5, 3)), 0));
+    lines.push_back(TaggedLine(Line(Point2f(2.5, 1), Point2f(2.5, 3)), 1));
+    lines.push_back(TaggedLine(Line(Point2f(3.5, 1), Point2f(3.5, 3)), 2));
+    lines.push_back(TaggedLine(Line(Point2f(4.5, 1), Point2f(4.5, 3)), 3));
+    lines.push_back(TaggedLine(Line(Point2f(1, 0.5), Point2f(5, 0.5)), 4));
+    lines.push_back(TaggedLine(Line(Point2f(1, 3.5), Point2f(5, 3.5)), 5));
+
+    std::unique_ptr<BSPNode> node(new BSPNode());
+
+    BSPTree::make(0, 0, lines, node.get());
+
+    FlatBSPTree tree = BSPTree::flatten(*node);
+
+    REQUIRE(compareFlattened(*node, tree, 0, EPSILON) == tree.nodes.size());
+
+    REQUIRE(tree.nodes[0].classify(Point2f(1, 2)) == node->classify(Point2f(1, 2)));
+    REQUIRE(tree.nodes[0].classify(Point2f(4, 2)) == node->classify(Point2f(4, 2)));
+
+    SECTION("An empty tree is a single node") {
+        BSPNode root;
+        FlatBSPTree single = BSPTree::flatten(root);
+        REQUIRE(single.nodes.size() == 1);
+        REQUIRE(single.nodes[0].tag == -1);
+        REQUIRE(single.nodes[0].left == -1);
+        REQUIRE(single.nodes[0].right == -1);
+    }
+}
@@ -0,0 +1,72 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "genlib/memorymappedfile.h"
+
+#include <cstdio>
+#include <fstream>
+#include <istream>
+
+TEST_CASE("MemoryMappedFile maps a whole file") {
+    const std::string filename = "memorymapped.bin";
+    {
+        std::ofstream out(filename, std::ios::binary);
+        for (int i = 0; i < 1000; i++) {
+            out.write(reinterpret_cast<const char *>(&i), sizeof(i));
+        }
+    }
+    {
+        depthmapX::MemoryMappedFile mapped(filename);
+        REQUIRE(mapped.isOpen());
+        REQUIRE(mapped.size() == 1000 * sizeof(int));
+
+        depthmapX::MemoryStreamBuf buffer(mapped.data(), mapped.size());
+        std::istream stream(&buffer);
+        int value;
+        stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+        REQUIRE(value == 0);
+        stream.seekg(10 * sizeof(int), std::ios::cur);
+        stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+        REQUIRE(value == 11);
+        REQUIRE(stream.tellg() == std::streampos(12 * sizeof(int)));
+        stream.seekg(500 * sizeof(int));
+        stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+        REQUIRE(value == 500);
+        stream.seekg(-std::streamoff(sizeof(int)), std::ios::end);
+        stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+        REQUIRE(value == 999);
+
+        // reading past the end fails like a file stream
+        REQUIRE_FALSE(stream.eof());
+        stream.read(reinterpret_cast<char *>(&value), sizeof(value));
+        REQUIRE(stream.eof());
+        stream.clear();
+        stream.seekg(-1, std::ios::beg);
+        REQUIRE(stream.fail());
+    }
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("MemoryMappedFile does not map missing or empty files") {
+    depthmapX::MemoryMappedFile missing("no_such_file.bin");
+    REQUIRE_FALSE(missing.isOpen());
+
+    const std::string filename = "memorymapped_empty.bin";
+    { std::ofstream out(filename, std::ios::binary); }
+    {
+        depthmapX::MemoryMappedFile empty(filename);
+        REQUIRE_FALSE(empty.isOpen());
+    }
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,92 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "genlib/packedrtree.h"
+
+#include <random>
+
+static std::vector<QtRegion> randomBoxes(size_t count, std::mt19937 &random) {
+    std::uniform_real_distribution<double> position(0.0, 100.0);
+    std::uniform_real_distribution<double> size(0.0, 5.0);
+    std::vector<QtRegion> boxes;
+    for (size_t i = 0; i < count; i++) {
+        Point2f bl(position(random), position(random));
+        boxes.push_back(QtRegion(bl, Point2f(bl.x + size(random), bl.y + size(random))));
+    }
+    return boxes;
+}
+
+TEST_CASE("PackedRTree search finds the same boxes as a linear scan") {
+    std::mt19937 random(1);
+    // one leaf, two levels and three levels
+    for (size_t count : {5, 200, 1000}) {
+        std::vector<QtRegion> boxes = randomBoxes(count, random);
+        depthmapX::PackedRTree tree(boxes);
+        REQUIRE(tree.size() == count);
+        for (int query = 0; query < 50; query++) {
+            QtRegion region = randomBoxes(1, random)[0];
+            region.top_right = region.top_right + Point2f(10.0, 10.0);
+            std::vector<size_t> expected;
+            for (size_t i = 0; i < boxes.size(); i++) {
+                if (intersect_region(boxes[i], region)) {
+                    expected.push_back(i);
+                }
+            }
+            std::vector<size_t> found;
+            tree.search(region, [&](size_t item) { found.push_back(item); });
+            std::sort(found.begin(), found.end());
+            REQUIRE(found == expected);
+        }
+    }
+}
+
+TEST_CASE("PackedRTree nearest finds the closest item") {
+    std::mt19937 random(2);
+    std::vector<QtRegion> boxes = randomBoxes(500, random);
+    std::vector<Line> lines;
+    for (auto &box : boxes) {
+        lines.push_back(Line(box.bottom_left, box.top_right));
+    }
+    depthmapX::PackedRTree tree(boxes);
+    std::uniform_real_distribution<double> position(-20.0, 120.0);
+    for (int query = 0; query < 100; query++) {
+        Point2f p(position(random), position(random));
+        int expected = -1;
+        for (size_t i = 0; i < lines.size(); i++) {
+            if (i % 3 != 0 && (expected == -1 || dist(p, lines[i]) < dist(p, lines[size_t(expected)]))) {
+                expected = int(i);
+            }
+        }
+        // every third line is left out
+        int found = tree.nearest(p, [&](size_t item) { return item % 3 == 0 ? -1.0 : dist(p, lines[item]); });
+        REQUIRE(found == expected);
+    }
+
+    SECTION("Ties go to the lower item") {
+        std::vector<QtRegion> same(40, QtRegion(Point2f(1, 1), Point2f(2, 2)));
+        depthmapX::PackedRTree sameTree(same);
+        int found = sameTree.nearest(Point2f(0, 0), [&](size_t item) { return item < 7 ? -1.0 : 1.0; });
+        REQUIRE(found == 7);
+    }
+}
+
+TEST_CASE("PackedRTree without boxes") {
+    depthmapX::PackedRTree tree(std::vector<QtRegion>{});
+    REQUIRE(tree.empty());
+    bool visited = false;
+    tree.search(QtRegion(Point2f(0, 0), Point2f(1, 1)), [&](size_t) { visited = true; });
+    REQUIRE_FALSE(visited);
+    int found = tree.nearest(Point2f(0, 0), [](size_t) { return 0.0; });
+    REQUIRE(found == -1);
+}
@@ -0,0 +1,56 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include <genlib/pafmath.h>
+
+TEST_CASE("pafrand state can be continued and skipped ahead", "")
+{
+    const int set = 3;
+    uint64_t saved = pafrandstate(set);
+    pafsrand(1234, set);
+
+    uint64_t state = pafrandstate(set);
+    uint64_t start = state;
+    for (int i = 0; i < 1000; i++)
+    {
+        REQUIRE(pafrandnext(state) == pafrand(set));
+        REQUIRE(state == pafrandstate(set));
+        REQUIRE(pafrandskip(start, uint64_t(i + 1)) == state);
+    }
+    REQUIRE(pafrandskip(start, 0) == start);
+    REQUIRE(pafrandskip(pafrandskip(start, 123456), 654321) == pafrandskip(start, 777777));
+
+    pafsetrandstate(start, set);
+    uint64_t copy = start;
+    REQUIRE(pafrand(set) == pafrandnext(copy));
+
+    pafsetrandstate(saved, set);
+}
+
+TEST_CASE("pafrand streams depend only on the seed and the stream number", "")
+{
+    REQUIRE(pafrandstream(7, 3) == pafrandstream(7, 3));
+    REQUIRE(pafrandstream(7, 3) != pafrandstream(7, 4));
+    REQUIRE(pafrandstream(7, 3) != pafrandstream(8, 3));
+
+    // neighbouring streams do not start anywhere near each other in the sequence
+    uint64_t first = pafrandstream(0, 0);
+    uint64_t second = pafrandstream(0, 1);
+    uint64_t state = first;
+    for (int i = 0; i < 10000; i++)
+    {
+        pafrandnext(state);
+        REQUIRE(state != second);
+    }
+}
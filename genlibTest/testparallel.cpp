@@ -0,0 +1,93 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "../genlib/parallel.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("parallelFor processes every item once", "") {
+    const size_t count = 10007;
+    std::vector<std::atomic<int>> visits(count);
+    for (auto &visit : visits) {
+        visit = 0;
+    }
+
+    SECTION("Stealing") {
+        // uneven items, so that the workers finish their own ranges at different times
+        depthmapX::parallelFor(nullptr, count, 4, [&](int, size_t item) {
+            volatile size_t work = 0;
+            for (size_t i = 0; i < (item % 97) * 10; i++) {
+                work += i;
+            }
+            visits[item]++;
+        });
+    }
+
+    SECTION("In order") {
+        depthmapX::parallelFor(
+            nullptr, count, 3, [&](int, size_t item) { visits[item]++; }, depthmapX::Schedule::IN_ORDER);
+    }
+
+    SECTION("More threads than items") {
+        depthmapX::parallelFor(nullptr, 3, 8, [&](int, size_t item) { visits[item]++; });
+        for (size_t item = 3; item < count; item++) {
+            visits[item]++;
+        }
+    }
+
+    for (size_t item = 0; item < count; item++) {
+        REQUIRE(visits[item] == 1);
+    }
+}
+
+TEST_CASE("parallelFor with a single thread runs in order on the calling thread", "") {
+    std::vector<size_t> order;
+    depthmapX::parallelFor(nullptr, 5, 1, [&](int worker, size_t item) {
+        REQUIRE(worker == 0);
+        order.push_back(item);
+    });
+    REQUIRE(order == std::vector<size_t>({0, 1, 2, 3, 4}));
+}
+
+TEST_CASE("parallelFor rethrows the exception of a task", "") {
+    auto task = [](int, size_t item) {
+        if (item == 500) {
+            throw std::runtime_error("failed");
+        }
+    };
+    REQUIRE_THROWS_AS(depthmapX::parallelFor(nullptr, 1000, 4, task), std::runtime_error);
+}
+
+TEST_CASE("parallelForWithScratch makes one scratch per worker", "") {
+    struct Scratch {
+        std::vector<size_t> items;
+    };
+    std::atomic<int> made(0);
+    std::atomic<size_t> total(0);
+    depthmapX::parallelForWithScratch(
+        nullptr, 1000, 4,
+        [&]() {
+            made++;
+            return Scratch();
+        },
+        [&](Scratch &scratch, size_t item) {
+            scratch.items.push_back(item);
+            total++;
+        });
+    REQUIRE(made >= 1);
+    REQUIRE(made <= 4);
+    REQUIRE(total == 1000);
+}
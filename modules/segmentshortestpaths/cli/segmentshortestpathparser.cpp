@@ -133,6 +133,6 @@ void SegmentShortestPathParser::run(const CommandLineParser &clp, IPerformanceSi
     }
 
     std::cout << " ok\nWriting out result..." << std::flush;
-    DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(), METAGRAPH_VERSION, false))
+    DO_TIMED("Writing graph", mGraph->write(clp.getOuputFile().c_str(), METAGRAPH_VERSION, false, clp.compressGraph()))
     std::cout << " ok" << std::endl;
 }
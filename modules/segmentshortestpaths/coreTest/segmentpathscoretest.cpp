@@ -70,8 +70,9 @@ TEST_CASE("Shortest paths working examples", "") {
         std::vector<int> expectedOrder = {-1, 0, 1, 4, -1, -1, -1, 3, 2, 5};
         for (int i = 0; i < lines.size(); i++) {
             QtRegion selRegion(lines[i].midpoint(), lines[i].midpoint());
-            AttributeRow &shapeRow =
-                segmentMap->getAttributeRowFromShapeIndex(segmentMap->getShapesInRegion(selRegion).begin()->first);
+            std::vector<size_t> shapesInRegion;
+            segmentMap->getShapesInRegion(selRegion, shapesInRegion);
+            AttributeRow &shapeRow = segmentMap->getAttributeRowFromShapeIndex(shapesInRegion.front());
 
             REQUIRE(shapeRow.getValue(angleColIdx) == Approx(expectedAngles[i]).epsilon(EPSILON));
             REQUIRE(shapeRow.getValue(orderColIdx) == expectedOrder[i]);
@@ -90,8 +91,9 @@ TEST_CASE("Shortest paths working examples", "") {
         std::vector<int> expectedOrder = {-1, 0, 1, 4, -1, 3, 2, -1, -1, 5};
         for (int i = 0; i < lines.size(); i++) {
             QtRegion selRegion(lines[i].midpoint(), lines[i].midpoint());
-            AttributeRow &shapeRow =
-                segmentMap->getAttributeRowFromShapeIndex(segmentMap->getShapesInRegion(selRegion).begin()->first);
+            std::vector<size_t> shapesInRegion;
+            segmentMap->getShapesInRegion(selRegion, shapesInRegion);
+            AttributeRow &shapeRow = segmentMap->getAttributeRowFromShapeIndex(shapesInRegion.front());
             REQUIRE(shapeRow.getValue(distanceColIdx) == Approx(expectedDistances[i]).epsilon(EPSILON));
             REQUIRE(shapeRow.getValue(orderColIdx) == expectedOrder[i]);
         }
@@ -109,8 +111,9 @@ TEST_CASE("Shortest paths working examples", "") {
         std::vector<int> expectedOrder = {2, 0, -1, -1, 1, -1, -1, -1, -1, 3};
         for (int i = 0; i < lines.size(); i++) {
             QtRegion selRegion(lines[i].midpoint(), lines[i].midpoint());
-            AttributeRow &shapeRow =
-                segmentMap->getAttributeRowFromShapeIndex(segmentMap->getShapesInRegion(selRegion).begin()->first);
+            std::vector<size_t> shapesInRegion;
+            segmentMap->getShapesInRegion(selRegion, shapesInRegion);
+            AttributeRow &shapeRow = segmentMap->getAttributeRowFromShapeIndex(shapesInRegion.front());
             REQUIRE(shapeRow.getValue(depthColIdx) == Approx(expectedDepths[i]).epsilon(EPSILON));
             REQUIRE(shapeRow.getValue(orderColIdx) == expectedOrder[i]);
         }
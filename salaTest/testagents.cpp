@@ -0,0 +1,151 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/agents/agentengine.h"
+#include "salalib/agents/agenthelpers.h"
+#include "salalib/mgraph.h"
+
+static std::string galleryFile() {
+    std::string file(__FILE__);
+    return file.substr(0, file.find_last_of("/\\") + 1) + "../testdata/gallery_connected.graph";
+}
+
+TEST_CASE("Agents that reach their lifetime give their slots to the next ones released", "") {
+    MetaGraph metaGraph;
+    REQUIRE(metaGraph.readFromFile(galleryFile()) == MetaGraph::OK);
+    PointMap &map = metaGraph.getPointMaps().front();
+    map.getAttributeTable().getOrInsertColumn(g_col_total_counts);
+    AgentCounts counts(map, false);
+
+    AgentSet agentSet;
+    agentSet.m_sel_type = AgentProgram::SEL_STANDARD;
+    agentSet.m_steps = 3;
+    agentSet.m_vbin = 7;
+    agentSet.m_lifetime = 3;
+
+    for (int i = 0; i < 4; i++) {
+        agentSet.release(&map, Agent::OUTPUT_COUNTS);
+    }
+    agentSet.move(&counts);
+    agentSet.release(&map, Agent::OUTPUT_COUNTS);
+    agentSet.move(&counts);
+    REQUIRE(agentSet.agentCount() == 5);
+    REQUIRE(agentSet.getAgent(0).getFrame() == 2);
+    REQUIRE(agentSet.getAgent(4).getFrame() == 1);
+
+    // the first four agents reach their lifetime together
+    agentSet.move(&counts);
+    REQUIRE(agentSet.agentCount() == 1);
+    REQUIRE(agentSet.getAgent(0).getFrame() == 2);
+
+    for (int i = 0; i < 4; i++) {
+        agentSet.release(&map, Agent::OUTPUT_COUNTS);
+    }
+    REQUIRE(agentSet.agentCount() == 5);
+    REQUIRE(agentSet.m_agent_pool.size() == 5);
+    REQUIRE(agentSet.getAgent(0).getFrame() == 2);
+    REQUIRE(agentSet.getAgent(1).getFrame() == 0);
+
+    agentSet.clear();
+    REQUIRE(agentSet.agentCount() == 0);
+}
+
+TEST_CASE("Agents count every gate they cross", "") {
+    MetaGraph metaGraph;
+    REQUIRE(metaGraph.readFromFile(galleryFile()) == MetaGraph::OK);
+    PointMap &map = metaGraph.getPointMaps().front();
+
+    // with a gate on every pixel, every step into a new pixel crosses a gate
+    AttributeTable &table = map.getAttributeTable();
+    size_t gateCol = table.insertOrResetColumn(g_col_gate);
+    table.insertOrResetColumn(g_col_gate_counts);
+    for (auto iter = table.begin(); iter != table.end(); ++iter) {
+        iter->getRow().setValue(gateCol, float(iter->getKey().value));
+    }
+
+    AgentEngine engine;
+    engine.m_timesteps = 300;
+    engine.m_gatelayer = 0;
+    engine.agentSets.push_back(AgentSet());
+    AgentSet &agentSet = engine.agentSets.back();
+    agentSet.m_sel_type = AgentProgram::SEL_STANDARD;
+    agentSet.m_steps = 3;
+    agentSet.m_vbin = 7;
+    agentSet.m_release_rate = 1.0;
+    agentSet.m_lifetime = 100;
+    engine.run(nullptr, &map);
+
+    size_t countCol = table.getColumnIndex(g_col_total_counts);
+    size_t gateCountCol = table.getColumnIndex(g_col_gate_counts);
+    float total = 0.0f;
+    size_t mismatched = 0;
+    for (auto iter = table.begin(); iter != table.end(); ++iter) {
+        float count = iter->getRow().getValue(countCol);
+        if (count != iter->getRow().getValue(gateCountCol)) {
+            mismatched++;
+        }
+        if (count > 0.0f) {
+            total += count;
+        }
+    }
+    REQUIRE(total > 1000.0f);
+    REQUIRE(mismatched == 0);
+}
+
+static std::vector<float> runSeededAgents(int threads, int seed, std::vector<std::vector<Event2f>> &trails) {
+    MetaGraph metaGraph;
+    REQUIRE(metaGraph.readFromFile(galleryFile()) == MetaGraph::OK);
+    PointMap &map = metaGraph.getPointMaps().front();
+
+    AgentEngine engine;
+    engine.m_timesteps = 200;
+    engine.m_threads = threads;
+    engine.m_random_seed = seed;
+    engine.m_record_trails = true;
+    engine.m_trail_count = 10;
+    engine.agentSets.push_back(AgentSet());
+    AgentSet &agentSet = engine.agentSets.back();
+    agentSet.m_sel_type = AgentProgram::SEL_OCC_MEMORY;
+    agentSet.m_steps = 3;
+    agentSet.m_vbin = 7;
+    agentSet.m_release_rate = 2.0;
+    agentSet.m_lifetime = 50;
+    engine.run(nullptr, &map);
+
+    trails = agentSet.m_trails;
+    const AttributeTable &table = map.getAttributeTable();
+    size_t countCol = table.getColumnIndex(g_col_total_counts);
+    std::vector<float> counts;
+    for (auto iter = table.begin(); iter != table.end(); ++iter) {
+        counts.push_back(iter->getRow().getValue(countCol));
+    }
+    return counts;
+}
+
+TEST_CASE("Agents with a random seed do the same on any number of threads", "") {
+    std::vector<std::vector<Event2f>> trails, threadedTrails, otherSeedTrails;
+    std::vector<float> counts = runSeededAgents(1, 7, trails);
+    std::vector<float> threadedCounts = runSeededAgents(3, 7, threadedTrails);
+    REQUIRE(counts == threadedCounts);
+    REQUIRE(trails.size() == threadedTrails.size());
+    for (size_t i = 0; i < trails.size(); i++) {
+        REQUIRE(trails[i].size() == threadedTrails[i].size());
+        for (size_t j = 0; j < trails[i].size(); j++) {
+            REQUIRE(trails[i][j].x == threadedTrails[i][j].x);
+            REQUIRE(trails[i][j].y == threadedTrails[i][j].y);
+        }
+    }
+
+    REQUIRE(runSeededAgents(1, 8, otherSeedTrails) != counts);
+}
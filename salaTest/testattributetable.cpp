@@ -467,3 +467,95 @@ TEST_CASE("Attribute Table - serialisation")
 
 }
 
+
+TEST_CASE("Attribute Table - removing rows and moving the table")
+{
+    AttributeTable table;
+    size_t col1 = table.getOrInsertColumn("col1");
+    size_t col2 = table.getOrInsertColumn("col2");
+    for (int i = 0; i < 5; i++)
+    {
+        table.addRow(AttributeKey(i)).setValue(col1, float(i)).setValue(col2, float(10 * i));
+    }
+
+    table.removeRow(AttributeKey(1));
+    REQUIRE(table.getNumRows() == 4);
+    REQUIRE(table.getRowPtr(AttributeKey(1)) == 0);
+    for (int i : {0, 2, 3, 4})
+    {
+        REQUIRE(table.getRow(AttributeKey(i)).getValue(col1) == Approx(float(i)));
+        REQUIRE(table.getRow(AttributeKey(i)).getValue(col2) == Approx(float(10 * i)));
+    }
+
+    table.addRow(AttributeKey(7)).setValue(col2, 70.0f);
+    REQUIRE(table.getRow(AttributeKey(7)).getValue(col1) == -1.0f);
+    REQUIRE(table.getRow(AttributeKey(4)).getValue(col2) == Approx(40.0f));
+
+    AttributeTable moved(std::move(table));
+    moved.getRow(AttributeKey(3)).setValue("col1", 33.0f);
+    REQUIRE(moved.getRow(AttributeKey(3)).getValue(col1) == Approx(33.0f));
+    REQUIRE(moved.getColumn(col1).getStats().max == Approx(33.0f));
+
+    std::vector<int> keys;
+    for (auto& item : moved)
+    {
+        keys.push_back(item.getKey().value);
+    }
+    REQUIRE(keys == std::vector<int>({0, 2, 3, 4, 7}));
+}
+
+TEST_CASE("Attribute Table - setting whole columns")
+{
+    // rows added out of key order and one removed, so the positions have to be sorted out
+    AttributeTable table;
+    AttributeTable reference;
+    for (AttributeTable *t : {&table, &reference})
+    {
+        t->getOrInsertColumn("col1");
+        t->getOrInsertColumn("col2");
+        for (int key : {4, 1, 3, 0, 2, 5})
+        {
+            t->addRow(AttributeKey(key));
+        }
+        t->removeRow(AttributeKey(3));
+    }
+    REQUIRE(table.getRowPosition(AttributeKey(0)) == 0);
+    REQUIRE(table.getRowPosition(AttributeKey(4)) == 3);
+    REQUIRE(table.getRowPosition(AttributeKey(5)) == 4);
+    REQUIRE_THROWS_AS(table.getRowPosition(AttributeKey(3)), std::out_of_range);
+
+    std::vector<float> values = {0.5f, -1.0f, 2.0f, 1.5f, 3.0f};
+    table.setColumnValues(0, values);
+
+    AttributeColumnValues partial(table.getNumRows());
+    partial.setValue(1, 7.0f);
+    partial.setValue(3, 8.0f);
+    table.setColumnValues(1, partial);
+
+    size_t position = 0;
+    for (auto &item : reference)
+    {
+        item.getRow().setValue(0, values[position]);
+        if (partial.isSet(position))
+        {
+            item.getRow().setValue(1, partial.getValue(position));
+        }
+        position++;
+    }
+
+    for (int key : {0, 1, 2, 4, 5})
+    {
+        REQUIRE(table.getRow(AttributeKey(key)).getValue(0) == reference.getRow(AttributeKey(key)).getValue(0));
+        REQUIRE(table.getRow(AttributeKey(key)).getValue(1) == reference.getRow(AttributeKey(key)).getValue(1));
+    }
+    REQUIRE(table.getRow(AttributeKey(0)).getValue(1) == -1.0f);
+    for (size_t col = 0; col < 2; col++)
+    {
+        REQUIRE(table.getColumn(col).getStats().min == reference.getColumn(col).getStats().min);
+        REQUIRE(table.getColumn(col).getStats().max == reference.getColumn(col).getStats().max);
+        REQUIRE(table.getColumn(col).getStats().total == reference.getColumn(col).getStats().total);
+    }
+
+    REQUIRE_THROWS_AS(table.setColumnValues(0, std::vector<float>(3)), std::invalid_argument);
+    REQUIRE_THROWS_AS(table.setColumnValues(2, values), std::out_of_range);
+}
@@ -0,0 +1,76 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "genlib/pafmath.h"
+#include "salalib/axialmodules/axialintegration.h"
+#include "salalib/mapconverter.h"
+#include "salalib/mgraph.h"
+
+// a street-like tangle of short lines, deep enough for the radii and choice to matter
+static std::unique_ptr<ShapeGraph> makeAxialMap(MetaGraph &metaGraph) {
+    metaGraph.m_drawingFiles.emplace_back("Test SpacePixelGroup");
+    auto &spacePixel = metaGraph.m_drawingFiles.back().m_spacePixels;
+    spacePixel.emplace_back("Test ShapeMap");
+    for (int i = 0; i < 12; i++) {
+        double x = i * 1.5;
+        spacePixel.back().makeLineShape(Line(Point2f(x, 0.5 * (i % 3)), Point2f(x + 2.0, 0.5 * (i % 3))));
+        spacePixel.back().makeLineShape(Line(Point2f(x + 0.2, -1.0 - 0.3 * (i % 2)), Point2f(x + 0.2, 2.0)));
+        spacePixel.back().makeLineShape(Line(Point2f(x + 0.7, 1.5), Point2f(x + 1.9, 3.0 + 0.2 * (i % 4))));
+    }
+    auto shapeGraph = MapConverter::convertDrawingToAxial(nullptr, "Test axial", metaGraph.m_drawingFiles);
+    REQUIRE(shapeGraph->getShapeCount() == 36);
+    return shapeGraph;
+}
+
+static void requireSameValues(const AttributeTable &expected, const AttributeTable &actual) {
+    REQUIRE(expected.getNumColumns() == actual.getNumColumns());
+    REQUIRE(expected.getNumRows() == actual.getNumRows());
+    for (size_t col = 0; col < expected.getNumColumns(); col++) {
+        REQUIRE(expected.getColumnName(col) == actual.getColumnName(col));
+    }
+    for (auto iter = expected.begin(); iter != expected.end(); iter++) {
+        const AttributeRow &actualRow = actual.getRow(iter->getKey());
+        for (size_t col = 0; col < expected.getNumColumns(); col++) {
+            REQUIRE(iter->getRow().getValue(col) == actualRow.getValue(col));
+        }
+    }
+}
+
+static void requireSameAnalysis(const std::set<double> &radii, bool weighted, bool choice, bool local, int threads) {
+    MetaGraph serialGraph("Serial");
+    auto serialMap = makeAxialMap(serialGraph);
+    MetaGraph parallelGraph("Parallel");
+    auto parallelMap = makeAxialMap(parallelGraph);
+    int weightCol = weighted ? static_cast<int>(serialMap->getAttributeTable().getColumnIndex("Line Length")) : -1;
+
+    uint64_t saved = pafrandstate();
+    pafsrand(42);
+    REQUIRE(AxialIntegration(radii, weightCol, choice, true, local, 1).run(nullptr, *serialMap, false));
+    uint64_t serialState = pafrandstate();
+    pafsrand(42);
+    REQUIRE(AxialIntegration(radii, weightCol, choice, true, local, threads).run(nullptr, *parallelMap, false));
+    REQUIRE(pafrandstate() == serialState);
+    pafsetrandstate(saved);
+
+    requireSameValues(serialMap->getAttributeTable(), parallelMap->getAttributeTable());
+}
+
+TEST_CASE("Parallel axial integration matches the serial analysis", "") {
+    SECTION("Radius n") { requireSameAnalysis({-1.0}, false, false, false, 4); }
+    SECTION("Several radii with choice and local measures") {
+        requireSameAnalysis({2.0, 3.0, -1.0}, false, true, true, 3);
+    }
+    SECTION("Weighted choice") { requireSameAnalysis({3.0, -1.0}, true, true, false, 4); }
+    SECTION("More threads than lines") { requireSameAnalysis({2.0, -1.0}, true, true, true, 64); }
+}
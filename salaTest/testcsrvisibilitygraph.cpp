@@ -0,0 +1,82 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/csrvisibilitygraph.h"
+#include "salalib/mgraph.h"
+
+#include <iostream>
+
+static void requireSameGraph(PointMap &map, const CSRVisibilityGraph &graph) {
+    REQUIRE(graph.size() == map.getFilledPointCount());
+    size_t edges = 0;
+    for (size_t i = 0; i < graph.size(); i++) {
+        PixelRef curs = graph.cell(i);
+        REQUIRE(graph.index(curs) == static_cast<int>(i));
+        Node &node = map.getPoint(curs).getNode();
+        for (int b = 0; b < 32; b++) {
+            const Bin &bin = node.bin(b);
+            const unsigned int *iter = graph.binBegin(i, b);
+            for (auto pixVec : bin.m_pixel_vecs) {
+                for (PixelRef pix = pixVec.start(); pix.col(bin.m_dir) <= pixVec.end().col(bin.m_dir);) {
+                    REQUIRE(iter != graph.binEnd(i, b));
+                    REQUIRE(graph.cell(*iter) == pix);
+                    ++iter;
+                    pix.move(bin.m_dir);
+                }
+            }
+            REQUIRE(iter == graph.binEnd(i, b));
+        }
+        edges += graph.degree(i);
+    }
+    REQUIRE(edges == graph.edgeCount());
+}
+
+TEST_CASE("CSR visibility graph lists the same neighbours as the nodes", "") {
+    Point2f bottomLeft(0, 0);
+    Point2f topRight(4, 3);
+    MetaGraph metaGraph("Rectangle");
+    metaGraph.m_drawingFiles.emplace_back("Test SpacePixelGroup");
+    auto &spacePixel = metaGraph.m_drawingFiles.back().m_spacePixels;
+    spacePixel.emplace_back("Test ShapeMap");
+    spacePixel.back().makeLineShape(Line(Point2f(0, 0), Point2f(0, 3)));
+    spacePixel.back().makeLineShape(Line(Point2f(0, 3), Point2f(4, 3)));
+    spacePixel.back().makeLineShape(Line(Point2f(4, 3), Point2f(4, 0)));
+    spacePixel.back().makeLineShape(Line(Point2f(4, 0), Point2f(0, 0)));
+    spacePixel.back().makeLineShape(Line(Point2f(2, 0), Point2f(2, 2)));
+    metaGraph.setRegion(bottomLeft, topRight);
+    PointMap map(metaGraph.getRegion(), metaGraph.m_drawingFiles, "Rectangle");
+    map.setGrid(0.25, Point2f(0, 0));
+    map.makePoints(Point2f(0.3, 0.3), 0);
+    std::unique_ptr<Communicator> comm(new ICommunicator());
+    REQUIRE(map.sparkGraph2(comm.get(), false, -1));
+
+    CSRVisibilityGraph graph(map);
+    REQUIRE(graph.size() > 100);
+    REQUIRE(graph.index(PixelRef(0, 0)) == -1);
+    requireSameGraph(map, graph);
+}
+
+// not run by default, use: salaTest [benchmark]
+TEST_CASE("Compare the memory of the CSR visibility graph with the nodes", "[.][benchmark]") {
+    std::string file(__FILE__);
+    file = file.substr(0, file.find_last_of("/\\") + 1) + "../testdata/gallery_connected.graph";
+    MetaGraph metaGraph;
+    REQUIRE(metaGraph.readFromFile(file) == MetaGraph::OK);
+    PointMap &map = metaGraph.getPointMaps().front();
+    CSRVisibilityGraph graph(map);
+    requireSameGraph(map, graph);
+    std::cout << "gallery_connected.graph (" << graph.size() << " points, " << graph.edgeCount() << " edges)\n"
+              << "  Node/Bin:  " << CSRVisibilityGraph::nodeMemoryUsage(map) << " bytes\n"
+              << "  CSR:       " << graph.memoryUsage() << " bytes" << std::endl;
+}
@@ -14,11 +14,18 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "catch.hpp"
+#include "cliTest/selfcleaningfile.h"
+#include "salalib/importutils.h"
 #include "salalib/parsers/dxfp.h"
 
 #include "genlib/comm.h"
+#include "genlib/memorymappedfile.h"
 #include "genlib/p2dpoly.h"
 
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
 TEST_CASE("DXF Parsing (lines)")
 {
     const float EPSILON = 0.001f;
@@ -542,3 +549,168 @@ TEST_CASE("DXF Parsing (deeper blocks)")
     REQUIRE(dxfParser.getLayer(layer.c_str())->getLine(0).getEnd().x == Approx(lineEnd.x + 2*blockTranslation.x).epsilon(EPSILON));
     REQUIRE(dxfParser.getLayer(layer.c_str())->getLine(0).getEnd().y == Approx(lineEnd.y + 2*blockTranslation.y).epsilon(EPSILON));
 }
+
+TEST_CASE("DXF Parsing in parallel")
+{
+    // enough entities for the section to be cut into several parts
+    const int entities = 60000;
+    std::stringstream stream;
+    stream << "0\nSECTION\n"
+           << "2\nBLOCKS\n"
+           << "0\nBLOCK\n"
+           << "8\n0\n"
+           << "2\ndoor\n"
+           << "10\n0\n20\n0\n30\n0\n"
+           << "0\nLINE\n"
+           << "8\n0\n"
+           << "10\n0\n20\n0\n30\n0\n11\n1\n21\n0\n31\n0\n"
+           << "0\nINSERT\n"
+           << "8\n0\n"
+           << "2\nknob\n"
+           << "10\n0.5\n20\n0.5\n"
+           << "0\nENDBLK\n"
+           << "0\nBLOCK\n"
+           << "8\n0\n"
+           << "2\nknob\n"
+           << "10\n0\n20\n0\n30\n0\n"
+           << "0\nLINE\n"
+           << "8\n0\n"
+           << "10\n0\n20\n0\n30\n0\n11\n0\n21\n0.1\n31\n0\n"
+           << "0\nENDBLK\n"
+           << "0\nENDSEC\n"
+           << "0\nSECTION\n"
+           << "2\nENTITIES\n";
+    for (int i = 0; i < entities; i++) {
+        std::string layer = (i % 3 == 0) ? "walls" : "doors";
+        switch (i % 4) {
+        case 0:
+        case 1:
+            stream << "0\nLINE\n"
+                   << "8\n" << layer << "\n"
+                   << "10\n" << i << "\n20\n" << i % 7 << "\n30\n0\n"
+                   << "11\n" << i + 1 << "\n21\n" << i % 11 << "\n31\n0\n";
+            break;
+        case 2:
+            stream << "0\nPOLYLINE\n"
+                   << "8\n" << layer << "\n"
+                   << "66\n1\n70\n0\n";
+            for (int j = 0; j < 3; j++) {
+                stream << "0\nVERTEX\n"
+                       << "8\n" << layer << "\n"
+                       << "10\n" << i + j << "\n20\n" << j << "\n30\n0\n";
+            }
+            stream << "0\nSEQEND\n"
+                   << "8\n" << layer << "\n";
+            break;
+        case 3:
+            stream << "0\nINSERT\n"
+                   << "8\n" << layer << "\n"
+                   << "2\ndoor\n"
+                   << "10\n" << i << "\n20\n" << i << "\n"
+                   << "50\n" << i % 360 << "\n";
+            break;
+        }
+    }
+    stream << "0\nENDSEC\n"
+           << "0\nEOF\n";
+    std::string text = stream.str();
+
+    DxfParser serialParser;
+    serialParser.open(stream);
+    DxfParser parallelParser;
+    parallelParser.open(text.data(), text.size(), 3);
+
+    REQUIRE(parallelParser.numLayers() == serialParser.numLayers());
+    for (auto &layer : serialParser.getLayers()) {
+        const DxfLayer &serialLayer = layer.second;
+        const DxfLayer &parallelLayer = *parallelParser.getLayer(layer.first);
+        REQUIRE(parallelLayer.numLines() == serialLayer.numLines());
+        REQUIRE(parallelLayer.numPolyLines() == serialLayer.numPolyLines());
+        REQUIRE(parallelLayer.numArcs() == serialLayer.numArcs());
+        REQUIRE(parallelLayer.numCircles() == serialLayer.numCircles());
+        REQUIRE(parallelLayer.numTotalLines() == serialLayer.numTotalLines());
+        size_t different = 0;
+        for (size_t i = 0; i < serialLayer.numLines(); i++) {
+            if (parallelLayer.getLine(i).getStart() != serialLayer.getLine(i).getStart() ||
+                parallelLayer.getLine(i).getEnd() != serialLayer.getLine(i).getEnd()) {
+                different++;
+            }
+        }
+        for (size_t i = 0; i < serialLayer.numPolyLines(); i++) {
+            const DxfPolyLine &serialPolyLine = serialLayer.getPolyLine(i);
+            const DxfPolyLine &parallelPolyLine = parallelLayer.getPolyLine(i);
+            if (parallelPolyLine.numVertices() != serialPolyLine.numVertices()) {
+                different++;
+                continue;
+            }
+            for (size_t j = 0; j < serialPolyLine.numVertices(); j++) {
+                if (parallelPolyLine.getVertex(j) != serialPolyLine.getVertex(j)) {
+                    different++;
+                }
+            }
+        }
+        REQUIRE(different == 0);
+    }
+    REQUIRE(parallelParser.getExtMin().x == serialParser.getExtMin().x);
+    REQUIRE(parallelParser.getExtMin().y == serialParser.getExtMin().y);
+    REQUIRE(parallelParser.getExtMax().x == serialParser.getExtMax().x);
+    REQUIRE(parallelParser.getExtMax().y == serialParser.getExtMax().y);
+}
+
+// not run by default, use: salaTest [benchmark]
+TEST_CASE("Benchmark reading DXF files from a stream and from memory", "[.][benchmark]")
+{
+    std::string testData(__FILE__);
+    testData = testData.substr(0, testData.find_last_of("/\\") + 1) + "../testdata/";
+    auto milliseconds = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    // a larger file is made by repeating the entities of the test file
+    std::string original = testData + "barnsbury_extended1.dxf";
+    std::string text;
+    {
+        std::ifstream stream(original, std::ios::binary);
+        std::stringstream contents;
+        contents << stream.rdbuf();
+        text = contents.str();
+    }
+    size_t entitiesStart = text.find('\n', text.find("ENTITIES")) + 1;
+    size_t entitiesEnd = text.rfind('\n', text.rfind('\n', text.find("ENDSEC", entitiesStart)) - 1) + 1;
+    std::string entities = text.substr(entitiesStart, entitiesEnd - entitiesStart);
+    SelfCleaningFile enlarged("barnsbury_enlarged.dxf");
+    {
+        std::ofstream stream(enlarged.Filename(), std::ios::binary);
+        stream << text.substr(0, entitiesStart);
+        for (int i = 0; i < 200; i++) {
+            stream << entities;
+        }
+        stream << text.substr(entitiesEnd);
+    }
+
+    for (const std::string &filename : {original, enlarged.Filename()}) {
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::ifstream stream(filename);
+            DxfParser parser;
+            parser.open(stream);
+        }
+        std::cout << filename << ": stream parse " << milliseconds(start) << " ms";
+        for (int threads : {1, 2, 4, 0}) {
+            start = std::chrono::steady_clock::now();
+            {
+                depthmapX::MemoryMappedFile file(filename);
+                DxfParser parser;
+                parser.open(file.data(), file.size(), threads);
+            }
+            double parse = milliseconds(start);
+            start = std::chrono::steady_clock::now();
+            MetaGraph mgraph;
+            REQUIRE(depthmapX::importFile(mgraph, filename, nullptr, filename, depthmapX::ImportType::DRAWINGMAP,
+                                          depthmapX::ImportFileType::DXF, threads));
+            std::cout << "; " << threads << " threads: memory parse " << parse << " ms, import "
+                      << milliseconds(start) << " ms";
+        }
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,215 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "cliTest/selfcleaningfile.h"
+#include "salalib/mgraph.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static std::string readWholeFile(const std::string &filename) {
+    std::ifstream stream(filename, std::ios::binary);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+}
+
+static size_t countUpgradeFiles() {
+    size_t count = 0;
+    for (auto &entry : std::filesystem::directory_iterator(std::filesystem::temp_directory_path())) {
+        if (entry.path().filename().string().find("depthmapX_upgrade_") == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static std::string summary(PointMap &map) {
+    std::stringstream stream;
+    map.outputSummary(stream, ',');
+    return stream.str();
+}
+
+TEST_CASE("Reading a current graph file with and without the visibility graphs") {
+    std::string file(__FILE__);
+    file = file.substr(0, file.find_last_of("/\\") + 1) + "../testdata/gallery_connected_with_isovist.graph";
+
+    // write the test data out again first, so that a full read is expected to give back
+    // exactly the same bytes
+    MetaGraph original;
+    REQUIRE(original.readFromFile(file) == MetaGraph::OK);
+    SelfCleaningFile current("gallery_current.graph");
+    REQUIRE(original.write(current.Filename(), METAGRAPH_VERSION) == MetaGraph::OK);
+
+    MetaGraph full;
+    REQUIRE(full.readFromFile(current.Filename()) == MetaGraph::OK);
+    MetaGraph skipped;
+    REQUIRE(skipped.readFromFile(current.Filename(), MetaGraph::SKIP_VISIBILITY_GRAPHS) == MetaGraph::OK);
+
+    SECTION("A full read writes back the same file") {
+        SelfCleaningFile again("gallery_again.graph");
+        REQUIRE(full.write(again.Filename(), METAGRAPH_VERSION) == MetaGraph::OK);
+        REQUIRE(readWholeFile(again.Filename()) == readWholeFile(current.Filename()));
+    }
+
+    SECTION("Skipping the visibility graphs keeps everything else") {
+        REQUIRE(skipped.getState() == full.getState());
+        REQUIRE(skipped.getPointMaps().size() == full.getPointMaps().size());
+        REQUIRE(!full.getPointMaps().empty());
+        for (size_t i = 0; i < full.getPointMaps().size(); i++) {
+            PointMap &fullMap = full.getPointMaps()[i];
+            PointMap &skippedMap = skipped.getPointMaps()[i];
+            REQUIRE(skippedMap.getFilledPointCount() == fullMap.getFilledPointCount());
+            REQUIRE(summary(skippedMap) == summary(fullMap));
+
+            size_t nodes = 0;
+            for (size_t col = 0; col < fullMap.getCols(); col++) {
+                for (size_t row = 0; row < fullMap.getRows(); row++) {
+                    PixelRef pix(static_cast<short>(col), static_cast<short>(row));
+                    nodes += fullMap.getPoint(pix).hasNode() ? 1 : 0;
+                    REQUIRE_FALSE(skippedMap.getPoint(pix).hasNode());
+                }
+            }
+            REQUIRE(nodes > 0);
+        }
+        REQUIRE(skipped.getDataMaps().size() == full.getDataMaps().size());
+        REQUIRE(skipped.getShapeGraphs().size() == full.getShapeGraphs().size());
+    }
+
+    SECTION("Reading from a stream gives the same graph as the mapped file") {
+        std::ifstream stream(current.Filename(), std::ios::binary);
+        MetaGraph streamed;
+        REQUIRE(streamed.readFromStream(stream, current.Filename()) == MetaGraph::OK);
+        SelfCleaningFile again("gallery_streamed.graph");
+        REQUIRE(streamed.write(again.Filename(), METAGRAPH_VERSION) == MetaGraph::OK);
+        REQUIRE(readWholeFile(again.Filename()) == readWholeFile(current.Filename()));
+    }
+}
+
+TEST_CASE("Reading an older graph file upgrades it through a temporary file") {
+    std::string file(__FILE__);
+    file = file.substr(0, file.find_last_of("/\\") + 1) + "../testdata/barnsbury_axial.graph";
+
+    // an axial map is stored in the same way in version 430, only the version number differs
+    std::string contents = readWholeFile(file);
+    int olderVersion = 430;
+    contents.replace(3, sizeof(olderVersion), reinterpret_cast<const char *>(&olderVersion), sizeof(olderVersion));
+    SelfCleaningFile older("barnsbury_axial_430.graph");
+    std::ofstream(older.Filename(), std::ios::binary) << contents;
+
+    size_t upgradeFiles = countUpgradeFiles();
+    MetaGraph upgraded;
+    REQUIRE(upgraded.readFromFile(older.Filename()) == MetaGraph::OK);
+    REQUIRE(countUpgradeFiles() == upgradeFiles);
+
+    MetaGraph current;
+    REQUIRE(current.readFromFile(file) == MetaGraph::OK);
+    REQUIRE(upgraded.getShapeGraphs().size() == 1);
+    std::stringstream upgradedMif, upgradedMid, currentMif, currentMid;
+    upgraded.getShapeGraphs()[0]->outputMifMap(upgradedMif, upgradedMid);
+    current.getShapeGraphs()[0]->outputMifMap(currentMif, currentMid);
+    REQUIRE(upgradedMif.str() == currentMif.str());
+    REQUIRE(upgradedMid.str() == currentMid.str());
+
+    // the same as reading the older file from a stream
+    std::ifstream stream(older.Filename(), std::ios::binary);
+    MetaGraph streamed;
+    REQUIRE(streamed.readFromStream(stream, older.Filename()) == MetaGraph::OK);
+    std::stringstream streamedMif, streamedMid;
+    streamed.getShapeGraphs()[0]->outputMifMap(streamedMif, streamedMid);
+    REQUIRE(streamedMid.str() == currentMid.str());
+}
+
+TEST_CASE("Writing and reading compressed graph files") {
+    std::string file(__FILE__);
+    file = file.substr(0, file.find_last_of("/\\") + 1) + "../testdata/gallery_connected_with_isovist.graph";
+    MetaGraph original;
+    REQUIRE(original.readFromFile(file) == MetaGraph::OK);
+
+    SelfCleaningFile plain("gallery_plain.graph");
+    SelfCleaningFile compressed("gallery_compressed.graph");
+    REQUIRE(original.write(plain.Filename(), METAGRAPH_VERSION) == MetaGraph::OK);
+    REQUIRE(original.write(compressed.Filename(), METAGRAPH_VERSION, false, true) == MetaGraph::OK);
+    REQUIRE(readWholeFile(compressed.Filename()).size() < readWholeFile(plain.Filename()).size() / 2);
+
+    SECTION("A compressed file reads back to the same graph") {
+        MetaGraph read;
+        REQUIRE(read.readFromFile(compressed.Filename()) == MetaGraph::OK);
+        SelfCleaningFile again("gallery_again.graph");
+        REQUIRE(read.write(again.Filename(), METAGRAPH_VERSION) == MetaGraph::OK);
+        REQUIRE(readWholeFile(again.Filename()) == readWholeFile(plain.Filename()));
+    }
+
+    SECTION("Skipping the visibility graphs in a compressed file") {
+        MetaGraph read;
+        REQUIRE(read.readFromFile(compressed.Filename(), MetaGraph::SKIP_VISIBILITY_GRAPHS) == MetaGraph::OK);
+        REQUIRE(summary(read.getPointMaps()[0]) == summary(original.getPointMaps()[0]));
+    }
+
+    SECTION("A compressed file read from a stream") {
+        std::ifstream stream(compressed.Filename(), std::ios::binary);
+        MetaGraph read;
+        REQUIRE(read.readFromStream(stream, compressed.Filename()) == MetaGraph::OK);
+        REQUIRE(summary(read.getPointMaps()[0]) == summary(original.getPointMaps()[0]));
+    }
+
+    SECTION("A damaged compressed file") {
+        std::string contents = readWholeFile(compressed.Filename());
+        SelfCleaningFile damaged("gallery_damaged.graph");
+        std::ofstream(damaged.Filename(), std::ios::binary) << contents.substr(0, contents.size() - 10);
+        MetaGraph read;
+        REQUIRE(read.readFromFile(damaged.Filename()) == MetaGraph::DAMAGED_FILE);
+    }
+}
+
+// not run by default, use: salaTest [benchmark]
+TEST_CASE("Benchmark plain and compressed graph files", "[.][benchmark]") {
+    std::string testData(__FILE__);
+    testData = testData.substr(0, testData.find_last_of("/\\") + 1) + "../testdata/";
+    auto milliseconds = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    for (auto &entry : std::filesystem::directory_iterator(testData)) {
+        if (entry.path().extension() != ".graph") {
+            continue;
+        }
+        MetaGraph original;
+        REQUIRE(original.readFromFile(entry.path().string()) == MetaGraph::OK);
+        SelfCleaningFile plain("benchmark_plain.graph");
+        SelfCleaningFile compressed("benchmark_compressed.graph");
+
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE(original.write(plain.Filename(), METAGRAPH_VERSION) == MetaGraph::OK);
+        double plainSave = milliseconds(start);
+        start = std::chrono::steady_clock::now();
+        REQUIRE(original.write(compressed.Filename(), METAGRAPH_VERSION, false, true) == MetaGraph::OK);
+        double compressedSave = milliseconds(start);
+
+        MetaGraph plainRead, compressedRead;
+        start = std::chrono::steady_clock::now();
+        REQUIRE(plainRead.readFromFile(plain.Filename()) == MetaGraph::OK);
+        double plainLoad = milliseconds(start);
+        start = std::chrono::steady_clock::now();
+        REQUIRE(compressedRead.readFromFile(compressed.Filename()) == MetaGraph::OK);
+        double compressedLoad = milliseconds(start);
+
+        std::cout << entry.path().filename().string() << ": plain " << std::filesystem::file_size(plain.Filename())
+                  << " bytes, save " << plainSave << " ms, load " << plainLoad << " ms; compressed "
+                  << std::filesystem::file_size(compressed.Filename()) << " bytes, save " << compressedSave
+                  << " ms, load " << compressedLoad << " ms" << std::endl;
+    }
+}
@@ -0,0 +1,96 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/importutils.h"
+
+#include <sstream>
+
+TEST_CASE("Importing lines with attributes from a text file", "") {
+    ShapeMap shapeMap("Lines", ShapeMap::DATAMAP);
+
+    SECTION("Lines without keys, with text cells and windows line ends") {
+        std::stringstream stream;
+        stream << "x1,y1,x2,y2,road_width,kind\r\n"
+               << "0,0,1,0,2.5,main\r\n"
+               << "\r\n"
+               << "0,1,1,1,+3,side\r\n"
+               << "0,2,1,2,4e-1,main\r\n";
+        REQUIRE(depthmapX::importTxt(shapeMap, stream, ','));
+
+        REQUIRE(shapeMap.getShapeCount() == 3);
+        const AttributeTable &attributes = shapeMap.getAttributeTable();
+        size_t widthCol = attributes.getColumnIndex("Road Width");
+        size_t kindCol = attributes.getColumnIndex("Kind");
+        const auto &shapes = shapeMap.getAllShapes();
+        auto shape = shapes.begin();
+        REQUIRE(shape->second.getLine().start().y == Approx(0.0));
+        REQUIRE(attributes.getRow(AttributeKey(shape->first)).getValue(widthCol) == Approx(2.5f));
+        REQUIRE(attributes.getRow(AttributeKey(shape->first)).getValue(kindCol) == 0.0f);
+        ++shape;
+        REQUIRE(attributes.getRow(AttributeKey(shape->first)).getValue(widthCol) == Approx(3.0f));
+        REQUIRE(attributes.getRow(AttributeKey(shape->first)).getValue(kindCol) == 1.0f);
+        ++shape;
+        REQUIRE(attributes.getRow(AttributeKey(shape->first)).getValue(widthCol) == Approx(0.4f));
+        REQUIRE(attributes.getRow(AttributeKey(shape->first)).getValue(kindCol) == 0.0f);
+    }
+
+    SECTION("Lines with keys out of order") {
+        std::stringstream stream;
+        stream << "Ref,x1,y1,x2,y2,value\n"
+               << "7,0,7,1,7,70\n"
+               << "3,0,3,1,3,30\n"
+               << "5,0,5,1,5,50\n";
+        REQUIRE(depthmapX::importTxt(shapeMap, stream, ','));
+
+        REQUIRE(shapeMap.getShapeCount() == 3);
+        const AttributeTable &attributes = shapeMap.getAttributeTable();
+        size_t valueCol = attributes.getColumnIndex("Value");
+        for (const auto &shape : shapeMap.getAllShapes()) {
+            REQUIRE(shape.second.getLine().start().y == Approx(shape.first));
+            REQUIRE(attributes.getRow(AttributeKey(shape.first)).getValue(valueCol) == Approx(shape.first * 10));
+        }
+    }
+
+    SECTION("Rows with the wrong number of cells") {
+        std::stringstream stream;
+        stream << "x1,y1,x2,y2\n"
+               << "0,0,1,0\n"
+               << "0,1,1\n";
+        REQUIRE_THROWS_AS(depthmapX::importTxt(shapeMap, stream, ','), depthmapX::RuntimeException);
+    }
+}
+
+TEST_CASE("Importing points from a text file read in several blocks", "") {
+    // enough rows to run over the 1MB blocks the file is read in
+    const size_t rows = 100000;
+    std::stringstream stream;
+    stream << "easting\tnorthing\tindex\n";
+    for (size_t i = 0; i < rows; i++) {
+        stream << 2 * i << ".5\t" << 2000 << "\t" << i << "\n";
+    }
+    ShapeMap shapeMap("Points", ShapeMap::DATAMAP);
+    REQUIRE(depthmapX::importTxt(shapeMap, stream, '\t'));
+
+    REQUIRE(shapeMap.getShapeCount() == rows);
+    const AttributeTable &attributes = shapeMap.getAttributeTable();
+    size_t indexCol = attributes.getColumnIndex("Index");
+    size_t misplaced = 0;
+    for (const auto &shape : shapeMap.getAllShapes()) {
+        float index = attributes.getRow(AttributeKey(shape.first)).getValue(indexCol);
+        if (shape.second.getPoint().x != 2.0 * double(index) + 0.5) {
+            misplaced++;
+        }
+    }
+    REQUIRE(misplaced == 0);
+}
@@ -14,7 +14,12 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "catch.hpp"
+#include "salalib/isovist.h"
 #include "salalib/mgraph.h"
+#include "salalib/vgamodules/vgaisovist.h"
+
+#include <chrono>
+#include <iostream>
 
 TEST_CASE("Simple Isovist") {
 
@@ -100,3 +105,89 @@ TEST_CASE("Simple Isovist") {
     REQUIRE(isovist.m_points[11].x == Approx(3.0).epsilon(EPSILON));
     REQUIRE(isovist.m_points[11].y == Approx(2.5).epsilon(EPSILON));
 }
+
+static void requireSameIsovist(const Isovist &expected, const Isovist &actual) {
+    REQUIRE(expected.getPolygon() == actual.getPolygon());
+    REQUIRE(expected.getOcclusionPoints().size() == actual.getOcclusionPoints().size());
+    for (size_t i = 0; i < expected.getOcclusionPoints().size(); i++) {
+        REQUIRE(expected.getOcclusionPoints()[i].m_point == actual.getOcclusionPoints()[i].m_point);
+        REQUIRE(expected.getOcclusionPoints()[i].m_dist == actual.getOcclusionPoints()[i].m_dist);
+    }
+}
+
+TEST_CASE("Isovist from a flattened BSP tree") {
+    // a room split in three by two walls with doors, plus some free standing walls
+    std::vector<TaggedLine> lines = {
+        TaggedLine(Line(Point2f(0, 0), Point2f(0, 6)), 0),     TaggedLine(Line(Point2f(0, 6), Point2f(9, 6)), 0),
+        TaggedLine(Line(Point2f(9, 6), Point2f(9, 0)), 0),     TaggedLine(Line(Point2f(9, 0), Point2f(0, 0)), 0),
+        TaggedLine(Line(Point2f(3, 0), Point2f(3, 2.5)), 1),   TaggedLine(Line(Point2f(3, 3.5), Point2f(3, 6)), 1),
+        TaggedLine(Line(Point2f(6, 0), Point2f(6, 4)), 2),     TaggedLine(Line(Point2f(6, 5), Point2f(6, 6)), 2),
+        TaggedLine(Line(Point2f(1, 4), Point2f(2, 4.5)), 3),   TaggedLine(Line(Point2f(4, 1), Point2f(5, 1)), 4),
+        TaggedLine(Line(Point2f(7, 2), Point2f(8, 3)), 5),     TaggedLine(Line(Point2f(7.5, 4.5), Point2f(8.5, 5)), 6),
+        TaggedLine(Line(Point2f(4.5, 4), Point2f(4.5, 5)), 7), TaggedLine(Line(Point2f(1, 1), Point2f(1.5, 1.5)), 8)};
+
+    BSPNode root;
+    BSPTree::make(nullptr, 0, lines, &root);
+    FlatBSPTree tree = BSPTree::flatten(root);
+    QtRegion region(Point2f(0, 0), Point2f(9, 6));
+
+    // one scratch isovist is reused for all the origins, as the VGA workers do
+    Isovist flatIsovist;
+    for (double x = 0.25; x < 9; x += 0.5) {
+        for (double y = 0.25; y < 6; y += 0.5) {
+            Isovist isovist;
+            isovist.makeit(&root, Point2f(x, y), region);
+            flatIsovist.makeit(tree, Point2f(x, y), region);
+            requireSameIsovist(isovist, flatIsovist);
+
+            // and a partial one, wrapping round 0
+            isovist.makeit(&root, Point2f(x, y), region, 1.5 * M_PI, 0.25 * M_PI);
+            flatIsovist.makeit(tree, Point2f(x, y), region, 1.5 * M_PI, 0.25 * M_PI);
+            requireSameIsovist(isovist, flatIsovist);
+        }
+    }
+}
+
+// not run by default, use: salaTest [benchmark]
+TEST_CASE("Benchmark isovists from the full and the culled BSP tree walk", "[.][benchmark]") {
+    std::string file(__FILE__);
+    file = file.substr(0, file.find_last_of("/\\") + 1) + "../testdata/gallery_connected.graph";
+    MetaGraph metaGraph;
+    REQUIRE(metaGraph.readFromFile(file) == MetaGraph::OK);
+    PointMap &map = metaGraph.getPointMaps().front();
+
+    BSPNode root = VGAIsovist().makeBSPtree(nullptr, map.getDrawingFiles());
+    FlatBSPTree tree = BSPTree::flatten(root);
+
+    std::vector<Point2f> origins;
+    for (size_t i = 0; i < map.getCols(); i++) {
+        for (size_t j = 0; j < map.getRows(); j++) {
+            PixelRef curs(static_cast<short>(i), static_cast<short>(j));
+            if (map.getPoint(curs).filled()) {
+                origins.push_back(map.depixelate(curs));
+            }
+        }
+    }
+
+    double fullArea = 0.0, culledArea = 0.0;
+    Isovist isovist;
+    auto start = std::chrono::steady_clock::now();
+    for (const Point2f &origin : origins) {
+        isovist.makeit(&root, origin, map.getRegion());
+        fullArea += isovist.getColumnValues(true)[0];
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (const Point2f &origin : origins) {
+        isovist.makeit(tree, origin, map.getRegion());
+        culledArea += isovist.getColumnValues(true)[0];
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    REQUIRE(fullArea == culledArea);
+    double fullSeconds = std::chrono::duration<double>(middle - start).count();
+    double culledSeconds = std::chrono::duration<double>(end - middle).count();
+    std::cout << "gallery_connected.graph (" << origins.size() << " isovists, " << tree.nodes.size()
+              << " BSP nodes)\n"
+              << "  full walk:    " << origins.size() / fullSeconds << " isovists/s\n"
+              << "  culled walk:  " << origins.size() / culledSeconds << " isovists/s" << std::endl;
+}
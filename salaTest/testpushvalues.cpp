@@ -630,3 +630,96 @@ TEST_CASE("Push values from shapemaps to VGA", "") {
         }
     }
 }
+
+TEST_CASE("Push values between shapemaps on several threads", "") {
+    // two overlapping squares in a data map, and lines in an axial map, some crossing both squares,
+    // one only the first, one inside the second and one missing both
+    //
+    //   +-----+
+    //   |  +--+--+
+    //   |  |  |  |
+    //   +--+--+  |
+    //      +-----+
+
+    std::unique_ptr<MetaGraph> mgraph(new MetaGraph);
+    Point2f bottomLeft(0, 0);
+    Point2f topRight(10, 10);
+    mgraph->setRegion(bottomLeft, topRight);
+
+    mgraph->addShapeMap("Test Data Map");
+    ShapeMap &dataMap = mgraph->getDataMaps().back();
+    dataMap.makePolyShape({Point2f(1, 4), Point2f(1, 8), Point2f(5, 8), Point2f(5, 4)}, false);
+    dataMap.makePolyShape({Point2f(3, 2), Point2f(3, 6), Point2f(7, 6), Point2f(7, 2)}, false);
+    int dataColIdx = dataMap.addAttribute("Data Value");
+    dataMap.getAttributeTable().getRow(AttributeKey(0)).setValue(dataColIdx, 1);
+    dataMap.getAttributeTable().getRow(AttributeKey(1)).setValue(dataColIdx, 2);
+
+    mgraph->addShapeGraph("Test Axial Map", ShapeMap::AXIALMAP);
+    ShapeGraph &axialMap = *mgraph->getShapeGraphs().back().get();
+    axialMap.init(5, mgraph->getRegion());
+    axialMap.initialiseAttributesAxial();
+    axialMap.makeLineShape(Line(Point2f(0.5, 5), Point2f(9.5, 5)));   // both
+    axialMap.makeLineShape(Line(Point2f(2, 7), Point2f(2, 9.5)));     // first
+    axialMap.makeLineShape(Line(Point2f(6, 2.5), Point2f(6.5, 3)));   // inside the second
+    axialMap.makeLineShape(Line(Point2f(8, 8), Point2f(9, 9)));       // neither
+    axialMap.makeLineShape(Line(Point2f(0.5, 0.5), Point2f(9.5, 9.5))); // both, diagonally
+    int axialColIdx = axialMap.addAttribute("Axial Value");
+    for (int i = 0; i < 5; i++) {
+        axialMap.getAttributeTable().getRow(AttributeKey(i)).setValue(axialColIdx, float(i + 1));
+    }
+
+    SECTION("Data map to axial map") {
+        int serialCol = axialMap.addAttribute("Serial");
+        int parallelCol = axialMap.addAttribute("Parallel");
+        for (int func : {MetaGraph::PUSH_FUNC_MAX, MetaGraph::PUSH_FUNC_MIN, MetaGraph::PUSH_FUNC_AVG,
+                         MetaGraph::PUSH_FUNC_TOT}) {
+            mgraph->pushValuesToLayer(MetaGraph::VIEWDATA, 0, MetaGraph::VIEWAXIAL, 0, dataColIdx, serialCol, func,
+                                      false, 1);
+            mgraph->pushValuesToLayer(MetaGraph::VIEWDATA, 0, MetaGraph::VIEWAXIAL, 0, dataColIdx, parallelCol, func,
+                                      false, 3);
+            for (int i = 0; i < 5; i++) {
+                const AttributeRow &row = axialMap.getAttributeTable().getRow(AttributeKey(i));
+                REQUIRE(row.getValue(serialCol) == row.getValue(parallelCol));
+            }
+        }
+        // the second line starts in the first square and crosses its edge, which counts it twice
+        REQUIRE(axialMap.getAttributeTable().getRow(AttributeKey(1)).getValue(serialCol) == 2);
+        REQUIRE(axialMap.getAttributeTable().getRow(AttributeKey(3)).getValue(serialCol) == -1);
+    }
+
+    SECTION("Axial map to data map") {
+        int serialCol = dataMap.addAttribute("Serial");
+        int parallelCol = dataMap.addAttribute("Parallel");
+        for (int func : {MetaGraph::PUSH_FUNC_MAX, MetaGraph::PUSH_FUNC_MIN, MetaGraph::PUSH_FUNC_AVG,
+                         MetaGraph::PUSH_FUNC_TOT}) {
+            mgraph->pushValuesToLayer(MetaGraph::VIEWAXIAL, 0, MetaGraph::VIEWDATA, 0, axialColIdx, serialCol, func,
+                                      false, 1);
+            mgraph->pushValuesToLayer(MetaGraph::VIEWAXIAL, 0, MetaGraph::VIEWDATA, 0, axialColIdx, parallelCol, func,
+                                      false, 3);
+            for (int i = 0; i < 2; i++) {
+                const AttributeRow &row = dataMap.getAttributeTable().getRow(AttributeKey(i));
+                REQUIRE(row.getValue(serialCol) == row.getValue(parallelCol));
+            }
+        }
+    }
+
+    SECTION("Batched lists match the single ones") {
+        std::vector<const SalaShape *> lines;
+        for (auto &shape : axialMap.getAllShapes()) {
+            lines.push_back(&shape.second);
+        }
+        std::vector<const SalaShape *> squares;
+        for (auto &shape : dataMap.getAllShapes()) {
+            squares.push_back(&shape.second);
+        }
+        std::vector<std::vector<int>> linesInSquares = dataMap.shapeInPolyLists(lines, 3);
+        std::vector<std::vector<int>> squaresOnLines = axialMap.shapeInPolyLists(squares, 3);
+        for (size_t i = 0; i < lines.size(); i++) {
+            REQUIRE(linesInSquares[i] == dataMap.shapeInPolyList(*lines[i]));
+        }
+        for (size_t i = 0; i < squares.size(); i++) {
+            REQUIRE(squaresOnLines[i] == axialMap.shapeInPolyList(*squares[i]));
+        }
+        REQUIRE(linesInSquares[3].empty());
+    }
+}
@@ -0,0 +1,166 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/mgraph.h"
+
+#include "genlib/radixheap.h"
+#include "genlib/simplematrix.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+TEST_CASE("RadixHeap pops in the same order as a std::set", "") {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> step(0.0f, 3.0f);
+    std::uniform_int_distribution<short> coordinate(0, 50);
+
+    depthmapX::RadixHeap<MetricTriple> heap;
+    std::set<MetricTriple> set;
+    heap.push(MetricTriple(0.0f, PixelRef(0, 0)));
+    set.insert(MetricTriple(0.0f, PixelRef(0, 0)));
+
+    // expand like a search does: everything pushed is at least as far as what was popped,
+    // with plenty of exact ties (including ties with the popped key)
+    int pushes = 0;
+    while (!set.empty()) {
+        REQUIRE(heap.size() == set.size());
+        MetricTriple expected = *set.begin();
+        set.erase(set.begin());
+        MetricTriple actual = heap.pop();
+        REQUIRE(actual.dist == expected.dist);
+        REQUIRE(actual.pixel == expected.pixel);
+        if (pushes < 20000) {
+            for (int i = 0; i < 3; i++) {
+                float dist = expected.dist + (i == 0 ? 0.0f : std::floor(step(generator) * 4.0f) * 0.25f);
+                MetricTriple next(dist, PixelRef(coordinate(generator), coordinate(generator)), expected.pixel);
+                if (set.insert(next).second) {
+                    heap.push(next);
+                    pushes++;
+                }
+            }
+        }
+    }
+    REQUIRE(heap.empty());
+
+    heap.push(MetricTriple(5.0f, PixelRef(1, 1)));
+    heap.clear();
+    REQUIRE(heap.empty());
+    // after a clear keys smaller than the last popped one are allowed again
+    heap.push(MetricTriple(1.0f, PixelRef(2, 1)));
+    heap.push(MetricTriple(0.5f, PixelRef(1, 2)));
+    REQUIRE(heap.pop().pixel == PixelRef(1, 2));
+    REQUIRE(heap.pop().pixel == PixelRef(2, 1));
+}
+
+namespace {
+    // the std::set queue the VGA metric and angular analyses used to run on
+    struct SetQueue {
+        std::set<MetricTriple> items;
+        bool empty() const { return items.empty(); }
+        void push(const MetricTriple &item) { items.insert(item); }
+        MetricTriple pop() {
+            MetricTriple item = *items.begin();
+            items.erase(items.begin());
+            return item;
+        }
+        void clear() { items.clear(); }
+    };
+
+    // a cut down metric search from every n-th origin, returning the sum of all depths
+    template <typename Queue> double metricSearches(PointMap &map, Queue &queue, size_t every) {
+        depthmapX::RowMatrix<float> dists(map.getRows(), map.getCols());
+        depthmapX::RowMatrix<int> seen(map.getRows(), map.getCols());
+        double total = 0.0;
+        size_t n = 0;
+        for (size_t i = 0; i < map.getCols(); i++) {
+            for (size_t j = 0; j < map.getRows(); j++) {
+                PixelRef curs(static_cast<short>(i), static_cast<short>(j));
+                if (!map.getPoint(curs).filled() || n++ % every != 0) {
+                    continue;
+                }
+                dists.initialiseValues(-1.0f);
+                seen.initialiseValues(0);
+                queue.clear();
+                queue.push(MetricTriple(0.0f, curs, NoPixel));
+                while (!queue.empty()) {
+                    MetricTriple here = queue.pop();
+                    Point &p = map.getPoint(here.pixel);
+                    if (!p.filled() || seen(here.pixel.y, here.pixel.x)) {
+                        continue;
+                    }
+                    seen(here.pixel.y, here.pixel.x) = 1;
+                    total += here.dist;
+                    Node &node = p.getNode();
+                    for (int b = 0; b < 32; b++) {
+                        Bin &bin = node.bin(b);
+                        for (auto pixVec : bin.m_pixel_vecs) {
+                            for (PixelRef pix = pixVec.start(); pix.col(bin.m_dir) <= pixVec.end().col(bin.m_dir);) {
+                                float dist = here.dist + (float)::dist(pix, here.pixel);
+                                float &pdist = dists(pix.y, pix.x);
+                                if (!seen(pix.y, pix.x) && (pdist == -1.0f || dist < pdist)) {
+                                    pdist = dist;
+                                    queue.push(MetricTriple(dist, pix, here.pixel));
+                                }
+                                pix.move(bin.m_dir);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return total;
+    }
+
+    void compareQueues(const std::string &name, PointMap &map, size_t every) {
+        SetQueue setQueue;
+        depthmapX::RadixHeap<MetricTriple> radixHeap;
+
+        auto start = std::chrono::steady_clock::now();
+        double setTotal = metricSearches(map, setQueue, every);
+        auto middle = std::chrono::steady_clock::now();
+        double heapTotal = metricSearches(map, radixHeap, every);
+        auto end = std::chrono::steady_clock::now();
+
+        REQUIRE(setTotal == heapTotal);
+        std::cout << name << " (" << map.getFilledPointCount() << " points, every " << every << ". origin)\n"
+                  << "  std::set:   " << std::chrono::duration<double, std::milli>(middle - start).count() << " ms\n"
+                  << "  RadixHeap:  " << std::chrono::duration<double, std::milli>(end - middle).count() << " ms"
+                  << std::endl;
+    }
+} // namespace
+
+// not run by default, use: salaTest [benchmark]
+TEST_CASE("Benchmark RadixHeap against std::set for metric VGA", "[.][benchmark]") {
+    SECTION("gallery_connected.graph") {
+        std::string file(__FILE__);
+        file = file.substr(0, file.find_last_of("/\\") + 1) + "../testdata/gallery_connected.graph";
+        MetaGraph metaGraph;
+        REQUIRE(metaGraph.readFromFile(file) == MetaGraph::OK);
+        compareQueues("gallery_connected.graph", metaGraph.getPointMaps().front(), 20);
+    }
+
+    SECTION("Dense grid") {
+        Point2f bottomLeft(0, 0);
+        Point2f topRight(20, 20);
+        MetaGraph metaGraph("Dense grid");
+        metaGraph.setRegion(bottomLeft, topRight);
+        PointMap map(metaGraph.getRegion(), metaGraph.m_drawingFiles, "Dense grid");
+        map.setGrid(0.5, Point2f(0, 0));
+        map.makePoints(Point2f(10.25, 10.25), 0);
+        std::unique_ptr<Communicator> comm(new ICommunicator());
+        REQUIRE(map.sparkGraph2(comm.get(), false, -1));
+        compareQueues("Dense grid", map, 20);
+    }
+}
@@ -0,0 +1,69 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/mapconverter.h"
+#include "salalib/mgraph.h"
+#include "salalib/segmmodules/segmtulip.h"
+
+// a street-like tangle of crossing lines, broken up into segments
+static std::unique_ptr<ShapeGraph> makeSegmentMap() {
+    std::vector<SpacePixelFile> drawingFiles;
+    drawingFiles.emplace_back("Test SpacePixelGroup");
+    auto &spacePixel = drawingFiles.back().m_spacePixels;
+    spacePixel.emplace_back("Test ShapeMap");
+    for (int i = 0; i < 10; i++) {
+        double x = i * 1.5;
+        spacePixel.back().makeLineShape(Line(Point2f(x, 0.5 * (i % 3)), Point2f(x + 2.0, 0.5 * (i % 3))));
+        spacePixel.back().makeLineShape(Line(Point2f(x + 0.2, -1.0 - 0.3 * (i % 2)), Point2f(x + 0.2, 2.0)));
+        spacePixel.back().makeLineShape(Line(Point2f(x + 0.7, 1.5), Point2f(x + 1.9, 3.0 + 0.2 * (i % 4))));
+    }
+    auto axialMap = MapConverter::convertDrawingToAxial(nullptr, "Test axial", drawingFiles);
+    auto segmentMap = MapConverter::convertAxialToSegment(nullptr, *axialMap, "Test segment");
+    REQUIRE(segmentMap->getShapeCount() > 50);
+    return segmentMap;
+}
+
+static void requireSameValues(const AttributeTable &expected, const AttributeTable &actual) {
+    REQUIRE(expected.getNumColumns() == actual.getNumColumns());
+    REQUIRE(expected.getNumRows() == actual.getNumRows());
+    for (size_t col = 0; col < expected.getNumColumns(); col++) {
+        REQUIRE(expected.getColumnName(col) == actual.getColumnName(col));
+    }
+    for (auto iter = expected.begin(); iter != expected.end(); iter++) {
+        const AttributeRow &actualRow = actual.getRow(iter->getKey());
+        for (size_t col = 0; col < expected.getNumColumns(); col++) {
+            REQUIRE(iter->getRow().getValue(col) == actualRow.getValue(col));
+        }
+    }
+}
+
+static void requireSameAnalysis(const std::set<double> &radii, int radiusType, bool weighted, int threads) {
+    auto serialMap = makeSegmentMap();
+    auto parallelMap = makeSegmentMap();
+    int weightCol = weighted ? static_cast<int>(serialMap->getAttributeTable().getColumnIndex("Segment Length")) : -1;
+
+    REQUIRE(SegmentTulip(radii, false, 1024, weightCol, radiusType, true, false, -1, -1, 1)
+                .run(nullptr, *serialMap, false));
+    REQUIRE(SegmentTulip(radii, false, 1024, weightCol, radiusType, true, false, -1, -1, threads)
+                .run(nullptr, *parallelMap, false));
+
+    requireSameValues(serialMap->getAttributeTable(), parallelMap->getAttributeTable());
+}
+
+TEST_CASE("Parallel tulip analysis matches the serial analysis", "") {
+    SECTION("Radius n") { requireSameAnalysis({-1.0}, Options::RADIUS_ANGULAR, false, 4); }
+    SECTION("Metric radii") { requireSameAnalysis({2.0, 5.0, -1.0}, Options::RADIUS_METRIC, false, 3); }
+    SECTION("Weighted angular radii") { requireSameAnalysis({0.5, 1.5, -1.0}, Options::RADIUS_ANGULAR, true, 4); }
+    SECTION("Weighted step radii") { requireSameAnalysis({3.0, -1.0}, Options::RADIUS_STEPS, true, 64); }
+}
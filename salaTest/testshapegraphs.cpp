@@ -161,3 +161,30 @@ TEST_CASE("Testing ShapeMap::getAllLinkLines and ShapeMap::getAllUnlinkPoints()"
     REQUIRE(unlinkPoints[0].x == Approx(intersection.x).epsilon(EPSILON));
     REQUIRE(unlinkPoints[0].y == Approx(intersection.y).epsilon(EPSILON));
 }
+
+TEST_CASE("Axial and segment connections made on several threads match the serial ones")
+{
+    std::string file(__FILE__);
+    file = file.substr(0, file.find_last_of("/\\") + 1) + "../testdata/barnsbury_drawing.graph";
+
+    // the drawing layers are hidden by a conversion, so every map comes from a fresh copy of the file
+    auto convert = [&](bool segment, int threads) {
+        MetaGraph metaGraph;
+        REQUIRE(metaGraph.readFromFile(file) == MetaGraph::OK);
+        auto shapeGraph = segment ? MapConverter::convertDrawingToSegment(nullptr, "map", metaGraph.m_drawingFiles, threads)
+                                  : MapConverter::convertDrawingToAxial(nullptr, "map", metaGraph.m_drawingFiles, threads);
+        return std::vector<Connector>(shapeGraph->getConnections());
+    };
+
+    for (bool segment : {false, true}) {
+        std::vector<Connector> serial = convert(segment, 1);
+        std::vector<Connector> parallel = convert(segment, 3);
+        REQUIRE(serial.size() > 50);
+        REQUIRE(parallel.size() == serial.size());
+        for (size_t i = 0; i < serial.size(); i++) {
+            REQUIRE(parallel[i].m_connections == serial[i].m_connections);
+            REQUIRE(parallel[i].m_back_segconns == serial[i].m_back_segconns);
+            REQUIRE(parallel[i].m_forward_segconns == serial[i].m_forward_segconns);
+        }
+    }
+}
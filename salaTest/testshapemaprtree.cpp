@@ -0,0 +1,194 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/mgraph.h"
+#include "salalib/shapemap.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+
+namespace {
+    std::unique_ptr<ShapeMap> makeTestMap(int spatialIndex) {
+        std::unique_ptr<ShapeMap> shapeMap(new ShapeMap("Test ShapeMap", ShapeMap::DATAMAP, spatialIndex));
+        shapeMap->makePolyShape({Point2f(1, 1), Point2f(5, 1), Point2f(5, 5), Point2f(1, 5)}, false);
+        shapeMap->makePolyShape({Point2f(2, 2), Point2f(3, 2), Point2f(3, 3), Point2f(2, 3)}, false);
+        shapeMap->makePolyShape({Point2f(6, 1), Point2f(9, 1), Point2f(7.5, 4)}, false);
+        shapeMap->makePolyShape({Point2f(4, 4), Point2f(7, 4), Point2f(7, 7), Point2f(4, 7)}, false);
+        shapeMap->makeLineShape(Line(Point2f(0.5, 8), Point2f(9.5, 8)));
+        shapeMap->makeLineShape(Line(Point2f(2.5, 2.5), Point2f(2.7, 2.7)));
+        shapeMap->makePointShape(Point2f(6, 6));
+        shapeMap->makePolyShape({Point2f(0.5, 0.5), Point2f(3, 0.5), Point2f(3, 1.5)}, true);
+        return shapeMap;
+    }
+
+    std::vector<int> unique(std::vector<int> list) {
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        return list;
+    }
+
+    std::unique_ptr<ShapeMap> copyWithIndex(const ShapeMap &map, int spatialIndex) {
+        std::unique_ptr<ShapeMap> copy(new ShapeMap(map.getName(), map.getMapType(), spatialIndex));
+        copy->copy(map, ShapeMap::COPY_GEOMETRY);
+        return copy;
+    }
+} // namespace
+
+TEST_CASE("ShapeMap queries from the packed R-tree") {
+    std::unique_ptr<ShapeMap> grid = makeTestMap(ShapeMap::PIXEL_GRID);
+    std::unique_ptr<ShapeMap> rtree = makeTestMap(ShapeMap::PACKED_RTREE);
+    REQUIRE(rtree->getSpatialIndex() == ShapeMap::PACKED_RTREE);
+
+    SECTION("Point in poly") {
+        REQUIRE(rtree->pointInPolyList(Point2f(2.5, 2.6)) == (std::vector<int>{0, 1}));
+        REQUIRE(rtree->pointInPolyList(Point2f(4.5, 4.5)) == (std::vector<int>{0, 3}));
+        REQUIRE(rtree->pointInPolyList(Point2f(6, 6)) == (std::vector<int>{3}));
+        REQUIRE(rtree->pointInPolyList(Point2f(9, 9)).empty());
+        for (double x = 0.13; x < 10; x += 0.25) {
+            for (double y = 0.17; y < 10; y += 0.25) {
+                REQUIRE(rtree->pointInPolyList(Point2f(x, y)) == grid->pointInPolyList(Point2f(x, y)));
+            }
+        }
+    }
+
+    SECTION("Line in poly") {
+        // the R-tree lists a polygon once for every edge the line crosses
+        Line line(Point2f(0, 3.5), Point2f(10, 3.5));
+        REQUIRE(rtree->lineInPolyList(line) == (std::vector<int>{0, 0, 2, 2}));
+        REQUIRE(unique(grid->lineInPolyList(line)) == (std::vector<int>{0, 2}));
+        // leaving out the line itself
+        REQUIRE(rtree->lineInPolyList(Line(Point2f(2.5, 2.5), Point2f(2.7, 2.7)), 5) == (std::vector<int>{0, 0, 1, 1}));
+    }
+
+    SECTION("Poly in poly") {
+        REQUIRE(rtree->polyInPolyList(0) == (std::vector<int>{1, 3, 5, 7}));
+        REQUIRE(rtree->polyInPolyList(1) == (std::vector<int>{0, 5}));
+        REQUIRE(rtree->polyInPolyList(2).empty());
+        REQUIRE(rtree->polyInPolyList(3) == (std::vector<int>{0, 6}));
+        REQUIRE_THROWS_AS(rtree->polyInPolyList(7), depthmapX::RuntimeException);
+
+        // a polygon that is not on the map is not added to it for the test
+        std::vector<const SalaShape *> shapes{&rtree->getAllShapes().at(1), &rtree->getAllShapes().at(3)};
+        REQUIRE(rtree->shapeInPolyLists(shapes, 2) == (std::vector<std::vector<int>>{{0, 1, 5}, {0, 3, 6}}));
+        REQUIRE(rtree->getShapeCount() == 8);
+    }
+
+    SECTION("Closest line") {
+        for (const Point2f &p : {Point2f(5, 9), Point2f(2.6, 2.0), Point2f(9, 0)}) {
+            REQUIRE(rtree->getClosestLine(p) == grid->getClosestLine(p));
+        }
+        REQUIRE(rtree->getClosestLine(Point2f(5, 9)) == 4);
+        REQUIRE(rtree->getClosestLine(Point2f(2.6, 2.0)) == 5);
+    }
+
+    SECTION("Shapes in region") {
+        std::vector<size_t> shapes;
+        rtree->getShapesInRegion(QtRegion(Point2f(5.8, 5.8), Point2f(6.2, 6.2)), shapes);
+        REQUIRE(shapes.size() == 2);
+        REQUIRE(rtree->getIndex(int(shapes[0])) == 3);
+        REQUIRE(rtree->getIndex(int(shapes[1])) == 6);
+        std::vector<size_t> gridShapes;
+        grid->getShapesInRegion(QtRegion(Point2f(5.8, 5.8), Point2f(6.2, 6.2)), gridShapes);
+        REQUIRE(gridShapes == shapes);
+    }
+
+    SECTION("The R-tree follows changes to the shapes") {
+        REQUIRE(rtree->pointInPolyList(Point2f(8, 9)).empty());
+        rtree->makePolyShape({Point2f(7.5, 8.5), Point2f(8.5, 8.5), Point2f(8.5, 9.5), Point2f(7.5, 9.5)}, false);
+        REQUIRE(rtree->pointInPolyList(Point2f(8, 9)) == (std::vector<int>{8}));
+        rtree->removeShape(0);
+        REQUIRE(rtree->pointInPolyList(Point2f(8, 9)) == (std::vector<int>{7}));
+        REQUIRE(rtree->pointInPolyList(Point2f(2.5, 2.6)) == (std::vector<int>{0}));
+    }
+}
+
+// not run by default, use: salaTest [benchmark]
+TEST_CASE("Benchmark ShapeMap queries from the pixel grid and the packed R-tree", "[.][benchmark]") {
+    for (std::string name : {"barnsbury_axial.graph", "barnsbury_segment.graph"}) {
+        std::string file(__FILE__);
+        file = file.substr(0, file.find_last_of("/\\") + 1) + "../testdata/" + name;
+        MetaGraph metaGraph;
+        REQUIRE(metaGraph.readFromFile(file) == MetaGraph::OK);
+        REQUIRE(!metaGraph.getShapeGraphs().empty());
+        const ShapeMap &source = *metaGraph.getShapeGraphs().front();
+
+        std::unique_ptr<ShapeMap> grid = copyWithIndex(source, ShapeMap::PIXEL_GRID);
+        std::unique_ptr<ShapeMap> rtree = copyWithIndex(source, ShapeMap::PACKED_RTREE);
+        rtree->makeRTree();
+
+        std::vector<Line> lines;
+        for (const auto &shape : source.getAllShapes()) {
+            lines.push_back(shape.second.getLine());
+        }
+        const QtRegion &region = source.getRegion();
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<double> x(region.bottom_left.x, region.top_right.x);
+        std::uniform_real_distribution<double> y(region.bottom_left.y, region.top_right.y);
+        std::vector<Point2f> points;
+        for (int i = 0; i < 10000; i++) {
+            points.push_back(Point2f(x(generator), y(generator)));
+        }
+        double boxSize = std::max(region.width(), region.height()) / 50.0;
+
+        auto time = [](std::function<void(const ShapeMap &)> query, const ShapeMap &map) {
+            auto start = std::chrono::steady_clock::now();
+            query(map);
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        auto report = [&](const std::string &queryName, std::function<void(const ShapeMap &)> query) {
+            double gridTime = time(query, *grid);
+            double rtreeTime = time(query, *rtree);
+            std::cout << name << ", " << queryName << ": pixel grid " << gridTime << " ms, packed R-tree " << rtreeTime
+                      << " ms" << std::endl;
+        };
+
+        size_t found = 0;
+        report(std::to_string(lines.size()) + " x lineInPolyList", [&](const ShapeMap &map) {
+            for (size_t i = 0; i < lines.size(); i++) {
+                found += map.lineInPolyList(lines[i], size_t(map.getIndex(int(i)))).size();
+            }
+        });
+        report(std::to_string(points.size()) + " x getClosestLine", [&](const ShapeMap &map) {
+            for (const Point2f &p : points) {
+                found += size_t(map.getClosestLine(p));
+            }
+        });
+        report("1000 x getShapesInRegion", [&](const ShapeMap &map) {
+            std::vector<size_t> shapes;
+            for (size_t i = 0; i < 1000; i++) {
+                map.getShapesInRegion(QtRegion(points[i], points[i] + Point2f(boxSize, boxSize)), shapes);
+                found += shapes.size();
+            }
+        });
+        report(std::to_string(points.size()) + " x pointInPolyList", [&](const ShapeMap &map) {
+            for (const Point2f &p : points) {
+                found += map.pointInPolyList(p).size();
+            }
+        });
+        REQUIRE(found > 0);
+
+        // both indexes give the same answers, apart from how often a shape is repeated
+        for (size_t i = 0; i < lines.size(); i++) {
+            size_t ref = size_t(source.getIndex(int(i)));
+            REQUIRE(unique(rtree->lineInPolyList(lines[i], ref)) == unique(grid->lineInPolyList(lines[i], ref)));
+        }
+        // (lines that meet at the closest point are equally close, and either may be picked)
+        for (size_t i = 0; i < 1000; i++) {
+            double rtreeDistance = dist(points[i], source.getAllShapes().at(rtree->getClosestLine(points[i])).getLine());
+            double gridDistance = dist(points[i], source.getAllShapes().at(grid->getClosestLine(points[i])).getLine());
+            REQUIRE(rtreeDistance == Approx(gridDistance));
+        }
+    }
+}
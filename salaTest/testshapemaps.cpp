@@ -121,3 +121,37 @@ TEST_CASE("Testing ShapeMap::getAllShapes variants")
         REQUIRE(colour.bluef() == Approx(0.2f).epsilon(EPSILON));
     }
 }
+
+TEST_CASE("Testing ShapeMap index and key lookups")
+{
+    std::unique_ptr<ShapeMap> shapeMap(new ShapeMap("Test ShapeMap"));
+
+    shapeMap->makeLineShapeWithRef(Line(Point2f(0, 0), Point2f(1, 0)), 10);
+    shapeMap->makeLineShapeWithRef(Line(Point2f(0, 1), Point2f(1, 1)), 5);
+    shapeMap->makeLineShapeWithRef(Line(Point2f(0, 2), Point2f(1, 2)), 20);
+
+    // the shapes are indexed in key order
+    REQUIRE(shapeMap->getShapeRefFromIndex(0)->first == 5);
+    REQUIRE(shapeMap->getShapeRefFromIndex(1)->first == 10);
+    REQUIRE(shapeMap->getShapeRefFromIndex(2)->first == 20);
+    REQUIRE(shapeMap->getIndexFromShapeRef(5) == 0);
+    REQUIRE(shapeMap->getIndexFromShapeRef(20) == 2);
+    REQUIRE(shapeMap->getIndexFromShapeRef(7) == -1);
+    REQUIRE(shapeMap->getIndexFromShapeRef(30) == -1);
+
+    SECTION("Adding a shape moves the ones after it along")
+    {
+        shapeMap->makeLineShapeWithRef(Line(Point2f(0, 3), Point2f(1, 3)), 7);
+        REQUIRE(shapeMap->getShapeRefFromIndex(1)->first == 7);
+        REQUIRE(shapeMap->getIndexFromShapeRef(10) == 2);
+        REQUIRE(shapeMap->getIndexFromShapeRef(20) == 3);
+    }
+
+    SECTION("Removing a shape moves the ones after it back")
+    {
+        shapeMap->removeShape(10);
+        REQUIRE(shapeMap->getShapeRefFromIndex(1)->first == 20);
+        REQUIRE(shapeMap->getIndexFromShapeRef(10) == -1);
+        REQUIRE(shapeMap->getIndexFromShapeRef(20) == 1);
+    }
+}
@@ -0,0 +1,175 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/mgraph.h"
+#include "salalib/csrvisibilitygraph.h"
+#include "salalib/vgamodules/vgaangular.h"
+#include "salalib/vgamodules/vgaisovist.h"
+#include "salalib/vgamodules/vgametric.h"
+#include "salalib/vgamodules/vgavisuallocal.h"
+
+// a square room with a wall half way across it, so that shortest paths have to turn
+static std::unique_ptr<MetaGraph> makeWalledRoom() {
+    std::unique_ptr<MetaGraph> metaGraph(new MetaGraph("Test MetaGraph"));
+    double size = 4.0;
+    metaGraph->m_drawingFiles.emplace_back("Test SpacePixelGroup");
+    auto &spacePixel = metaGraph->m_drawingFiles.back().m_spacePixels;
+    spacePixel.emplace_back("Test ShapeMap");
+    spacePixel.back().makeLineShape(Line(Point2f(0, 0), Point2f(0, size)));
+    spacePixel.back().makeLineShape(Line(Point2f(0, size), Point2f(size, size)));
+    spacePixel.back().makeLineShape(Line(Point2f(size, size), Point2f(size, 0)));
+    spacePixel.back().makeLineShape(Line(Point2f(size, 0), Point2f(0, 0)));
+    spacePixel.back().makeLineShape(Line(Point2f(size * 0.5, 0), Point2f(size * 0.5, size * 0.7)));
+    metaGraph->m_drawingFiles.back().m_region = spacePixel.back().getRegion();
+    metaGraph->setRegion(metaGraph->m_drawingFiles.back().m_region.bottom_left,
+                         metaGraph->m_drawingFiles.back().m_region.top_right);
+    return metaGraph;
+}
+
+static void makeGraph(PointMap &pointMap, int threads = 1) {
+    pointMap.setGrid(0.25, Point2f(0, 0));
+    pointMap.makePoints(Point2f(0.3, 0.3), 0);
+    std::unique_ptr<Communicator> comm(new ICommunicator());
+    REQUIRE(pointMap.sparkGraph2(comm.get(), false, -1, threads));
+}
+
+static void requireSameValues(const AttributeTable &expected, const AttributeTable &actual) {
+    REQUIRE(expected.getNumColumns() == actual.getNumColumns());
+    REQUIRE(expected.getNumRows() == actual.getNumRows());
+    for (auto iter = expected.begin(); iter != expected.end(); iter++) {
+        const AttributeRow &actualRow = actual.getRow(iter->getKey());
+        for (size_t col = 0; col < expected.getNumColumns(); col++) {
+            REQUIRE(iter->getRow().getValue(col) == actualRow.getValue(col));
+        }
+    }
+}
+
+TEST_CASE("Parallel metric VGA matches the serial analysis", "") {
+    auto metaGraph = makeWalledRoom();
+
+    PointMap serialMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Serial");
+    makeGraph(serialMap);
+    PointMap parallelMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Parallel");
+    makeGraph(parallelMap);
+    REQUIRE(serialMap.getFilledPointCount() > 100);
+
+    SECTION("Unrestricted radius") {
+        REQUIRE(VGAMetric(-1.0, false, 1).run(nullptr, serialMap, false));
+        REQUIRE(VGAMetric(-1.0, false, 4).run(nullptr, parallelMap, false));
+        requireSameValues(serialMap.getAttributeTable(), parallelMap.getAttributeTable());
+    }
+
+    SECTION("Restricted radius") {
+        REQUIRE(VGAMetric(1.5, false, 1).run(nullptr, serialMap, false));
+        REQUIRE(VGAMetric(1.5, false, 3).run(nullptr, parallelMap, false));
+        requireSameValues(serialMap.getAttributeTable(), parallelMap.getAttributeTable());
+    }
+}
+
+TEST_CASE("Parallel angular VGA matches the serial analysis", "") {
+    auto metaGraph = makeWalledRoom();
+
+    PointMap serialMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Serial");
+    makeGraph(serialMap);
+    PointMap parallelMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Parallel");
+    makeGraph(parallelMap);
+
+    SECTION("Unrestricted radius") {
+        REQUIRE(VGAAngular(-1.0, false, 1).run(nullptr, serialMap, false));
+        REQUIRE(VGAAngular(-1.0, false, 4).run(nullptr, parallelMap, false));
+        requireSameValues(serialMap.getAttributeTable(), parallelMap.getAttributeTable());
+    }
+
+    SECTION("Restricted radius") {
+        REQUIRE(VGAAngular(1.0, false, 1).run(nullptr, serialMap, false));
+        REQUIRE(VGAAngular(1.0, false, 3).run(nullptr, parallelMap, false));
+        requireSameValues(serialMap.getAttributeTable(), parallelMap.getAttributeTable());
+    }
+}
+
+TEST_CASE("Parallel local visibility VGA matches the serial analysis", "") {
+    auto metaGraph = makeWalledRoom();
+
+    PointMap serialMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Serial");
+    makeGraph(serialMap);
+    PointMap parallelMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Parallel");
+    makeGraph(parallelMap);
+
+    REQUIRE(VGAVisualLocal(false, 1).run(nullptr, serialMap, false));
+    REQUIRE(VGAVisualLocal(false, 4).run(nullptr, parallelMap, false));
+    REQUIRE(serialMap.getAttributeTable().hasColumn("Visual Clustering Coefficient"));
+    requireSameValues(serialMap.getAttributeTable(), parallelMap.getAttributeTable());
+}
+
+TEST_CASE("Parallel graph building matches the serial one", "") {
+    auto metaGraph = makeWalledRoom();
+
+    PointMap serialMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Serial");
+    makeGraph(serialMap);
+    PointMap parallelMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Parallel");
+    makeGraph(parallelMap, 4);
+
+    requireSameValues(serialMap.getAttributeTable(), parallelMap.getAttributeTable());
+    for (size_t col = 0; col < serialMap.getAttributeTable().getNumColumns(); col++) {
+        REQUIRE(serialMap.getAttributeTable().getColumn(col).getStats().total ==
+                parallelMap.getAttributeTable().getColumn(col).getStats().total);
+    }
+
+    CSRVisibilityGraph serialGraph(serialMap);
+    CSRVisibilityGraph parallelGraph(parallelMap);
+    REQUIRE(serialGraph.size() == parallelGraph.size());
+    REQUIRE(serialGraph.edgeCount() == parallelGraph.edgeCount());
+    for (size_t i = 0; i < serialGraph.size(); i++) {
+        REQUIRE(serialGraph.cell(i) == parallelGraph.cell(i));
+        for (int b = 0; b < 32; b++) {
+            REQUIRE(std::equal(serialGraph.binBegin(i, b), serialGraph.binEnd(i, b), parallelGraph.binBegin(i, b),
+                               parallelGraph.binEnd(i, b)));
+            REQUIRE(serialMap.getPoint(serialGraph.cell(i)).getNode().bindistance(b) ==
+                    parallelMap.getPoint(parallelGraph.cell(i)).getNode().bindistance(b));
+        }
+    }
+}
+
+TEST_CASE("Parallel isovist VGA matches the serial analysis", "") {
+    auto metaGraph = makeWalledRoom();
+
+    PointMap serialMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Serial");
+    makeGraph(serialMap);
+    PointMap parallelMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Parallel");
+    makeGraph(parallelMap);
+
+    // small sets of lines are split at random when the BSP tree is made, and the tree shape
+    // decides which split points end up in the isovist polygons, so both runs start from the same seed
+    pafsrand(1);
+    REQUIRE(VGAIsovist(1).run(nullptr, serialMap, false));
+    pafsrand(1);
+    REQUIRE(VGAIsovist(4).run(nullptr, parallelMap, false));
+    REQUIRE(serialMap.getAttributeTable().hasColumn("Isovist Perimeter"));
+    requireSameValues(serialMap.getAttributeTable(), parallelMap.getAttributeTable());
+
+    for (size_t i = 0; i < serialMap.getCols(); i++) {
+        for (size_t j = 0; j < serialMap.getRows(); j++) {
+            PixelRef curs(static_cast<short>(i), static_cast<short>(j));
+            if (!serialMap.getPoint(curs).filled()) {
+                continue;
+            }
+            Node &serialNode = serialMap.getPoint(curs).getNode();
+            Node &parallelNode = parallelMap.getPoint(curs).getNode();
+            for (int b = 0; b < 32; b++) {
+                REQUIRE(serialNode.m_occlusion_bins[b] == parallelNode.m_occlusion_bins[b]);
+                REQUIRE(serialNode.bin(b).occdistance() == parallelNode.bin(b).occdistance());
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "catch.hpp"
+#include "salalib/mgraph.h"
+#include "salalib/vgamodules/vgavisualglobal.h"
+
+// an L-shaped room with more cells than are searched in one batch
+static std::unique_ptr<MetaGraph> makeLShapedRoom() {
+    std::unique_ptr<MetaGraph> metaGraph(new MetaGraph("Test MetaGraph"));
+    metaGraph->m_drawingFiles.emplace_back("Test SpacePixelGroup");
+    auto &spacePixel = metaGraph->m_drawingFiles.back().m_spacePixels;
+    spacePixel.emplace_back("Test ShapeMap");
+    spacePixel.back().makeLineShape(Line(Point2f(0, 0), Point2f(0, 6)));
+    spacePixel.back().makeLineShape(Line(Point2f(0, 6), Point2f(2, 6)));
+    spacePixel.back().makeLineShape(Line(Point2f(2, 6), Point2f(2, 2)));
+    spacePixel.back().makeLineShape(Line(Point2f(2, 2), Point2f(6, 2)));
+    spacePixel.back().makeLineShape(Line(Point2f(6, 2), Point2f(6, 0)));
+    spacePixel.back().makeLineShape(Line(Point2f(6, 0), Point2f(0, 0)));
+    metaGraph->m_drawingFiles.back().m_region = spacePixel.back().getRegion();
+    metaGraph->setRegion(metaGraph->m_drawingFiles.back().m_region.bottom_left,
+                         metaGraph->m_drawingFiles.back().m_region.top_right);
+    return metaGraph;
+}
+
+static void makeGraph(PointMap &pointMap, bool merged) {
+    pointMap.setGrid(0.2, Point2f(0, 0));
+    pointMap.makePoints(Point2f(0.3, 0.3), 0);
+    std::unique_ptr<Communicator> comm(new ICommunicator());
+    REQUIRE(pointMap.sparkGraph2(comm.get(), false, -1));
+    if (merged) {
+        // join the two far ends of the L
+        PixelRef a = pointMap.pixelate(Point2f(1.0, 5.8));
+        PixelRef b = pointMap.pixelate(Point2f(5.8, 1.0));
+        REQUIRE(pointMap.getPoint(a).filled());
+        REQUIRE(pointMap.getPoint(b).filled());
+        pointMap.mergePixels(a, b);
+    }
+}
+
+static void requireSameValues(const AttributeTable &expected, const AttributeTable &actual) {
+    REQUIRE(expected.getNumColumns() == actual.getNumColumns());
+    REQUIRE(expected.getNumRows() == actual.getNumRows());
+    for (auto iter = expected.begin(); iter != expected.end(); iter++) {
+        const AttributeRow &actualRow = actual.getRow(iter->getKey());
+        for (size_t col = 0; col < expected.getNumColumns(); col++) {
+            REQUIRE(iter->getRow().getValue(col) == actualRow.getValue(col));
+        }
+    }
+}
+
+static void compareSearches(bool merged, double radius) {
+    auto metaGraph = makeLShapedRoom();
+    PointMap legacyMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Legacy");
+    makeGraph(legacyMap, merged);
+    PointMap batchedMap(metaGraph->getRegion(), metaGraph->m_drawingFiles, "Batched");
+    makeGraph(batchedMap, merged);
+    REQUIRE(legacyMap.getFilledPointCount() > 300);
+
+    REQUIRE(VGAVisualGlobal(radius, false, true).run(nullptr, legacyMap, false));
+    REQUIRE(VGAVisualGlobal(radius, false).run(nullptr, batchedMap, false));
+    requireSameValues(legacyMap.getAttributeTable(), batchedMap.getAttributeTable());
+}
+
+TEST_CASE("Batched visibility search matches the legacy one-origin search", "") {
+    SECTION("Unrestricted radius") { compareSearches(false, -1.0); }
+    SECTION("Restricted radius") { compareSearches(false, 2.0); }
+    SECTION("Merged cells, unrestricted radius") { compareSearches(true, -1.0); }
+    SECTION("Merged cells, restricted radius") { compareSearches(true, 2.0); }
+}
@@ -19,6 +19,47 @@
 #include "agent.h"
 #include "agenthelpers.h"
 
+AgentCounts::AgentCounts(PointMap &pointmap, bool withGates) {
+    auto &points = pointmap.getPoints();
+    cols = points.columns();
+    counts.resize(points.size(), 0);
+    if (withGates) {
+        gates.resize(points.size(), -1);
+        gateCounts.resize(points.size(), 0);
+        AttributeTable &table = pointmap.getAttributeTable();
+        size_t gatecol = table.getColumnIndex(g_col_gate);
+        for (auto iter = table.begin(); iter != table.end(); ++iter) {
+            gates[index(iter->getKey().value)] = (int)iter->getRow().getValue(gatecol);
+        }
+    }
+}
+
+void AgentCounts::add(AgentSteps &steps) {
+    for (size_t pixel : steps.pixels) {
+        counts[pixel]++;
+    }
+    for (size_t pixel : steps.gatePixels) {
+        gateCounts[pixel]++;
+    }
+    steps.pixels.clear();
+    steps.gatePixels.clear();
+}
+
+void AgentCounts::addTo(PointMap &pointmap) const {
+    AttributeTable &table = pointmap.getAttributeTable();
+    size_t countcol = table.getColumnIndex(g_col_total_counts);
+    size_t gatecountcol = gateCounts.empty() ? size_t(-1) : table.getColumnIndex(g_col_gate_counts);
+    for (auto iter = table.begin(); iter != table.end(); ++iter) {
+        size_t pixel = index(iter->getKey().value);
+        if (counts[pixel] != 0) {
+            iter->getRow().incrValue(countcol, float(counts[pixel]));
+        }
+        if (!gateCounts.empty() && gateCounts[pixel] != 0) {
+            iter->getRow().incrValue(gatecountcol, float(gateCounts[pixel]));
+        }
+    }
+}
+
 Agent::Agent(AgentProgram *program, PointMap *pointmap, int output_mode) {
     m_program = program;
     m_pointmap = pointmap;
@@ -57,7 +98,7 @@ void Agent::onInit(PixelRef node, int trail_num) {
     m_target_pix = NoPixel;
 }
 
-void Agent::onMove() {
+void Agent::onMove(const AgentCounts *counts, AgentSteps *steps) {
     m_at_target = false;
     m_frame++;
     if (m_program->m_destination_directed && dist(m_loc, m_destination) < 10.0) {
@@ -69,7 +110,7 @@ void Agent::onMove() {
         m_step = 0;
         onTarget();
         m_vector = onLook(false);
-    } else if (prandomr() < (1.0 / m_program->m_steps) && !m_target_lock) { // note, on average, will change 1 in steps
+    } else if (nextRandomR() < (1.0 / m_program->m_steps) && !m_target_lock) { // note, on average, will change 1 in steps
         m_step = 0;
         m_vector = onLook(false);
         /*
@@ -91,16 +132,16 @@ void Agent::onMove() {
     onStep();
     if (m_node != lastnode && m_output_mode != OUTPUT_NOTHING) {
         if (m_pointmap->getPoint(m_node).filled()) {
-            AttributeRow &row = m_pointmap->getAttributeTable().getRow(AttributeKey(m_node));
+            size_t pixel = counts->index(m_node);
             if (m_output_mode & OUTPUT_COUNTS) {
-                row.incrValue(g_col_total_counts);
+                steps->pixels.push_back(pixel);
             }
             if (m_output_mode & OUTPUT_GATE_COUNTS) {
-                int obj = (int)row.getValue(g_col_gate);
+                int obj = counts->gates[pixel];
                 if (m_gate != obj) {
                     m_gate = obj;
                     if (m_gate != -1) {
-                        row.incrValue(g_col_gate_counts);
+                        steps->gatePixels.push_back(pixel);
                         // actually crossed into a new gate:
                         m_gate_encountered = true;
                     }
@@ -157,7 +198,7 @@ bool Agent::diagonalStep() {
     int nextnode2 = m_pointmap->pixelate(nextloc2, false);
 
     bool good = false;
-    if (pafrand() % 2 == 0) {
+    if (nextRand() % 2 == 0) {
         if (goodStep(nextnode1)) {
             m_node = nextnode1;
             m_loc = nextloc1;
@@ -261,18 +302,13 @@ Point2f Agent::onStandardLook(bool wholeisovist) {
             return Point2f(0, 0);
         }
     } else {
-        int chosen = pafrand() % choices;
+        int chosen = nextRand() % choices;
         Node &node = m_pointmap->getPoint(m_node).getNode();
         for (; chosen >= node.bincount(directionbin % 32); directionbin++) {
             chosen -= node.bincount(directionbin % 32);
         }
-        Bin &bin = node.bin(directionbin % 32);
-        bin.first();
-        tarpixelate = bin.cursor();
-        for (; chosen > 0; chosen--) {
-            bin.next();
-            tarpixelate = bin.cursor();
-        }
+        // the bin cursor is shared by every agent looking from the node
+        tarpixelate = node.bin(directionbin % 32).pixel(chosen);
     }
 
     m_target_pix = tarpixelate;
@@ -326,7 +362,7 @@ Point2f Agent::onWeightedLook(bool wholeisovist) {
     if (weightmap.size() == 0) {
         return onWeightedLook(true);
     } else {
-        double chosen = prandomr() * weight;
+        double chosen = nextRandomR() * weight;
         for (size_t i = 0; i < weightmap.size(); i++) {
             if (chosen < weightmap[i].weight) {
                 tarpixelate = weightmap[i].node;
@@ -380,7 +416,7 @@ Point2f Agent::onOcclusionLook(bool wholeisovist, int looktype) {
                 return Point2f(0, 0);
             }
         } else {
-            size_t chosen = pafrand() % choices;
+            size_t chosen = nextRand() % choices;
             for (; chosen >= node.m_occlusion_bins[directionbin % 32].size(); directionbin++) {
                 chosen -= node.m_occlusion_bins[directionbin % 32].size();
             }
@@ -446,7 +482,7 @@ Point2f Agent::onOcclusionLook(bool wholeisovist, int looktype) {
                 return Point2f(0, 0);
             }
         } else {
-            double chosen = prandomr() * weight;
+            double chosen = nextRandomR() * weight;
             for (size_t i = 0; i < weightmap.size(); i++) {
                 if (chosen < weightmap[i].weight) {
                     tarpixelate = weightmap[i].node;
@@ -506,7 +542,7 @@ Point2f Agent::onLoSLook(bool wholeisovist, int look_type) {
             return Point2f(0, 0);
         }
     } else {
-        double chosen = prandomr() * weight;
+        double chosen = nextRandomR() * weight;
         for (size_t i = 0; i < weightmap.size(); i++) {
             if (chosen < weightmap[i].weight) {
                 targetbin = weightmap[i].node;
@@ -515,7 +551,7 @@ Point2f Agent::onLoSLook(bool wholeisovist, int look_type) {
         }
     }
 
-    float angle = (float)anglefrombin2(targetbin);
+    float angle = (float)anglefrombin2(targetbin, nextRandom());
 
     return Point2f(cosf(angle), sinf(angle));
 }
@@ -555,7 +591,7 @@ Point2f Agent::onDirectedLoSLook(bool wholeisovist, int look_type) {
             return Point2f(0, 0);
         }
     } else {
-        double chosen = prandomr() * weight;
+        double chosen = nextRandomR() * weight;
         for (size_t i = 0; i < weightmap.size(); i++) {
             if (chosen < weightmap[i].weight) {
                 targetbin = weightmap[i].node;
@@ -564,7 +600,7 @@ Point2f Agent::onDirectedLoSLook(bool wholeisovist, int look_type) {
         }
     }
 
-    float angle = (float)anglefrombin2(targetbin);
+    float angle = (float)anglefrombin2(targetbin, nextRandom());
 
     return Point2f(cosf(angle), sinf(angle));
 }
@@ -593,7 +629,7 @@ Point2f Agent::onGibsonianLook(bool wholeisovist) {
     float angle = 0.0;
 
     if (rule_choice != -1) {
-        angle = (float)anglefrombin2((binfromvec(m_vector) + (2 * rule_choice + 1) * dir + 32) % 32);
+        angle = (float)anglefrombin2((binfromvec(m_vector) + (2 * rule_choice + 1) * dir + 32) % 32, nextRandom());
     }
 
     // if no rule selection made, carry on in current direction
@@ -643,13 +679,14 @@ int Agent::onGibsonianRule(int rule) {
         break;
     }
     int dir = 0;
-    if (option == 0x01 && m_program->m_rule_probability[0] > prandomr()) {
+    if (option == 0x01 && m_program->m_rule_probability[0] > nextRandomR()) {
         dir = -1;
-    } else if (option == 0x10 && m_program->m_rule_probability[0] > prandomr()) {
+    } else if (option == 0x10 && m_program->m_rule_probability[0] > nextRandomR()) {
         dir = +1;
-    } else if (option == 0x11 && m_program->m_rule_probability[0] > prandomr() * prandomr()) {
+    } else if (option == 0x11 && m_program->m_rule_probability[0] > nextRandomR() * nextRandomR()) {
         // note, use random * random event as there are two ways to do this
-        dir = (rand() % 2) ? -1 : +1;
+        // agents on the shared sequence toss with C rand, as they always have
+        dir = ((m_own_stream ? nextRand() : rand()) % 2) ? -1 : +1;
     }
     return dir;
 }
@@ -682,12 +719,12 @@ Point2f Agent::onGibsonianLook2(bool wholeisovist) {
     if ((m_curr_los[2] - m_last_los[2]) / m_curr_los[2] > m_program->m_feeler_threshold) {
         dir |= 0x10;
     }
-    if (dir == 0x01 && m_program->m_feeler_probability > prandomr()) {
+    if (dir == 0x01 && m_program->m_feeler_probability > nextRandomR()) {
         maxbin = -m_program->m_vbin;
-    } else if (dir == 0x10 && m_program->m_feeler_probability > prandomr()) {
+    } else if (dir == 0x10 && m_program->m_feeler_probability > nextRandomR()) {
         maxbin = m_program->m_vbin;
-    } else if (dir == 0x11 && m_program->m_feeler_probability > prandomr() * prandomr()) {
-        maxbin = (pafrand() % 2) ? m_program->m_vbin : -m_program->m_vbin;
+    } else if (dir == 0x11 && m_program->m_feeler_probability > nextRandomR() * nextRandomR()) {
+        maxbin = (nextRand() % 2) ? m_program->m_vbin : -m_program->m_vbin;
     }
     // third action: detect heading for dead-end
     if (maxbin == 0 && (m_curr_los[0] / m_pointmap->getSpacing() < m_program->m_ahead_threshold)) {
@@ -699,7 +736,7 @@ Point2f Agent::onGibsonianLook2(bool wholeisovist) {
     }
 
     int bin = binfromvec(m_vector) + maxbin;
-    float angle = (float)anglefrombin2(bin);
+    float angle = (float)anglefrombin2(bin, nextRandom());
 
     return (maxbin == 0) ? m_vector : Point2f(cosf(angle), sinf(angle));
 }
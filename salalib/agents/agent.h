@@ -26,6 +26,29 @@
 #include "genlib/p2dpoly.h"
 #include "genlib/pflipper.h"
 
+// The pixels agents stepped into and the gates they crossed while being moved by one
+// worker, added to the AgentCounts once every agent has made its step
+struct AgentSteps {
+    std::vector<size_t> pixels;
+    std::vector<size_t> gatePixels;
+};
+
+// The counts agents leave on the pixels they step into, kept by pixel (row by row across
+// the map) while they move and only added to the attribute table of the map once they stop
+struct AgentCounts {
+    size_t cols = 0;
+    // the gate of each pixel, -1 where there is none (only filled in for gate counts)
+    std::vector<int> gates;
+    std::vector<unsigned int> counts;
+    std::vector<unsigned int> gateCounts;
+    AgentCounts() {}
+    AgentCounts(PointMap &pointmap, bool withGates);
+    size_t index(PixelRef pix) const { return size_t(pix.y) * cols + size_t(pix.x); }
+    // adds the steps and clears them
+    void add(AgentSteps &steps);
+    void addTo(PointMap &pointmap) const;
+};
+
 class Agent {
   public:
     enum { OUTPUT_NOTHING = 0x00, OUTPUT_COUNTS = 0x01, OUTPUT_GATE_COUNTS = 0x02, OUTPUT_TRAILS = 0x04 };
@@ -61,6 +84,11 @@ class Agent {
     // extra memory of last observed values for Gibsonian agents:
     float m_last_los[9];
     float m_curr_los[9];
+    //
+    // an agent with its own random stream draws the same numbers whichever thread moves
+    // it, otherwise it draws from the shared pafrand sequence
+    bool m_own_stream = false;
+    uint64_t m_randstate = 0;
 
   public:
     Agent() {
@@ -82,7 +110,9 @@ class Agent {
     int onGibsonianRule(int rule);
     void calcLoS(int directionbin, bool curr);
     void calcLoS2(int directionbin, bool curr);
-    void onMove();
+    // counts and steps may only be NULL if the agent does not output anything. The counts
+    // are only read, what the agent leaves is recorded in the steps
+    void onMove(const AgentCounts *counts = NULL, AgentSteps *steps = NULL);
     void onTarget();
     void onDestination();
     void onStep();
@@ -99,13 +129,24 @@ class Agent {
     const PixelRef getNode() const { return m_node; }
     int getFrame() const { return m_frame; }
     const PointMap &getPointMap() const { return *m_pointmap; }
+    //
+    void setRandomStream(uint64_t state) {
+        m_own_stream = true;
+        m_randstate = state;
+    }
+    // as pafrand, prandom and prandomr, but from the agent's own stream if it has one
+    unsigned int nextRand() { return m_own_stream ? pafrandnext(m_randstate) : pafrand(); }
+    double nextRandom() { return double(nextRand()) / double(PAF_RAND_MAX); }
+    double nextRandomR() { return double(nextRand()) / double(PAF_RAND_MAX + 1); }
 };
 
 // note the add 0.5 means angles from e.g., -1/32 to 1/32 are in bin 0
 inline int binfromvec(const Point2f &p) { return int(32.0 * (0.5 * p.angle() / M_PI) + 0.5); }
 
-// a random angle based on a bin direction
-inline double anglefrombin2(int here) { return (2.0 * M_PI) * ((double(here) - 0.5) / 32.0 + prandom() / 32.0); }
+// a random angle based on a bin direction, random is from 0 to 1
+inline double anglefrombin2(int here, double random) {
+    return (2.0 * M_PI) * ((double(here) - 0.5) / 32.0 + random / 32.0);
+}
 
 inline int binsbetween(int bin1, int bin2) {
     int b = abs(bin1 - bin2);
@@ -19,6 +19,8 @@
 #include "agentengine.h"
 #include "agenthelpers.h"
 
+#include "genlib/parallel.h"
+
 // run one agent engine only
 
 AgentEngine::AgentEngine() {
@@ -46,6 +48,7 @@ void AgentEngine::run(Communicator *comm, PointMap *pointmap) {
     if (m_gatelayer != -1) {
         output_mode |= Agent::OUTPUT_GATE_COUNTS;
     }
+    AgentCounts counts(*pointmap, output_mode & Agent::OUTPUT_GATE_COUNTS);
 
     int trail_num = -1;
     if (m_record_trails) {
@@ -60,19 +63,21 @@ void AgentEngine::run(Communicator *comm, PointMap *pointmap) {
 
     // remove any agents that are left from a previous run
     for (auto &agentSet : agentSets) {
-        agentSet.agents.clear();
+        agentSet.clear();
+    }
+    int threads = depthmapX::resolveThreadCount(m_threads);
+    if (m_random_seed >= 0 || threads > 1) {
+        uint64_t seed = m_random_seed >= 0 ? uint64_t(m_random_seed) : 0;
+        for (size_t i = 0; i < agentSets.size(); i++) {
+            agentSets[i].startRandomStreams(pafrandstream(seed, i));
+        }
     }
 
     for (int i = 0; i < m_timesteps; i++) {
         for (auto &agentSet : agentSets) {
-            int q = invcumpoisson(prandomr(), agentSet.m_release_rate);
-            int length = agentSet.agents.size();
-            int k;
-            for (k = 0; k < q; k++) {
-                agentSet.agents.push_back(Agent(&(agentSet), pointmap, output_mode));
-            }
-            for (k = 0; k < q; k++) {
-                agentSet.init(length + k, trail_num);
+            int q = agentSet.releaseCount();
+            for (int k = 0; k < q; k++) {
+                agentSet.release(pointmap, output_mode, trail_num);
                 if (trail_num != -1) {
                     trail_num++;
                     // after trail count, stop recording:
@@ -84,12 +89,13 @@ void AgentEngine::run(Communicator *comm, PointMap *pointmap) {
         }
 
         for (auto &agentSet : agentSets) {
-            agentSet.move();
+            agentSet.move(&counts, threads);
         }
 
         if (comm) {
             if (qtimer(atime, 500)) {
                 if (comm->IsCancelled()) {
+                    counts.addTo(*pointmap);
                     throw Communicator::CancelledException();
                 }
                 comm->CommPostMessage(Communicator::CURRENT_RECORD, i);
@@ -97,6 +103,8 @@ void AgentEngine::run(Communicator *comm, PointMap *pointmap) {
         }
     }
 
+    counts.addTo(*pointmap);
+
     pointmap->overrideDisplayedAttribute(-2);
     pointmap->setDisplayedAttribute(displaycol);
 }
@@ -29,6 +29,12 @@ class AgentEngine {
   public:
     bool m_record_trails;
     int m_trail_count = 50;
+    // threads to move the agents on (0 for all cores). With a random seed, or with more
+    // than one thread, the agents draw from random streams made from the seed (0 if not
+    // given), so the same seed gives the same run on any number of threads. Otherwise
+    // they draw from the shared pafrand sequence as they always have
+    int m_threads = 1;
+    int m_random_seed = -1;
 
   public:
     AgentEngine();
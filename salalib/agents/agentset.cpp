@@ -20,31 +20,100 @@
 
 #include "salalib/pixelref.h"
 
+#include "genlib/parallel.h"
+
 AgentSet::AgentSet() {
     m_release_rate = 0.1;
     m_lifetime = 1000;
 }
 
-void AgentSet::init(int agent, int trail_num) {
+void AgentSet::startRandomStreams(uint64_t key) {
+    m_random_streams = true;
+    m_agent_streams_key = pafrandstream(key, 0);
+    m_release_randstate = pafrandstream(key, 1);
+    m_location_randstate = pafrandstream(key, 2 + uint64_t(m_release_locations_seed));
+    m_released = 0;
+}
+
+int AgentSet::releaseCount() {
+    double random = m_random_streams ? double(pafrandnext(m_release_randstate)) / double(PAF_RAND_MAX + 1) : prandomr();
+    return invcumpoisson(random, m_release_rate);
+}
+
+void AgentSet::release(PointMap *pointmap, int output_mode, int trail_num) {
+    size_t slot;
+    if (m_free_slots.empty()) {
+        slot = m_agent_pool.size();
+        m_agent_pool.push_back(Agent(this, pointmap, output_mode));
+    } else {
+        slot = m_free_slots.back();
+        m_free_slots.pop_back();
+        // assigning a new agent keeps the memory its occlusion lists already hold
+        m_agent_pool[slot] = Agent(this, pointmap, output_mode);
+    }
+    m_living.push_back(slot);
+    if (m_random_streams) {
+        m_agent_pool[slot].setRandomStream(pafrandstream(m_agent_streams_key, m_released));
+    }
+    m_released++;
+    init(m_agent_pool[slot], trail_num);
+}
+
+void AgentSet::init(Agent &agent, int trail_num) {
     if (m_release_locations.size()) {
-        int which = pafrand() % m_release_locations.size();
-        agents[agent].onInit(m_release_locations[which], trail_num);
+        unsigned int random = m_random_streams ? pafrandnext(m_release_randstate) : pafrand();
+        int which = random % m_release_locations.size();
+        agent.onInit(m_release_locations[which], trail_num);
     } else {
-        const PointMap &map = agents[agent].getPointMap();
+        const PointMap &map = agent.getPointMap();
         PixelRef pix;
         do {
-            pix = map.pickPixel(prandom(m_release_locations_seed));
+            double random = m_random_streams ? double(pafrandnext(m_location_randstate)) / double(PAF_RAND_MAX)
+                                             : prandom(m_release_locations_seed);
+            pix = map.pickPixel(random);
         } while (!map.getPoint(pix).filled());
-        agents[agent].onInit(pix, trail_num);
+        agent.onInit(pix, trail_num);
     }
 }
 
-void AgentSet::move() {
-    // go through backwards so remove does not affect later agents
-    for (auto rev_iter = agents.rbegin(); rev_iter != agents.rend(); ++rev_iter) {
-        rev_iter->onMove();
-        if (rev_iter->getFrame() >= m_lifetime) {
-            agents.erase(std::next(rev_iter).base());
+void AgentSet::move(AgentCounts *counts, int threads) {
+    // agents on the shared pafrand sequence have to move one after the other
+    threads = m_random_streams ? depthmapX::resolveThreadCount(threads) : 1;
+    if (m_worker_steps.size() < size_t(threads)) {
+        m_worker_steps.resize(size_t(threads));
+    }
+    if (threads == 1) {
+        // the latest agents released move first
+        for (auto rev_iter = m_living.rbegin(); rev_iter != m_living.rend(); ++rev_iter) {
+            m_agent_pool[*rev_iter].onMove(counts, &m_worker_steps[0]);
+        }
+    } else {
+        depthmapX::parallelFor(nullptr, m_living.size(), threads, [&](int worker, size_t i) {
+            m_agent_pool[m_living[i]].onMove(counts, &m_worker_steps[size_t(worker)]);
+        });
+    }
+    // counts are whole numbers, so they add up to the same whichever worker saw a step
+    for (auto &steps : m_worker_steps) {
+        if (counts) {
+            counts->add(steps);
         }
     }
+    // the agents that reached their lifetime give up their slots, the rest keep their order
+    size_t kept = 0;
+    for (size_t slot : m_living) {
+        if (m_agent_pool[slot].getFrame() >= m_lifetime) {
+            m_free_slots.push_back(slot);
+        } else {
+            m_living[kept++] = slot;
+        }
+    }
+    m_living.resize(kept);
+}
+
+void AgentSet::clear() {
+    m_agent_pool.clear();
+    m_free_slots.clear();
+    m_living.clear();
+    m_random_streams = false;
+    m_released = 0;
 }
@@ -22,12 +22,35 @@
 #include "agentprogram.h"
 
 struct AgentSet : public AgentProgram {
-    std::vector<Agent> agents;
+    // agents live in a pool of slots, and the slot of an agent that reaches its
+    // lifetime is kept for the next one released, so that no agent is ever moved
+    std::vector<Agent> m_agent_pool;
+    std::vector<size_t> m_free_slots;
+    // the slots of the living agents in the order they were released
+    std::vector<size_t> m_living;
     std::vector<int> m_release_locations;
     int m_release_locations_seed = 0;
     double m_release_rate;
     int m_lifetime;
+    // with random streams every agent draws from its own stream, picked by the order it
+    // was released in, and releases draw from streams of their own, so that a run only
+    // depends on the key and not on how many threads move the agents
+    bool m_random_streams = false;
+    uint64_t m_agent_streams_key = 0;
+    uint64_t m_release_randstate = 0;
+    uint64_t m_location_randstate = 0;
+    uint64_t m_released = 0;
+    // what the agents leave while being moved, one for each worker
+    std::vector<AgentSteps> m_worker_steps;
     AgentSet();
-    void move();
-    void init(int agent, int trail_num = -1);
+    void startRandomStreams(uint64_t key);
+    // the number of agents to release in a timestep
+    int releaseCount();
+    void release(PointMap *pointmap, int output_mode, int trail_num = -1);
+    // moves every agent one step, on several threads only if the set has random streams
+    void move(AgentCounts *counts, int threads = 1);
+    void clear();
+    size_t agentCount() const { return m_living.size(); }
+    Agent &getAgent(size_t index) { return m_agent_pool[m_living[index]]; }
+    void init(Agent &agent, int trail_num = -1);
 };
@@ -258,7 +258,7 @@ std::tuple<std::unique_ptr<ShapeGraph>, std::unique_ptr<ShapeGraph>> AllLineMap:
    // make new lines here (assumes line map has only lines
    for (int k = 0; k < int(getAllShapes().size()); k++) {
       if (!minimiser.removed(k)) {
-         lines_m.push_back( depthmapX::getMapAtIndex(getAllShapes(), k)->second.getLine() );
+         lines_m.push_back( getShapeRefFromIndex(k)->second.getLine() );
       }
    }
 
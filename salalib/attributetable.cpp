@@ -64,22 +64,27 @@ const AttributeColumnStats &AttributeColumnImpl::getStats() const
 
 void AttributeColumnImpl::updateStats(float val, float oldVal) const
 {
-    if (m_stats.total < 0)
+    updateStats(m_stats, val, oldVal);
+}
+
+void AttributeColumnImpl::updateStats(AttributeColumnStats &stats, float val, float oldVal)
+{
+    if (stats.total < 0)
     {
-        m_stats.total = val;
+        stats.total = val;
     }
     else
     {
-        m_stats.total += val;
-        m_stats.total -= oldVal;
+        stats.total += val;
+        stats.total -= oldVal;
     }
-    if (val > m_stats.max)
+    if (val > stats.max)
     {
-        m_stats.max = val;
+        stats.max = val;
     }
-    if (m_stats.min < 0 || val < m_stats.min)
+    if (stats.min < 0 || val < stats.min)
     {
-        m_stats.min = val;
+        stats.min = val;
     }
 }
 
@@ -230,6 +235,93 @@ AttributeRow &AttributeRowImpl::incrValue(const std::string &colName, float valu
     return incrValue(m_colManager.getColumnIndex(colName), value);
 }
 
+AttributeColumnValues::AttributeColumnValues(size_t numRows) : m_values(numRows, -1.0f), m_isSet(numRows, 0)
+{
+}
+
+// AttributeTableRow implementation - the values live in the column arrays of the table
+float AttributeTableRow::getValue(const std::string &column) const
+{
+    return getValue(m_table->getColumnIndex(column));
+}
+
+float AttributeTableRow::getValue(size_t index) const
+{
+    m_table->checkColumnIndex(index);
+    return m_table->m_data[index][m_index];
+}
+
+float AttributeTableRow::getNormalisedValue(size_t index) const
+{
+    m_table->checkColumnIndex(index);
+    auto& colStats = m_table->m_columns[index].m_stats;
+    if (colStats.max == colStats.min)
+    {
+        return 0.5f;
+    }
+    float val = m_table->m_data[index][m_index];
+    return val < 0 ? -1.0f : float((val - colStats.min)/(colStats.max - colStats.min));
+}
+
+AttributeRow &AttributeTableRow::setValue(const std::string &column, float value)
+{
+    return setValue(m_table->getColumnIndex(column), value);
+}
+
+AttributeRow &AttributeTableRow::setValue(size_t index, float value)
+{
+    m_table->checkColumnIndex(index);
+    m_table->setValueInternal(m_index, index, value);
+    return *this;
+}
+
+AttributeRow &AttributeTableRow::incrValue(const std::string &column, float value)
+{
+    return incrValue(m_table->getColumnIndex(column), value);
+}
+
+AttributeRow &AttributeTableRow::incrValue(size_t index, float value)
+{
+    m_table->checkColumnIndex(index);
+    float val = m_table->m_data[index][m_index];
+    m_table->setValueInternal(m_index, index, val < 0 ? value : val + value);
+    return *this;
+}
+
+AttributeRow &AttributeTableRow::setSelection(bool selected)
+{
+    m_selected = selected;
+    return *this;
+}
+
+bool AttributeTableRow::isSelected() const
+{
+    return m_selected;
+}
+
+AttributeTable::AttributeTable(AttributeTable &&other)
+    : m_rows(std::move(other.m_rows)), m_rowsByIndex(std::move(other.m_rowsByIndex)), m_data(std::move(other.m_data)),
+      m_rowsInKeyOrder(other.m_rowsInKeyOrder), m_columnMapping(std::move(other.m_columnMapping)),
+      m_columns(std::move(other.m_columns)), m_keyColumn(std::move(other.m_keyColumn)),
+      m_displayParams(std::move(other.m_displayParams))
+{
+    rebindRows();
+}
+
+AttributeTable &AttributeTable::operator =(AttributeTable &&other)
+{
+    m_rows = std::move(other.m_rows);
+    m_rowsByIndex = std::move(other.m_rowsByIndex);
+    m_data = std::move(other.m_data);
+    m_rowsInKeyOrder = other.m_rowsInKeyOrder;
+    m_columnMapping = std::move(other.m_columnMapping);
+    m_columns = std::move(other.m_columns);
+    m_keyColumn = std::move(other.m_keyColumn);
+    m_displayParams = std::move(other.m_displayParams);
+    rebindRows();
+    return *this;
+}
+
 AttributeRow &AttributeTable::getRow(const AttributeKey &key)
 {
     auto* row = getRowPtr(key);
@@ -277,7 +369,17 @@ AttributeRow &AttributeTable::addRow(const AttributeKey &key)
     {
         throw new std::invalid_argument("Duplicate key");
     }
-    auto res = m_rows.insert(std::make_pair(key, std::unique_ptr<AttributeRowImpl>(new AttributeRowImpl(*this))));
+    size_t index = m_rowsByIndex.size();
+    auto res = m_rows.insert(std::make_pair(key, std::unique_ptr<AttributeTableRow>(new AttributeTableRow(*this, index))));
+    m_rowsByIndex.push_back(res.first->second.get());
+    if (std::next(res.first) != m_rows.end())
+    {
+        m_rowsInKeyOrder = false;
+    }
+    for (auto& column : m_data)
+    {
+        column.push_back(-1.0f);
+    }
     return *res.first->second;
 }
 
@@ -288,6 +390,24 @@ void AttributeTable::removeRow(const AttributeKey &key)
     {
         throw new std::invalid_argument("Row does not exist");
     }
+    // move the last row into the gap to keep the column arrays dense
+    size_t index = iter->second->m_index;
+    size_t last = m_rowsByIndex.size() - 1;
+    if (index != last)
+    {
+        for (auto& column : m_data)
+        {
+            column[index] = column[last];
+        }
+        m_rowsByIndex[index] = m_rowsByIndex[last];
+        m_rowsByIndex[index]->m_index = index;
+        m_rowsInKeyOrder = false;
+    }
+    for (auto& column : m_data)
+    {
+        column.pop_back();
+    }
+    m_rowsByIndex.pop_back();
     m_rows.erase(iter);
 }
 
@@ -313,7 +433,7 @@ size_t AttributeTable::insertOrResetColumn(const std::string &columnName, const
     m_columns[iter->second].setLock(false);
     for (auto& row : m_rows)
     {
-        row.second->setValue(iter->second, -1.0f);
+        setValueInternal(row.second->m_index, iter->second, -1.0f);
     }
     return iter->second;
 }
@@ -356,10 +476,7 @@ void AttributeTable::removeColumn(size_t colIndex)
         }
     }
     m_columns.erase(m_columns.begin()+colIndex);
-    for (auto& row : m_rows)
-    {
-        row.second->removeColumn(colIndex);
-    }
+    m_data.erase(m_data.begin()+colIndex);
 }
 
 void AttributeTable::renameColumn(const std::string &oldName, const std::string &newName)
@@ -413,10 +530,24 @@ void AttributeTable::read(std::istream &stream, LayerManager &layerManager)
 
     int rowcount, rowkey;
     stream.read((char *)&rowcount, sizeof(rowcount));
+    m_data.resize(m_columns.size());
+    for (auto& column : m_data)
+    {
+        column.reserve(rowcount);
+    }
+    m_rowsByIndex.reserve(rowcount);
+    std::vector<float> values;
     for (int i = 0; i < rowcount; i++) {
         stream.read((char *)&rowkey, sizeof(rowkey));
-        auto row = std::unique_ptr<AttributeRowImpl>(new AttributeRowImpl(*this));
-        row->read(stream);
+        auto row = std::unique_ptr<AttributeTableRow>(new AttributeTableRow(*this, m_rowsByIndex.size()));
+        stream.read((char *)&row->m_layerKey, sizeof(row->m_layerKey));
+        dXreadwrite::readIntoVector(stream, values);
+        values.resize(m_data.size(), -1.0f);
+        for (size_t j = 0; j < m_data.size(); j++)
+        {
+            m_data[j].push_back(values[j]);
+        }
+        m_rowsByIndex.push_back(row.get());
         m_rows.insert(std::make_pair(AttributeKey(rowkey),std::move(row)));
     }
 
@@ -447,20 +578,82 @@ void AttributeTable::write(std::ostream &stream, const LayerManager &layerManage
 
     int rowcount = (int)m_rows.size();
     stream.write((char *)&rowcount, sizeof(int));
+    std::vector<float> values(m_data.size());
     for ( auto &kvp : m_rows)
     {
         kvp.first.write(stream);
-        kvp.second->write(stream);
+        stream.write((char *)&kvp.second->m_layerKey, sizeof(kvp.second->m_layerKey));
+        for (size_t j = 0; j < m_data.size(); j++)
+        {
+            values[j] = m_data[j][kvp.second->m_index];
+        }
+        dXreadwrite::writeVector(stream, values);
     }
     stream.write((const char *)&m_displayParams, sizeof(DisplayParams));
 }
 
 void AttributeTable::clear() {
     m_rows.clear();
+    m_rowsByIndex.clear();
+    m_data.clear();
+    m_rowsInKeyOrder = true;
     m_columns.clear();
     m_columnMapping.clear();
 }
 
+size_t AttributeTable::getRowPosition(const AttributeKey &key)
+{
+    auto iter = m_rows.find(key);
+    if (iter == m_rows.end())
+    {
+        throw std::out_of_range("Invalid row key");
+    }
+    sortRowsByKey();
+    return iter->second->m_index;
+}
+
+void AttributeTable::setColumnValues(size_t colIndex, const std::vector<float> &values)
+{
+    checkColumnIndex(colIndex);
+    if (values.size() != m_rowsByIndex.size())
+    {
+        throw std::invalid_argument("Number of values does not match the number of rows");
+    }
+    sortRowsByKey();
+    std::vector<float>& column = m_data[colIndex];
+    AttributeColumnStats stats = m_columns[colIndex].m_stats;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        float oldVal = column[i];
+        column[i] = values[i];
+        AttributeColumnImpl::updateStats(stats, values[i], oldVal < 0.0f ? 0.0f : oldVal);
+    }
+    m_columns[colIndex].m_stats = stats;
+}
+
+void AttributeTable::setColumnValues(size_t colIndex, const AttributeColumnValues &values)
+{
+    checkColumnIndex(colIndex);
+    if (values.size() != m_rowsByIndex.size())
+    {
+        throw std::invalid_argument("Number of values does not match the number of rows");
+    }
+    sortRowsByKey();
+    std::vector<float>& column = m_data[colIndex];
+    AttributeColumnStats stats = m_columns[colIndex].m_stats;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        if (!values.isSet(i))
+        {
+            continue;
+        }
+        float oldVal = column[i];
+        column[i] = values.getValue(i);
+        AttributeColumnImpl::updateStats(stats, column[i], oldVal < 0.0f ? 0.0f : oldVal);
+    }
+    m_columns[colIndex].m_stats = stats;
+}
+
 size_t AttributeTable::getColumnIndex(const std::string &name) const
 {
     auto iter = m_columnMapping.find(name);
@@ -523,9 +716,51 @@ size_t AttributeTable::addColumnInternal(const std::string &name, const std::str
     size_t colIndex = m_columns.size();
     m_columns.push_back(AttributeColumnImpl(name, formula));
     m_columnMapping[name] = colIndex;
-    for (auto& elem : m_rows)
+    m_data.push_back(std::vector<float>(m_rowsByIndex.size(), -1.0f));
+    return colIndex;
+}
+
+void AttributeTable::setValueInternal(size_t rowIndex, size_t colIndex, float value)
+{
+    float& cell = m_data[colIndex][rowIndex];
+    float oldVal = cell;
+    cell = value;
+    if (oldVal < 0.0f)
     {
-        elem.second->addColumn();
+        oldVal = 0.0f;
+    }
+    m_columns[colIndex].AttributeColumnImpl::updateStats(value, oldVal);
+}
+
+// the bulk methods index rows by their position in key order, so bring the dense
+// indices back in line with the keys if rows have been added out of order or removed
+void AttributeTable::sortRowsByKey()
+{
+    if (m_rowsInKeyOrder)
+    {
+        return;
+    }
+    std::vector<std::vector<float>> data(m_data.size(), std::vector<float>(m_rowsByIndex.size()));
+    size_t position = 0;
+    for (auto& kvp : m_rows)
+    {
+        AttributeTableRow* row = kvp.second.get();
+        for (size_t j = 0; j < m_data.size(); j++)
+        {
+            data[j][position] = m_data[j][row->m_index];
+        }
+        row->m_index = position;
+        m_rowsByIndex[position] = row;
+        position++;
+    }
+    m_data.swap(data);
+    m_rowsInKeyOrder = true;
+}
+
+void AttributeTable::rebindRows()
+{
+    for (auto row : m_rowsByIndex)
+    {
+        row->m_table = this;
     }
-    return colIndex;
 }
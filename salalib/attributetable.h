@@ -143,6 +143,8 @@ public:
 
     virtual void updateStats(float val, float oldVal = 0.0f) const;
 
+    static void updateStats(AttributeColumnStats &stats, float val, float oldVal);
+
 public:
     // stats are mutable - we need to be able to update them all the time,
     // even when not allowed to modify the column settings
@@ -206,6 +208,71 @@ private:
 
 };
 
+class AttributeTable;
+
+///
+/// \brief Values for one column of an AttributeTable, to be written in one go
+/// The values are held in the order the table iterates its rows (see AttributeTable::getRowPosition).
+/// Rows that are never set keep the value they already have in the table.
+///
+class AttributeColumnValues
+{
+public:
+    AttributeColumnValues(size_t numRows = 0);
+
+    void setValue(size_t row, float value)
+    {
+        m_values[row] = value;
+        m_isSet[row] = 1;
+    }
+    void clearValue(size_t row)
+    {
+        m_values[row] = -1.0f;
+        m_isSet[row] = 0;
+    }
+    float getValue(size_t row) const { return m_values[row]; }
+    bool isSet(size_t row) const { return m_isSet[row] != 0; }
+    size_t size() const { return m_values.size(); }
+
+private:
+    std::vector<float> m_values;
+    std::vector<char> m_isSet;
+};
+
+///
+/// \brief Row of an AttributeTable
+/// The values are not stored in the row but in the column arrays of the table, the row only
+/// knows its position (dense index) in those arrays.
+///
+class AttributeTableRow : public AttributeRow
+{
+public:
+    AttributeTableRow(AttributeTable& table, size_t index) : m_table(&table), m_index(index), m_selected(false)
+    {
+        m_layerKey = 1;
+    }
+
+    // AttributeRow interface
+public:
+    virtual float getValue(const std::string &column) const;
+    virtual float getValue(size_t index) const;
+    virtual float getNormalisedValue(size_t index) const;
+    virtual AttributeRow& setValue(const std::string &column, float value);
+    virtual AttributeRow& setValue(size_t index, float value);
+    virtual AttributeRow& incrValue(const std::string &column, float value);
+    virtual AttributeRow& incrValue(size_t index, float value);
+    virtual AttributeRow& setSelection(bool selected);
+    virtual bool isSelected() const;
+
+    size_t getIndex() const { return m_index; }
+
+private:
+    friend class AttributeTable;
+    AttributeTable* m_table;
+    size_t m_index;
+    bool m_selected;
+};
+
 ///
 /// \brief Small struct to make an attribute key distinguishable from an int
 /// PixelRefs are serialised into an int (2 bytes x, 2 bytes y) for historic reason. This seems dangerous
@@ -243,8 +310,8 @@ class AttributeTable : public AttributeColumnManager
 public:
     AttributeTable(){}
     virtual ~AttributeTable(){}
-    AttributeTable(AttributeTable&&) = default;
-    AttributeTable& operator =(AttributeTable&&) = default;
+    AttributeTable(AttributeTable&& other);
+    AttributeTable& operator =(AttributeTable&& other);
     AttributeTable(const AttributeTable& ) = delete;
     AttributeTable& operator =(const AttributeTable&) = delete;
 
@@ -292,6 +359,30 @@ public:
     void read(std::istream &stream, LayerManager &layerManager);
     void write(std::ostream &stream, const LayerManager &layerManager);
     void clear();
+
+    ///
+    /// \brief Get the position of a row in the order the table iterates its rows
+    /// This is the index to use for the row in setColumnValues.
+    /// \param key of the row
+    /// \return position of the row, throws if key not found
+    ///
+    size_t getRowPosition(const AttributeKey& key);
+
+    ///
+    /// \brief Set the values of a whole column at once
+    /// The column stats are updated as if setValue had been called for every row in turn.
+    /// \param colIndex index of the column
+    /// \param values one value per row, in the order the table iterates its rows
+    ///
+    void setColumnValues(size_t colIndex, const std::vector<float>& values);
+
+    ///
+    /// \brief Set the values of a whole column at once, leaving the rows that are not set alone
+    /// \param colIndex index of the column
+    /// \param values one entry per row, in the order the table iterates its rows
+    ///
+    void setColumnValues(size_t colIndex, const AttributeColumnValues& values);
+
     float getSelAvg(size_t columnIndex) {
         float selTotal = 0;
         int selNum = 0;
@@ -320,8 +411,16 @@ public:
     size_t getColumnSortedIndex(size_t index) const;
 
 private:
-    typedef std::map<AttributeKey, std::unique_ptr<AttributeRowImpl>> StorageType;
+    friend class AttributeTableRow;
+
+    // the values are stored column by column: m_data[column][row index], where the
+    // row index is the dense index held by each row, i.e. the position in m_rowsByIndex
+    typedef std::map<AttributeKey, std::unique_ptr<AttributeTableRow>> StorageType;
     StorageType m_rows;
+    std::vector<AttributeTableRow*> m_rowsByIndex;
+    std::vector<std::vector<float>> m_data;
+    // true while the dense index of every row is also its position in key order
+    bool m_rowsInKeyOrder = true;
     std::map<std::string, size_t> m_columnMapping;
     std::vector<AttributeColumnImpl> m_columns;
     KeyColumn m_keyColumn;
@@ -330,6 +429,9 @@ private:
 private:
     void checkColumnIndex(size_t index) const;
     size_t addColumnInternal(const std::string &name, const std::string &formula);
+    void setValueInternal(size_t rowIndex, size_t colIndex, float value);
+    void rebindRows();
+    void sortRowsByKey();
 
 // warning - here be dragons!
 // This is the implementation of stl style iterators on attribute table, allowing efficient
@@ -478,7 +580,7 @@ public:
         return iterator(m_rows.find(key));
     }
 
-    std::pair<const AttributeKey, std::unique_ptr<AttributeRowImpl>>& back()
+    std::pair<const AttributeKey, std::unique_ptr<AttributeTableRow>>& back()
     {
         return *m_rows.rbegin();
     }
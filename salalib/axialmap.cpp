@@ -30,6 +30,7 @@
 #include "genlib/containerutils.h"
 #include "genlib/readwritehelpers.h"
 #include "genlib/pflipper.h"
+#include "genlib/parallel.h"
 
 #include <math.h>
 #include <float.h>
@@ -58,7 +59,7 @@ void ShapeGraph::initialiseAttributesAxial()
 
 }
 
-void ShapeGraph::makeConnections(const KeyVertices &keyvertices)
+void ShapeGraph::makeConnections(const KeyVertices &keyvertices, int threads)
 {
    m_connectors.clear();
    m_links.clear();
@@ -69,15 +70,17 @@ void ShapeGraph::makeConnections(const KeyVertices &keyvertices)
    int conn_col = m_attributes->getColumnIndex("Connectivity");
    int leng_col = m_attributes->getColumnIndex("Line Length");
 
+   std::vector<std::vector<int>> connections =
+       getAllConnections(true, TOLERANCE_B*__max(m_region.height(),m_region.width()), threads);
    int i = -1;
-   for (auto shape: m_shapes) {
+   for (const auto &shape: m_shapes) {
       i++;
       int key = shape.first;
       AttributeRow &row =
           m_attributes->getRow(AttributeKey(key));
       // all indices should match...
       m_connectors.push_back( Connector() );
-      m_connectors[i].m_connections = getLineConnections( key, TOLERANCE_B*__max(m_region.height(),m_region.width()));
+      m_connectors[i].m_connections = std::move(connections[i]);
       row.setValue(conn_col, float(m_connectors[i].m_connections.size()) );
       row.setValue(leng_col, float(shape.second.getLine().length()) );
       if (keyvertices.size()) {
@@ -269,7 +272,7 @@ bool ShapeGraph::readold( std::istream& stream)
    return true;
 }
 
-bool ShapeGraph::write( std::ofstream& stream )
+bool ShapeGraph::write( std::ostream& stream )
 {
    // note keyvertexcount and keyvertices are different things!  (length keyvertices not the same as keyvertexcount!)
    stream.write((char *)&m_keyvertexcount,sizeof(m_keyvertexcount));
@@ -308,13 +311,13 @@ void ShapeGraph::writeLinksUnlinksAsPairsCSV(std::ostream &stream, char delimite
     stream << "refA" << delimiter << "refB" << delimiter << "link" << std::endl;
 
     for (auto &link : m_links) {
-        stream << depthmapX::getMapAtIndex(m_shapes, link.a)->first << delimiter
-               << depthmapX::getMapAtIndex(m_shapes, link.b)->first << delimiter << "1" << std::endl;
+        stream << getShapeRefFromIndex(link.a)->first << delimiter
+               << getShapeRefFromIndex(link.b)->first << delimiter << "1" << std::endl;
     }
 
     for (auto &unlink : m_unlinks) {
-        stream << depthmapX::getMapAtIndex(m_shapes, unlink.a)->first << delimiter
-               << depthmapX::getMapAtIndex(m_shapes, unlink.b)->first << delimiter << "0" << std::endl;
+        stream << getShapeRefFromIndex(unlink.a)->first << delimiter
+               << getShapeRefFromIndex(unlink.b)->first << delimiter << "0" << std::endl;
     }
 }
 
@@ -374,12 +377,14 @@ void ShapeGraph::unlinkAtPoint(const Point2f& unlinkPoint) {
        for (auto jter = iter; jter != pix_shapes.end(); ++jter) {
           auto aIter = m_shapes.find(int(iter->m_shape_ref));
           auto bIter = m_shapes.find(int(jter->m_shape_ref));
-          int a = int(std::distance(m_shapes.begin(), aIter));
-          int b = int(std::distance(m_shapes.begin(), bIter));
+          if (aIter == m_shapes.end() || bIter == m_shapes.end()
+                  || !aIter->second.isLine() || !bIter->second.isLine()) {
+             continue;
+          }
+          int a = getIndexFromShapeRef(aIter->first);
+          int b = getIndexFromShapeRef(bIter->first);
           auto& connections = m_connectors[size_t(a)].m_connections;
-          if (aIter != m_shapes.end() && bIter != m_shapes.end()
-                  && aIter->second.isLine() && bIter->second.isLine()
-                  && std::find(connections.begin(), connections.end(), b) != connections.end()) {
+          if (std::find(connections.begin(), connections.end(), b) != connections.end()) {
              closepoints.push_back( intersection_point(aIter->second.getLine(), bIter->second.getLine(), TOLERANCE_A) );
              intersections.push_back( std::pair<int, int>(a,b) );
           }
@@ -439,7 +444,7 @@ void ShapeGraph::unlinkFromShapeMap(const ShapeMap& shapemap)
 
 // Method 1: direct linkage of endpoints where they touch
 
-void ShapeGraph::makeNewSegMap(Communicator *comm) {
+void ShapeGraph::makeNewSegMap(Communicator *comm, int threads) {
     // now make a connection set from the ends of lines:
     struct LineConnector {
         const Line &m_line;
@@ -456,95 +461,80 @@ void ShapeGraph::makeNewSegMap(Communicator *comm) {
         }
     }
     std::map<size_t, LineConnector> lineConnectors;
+    std::vector<LineConnector *> lineConnectorList;
     auto connectionIter = connectionset.begin();
     int connectionIdx = 0;
     for (auto &shape : m_shapes) {
         if (shape.second.isLine()) {
-            lineConnectors.insert(std::make_pair(
+            auto inserted = lineConnectors.insert(std::make_pair(
                 shape.first, LineConnector(shape.second.getLine(), *connectionIter, connectionIdx)));
+            lineConnectorList.push_back(&inserted.first->second);
             connectionIter++;
             connectionIdx++;
         }
     }
 
-    time_t atime = 0;
     if (comm) {
-        qtimer(atime, 0);
         comm->CommPostMessage(Communicator::NUM_RECORDS, lineConnectors.size());
     }
 
     double maxdim = __max(m_region.width(), m_region.height());
 
-    int count = 0;
-    for (auto &lineConnector_a : lineConnectors) {
-        Connector &connectionset_a = lineConnector_a.second.m_connector;
-        const Line &line_a = lineConnector_a.second.m_line;
-        int idx_a = lineConnector_a.second.m_index;
-        // n.b., vector() is based on t_start and t_end, so we must use t_start and t_end here and throughout
-        PixelRef pix1 = pixelate(line_a.t_start());
-        std::vector<ShapeRef> &shapes1 = m_pixel_shapes(static_cast<size_t>(pix1.y), static_cast<size_t>(pix1.x));
-        for (auto &shape : shapes1) {
-            auto lineConnector_b = lineConnectors.find(shape.m_shape_ref);
-            if (lineConnector_b != lineConnectors.end() && idx_a < lineConnector_b->second.m_index) {
-
-                Connector &connectionset_b = lineConnector_b->second.m_connector;
-                const Line &line_b = lineConnector_b->second.m_line;
-                int idx_b = lineConnector_b->second.m_index;
-
-                Point2f alpha = line_a.vector();
-                Point2f beta = line_b.vector();
-                alpha.normalise();
-                beta.normalise();
-                if (approxeq(line_a.t_start(), line_b.t_start(), (maxdim * TOLERANCE_B))) {
-                    float x = float(2.0 * acos(__min(__max(-dot(alpha, beta), -1.0), 1.0)) / M_PI);
-                    depthmapX::addIfNotExists(connectionset_a.m_back_segconns, SegmentRef(1, idx_b), x);
-                    depthmapX::addIfNotExists(connectionset_b.m_back_segconns, SegmentRef(1, idx_a), x);
-                }
-                if (approxeq(line_a.t_start(), line_b.t_end(), (maxdim * TOLERANCE_B))) {
-                    float x = float(2.0 * acos(__min(__max(-dot(alpha, -beta), -1.0), 1.0)) / M_PI);
-                    depthmapX::addIfNotExists(connectionset_a.m_back_segconns, SegmentRef(-1, idx_b), x);
-                    depthmapX::addIfNotExists(connectionset_b.m_forward_segconns, SegmentRef(1, idx_a), x);
-                }
-            }
-        }
-
-        PixelRef pix2 = pixelate(line_a.t_end());
-        std::vector<ShapeRef> &shapes2 = m_pixel_shapes(static_cast<size_t>(pix2.y), static_cast<size_t>(pix2.x));
-        for (auto &shape : shapes2) {
-            auto lineConnector_b = lineConnectors.find(shape.m_shape_ref);
-            if (lineConnector_b != lineConnectors.end() && idx_a < lineConnector_b->second.m_index) {
-
-                Connector &connectionset_b = lineConnector_b->second.m_connector;
-                const Line &line_b = lineConnector_b->second.m_line;
-                int idx_b = lineConnector_b->second.m_index;
-
-                Point2f alpha = line_a.vector();
-                Point2f beta = line_b.vector();
-
-                alpha.normalise();
-                beta.normalise();
-                if (approxeq(line_a.t_end(), line_b.t_start(), (maxdim * TOLERANCE_B))) {
-                    float x = float(2.0 * acos(__min(__max(-dot(-alpha, beta), -1.0), 1.0)) / M_PI);
-                    depthmapX::addIfNotExists(connectionset_a.m_forward_segconns, SegmentRef(1, idx_b), x);
-                    depthmapX::addIfNotExists(connectionset_b.m_back_segconns, SegmentRef(-1, idx_a), x);
-                }
-                if (approxeq(line_a.t_end(), line_b.t_end(), (maxdim * TOLERANCE_B))) {
-                    float x = float(2.0 * acos(__min(__max(-dot(-alpha, -beta), -1.0), 1.0)) / M_PI);
-                    depthmapX::addIfNotExists(connectionset_a.m_forward_segconns, SegmentRef(-1, idx_b), x);
-                    depthmapX::addIfNotExists(connectionset_b.m_forward_segconns, SegmentRef(-1, idx_a), x);
+    // The joins of each line to the lines after it are found on several threads and then added to
+    // the connectors line by line, in the same order as they would be found one after the other
+    struct Join {
+        LineConnector *m_line_b;
+        bool m_end_a; // joined at the end of line a rather than its start
+        bool m_end_b;
+        float m_x;
+    };
+    std::vector<std::vector<Join>> joins(lineConnectorList.size());
+
+    depthmapX::parallelFor(comm, lineConnectorList.size(), threads, [&](int, size_t item) {
+        const Line &line_a = lineConnectorList[item]->m_line;
+        int idx_a = lineConnectorList[item]->m_index;
+        for (bool end_a : {false, true}) {
+            // n.b., vector() is based on t_start and t_end, so we must use t_start and t_end here and throughout
+            Point2f point_a = end_a ? line_a.t_end() : line_a.t_start();
+            PixelRef pix = pixelate(point_a);
+            const std::vector<ShapeRef> &shapes = m_pixel_shapes(static_cast<size_t>(pix.y), static_cast<size_t>(pix.x));
+            for (auto &shape : shapes) {
+                auto lineConnector_b = lineConnectors.find(shape.m_shape_ref);
+                if (lineConnector_b != lineConnectors.end() && idx_a < lineConnector_b->second.m_index) {
+                    const Line &line_b = lineConnector_b->second.m_line;
+
+                    Point2f alpha = line_a.vector();
+                    Point2f beta = line_b.vector();
+                    alpha.normalise();
+                    beta.normalise();
+                    if (end_a) {
+                        alpha = -alpha;
+                    }
+                    for (bool end_b : {false, true}) {
+                        if (approxeq(point_a, end_b ? line_b.t_end() : line_b.t_start(), (maxdim * TOLERANCE_B))) {
+                            float x = float(2.0 * acos(__min(__max(-dot(alpha, end_b ? -beta : beta), -1.0), 1.0)) /
+                                            M_PI);
+                            joins[item].push_back(Join{&lineConnector_b->second, end_a, end_b, x});
+                        }
+                    }
                 }
             }
         }
-
-        if (comm) {
-            if (qtimer(atime, 500)) {
-                if (comm->IsCancelled()) {
-                    throw Communicator::CancelledException();
-                }
-                comm->CommPostMessage(Communicator::CURRENT_RECORD, count);
-            }
+    });
+
+    for (size_t item = 0; item < lineConnectorList.size(); item++) {
+        Connector &connectionset_a = lineConnectorList[item]->m_connector;
+        int idx_a = lineConnectorList[item]->m_index;
+        for (const Join &join : joins[item]) {
+            Connector &connectionset_b = join.m_line_b->m_connector;
+            int idx_b = join.m_line_b->m_index;
+            depthmapX::addIfNotExists(join.m_end_a ? connectionset_a.m_forward_segconns
+                                                   : connectionset_a.m_back_segconns,
+                                      SegmentRef(join.m_end_b ? -1 : 1, idx_b), join.m_x);
+            depthmapX::addIfNotExists(join.m_end_b ? connectionset_b.m_forward_segconns
+                                                   : connectionset_b.m_back_segconns,
+                                      SegmentRef(join.m_end_a ? -1 : 1, idx_a), join.m_x);
         }
-        count++;
     }
 
     // initialise attributes now separated from making the connections
@@ -591,7 +581,7 @@ void ShapeGraph::makeSegmentMap(std::vector<Line>& lines, std::vector<Connector>
       for (size_t j = 0; j < connections.size(); j++) {
          // find the intersection point and add...
          // note: more than one break at the same place allowed
-         auto shapeJ = depthmapX::getMapAtIndex(m_shapes, connections[j])->second;
+         auto shapeJ = getShapeRefFromIndex(connections[j])->second;
          if (static_cast<int>(i) != connections[j] && shapeJ.isLine()) {
             breaks.push_back(std::make_pair(parity * line.intersection_point( shapeJ.getLine(), axis, TOLERANCE_A ),
                                          connections[j]));
@@ -64,10 +64,10 @@ public:
    ShapeGraph(const std::string& name = "<axial map>", int type = ShapeMap::AXIALMAP);
    virtual ~ShapeGraph() {;}
    void initialiseAttributesAxial();
-   void makeConnections(const KeyVertices &keyvertices = KeyVertices());
+   void makeConnections(const KeyVertices &keyvertices = KeyVertices(), int threads = 1);
    bool stepdepth(Communicator *comm = NULL);
    // lineset and connectionset are filled in by segment map
-   void makeNewSegMap(Communicator *comm);
+   void makeNewSegMap(Communicator *comm, int threads = 1);
    void makeSegmentMap(std::vector<Line> &lines, std::vector<Connector> &connectors, double stubremoval);
    void initialiseAttributesSegment();
    void makeSegmentConnections(std::vector<Connector> &connectionset);
@@ -75,7 +75,7 @@ public:
    //
    virtual bool read(std::istream& stream);
    bool readold(std::istream& stream);
-   virtual bool write(std::ofstream& stream);
+   virtual bool write(std::ostream& stream);
    void writeAxialConnectionsAsDotGraph(std::ostream &stream);
    void writeAxialConnectionsAsPairsCSV(std::ostream &stream);
    void writeSegmentConnectionsAsPairsCSV(std::ostream &stream);
@@ -54,7 +54,7 @@ void AxialMinimiser::removeSubsets(std::map<int, std::set<int> >& axsegcuts, std
       m_vps[y].index = y;
       double length = m_axialconns[y].m_connections.size();
       m_vps[y].value1 = (int) length;
-      length = depthmapX::getMapAtIndex(m_alllinemap->m_shapes, y)->second.getLine().length();
+      length = m_alllinemap->getShapeRefFromIndex(y)->second.getLine().length();
       m_vps[y].value2 = (float) length;
    }
 
@@ -183,7 +183,7 @@ void AxialMinimiser::fewestLongest(std::map<int, std::set<int> > &axsegcuts, std
       if (!m_removed[y] && !m_vital[y]) {
          m_vps[livecount].index = (int) y;
          m_vps[livecount].value1 = (int) m_axialconns[y].m_connections.size();
-         m_vps[livecount].value2 = (float) depthmapX::getMapAtIndex(m_alllinemap->m_shapes, y)->second.getLine().length();
+         m_vps[livecount].value2 = (float) m_alllinemap->getShapeRefFromIndex(y)->second.getLine().length();
          livecount++;
       }
    }
@@ -18,6 +18,7 @@
 
 #include "salalib/axialmodules/axialintegration.h"
 
+#include "genlib/parallel.h"
 #include "genlib/pflipper.h"
 #include "genlib/stringutils.h"
 
@@ -217,34 +218,97 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
         }
     }
 
-    // for choice
-    AnalysisInfo **audittrail;
-    if (m_choice) {
-        audittrail = new AnalysisInfo *[map.getShapeCount()];
-        for (size_t i = 0; i < map.getShapeCount(); i++) {
-            audittrail[i] = new AnalysisInfo[radii.size()];
-        }
-    }
+    size_t shapeCount = map.getShapeCount();
+    size_t radiusCount = radii.size();
 
-    // n.b., for this operation we assume continuous line referencing from zero (this is silly?)
-    // has already failed due to this!  when intro hand drawn fewest line (where user may have deleted)
-    // it's going to get worse...
+    std::vector<AttributeRow *> rows;
+    rows.reserve(shapeCount);
+    for (auto &iter : attributes) {
+        rows.push_back(&iter.getRow());
+    }
 
-    bool *covered = new bool[map.getShapeCount()];
+    int threads = depthmapX::resolveThreadCount(m_threads);
+
+    // Choice picks the next line to search from with pafrand, so to get the same values
+    // from several threads every origin has to start from where the random sequence
+    // would be in a single thread. One number is drawn each time a line is searched from,
+    // and which lines are searched from does not depend on the order, so a plain search
+    // counts them beforehand.
+    uint64_t randstate = pafrandstate();
+    std::vector<uint64_t> randstates;
+    if (m_choice && threads > 1) {
+        std::vector<uint64_t> draws(shapeCount);
+        std::vector<std::vector<char>> workerCovered(static_cast<size_t>(threads));
+        std::vector<std::vector<int>> workerLevels(static_cast<size_t>(threads));
+        depthmapX::parallelFor(nullptr, shapeCount, threads, [&](int worker, size_t i) {
+            draws[i] = countSearched(map, i, radii.back(), workerCovered[static_cast<size_t>(worker)],
+                                     workerLevels[static_cast<size_t>(worker)]);
+        });
+        randstates.resize(shapeCount);
+        for (size_t i = 0; i < shapeCount; i++) {
+            randstates[i] = randstate;
+            randstate = pafrandskip(randstate, draws[i]);
+        }
+    }
 
-    size_t i = -1;
-    for (auto & iter : attributes) {
-        i++;
-        AttributeRow &row = iter.getRow();
-        for (size_t j = 0; j < map.getShapeCount(); j++) {
-            covered[j] = false;
+    // Choice counts are whole numbers, so each worker can keep its own totals and they
+    // add up to the same thing in any order. Weighted choice is not, so with more than
+    // one thread each origin logs what it adds and the logs are added in origin order,
+    // a few origins at a time to keep them small.
+    bool logWeightedChoice = m_choice && m_weighted_measure_col != -1 && threads > 1;
+    std::vector<SearchState> states(static_cast<size_t>(threads));
+
+    // each origin only sets its own row of these, and they are written to the table
+    // column by column at the end, which updates the column stats in row order
+    std::vector<AttributeColumnValues> columnValues(attributes.getNumColumns());
+    for (const std::vector<int> *cols :
+         {&entropy_col, &integ_dv_col, &integ_pv_col, &integ_tk_col, &intensity_col, &depth_col, &count_col,
+          &rel_entropy_col, &penn_norm_col, &w_depth_col, &total_weight_col, &ra_col, &rra_col, &td_col,
+          &harmonic_col}) {
+        for (int col : *cols) {
+            columnValues[col] = AttributeColumnValues(shapeCount);
         }
-        if (m_choice) {
-            for (size_t k = 0; k < map.getShapeCount(); k++) {
-                audittrail[k][0].previous.ref = -1; // note, 0th member used as radius doesn't matter
-                // note, choice columns are not cleared, but cummulative over all shortest path pairs
+    }
+    if (control_col != -1) {
+        columnValues[control_col] = AttributeColumnValues(shapeCount);
+        columnValues[controllability_col] = AttributeColumnValues(shapeCount);
+    }
+    std::vector<std::vector<std::pair<size_t, double>>> weightedChoiceLogs(logWeightedChoice ? shapeCount : 0);
+
+    auto analyse = [&](int worker, size_t i) {
+        SearchState &state = states[static_cast<size_t>(worker)];
+        if (state.covered.empty()) {
+            state.covered.resize(shapeCount);
+            if (m_choice) {
+                state.previous.resize(shapeCount);
+                state.choice.assign(shapeCount * radiusCount, 0.0);
+                if (!logWeightedChoice) {
+                    state.weightedChoice.assign(shapeCount * radiusCount, 0.0);
+                }
+            }
+            if (!randstates.empty() || worker == 0) {
+                state.randstate = randstate;
             }
         }
+        if (!randstates.empty()) {
+            state.randstate = randstates[i];
+        }
+        std::vector<std::pair<size_t, double>> *weightedChoiceLog =
+            logWeightedChoice ? &weightedChoiceLogs[i] : nullptr;
+        auto setValue = [&columnValues, i](int col, float value) { columnValues[col].setValue(i, value); };
+        auto addWeightedChoice = [&](size_t index, double value) {
+            if (weightedChoiceLog) {
+                weightedChoiceLog->emplace_back(index, value);
+            } else {
+                state.weightedChoice[index] += value;
+            }
+        };
+
+        std::fill(state.covered.begin(), state.covered.end(), 0);
+        if (m_choice) {
+            // note, choice columns are not cleared, but cummulative over all shortest path pairs
+            std::fill(state.previous.begin(), state.previous.end(), -1);
+        }
 
         if (m_local) {
             double control = 0.0;
@@ -266,12 +330,12 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
 
             if (!simple_version) {
                 if (connections.size() > 0) {
-                    row.setValue(control_col, float(control));
-                    row.setValue(controllability_col,
-                                 float(double(connections.size()) / double(totalneighbourhood.size() - 1)));
+                    setValue(control_col, float(control));
+                    setValue(controllability_col,
+                             float(double(connections.size()) / double(totalneighbourhood.size() - 1)));
                 } else {
-                    row.setValue(control_col, -1);
-                    row.setValue(controllability_col, -1);
+                    setValue(control_col, -1);
+                    setValue(controllability_col, -1);
                 }
             }
         }
@@ -281,7 +345,7 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
 
         pflipper<std::vector<std::pair<int, int>>> foundlist;
         foundlist.a().push_back(std::pair<int, int>(i, -1));
-        covered[i] = true;
+        state.covered[i] = 1;
         int total_depth = 0, depth = 1, node_count = 1, pos = -1, previous = -1; // node_count includes this 1
         double weight = 0.0, rootweight = 0.0, total_weight = 0.0, w_total_depth = 0.0;
         if (m_weighted_measure_col != -1) {
@@ -296,16 +360,16 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
                 if (!m_choice) {
                     index = foundlist.a().back().first;
                 } else {
-                    pos = pafrand() % foundlist.a().size();
+                    pos = pafrandnext(state.randstate) % foundlist.a().size();
                     index = foundlist.a().at(pos).first;
                     previous = foundlist.a().at(pos).second;
-                    audittrail[index][0].previous.ref =
+                    state.previous[index] =
                         previous; // note 0th member used here: can be used individually different radius previous
                 }
                 Connector &line = map.getConnections()[index];
                 for (size_t k = 0; k < line.m_connections.size(); k++) {
-                    if (!covered[line.m_connections[k]]) {
-                        covered[line.m_connections[k]] = true;
+                    if (!state.covered[line.m_connections[k]]) {
+                        state.covered[line.m_connections[k]] = 1;
                         foundlist.b().push_back(std::pair<int, int>(line.m_connections[k], index));
                         if (m_weighted_measure_col != -1) {
                             // the weight is taken from the discovered node:
@@ -318,16 +382,15 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
                             // (coincidentally fixes choice problem which was completely wrong)
                             size_t here = index;   // note: start counting from index as actually looking ahead here
                             while (here != i) { // not i means not the current root for the path
-                                audittrail[here][r].choice += 1;
-                                audittrail[here][r].weighted_choice += weight * rootweight;
-                                here =
-                                    audittrail[here][0].previous.ref; // <- note, just using 0th position: radius for
-                                                                      // the previous doesn't matter in this analysis
+                                state.choice[here * radiusCount + r] += 1;
+                                addWeightedChoice(here * radiusCount + r, weight * rootweight);
+                                here = state.previous[here]; // <- note, just using 0th position: radius for
+                                                             // the previous doesn't matter in this analysis
                             }
                             if (m_weighted_measure_col != -1) {
                                 // in weighted choice, root node and current node receive values:
-                                audittrail[i][r].weighted_choice += (weight * rootweight) * 0.5;
-                                audittrail[line.m_connections[k]][r].weighted_choice += (weight * rootweight) * 0.5;
+                                addWeightedChoice(i * radiusCount + r, (weight * rootweight) * 0.5);
+                                addWeightedChoice(line.m_connections[k] * radiusCount + r, (weight * rootweight) * 0.5);
                             }
                         }
                         total_depth += depth;
@@ -349,18 +412,18 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
                 }
             }
             // set the attributes for this node:
-            row.setValue(count_col[r], float(node_count));
+            setValue(count_col[r], float(node_count));
             if (m_weighted_measure_col != -1) {
-                row.setValue(total_weight_col[r], float(total_weight));
+                setValue(total_weight_col[r], float(total_weight));
             }
             // node count > 1 to avoid divide by zero (was > 2)
             if (node_count > 1) {
                 // note -- node_count includes this one -- mean depth as per p.108 Social Logic of Space
                 double mean_depth = double(total_depth) / double(node_count - 1);
-                row.setValue(depth_col[r], float(mean_depth));
+                setValue(depth_col[r], float(mean_depth));
                 if (m_weighted_measure_col != -1) {
                     // weighted mean depth:
-                    row.setValue(w_depth_col[r], float(w_total_depth / total_weight));
+                    setValue(w_depth_col[r], float(w_total_depth / total_weight));
                 }
                 // total nodes > 2 to avoid divide by 0 (was > 3)
                 if (node_count > 2 && mean_depth > 1.0) {
@@ -369,52 +432,52 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
                     double rra_d = ra / dvalue(node_count);
                     double rra_p = ra / dvalue(node_count);
                     double integ_tk = teklinteg(node_count, total_depth);
-                    row.setValue(integ_dv_col[r], float(1.0 / rra_d));
+                    setValue(integ_dv_col[r], float(1.0 / rra_d));
 
                     if (!simple_version) {
-                        row.setValue(integ_pv_col[r], float(1.0 / rra_p));
+                        setValue(integ_pv_col[r], float(1.0 / rra_p));
                         if (total_depth - node_count + 1 > 1) {
-                            row.setValue(integ_tk_col[r], float(integ_tk));
+                            setValue(integ_tk_col[r], float(integ_tk));
                         } else {
-                            row.setValue(integ_tk_col[r], -1.0f);
+                            setValue(integ_tk_col[r], -1.0f);
                         }
                     }
 
                     if (m_fulloutput) {
-                        row.setValue(ra_col[r], float(ra));
+                        setValue(ra_col[r], float(ra));
 
                         if (!simple_version) {
-                            row.setValue(rra_col[r], float(rra_d));
+                            setValue(rra_col[r], float(rra_d));
                         }
-                        row.setValue(td_col[r], float(total_depth));
+                        setValue(td_col[r], float(total_depth));
 
                         if (!simple_version) {
                             // alan's palm-tree normalisation: palmtree
                             double dmin = node_count - 1;
                             double dmax = palmtree(node_count, depth - 1);
                             if (dmax != dmin) {
-                                row.setValue(penn_norm_col[r], float((dmax - total_depth) / (dmax - dmin)));
+                                setValue(penn_norm_col[r], float((dmax - total_depth) / (dmax - dmin)));
                             }
                         }
                     }
                 } else {
-                    row.setValue(integ_dv_col[r], -1.0f);
+                    setValue(integ_dv_col[r], -1.0f);
 
                     if (!simple_version) {
-                        row.setValue(integ_pv_col[r], -1.0f);
-                        row.setValue(integ_tk_col[r], -1.0f);
+                        setValue(integ_pv_col[r], -1.0f);
+                        setValue(integ_tk_col[r], -1.0f);
                     }
                     if (m_fulloutput) {
-                        row.setValue(ra_col[r], -1.0f);
+                        setValue(ra_col[r], -1.0f);
 
                         if (!simple_version) {
-                            row.setValue(rra_col[r], -1.0f);
+                            setValue(rra_col[r], -1.0f);
                         }
 
-                        row.setValue(td_col[r], -1.0f);
+                        setValue(td_col[r], -1.0f);
 
                         if (!simple_version) {
-                            row.setValue(penn_norm_col[r], -1.0f);
+                            setValue(penn_norm_col[r], -1.0f);
                         }
                     }
                 }
@@ -441,46 +504,103 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
                     } else {
                         intensity = -1;
                     }
-                    row.setValue(entropy_col[r], float(entropy));
-                    row.setValue(rel_entropy_col[r], float(rel_entropy));
-                    row.setValue(intensity_col[r], float(intensity));
-                    row.setValue(harmonic_col[r], float(harmonic));
+                    setValue(entropy_col[r], float(entropy));
+                    setValue(rel_entropy_col[r], float(rel_entropy));
+                    setValue(intensity_col[r], float(intensity));
+                    setValue(harmonic_col[r], float(harmonic));
                 }
             } else {
-                row.setValue(depth_col[r], -1.0f);
-                row.setValue(integ_dv_col[r], -1.0f);
+                setValue(depth_col[r], -1.0f);
+                setValue(integ_dv_col[r], -1.0f);
 
                 if (!simple_version) {
-                    row.setValue(integ_pv_col[r], -1.0f);
-                    row.setValue(integ_tk_col[r], -1.0f);
-                    row.setValue(entropy_col[r], -1.0f);
-                    row.setValue(rel_entropy_col[r], -1.0f);
-                    row.setValue(harmonic_col[r], -1.0f);
+                    setValue(integ_pv_col[r], -1.0f);
+                    setValue(integ_tk_col[r], -1.0f);
+                    setValue(entropy_col[r], -1.0f);
+                    setValue(rel_entropy_col[r], -1.0f);
+                    setValue(harmonic_col[r], -1.0f);
                 }
             }
             ++r;
         }
-        //
-        if (comm) {
-            if (qtimer(atime, 500)) {
-                if (comm->IsCancelled()) {
-                    delete[] covered;
-                    throw Communicator::CancelledException();
+    };
+
+    std::vector<double> weightedChoice;
+    if (!logWeightedChoice) {
+        depthmapX::parallelFor(comm, shapeCount, threads, analyse);
+    } else {
+        weightedChoice.assign(shapeCount * radiusCount, 0.0);
+        size_t chunk = static_cast<size_t>(threads) * 4;
+        for (size_t first = 0; first < shapeCount; first += chunk) {
+            size_t count = std::min(chunk, shapeCount - first);
+            depthmapX::parallelFor(nullptr, count, threads,
+                                   [&](int worker, size_t item) { analyse(worker, first + item); });
+            for (size_t i = first; i < first + count; i++) {
+                for (auto &entry : weightedChoiceLogs[i]) {
+                    weightedChoice[entry.first] += entry.second;
+                }
+                std::vector<std::pair<size_t, double>>().swap(weightedChoiceLogs[i]);
+            }
+            if (comm) {
+                if (qtimer(atime, 500)) {
+                    if (comm->IsCancelled()) {
+                        throw Communicator::CancelledException();
+                    }
+                    comm->CommPostMessage(Communicator::CURRENT_RECORD, static_cast<int>(first + count));
                 }
-                comm->CommPostMessage(Communicator::CURRENT_RECORD, i);
             }
         }
     }
-    delete[] covered;
+
+    for (size_t col = 0; col < columnValues.size(); col++) {
+        if (columnValues[col].size() != 0) {
+            attributes.setColumnValues(col, columnValues[col]);
+        }
+    }
+    std::vector<AttributeColumnValues>().swap(columnValues);
+
     if (m_choice) {
-        i = -1;
-        for (auto & iter: attributes) {
-            i++;
-            AttributeRow &row = iter.getRow();
+        // carry on the random sequence from where a single thread would have left it
+        if (!randstates.empty()) {
+            pafsetrandstate(randstate);
+        } else if (!states.empty() && !states[0].covered.empty()) {
+            pafsetrandstate(states[0].randstate);
+        }
+
+        std::vector<double> choice(shapeCount * radiusCount, 0.0);
+        for (SearchState &state : states) {
+            if (state.covered.empty()) {
+                continue;
+            }
+            for (size_t k = 0; k < choice.size(); k++) {
+                choice[k] += state.choice[k];
+            }
+            if (!logWeightedChoice) {
+                if (weightedChoice.empty()) {
+                    weightedChoice.assign(shapeCount * radiusCount, 0.0);
+                }
+                for (size_t k = 0; k < weightedChoice.size(); k++) {
+                    weightedChoice[k] += state.weightedChoice[k];
+                }
+            }
+        }
+        if (weightedChoice.empty()) {
+            weightedChoice.assign(shapeCount * radiusCount, 0.0);
+        }
+
+        std::vector<AttributeColumnValues> choiceValues(radiusCount, AttributeColumnValues(shapeCount));
+        std::vector<AttributeColumnValues> nChoiceValues(radiusCount, AttributeColumnValues(shapeCount));
+        std::vector<AttributeColumnValues> wChoiceValues, nwChoiceValues;
+        if (m_weighted_measure_col != -1) {
+            wChoiceValues.assign(radiusCount, AttributeColumnValues(shapeCount));
+            nwChoiceValues.assign(radiusCount, AttributeColumnValues(shapeCount));
+        }
+        for (size_t i = 0; i < shapeCount; i++) {
+            const AttributeRow &row = *rows[i];
             double total_choice = 0.0, w_total_choice = 0.0;
             for (size_t r = 0; r < radii.size(); r++) {
-                total_choice += audittrail[i][r].choice;
-                w_total_choice += audittrail[i][r].weighted_choice;
+                total_choice += choice[i * radiusCount + r];
+                w_total_choice += weightedChoice[i * radiusCount + r];
                 // n.b., normalise choice according to (n-1)(n-2)/2 (maximum possible through routes)
                 double node_count = row.getValue(count_col[r]);
                 double total_weight = 0;
@@ -488,26 +608,30 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
                     total_weight = row.getValue(total_weight_col[r]);
                 }
                 if (node_count > 2) {
-                    row.setValue(choice_col[r], float(total_choice));
-                    row.setValue(n_choice_col[r], float(2.0 * total_choice / ((node_count - 1) * (node_count - 2))));
+                    choiceValues[r].setValue(i, float(total_choice));
+                    nChoiceValues[r].setValue(i, float(2.0 * total_choice / ((node_count - 1) * (node_count - 2))));
                     if (m_weighted_measure_col != -1) {
-                        row.setValue(w_choice_col[r], float(w_total_choice));
-                        row.setValue(nw_choice_col[r], float(2.0 * w_total_choice / (total_weight * total_weight)));
+                        wChoiceValues[r].setValue(i, float(w_total_choice));
+                        nwChoiceValues[r].setValue(i, float(2.0 * w_total_choice / (total_weight * total_weight)));
                     }
                 } else {
-                    row.setValue(choice_col[r], -1);
-                    row.setValue(n_choice_col[r], -1);
+                    choiceValues[r].setValue(i, -1);
+                    nChoiceValues[r].setValue(i, -1);
                     if (m_weighted_measure_col != -1) {
-                        row.setValue(w_choice_col[r], -1);
-                        row.setValue(nw_choice_col[r], -1);
+                        wChoiceValues[r].setValue(i, -1);
+                        nwChoiceValues[r].setValue(i, -1);
                     }
                 }
             }
         }
-        for (size_t i = 0; i < map.getShapeCount(); i++) {
-            delete[] audittrail[i];
+        for (size_t r = 0; r < radiusCount; r++) {
+            attributes.setColumnValues(choice_col[r], choiceValues[r]);
+            attributes.setColumnValues(n_choice_col[r], nChoiceValues[r]);
+            if (m_weighted_measure_col != -1) {
+                attributes.setColumnValues(w_choice_col[r], wChoiceValues[r]);
+                attributes.setColumnValues(nw_choice_col[r], nwChoiceValues[r]);
+            }
         }
-        delete[] audittrail;
     }
 
     map.setDisplayedAttribute(-1); // <- override if it's already showing
@@ -515,3 +639,31 @@ bool AxialIntegration::run(Communicator *comm, ShapeGraph &map, bool simple_vers
 
     return true;
 }
+
+// the number of lines an origin is searched from, i.e. those closer than the largest radius
+uint64_t AxialIntegration::countSearched(ShapeGraph &map, size_t origin, int radius, std::vector<char> &covered,
+                                         std::vector<int> &level) const {
+    covered.assign(map.getShapeCount(), 0);
+    level.clear();
+    level.push_back(static_cast<int>(origin));
+    covered[origin] = 1;
+    std::vector<int> next;
+    uint64_t searched = 0;
+    for (int depth = 1; !level.empty(); depth++) {
+        searched += level.size();
+        if (radius != -1 && depth >= radius) {
+            break;
+        }
+        next.clear();
+        for (int index : level) {
+            for (int connection : map.getConnections()[size_t(index)].m_connections) {
+                if (!covered[size_t(connection)]) {
+                    covered[size_t(connection)] = 1;
+                    next.push_back(connection);
+                }
+            }
+        }
+        level.swap(next);
+    }
+    return searched;
+}
@@ -20,6 +20,9 @@
 
 #include "salalib/iaxial.h"
 
+#include <cstdint>
+#include <vector>
+
 class AxialIntegration : IAxial {
   private:
     std::set<double> m_radius_set;
@@ -27,11 +30,25 @@ class AxialIntegration : IAxial {
     bool m_choice;
     bool m_fulloutput;
     bool m_local;
+    int m_threads;
+
+    // what a worker needs to search from one origin, kept between origins
+    struct SearchState {
+        std::vector<char> covered;
+        std::vector<int> previous;
+        std::vector<double> choice;
+        std::vector<double> weightedChoice;
+        uint64_t randstate = 0;
+    };
+
+    uint64_t countSearched(ShapeGraph &map, size_t origin, int radius, std::vector<char> &covered,
+                           std::vector<int> &level) const;
 
   public:
     std::string getAnalysisName() const override { return "Angular Analysis"; }
     bool run(Communicator *, ShapeGraph &map, bool) override;
-    AxialIntegration(std::set<double> radius_set, int weighted_measure_col, bool choice, bool fulloutput, bool local)
+    AxialIntegration(std::set<double> radius_set, int weighted_measure_col, bool choice, bool fulloutput, bool local,
+                     int threads = 1)
         : m_radius_set(radius_set), m_weighted_measure_col(weighted_measure_col), m_choice(choice),
-          m_fulloutput(fulloutput), m_local(local) {}
+          m_fulloutput(fulloutput), m_local(local), m_threads(threads) {}
 };
@@ -42,7 +42,7 @@ bool Connector::read( std::istream& stream)
    return true;
 }
 
-bool Connector::write( std::ofstream& stream )
+bool Connector::write( std::ostream& stream )
 {
    // n.b., must set displayed attribute as soon as loaded...
    dXreadwrite::writeVector(stream, m_connections);
@@ -0,0 +1,85 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "salalib/csrvisibilitygraph.h"
+
+#include "salalib/ngraph.h"
+#include "salalib/pointdata.h"
+
+CSRVisibilityGraph::CSRVisibilityGraph(PointMap &map) : m_index(map.getRows(), map.getCols()) {
+    m_index.initialiseValues(-1);
+    for (size_t i = 0; i < map.getCols(); i++) {
+        for (size_t j = 0; j < map.getRows(); j++) {
+            PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
+            Point &point = map.getPoint(curs);
+            if (point.filled() && point.hasNode()) {
+                m_index(j, i) = static_cast<int>(m_cells.size());
+                m_cells.push_back(curs);
+            }
+        }
+    }
+
+    size_t edges = 0;
+    for (PixelRef curs : m_cells) {
+        Node &node = map.getPoint(curs).getNode();
+        for (int b = 0; b < 32; b++) {
+            edges += node.bin(b).count();
+        }
+    }
+    m_neighbours.reserve(edges);
+    m_offsets.reserve(m_cells.size() * 32 + 1);
+    for (PixelRef curs : m_cells) {
+        Node &node = map.getPoint(curs).getNode();
+        for (int b = 0; b < 32; b++) {
+            m_offsets.push_back(m_neighbours.size());
+            Bin &bin = node.bin(b);
+            for (auto pixVec : bin.m_pixel_vecs) {
+                for (PixelRef pix = pixVec.start(); pix.col(bin.m_dir) <= pixVec.end().col(bin.m_dir);) {
+                    // bins only hold filled pixels unless the points have been changed since
+                    int index = m_index(pix.y, pix.x);
+                    if (index != -1) {
+                        m_neighbours.push_back(static_cast<unsigned int>(index));
+                    }
+                    pix.move(bin.m_dir);
+                }
+            }
+        }
+    }
+    m_offsets.push_back(m_neighbours.size());
+}
+
+size_t CSRVisibilityGraph::memoryUsage() const {
+    return sizeof(CSRVisibilityGraph) + m_cells.capacity() * sizeof(PixelRef) + m_index.size() * sizeof(int) +
+           m_offsets.capacity() * sizeof(size_t) + m_neighbours.capacity() * sizeof(unsigned int);
+}
+
+size_t CSRVisibilityGraph::nodeMemoryUsage(PointMap &map) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < map.getCols(); i++) {
+        for (size_t j = 0; j < map.getRows(); j++) {
+            Point &point = map.getPoint(PixelRef(static_cast<short>(i), static_cast<short>(j)));
+            if (!point.hasNode()) {
+                continue;
+            }
+            Node &node = point.getNode();
+            bytes += sizeof(Node);
+            for (int b = 0; b < 32; b++) {
+                bytes += node.bin(b).m_pixel_vecs.capacity() * sizeof(PixelVec);
+                bytes += node.m_occlusion_bins[b].capacity() * sizeof(PixelRef);
+            }
+        }
+    }
+    return bytes;
+}
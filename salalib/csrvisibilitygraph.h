@@ -0,0 +1,58 @@
+// sala - a component of the depthmapX - spatial network analysis platform
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "salalib/pixelref.h"
+
+#include "genlib/simplematrix.h"
+
+#include <vector>
+
+class PointMap;
+
+// An immutable compressed sparse row copy of the visibility graph of a PointMap,
+// taken once the graph has been made (sparkGraph2). The filled cells are numbered
+// column by column, in the order the analyses visit their origins in, and the
+// neighbours of each cell are stored as cell numbers in one array, in the order
+// the bins of its Node list them, with an offset per bin so that the 32-bin
+// partition is kept. The snapshot does not follow later changes to the map.
+class CSRVisibilityGraph {
+  public:
+    explicit CSRVisibilityGraph(PointMap &map);
+
+    size_t size() const { return m_cells.size(); }
+    PixelRef cell(size_t i) const { return m_cells[i]; }
+    // the number of a filled cell, -1 for any other pixel
+    int index(PixelRef pix) const { return m_index(pix.y, pix.x); }
+
+    const unsigned int *begin(size_t i) const { return m_neighbours.data() + m_offsets[i * 32]; }
+    const unsigned int *end(size_t i) const { return m_neighbours.data() + m_offsets[i * 32 + 32]; }
+    const unsigned int *binBegin(size_t i, int bin) const { return m_neighbours.data() + m_offsets[i * 32 + bin]; }
+    const unsigned int *binEnd(size_t i, int bin) const { return m_neighbours.data() + m_offsets[i * 32 + bin + 1]; }
+    size_t degree(size_t i) const { return m_offsets[i * 32 + 32] - m_offsets[i * 32]; }
+    size_t edgeCount() const { return m_neighbours.size(); }
+
+    // bytes held by the snapshot
+    size_t memoryUsage() const;
+    // bytes held by the Nodes of the map's filled points, for comparison
+    static size_t nodeMemoryUsage(PointMap &map);
+
+  private:
+    std::vector<PixelRef> m_cells;
+    depthmapX::RowMatrix<int> m_index;
+    std::vector<size_t> m_offsets;
+    std::vector<unsigned int> m_neighbours;
+};
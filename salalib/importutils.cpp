@@ -15,119 +15,119 @@
 
 #include "importutils.h"
 
+#include "genlib/memorymappedfile.h"
+#include "genlib/parallel.h"
 #include "genlib/stringutils.h"
 
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <numeric>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
 
 namespace depthmapX {
 
     const int DXFCIRCLERES = 36;
 
-    bool importFile(MetaGraph &mgraph, std::istream &stream, Communicator *communicator, std::string name,
-                    ImportType mapType, ImportFileType fileType) {
-
-        // This function is still too fiddly but at least it shows the common interface for
-        // drawing and data maps and how different file types may be parsed to be imported
-        // into them
+    namespace {
+        // Makes a map for every layer with something in it and fills them in parallel. The maps
+        // are all made first, as making one may move the maps made before it
+        bool importDxfLayers(MetaGraph &mgraph, const DxfParser &dp, ImportType mapType, int threads) {
+            std::vector<const DxfLayer *> dxfLayers;
+            for (auto &layer : dp.getLayers()) {
+                if (!layer.second.empty()) {
+                    mgraph.createNewShapeMap(mapType, layer.first);
+                    dxfLayers.push_back(&layer.second);
+                }
+            }
+            std::vector<ShapeMap *> shapeMaps;
+            for (size_t i = 0; i < dxfLayers.size(); i++) {
+                if (mapType == DRAWINGMAP) {
+                    auto &layers = mgraph.m_drawingFiles.back().m_spacePixels;
+                    shapeMaps.push_back(&layers[layers.size() - dxfLayers.size() + i]);
+                } else {
+                    auto &dataMaps = mgraph.getDataMaps();
+                    shapeMaps.push_back(&dataMaps[dataMaps.size() - dxfLayers.size() + i]);
+                }
+            }
 
-        int state = MetaGraph::NONE;
-        int viewClass = MetaGraph::NONE;
+            parallelFor(nullptr, dxfLayers.size(), threads,
+                        [&](int, size_t i) { importDxfLayer(*dxfLayers[i], *shapeMaps[i]); });
 
-        switch (mapType) {
-        case DRAWINGMAP: {
-            state = MetaGraph::LINEDATA;
-            viewClass = MetaGraph::SHOWSHAPETOP;
-            break;
-        }
-        case DATAMAP: {
-            state = MetaGraph::DATAMAPS;
-            viewClass = MetaGraph::SHOWSHAPETOP;
-            break;
-        }
+            if (mapType == DRAWINGMAP) {
+                for (ShapeMap *shapeMap : shapeMaps) {
+                    mgraph.updateParentRegions(*shapeMap);
+                }
+            }
+            return !shapeMaps.empty();
         }
 
-        int oldstate = mgraph.getState();
-        mgraph.setState(oldstate & ~state);
+        // data is the whole of the stream where it is held in memory, for the parsers that
+        // can make use of it
+        bool importFromStream(MetaGraph &mgraph, std::istream &stream, const char *data, size_t size,
+                              Communicator *communicator, std::string name, ImportType mapType,
+                              ImportFileType fileType, int threads) {
 
-        // Currently the drawing shapemaps are understood as two-level trees (file -> layers)
-        // while the data shapemaps are flat. Therefore, for the moment, when we load dxfs as
-        // drawing shapemaps then we let the filename be the parent and the layers the children.
-        // For text files (csv, tsv) we create an artificial parent with the relevant name
-        // Drawing shapemaps also carry region data that needs to be initialised and their parents
-        // updated when they are created.
-        // Ideally datamaps and drawingmaps should be more similar.
-
-        if (mapType == DRAWINGMAP) {
-            mgraph.m_drawingFiles.emplace_back(name);
-        }
+            // This function is still too fiddly but at least it shows the common interface for
+            // drawing and data maps and how different file types may be parsed to be imported
+            // into them
 
-        bool parsed = false;
+            int state = MetaGraph::NONE;
+            int viewClass = MetaGraph::NONE;
 
-        switch (fileType) {
-        case CSV: {
-            ShapeMap &shapeMap = mgraph.createNewShapeMap(mapType, name);
-            int newMapIdx = mgraph.getMapRef(mgraph.getDataMaps(), shapeMap.getName());
-            parsed = importTxt(shapeMap, stream, ',');
-
-            if (!parsed) {
-                mgraph.deleteShapeMap(mapType, shapeMap);
+            switch (mapType) {
+            case DRAWINGMAP: {
+                state = MetaGraph::LINEDATA;
+                viewClass = MetaGraph::SHOWSHAPETOP;
                 break;
             }
-            if (mapType == DRAWINGMAP) {
-                mgraph.updateParentRegions(shapeMap);
-            } else if (mapType == DATAMAP) {
-                mgraph.setDisplayedDataMapRef(newMapIdx);
-            }
-            break;
-        }
-        case TSV: {
-            ShapeMap &shapeMap = mgraph.createNewShapeMap(mapType, name);
-            int newMapIdx = mgraph.getMapRef(mgraph.getDataMaps(), shapeMap.getName());
-            parsed = importTxt(shapeMap, stream, '\t');
-
-            if (!parsed) {
-                mgraph.deleteShapeMap(mapType, shapeMap);
+            case DATAMAP: {
+                state = MetaGraph::DATAMAPS;
+                viewClass = MetaGraph::SHOWSHAPETOP;
                 break;
             }
-            if (mapType == DRAWINGMAP) {
-                mgraph.updateParentRegions(shapeMap);
-            } else if (mapType == DATAMAP) {
-                mgraph.setDisplayedDataMapRef(newMapIdx);
             }
-            break;
-        }
-        case DXF: {
-
-            DxfParser dp;
 
-            if (communicator) {
-                dp = DxfParser(communicator);
+            int oldstate = mgraph.getState();
+            mgraph.setState(oldstate & ~state);
 
-                try {
-                    stream >> dp;
-                } catch (Communicator::CancelledException) {
-                    return 0;
-                } catch (std::logic_error &) {
-                    return -1;
-                }
+            // Currently the drawing shapemaps are understood as two-level trees (file -> layers)
+            // while the data shapemaps are flat. Therefore, for the moment, when we load dxfs as
+            // drawing shapemaps then we let the filename be the parent and the layers the children.
+            // For text files (csv, tsv) we create an artificial parent with the relevant name
+            // Drawing shapemaps also carry region data that needs to be initialised and their parents
+            // updated when they are created.
+            // Ideally datamaps and drawingmaps should be more similar.
 
-                if (communicator->IsCancelled()) {
-                    return 0;
-                }
-            } else {
-                dp.open(stream);
+            if (mapType == DRAWINGMAP) {
+                mgraph.m_drawingFiles.emplace_back(name);
             }
 
-            for (auto &layer : dp.getLayers()) {
+            bool parsed = false;
 
-                const DxfLayer &dxfLayer = layer.second;
+            switch (fileType) {
+            case CSV: {
+                ShapeMap &shapeMap = mgraph.createNewShapeMap(mapType, name);
+                int newMapIdx = mgraph.getMapRef(mgraph.getDataMaps(), shapeMap.getName());
+                parsed = importTxt(shapeMap, stream, ',');
 
-                if (dxfLayer.empty()) {
-                    continue;
+                if (!parsed) {
+                    mgraph.deleteShapeMap(mapType, shapeMap);
+                    break;
                 }
-
-                ShapeMap &shapeMap = mgraph.createNewShapeMap(mapType, layer.first);
-                parsed = importDxfLayer(dxfLayer, shapeMap);
+                if (mapType == DRAWINGMAP) {
+                    mgraph.updateParentRegions(shapeMap);
+                } else if (mapType == DATAMAP) {
+                    mgraph.setDisplayedDataMapRef(newMapIdx);
+                }
+                break;
+            }
+            case TSV: {
+                ShapeMap &shapeMap = mgraph.createNewShapeMap(mapType, name);
+                int newMapIdx = mgraph.getMapRef(mgraph.getDataMaps(), shapeMap.getName());
+                parsed = importTxt(shapeMap, stream, '\t');
 
                 if (!parsed) {
                     mgraph.deleteShapeMap(mapType, shapeMap);
@@ -135,125 +135,355 @@ namespace depthmapX {
                 }
                 if (mapType == DRAWINGMAP) {
                     mgraph.updateParentRegions(shapeMap);
+                } else if (mapType == DATAMAP) {
+                    mgraph.setDisplayedDataMapRef(newMapIdx);
                 }
+                break;
+            }
+            case DXF: {
+
+                DxfParser dp(communicator);
+                auto parse = [&]() {
+                    if (data != nullptr) {
+                        dp.open(data, size, threads);
+                    } else {
+                        stream >> dp;
+                    }
+                };
+
+                if (communicator) {
+                    try {
+                        parse();
+                    } catch (Communicator::CancelledException) {
+                        return 0;
+                    } catch (std::logic_error &) {
+                        return -1;
+                    }
+
+                    if (communicator->IsCancelled()) {
+                        return 0;
+                    }
+                } else {
+                    parse();
+                }
+
+                parsed = importDxfLayers(mgraph, dp, mapType, threads);
+                break;
+            }
+            }
+
+            if (parsed) {
+                mgraph.setState(mgraph.getState() | state);
+                mgraph.setViewClass(viewClass);
+                return true;
+            } else {
+                mgraph.setState(oldstate);
+                return false;
             }
-            break;
-        }
         }
+    } // namespace
 
-        if (parsed) {
-            mgraph.setState(mgraph.getState() | state);
-            mgraph.setViewClass(viewClass);
-            return true;
-        } else {
-            mgraph.setState(oldstate);
-            return false;
+    bool importFile(MetaGraph &mgraph, std::istream &stream, Communicator *communicator, std::string name,
+                    ImportType mapType, ImportFileType fileType) {
+        return importFromStream(mgraph, stream, nullptr, 0, communicator, name, mapType, fileType, 1);
+    }
+
+    bool importFile(MetaGraph &mgraph, const std::string &filename, Communicator *communicator, std::string name,
+                    ImportType mapType, ImportFileType fileType, int threads) {
+        MemoryMappedFile file(filename);
+        if (!file.isOpen()) {
+            // empty files cannot be mapped, read them (and anything else that cannot) as before
+            std::ifstream stream(filename);
+            return importFromStream(mgraph, stream, nullptr, 0, communicator, name, mapType, fileType, threads);
         }
+        MemoryStreamBuf buffer(file.data(), file.size());
+        std::istream stream(&buffer);
+        return importFromStream(mgraph, stream, file.data(), file.size(), communicator, name, mapType, fileType,
+                                threads);
     }
 
+    // Text files are read a block at a time and parsed straight into numbers, so that the
+    // memory used is that of the shapes and their attributes rather than of the text
+
+    namespace {
+        const size_t TEXT_BLOCK_SIZE = 1 << 20;
+
+        // Hands out the lines of a stream without their line ends. Lines are views into a
+        // buffer that is refilled a block at a time, they only stay valid until the next call
+        class LineReader {
+          public:
+            explicit LineReader(std::istream &stream) : m_stream(stream), m_buffer(TEXT_BLOCK_SIZE) {}
+
+            bool nextLine(std::string_view &line) {
+                while (true) {
+                    const char *begin = m_buffer.data() + m_begin;
+                    const char *end = m_buffer.data() + m_end;
+                    const char *lineEnd = std::find(begin, end, '\n');
+                    if (lineEnd != end || (m_eof && begin != end)) {
+                        m_begin = size_t(lineEnd - m_buffer.data()) + (lineEnd != end ? 1 : 0);
+                        line = std::string_view(begin, size_t(lineEnd - begin));
+                        if (!line.empty() && line.back() == '\r') {
+                            line.remove_suffix(1);
+                        }
+                        return true;
+                    }
+                    if (m_eof) {
+                        return false;
+                    }
+                    // keep the start of the unfinished line and read the next block after it
+                    std::copy(begin, end, m_buffer.data());
+                    m_end -= m_begin;
+                    m_begin = 0;
+                    if (m_end == m_buffer.size()) {
+                        m_buffer.resize(m_buffer.size() * 2);
+                    }
+                    m_stream.read(m_buffer.data() + m_end, std::streamsize(m_buffer.size() - m_end));
+                    m_end += size_t(m_stream.gcount());
+                    m_eof = m_stream.gcount() == 0;
+                }
+            }
+
+          private:
+            std::istream &m_stream;
+            std::vector<char> m_buffer;
+            size_t m_begin = 0;
+            size_t m_end = 0;
+            bool m_eof = false;
+        };
+
+        // splits as dXstring::split does, a delimiter at the end of the line does not start another cell
+        void splitCells(std::string_view line, char delimiter, std::vector<std::string_view> &cells) {
+            cells.clear();
+            size_t start = 0;
+            while (start < line.size()) {
+                size_t end = line.find(delimiter, start);
+                if (end == std::string_view::npos) {
+                    end = line.size();
+                }
+                cells.push_back(line.substr(start, end - start));
+                start = end + 1;
+            }
+        }
+
+        // Parses the number at the start of the cell, as strtod does. std::from_chars does not
+        // allocate or look at the locale, but does not take leading spaces, a plus sign or hex,
+        // so those are left to strtod
+        bool parseDouble(std::string_view cell, double &value) {
+#ifdef __cpp_lib_to_chars
+            auto result = std::from_chars(cell.data(), cell.data() + cell.size(), value);
+            if (result.ec == std::errc() &&
+                (result.ptr == cell.data() + cell.size() || (*result.ptr != 'x' && *result.ptr != 'X'))) {
+                return true;
+            }
+#endif
+            std::string text(cell);
+            char *endPtr = nullptr;
+            value = strtod(text.c_str(), &endPtr);
+            return endPtr != text.c_str();
+        }
+
+        double cellToDouble(std::string_view cell) {
+            double value;
+            if (!parseDouble(cell, value)) {
+                // throws just as it did when the cells were read as strings
+                return std::stod(std::string(cell));
+            }
+            return value;
+        }
+
+        int cellToInt(std::string_view cell) {
+            int value;
+            auto result = std::from_chars(cell.data(), cell.data() + cell.size(), value);
+            if (result.ec != std::errc()) {
+                return std::stoi(std::string(cell));
+            }
+            return value;
+        }
+
+        // An attribute column read as numbers. Cells that are not numbers are given a code
+        // for their text, as ShapeMap::importData does, up to 32 codes, after which all the
+        // rows up to the last new text are set to -1
+        struct TextColumn {
+            size_t position;
+            std::string name;
+            std::vector<float> values;
+            std::unordered_map<std::string, size_t> codes;
+            size_t codesOverflowAt = 0; // one past the last row with a text past the 32 codes
+
+            void addCell(std::string_view cell) {
+                double value;
+                if (!parseDouble(cell, value)) {
+                    auto code = codes.find(std::string(cell));
+                    if (code != codes.end()) {
+                        value = double(code->second);
+                    } else if (codes.size() >= 32) {
+                        codesOverflowAt = values.size() + 1;
+                        value = -1.0;
+                    } else {
+                        value = double(codes.size());
+                        codes.insert(std::make_pair(std::string(cell), codes.size()));
+                    }
+                }
+                values.push_back(float(value));
+            }
+
+            void finish() { std::fill(values.begin(), values.begin() + codesOverflowAt, -1.0f); }
+        };
+    } // namespace
+
     bool importTxt(ShapeMap &shapeMap, std::istream &stream, char delimiter = '\t') {
-        Table table = csvToTable(stream, delimiter);
-        std::vector<std::string> columns;
+        LineReader reader(stream);
+        std::string_view line;
+        std::vector<std::string_view> cells;
+
+        // check for a matching delimited header line...
+        if (!reader.nextLine(line)) {
+            return true;
+        }
+        splitCells(line, delimiter, cells);
+        if (cells.size() < 2) {
+            return true;
+        }
+        size_t columnCount = cells.size();
+
+        // the columns by name, in the order they were imported into the table, where only
+        // the first of two columns with the same name is used
+        std::map<std::string, size_t> columns;
+        for (size_t i = 0; i < cells.size(); i++) {
+            std::string columnName(cells[i]);
+            if (!columnName.empty()) {
+                dXstring::ltrim(columnName, '\"');
+                dXstring::rtrim(columnName, '\"');
+            }
+            columns.insert(std::make_pair(columnName, i));
+        }
+
         int xcol = -1, ycol = -1, x1col = -1, y1col = -1, x2col = -1, y2col = -1, refcol = -1;
-        for (auto const &column : table) {
+        for (auto const &column : columns) {
             if (column.first == "x" || column.first == "easting")
-                xcol = columns.size();
+                xcol = int(column.second);
             else if (column.first == "y" || column.first == "northing")
-                ycol = columns.size();
+                ycol = int(column.second);
             else if (column.first == "x1")
-                x1col = columns.size();
+                x1col = int(column.second);
             else if (column.first == "x2")
-                x2col = columns.size();
+                x2col = int(column.second);
             else if (column.first == "y1")
-                y1col = columns.size();
+                y1col = int(column.second);
             else if (column.first == "y2")
-                y2col = columns.size();
+                y2col = int(column.second);
             else if (column.first == "Ref")
-                refcol = columns.size();
-            columns.push_back(column.first);
+                refcol = int(column.second);
         }
 
-        if (xcol != -1 && ycol != -1 && refcol != -1) {
-            std::map<int, Point2f> points =
-                extractPointsWithRefs(table[columns[xcol]], table[columns[ycol]], table[columns[refcol]]);
-            table.erase(table.find(columns[xcol]));
-            table.erase(table.find(columns[ycol]));
-            table.erase(table.find(columns[refcol]));
-
-            QtRegion region;
+        std::vector<int> geometryColumns;
+        bool points = false;
+        if (xcol != -1 && ycol != -1) {
+            points = true;
+            geometryColumns = {xcol, ycol};
+        } else if (x1col != -1 && y1col != -1 && x2col != -1 && y2col != -1) {
+            geometryColumns = {x1col, y1col, x2col, y2col};
+        } else {
+            return true;
+        }
+        if (refcol != -1) {
+            geometryColumns.push_back(refcol);
+        }
 
-            for (auto &point : points) {
-                if (region.atZero()) {
-                    region = point.second;
-                } else {
-                    region = runion(region, point.second);
-                }
+        std::vector<TextColumn> attributeColumns;
+        for (auto const &column : columns) {
+            if (std::find(geometryColumns.begin(), geometryColumns.end(), int(column.second)) ==
+                geometryColumns.end()) {
+                attributeColumns.push_back(TextColumn{column.second, column.first, {}, {}, 0});
             }
+        }
 
-            shapeMap.init(points.size(), region);
-            shapeMap.importPointsWithRefs(points, table);
-
-        } else if (xcol != -1 && ycol != -1) {
-            std::vector<Point2f> points = extractPoints(table[columns[xcol]], table[columns[ycol]]);
-            table.erase(table.find(columns[xcol]));
-            table.erase(table.find(columns[ycol]));
-
-            QtRegion region;
-
-            for (auto &point : points) {
-                if (region.atZero()) {
-                    region = point;
-                } else {
-                    region = runion(region, point);
-                }
+        std::vector<Point2f> pointList;
+        std::vector<Line> lineList;
+        std::vector<int> refs;
+        while (reader.nextLine(line)) {
+            if (line.empty()) {
+                continue;
             }
+            splitCells(line, delimiter, cells);
+            if (cells.size() != columnCount) {
+                std::stringstream message;
+                message << "Cells in line " << line << "not the same number as the columns" << std::flush;
+                throw RuntimeException(message.str().c_str());
+            }
+            if (points) {
+                pointList.push_back(Point2f(cellToDouble(cells[size_t(xcol)]), cellToDouble(cells[size_t(ycol)])));
+            } else {
+                lineList.push_back(
+                    Line(Point2f(cellToDouble(cells[size_t(x1col)]), cellToDouble(cells[size_t(y1col)])),
+                         Point2f(cellToDouble(cells[size_t(x2col)]), cellToDouble(cells[size_t(y2col)]))));
+            }
+            if (refcol != -1) {
+                refs.push_back(cellToInt(cells[size_t(refcol)]));
+            }
+            for (auto &column : attributeColumns) {
+                column.addCell(cells[column.position]);
+            }
+        }
+        for (auto &column : attributeColumns) {
+            column.finish();
+        }
 
-            shapeMap.init(points.size(), region);
-            shapeMap.importPoints(points, table);
-
-        } else if (x1col != -1 && y1col != -1 && x2col != -1 && y2col != -1 && refcol != -1) {
-            std::map<int, Line> lines =
-                extractLinesWithRef(table[columns[x1col]], table[columns[y1col]], table[columns[x2col]],
-                                    table[columns[y2col]], table[columns[refcol]]);
-            table.erase(table.find(columns[x1col]));
-            table.erase(table.find(columns[y1col]));
-            table.erase(table.find(columns[x2col]));
-            table.erase(table.find(columns[y2col]));
-            table.erase(table.find(columns[refcol]));
-
-            QtRegion region;
+        // the rows in the order the shapes are made: by key where there is one (the first of
+        // two rows with the same key is used), otherwise as they are in the file
+        size_t rowCount = points ? pointList.size() : lineList.size();
+        std::vector<size_t> rows(rowCount);
+        std::iota(rows.begin(), rows.end(), 0);
+        if (refcol != -1) {
+            std::stable_sort(rows.begin(), rows.end(), [&](size_t a, size_t b) { return refs[a] < refs[b]; });
+            rows.erase(std::unique(rows.begin(), rows.end(), [&](size_t a, size_t b) { return refs[a] == refs[b]; }),
+                       rows.end());
+        }
 
-            for (auto &line : lines) {
-                if (region.atZero()) {
-                    region = line.second;
-                } else {
-                    region = runion(region, line.second);
-                }
+        QtRegion region;
+        for (size_t row : rows) {
+            QtRegion shapeRegion =
+                points ? QtRegion(pointList[row], pointList[row]) : QtRegion(lineList[row]);
+            if (region.atZero()) {
+                region = shapeRegion;
+            } else {
+                region = runion(region, shapeRegion);
             }
+        }
 
-            shapeMap.init(lines.size(), region);
-            shapeMap.importLinesWithRefs(lines, table);
-        } else if (x1col != -1 && y1col != -1 && x2col != -1 && y2col != -1) {
-            std::vector<Line> lines = extractLines(table[columns[x1col]], table[columns[y1col]], table[columns[x2col]],
-                                                   table[columns[y2col]]);
-            table.erase(table.find(columns[x1col]));
-            table.erase(table.find(columns[y1col]));
-            table.erase(table.find(columns[x2col]));
-            table.erase(table.find(columns[y2col]));
-
-            QtRegion region;
-
-            for (auto &line : lines) {
-                if (region.atZero()) {
-                    region = line;
-                } else {
-                    region = runion(region, line);
-                }
+        shapeMap.init(int(rows.size()), region);
+        std::vector<int> shapeRefs;
+        shapeRefs.reserve(rows.size());
+        for (size_t row : rows) {
+            if (points) {
+                shapeRefs.push_back(refcol != -1 ? shapeMap.makePointShapeWithRef(pointList[row], refs[row])
+                                                 : shapeMap.makePointShape(pointList[row]));
+            } else {
+                shapeRefs.push_back(refcol != -1 ? shapeMap.makeLineShapeWithRef(lineList[row], refs[row])
+                                                 : shapeMap.makeLineShape(lineList[row]));
             }
+        }
 
-            shapeMap.init(lines.size(), region);
-            shapeMap.importLines(lines, table);
+        AttributeTable &attributes = shapeMap.getAttributeTable();
+        for (auto &column : attributeColumns) {
+            std::string colName = column.name;
+            std::replace(colName.begin(), colName.end(), '_', ' ');
+            dXstring::makeInitCaps(colName);
+            if (colName.empty()) {
+                continue;
+            }
+            int colIndex = int(attributes.insertOrResetColumn(colName));
+            if (colIndex == -1) {
+                // error adding column (e.g., duplicate column names)
+                continue;
+            }
+            for (size_t i = 0; i < rows.size(); i++) {
+                attributes.getRow(AttributeKey(shapeRefs[i])).setValue(size_t(colIndex), column.values[rows[i]]);
+            }
         }
+
+        shapeMap.invalidateDisplayedAttribute();
+        shapeMap.setDisplayedAttribute(-1);
         return true;
     }
 
@@ -24,6 +24,10 @@
 namespace depthmapX {
     bool importFile(MetaGraph &mgraph, std::istream &stream, Communicator *communicator, std::string name,
                     ImportType mapType, ImportFileType fileType);
+    // reads the file from memory where it can be mapped, DXF files are then parsed and
+    // their layers imported on the number of threads given (0 for all cores)
+    bool importFile(MetaGraph &mgraph, const std::string &filename, Communicator *communicator, std::string name,
+                    ImportType mapType, ImportFileType fileType, int threads = 1);
     bool importTxt(ShapeMap &shapeMap, std::istream &stream, char delimiter);
     depthmapX::Table csvToTable(std::istream &stream, char delimiter);
     std::vector<Line> extractLines(ColumnData &x1col, ColumnData &y1col, ColumnData &x2col, ColumnData &y2col);
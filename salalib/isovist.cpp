@@ -17,6 +17,7 @@
 
 #include "salalib/isovist.h"
 
+#include <algorithm>
 #include <math.h>
 #include <float.h>
 #include <time.h>
@@ -30,15 +31,32 @@
 
 void Isovist::makeit(BSPNode *root, const Point2f& p, const QtRegion& region, double startangle, double endangle)
 {
-   // region is used to give an idea of scale, so isovists can be linked when there is floating point error
-   double tolerance = std::max(region.width(),region.height()) * 1e-9;
+   bool complete, parity;
+   start(p, startangle, endangle, complete, parity);
+   make(root);
+   sortBlocks();
+   makePolygon(region, startangle, complete, parity);
+}
+
+// the same isovist made from a flattened tree, which may be shared between threads
+
+void Isovist::makeit(const FlatBSPTree& tree, const Point2f& p, const QtRegion& region, double startangle, double endangle)
+{
+   bool complete, parity;
+   start(p, startangle, endangle, complete, parity);
+   make(tree);
+   sortBlocks();
+   makePolygon(region, startangle, complete, parity);
+}
 
+void Isovist::start(const Point2f& p, double& startangle, double& endangle, bool& complete, bool& parity)
+{
    m_centre = p;
    m_blocks.clear();
    m_gaps.clear();
 
    // still doesn't work when need centre point, but this will work for 180 degree isovists
-   bool complete = false;
+   complete = false;
 
    if (startangle == endangle || (startangle == 0.0 && endangle == 2.0 * M_PI)) {
       startangle = 0.0;
@@ -46,18 +64,22 @@ void Isovist::makeit(BSPNode *root, const Point2f& p, const QtRegion& region, do
       complete = true;
    }
 
-   bool parity = false;
+   parity = false;
 
    if (startangle > endangle) {
-      m_gaps.insert(IsoSeg(0.0,endangle));
-      m_gaps.insert(IsoSeg(startangle,2.0*M_PI));
+      m_gaps.push_back(IsoSeg(0.0,endangle));
+      m_gaps.push_back(IsoSeg(startangle,2.0*M_PI));
    }
    else {
       parity = true;
-      m_gaps.insert(IsoSeg(startangle,endangle));
+      m_gaps.push_back(IsoSeg(startangle,endangle));
    }
+}
 
-   make(root);
+void Isovist::makePolygon(const QtRegion& region, double startangle, bool complete, bool parity)
+{
+   // region is used to give an idea of scale, so isovists can be linked when there is floating point error
+   double tolerance = std::max(region.width(),region.height()) * 1e-9;
 
    // now it is constructed, make the isovist polygon:
    m_poly.clear();
@@ -71,7 +93,7 @@ void Isovist::makeit(BSPNode *root, const Point2f& p, const QtRegion& region, do
    for (;curr != m_blocks.end(); ++curr){
       if (!complete && !markedcentre && !parity && curr->startangle == startangle) {
          // centre
-         m_poly.push_back(p);
+         m_poly.push_back(m_centre);
          // perimeter! occlusivity!
          markedcentre = true;
       }
@@ -97,7 +119,7 @@ void Isovist::makeit(BSPNode *root, const Point2f& p, const QtRegion& region, do
    // for some reason to do with ordering, if parity is true, the centre point must be last not first
    if (!complete && parity) {
       // centre
-      m_poly.push_back(p);
+      m_poly.push_back(m_centre);
       // perimeter! occlusivity!
    }
    if (m_blocks.size() && !approxeq(m_blocks.rbegin()->endpoint, m_blocks.begin()->startpoint, tolerance)) {
@@ -125,9 +147,10 @@ int Isovist::getClosestLine(BSPNode *root, const Point2f& p)
    m_blocks.clear();
    m_gaps.clear();
 
-   m_gaps.insert(IsoSeg(0.0,2.0*M_PI));
+   m_gaps.push_back(IsoSeg(0.0,2.0*M_PI));
 
    make(root);
+   sortBlocks();
 
    int mintag = -1;
    double mindist = 0.0;
@@ -164,6 +187,42 @@ void Isovist::make(BSPNode *here)
    }
 }
 
+// as make above, visiting the near side, the node and then the far side, but with an explicit
+// stack so that deep trees do not run out of the (smaller) stack of a worker thread.
+// Subtrees that lie entirely outside the remaining gaps are skipped, which only
+// leaves out nodes that would not have added any blocks
+
+void Isovist::make(const FlatBSPTree& tree)
+{
+   if (tree.empty()) {
+      return;
+   }
+   // node index, and whether the node's children have been pushed already
+   std::vector<std::pair<int,bool>> stack;
+   stack.push_back(std::make_pair(0,false));
+   while (!stack.empty() && m_gaps.size()) {
+      std::pair<int,bool> entry = stack.back();
+      stack.pop_back();
+      const FlatBSPTree::Node& here = tree.nodes[size_t(entry.first)];
+      if (entry.second) {
+         drawnode(here.line,here.tag);
+         continue;
+      }
+      if (missesGaps(here.bounds)) {
+         continue;
+      }
+      int near = here.left, far = here.right;
+      if (here.classify(m_centre) != BSPNode::BSPLEFT) {
+         std::swap(near,far);
+      }
+      if (far != -1)
+         stack.push_back(std::make_pair(far,false));
+      stack.push_back(std::make_pair(entry.first,true));
+      if (near != -1)
+         stack.push_back(std::make_pair(near,false));
+   }
+}
+
 void Isovist::drawnode(const Line& li, int tag)
 {
    Point2f p1 = li.start() - m_centre;
@@ -195,79 +254,148 @@ void Isovist::drawnode(const Line& li, int tag)
       }
    }
    //
-   for (auto it = m_gaps.begin(); it != m_gaps.end(); ) {
-       if (it->tagdelete) {
-           it = m_gaps.erase(it);
-       }
-       else {
-           ++it;
-       }
-   }
+   m_gaps.erase(std::remove_if(m_gaps.begin(), m_gaps.end(), [](const IsoSeg& gap) { return gap.tagdelete; }),
+                m_gaps.end());
 }
 
+// the gaps are kept sorted and do not overlap, so a gap that is split or shortened
+// stays where it is in the array and the remainder of a split gap goes straight after it
+
+
 void Isovist::addBlock(const Line& li, int tag, double startangle, double endangle)
 {
-   auto gap = m_gaps.begin();
+   size_t gap = 0;
    bool finished = false;
 
    while (!finished) {
-      while (gap != m_gaps.end() && gap->endangle < startangle) {
+      while (gap < m_gaps.size() && m_gaps[gap].endangle < startangle) {
          gap++;
       }
-      if (gap != m_gaps.end() && gap->startangle < endangle + 1e-9) {
+      if (gap < m_gaps.size() && m_gaps[gap].startangle < endangle + 1e-9) {
          double a,b;
-         if (gap->startangle > startangle - 1e-9) {
-            a = gap->startangle;
-            if (gap->endangle < endangle + 1e-9) {
-               b = gap->endangle;
-               gap->tagdelete = true;
+         IsoSeg& here = m_gaps[gap];
+         if (here.startangle > startangle - 1e-9) {
+            a = here.startangle;
+            if (here.endangle < endangle + 1e-9) {
+               b = here.endangle;
+               here.tagdelete = true;
             }
             else {
                b = endangle;
-               IsoSeg isoseg = *gap;
-               isoseg.startangle = endangle;
-               auto hint = gap;
-               hint++;
-               m_gaps.erase(gap);
-               gap = m_gaps.insert(hint, isoseg);
+               here.startangle = endangle;
             }
          }
          else {
             a = startangle;
-            if (gap->endangle < endangle + 1e-9) {
-               b = gap->endangle;
-               IsoSeg isoseg = *gap;
-               isoseg.endangle = startangle;
-               auto hint = gap;
-               hint++;
-               m_gaps.erase(gap);
-               gap = m_gaps.insert(hint, isoseg);
+            if (here.endangle < endangle + 1e-9) {
+               b = here.endangle;
+               here.endangle = startangle;
             }
             else {
                b = endangle;
-               m_gaps.insert(IsoSeg(endangle, gap->endangle, gap->quadrant));
-               IsoSeg isoseg = *gap;
-               isoseg.endangle = startangle;
-               auto hint = gap;
-               hint++;
-               m_gaps.erase(gap);
-               gap = m_gaps.insert(hint, isoseg);
+               IsoSeg remainder(endangle, here.endangle, here.quadrant);
+               here.endangle = startangle;
+               m_gaps.insert(m_gaps.begin() + static_cast<std::ptrdiff_t>(gap) + 1, remainder);
                gap++; // advance past gap just added
             }
          }
          Point2f pa = intersection_point(li,Line(m_centre,m_centre+pointfromangle(a)));
          Point2f pb = intersection_point(li,Line(m_centre,m_centre+pointfromangle(b)));
-         m_blocks.insert(IsoSeg(a,b,pa,pb,tag));
+         m_blocks.push_back(IsoSeg(a,b,pa,pb,tag));
       }
       else {
          finished = true;
       }
-      if(gap == m_gaps.end()) break;
+      if(gap == m_gaps.size()) break;
       gap++;
    }
 }
 
+// puts the blocks in angle order, dropping repeats of the same angles
+// (keeping the first one found, as a set would have done)
+
+void Isovist::sortBlocks()
+{
+   std::stable_sort(m_blocks.begin(), m_blocks.end());
+   m_blocks.erase(std::unique(m_blocks.begin(), m_blocks.end()), m_blocks.end());
+}
+
+// true if nothing inside bounds can be seen through the remaining gaps. The angles of the box
+// are taken either side of the direction to its centre, and only boxes seen across well under
+// 180 degrees are tested, so that lines passing close to the centre are always drawn
+
+bool Isovist::missesGaps(const QtRegion& bounds) const
+{
+   if (bounds.contains_touch(m_centre)) {
+      return false;
+   }
+   Point2f mid = bounds.getCentre() - m_centre;
+   double lo = 0.0, hi = 0.0;
+   const Point2f corners[] = {bounds.bottom_left, bounds.top_right,
+                              Point2f(bounds.bottom_left.x, bounds.top_right.y),
+                              Point2f(bounds.top_right.x, bounds.bottom_left.y)};
+   for (const Point2f& corner : corners) {
+      Point2f v = corner - m_centre;
+      double diff = atan2(det(mid, v), dot(mid, v));
+      lo = std::min(lo, diff);
+      hi = std::max(hi, diff);
+   }
+   if (hi - lo > M_PI - 1e-3) {
+      return false;
+   }
+   // the margin is far wider than the rounding of the angles in drawnode (which come from acos)
+   const double margin = 1e-5;
+   double midangle = atan2(mid.y, mid.x);
+   if (midangle < 0.0) {
+      midangle += 2.0 * M_PI;
+   }
+   double from = midangle + lo - margin;
+   double to = midangle + hi + margin;
+   // the extent may wrap around 0 / 2 pi, in which case it is tested in two parts
+   double ranges[2][2] = {{from, to}, {1.0, -1.0}};
+   if (from < 0.0) {
+      ranges[0][0] = from + 2.0 * M_PI;
+      ranges[0][1] = 2.0 * M_PI;
+      ranges[1][0] = 0.0;
+      ranges[1][1] = to;
+   }
+   else if (to > 2.0 * M_PI) {
+      ranges[0][1] = 2.0 * M_PI;
+      ranges[1][0] = 0.0;
+      ranges[1][1] = to - 2.0 * M_PI;
+   }
+   for (const IsoSeg& gap : m_gaps) {
+      for (auto& range : ranges) {
+         if (gap.endangle >= range[0] && gap.startangle <= range[1]) {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
 void Isovist::setData(AttributeTable& table, AttributeRow& row, bool simple_version)
+{
+   std::vector<std::string> names = getColumnNames(simple_version);
+   std::vector<float> values = getColumnValues(simple_version);
+   for (size_t i = 0; i < names.size(); i++) {
+      int col = table.getOrInsertColumn(names[i]);
+      row.setValue(col, values[i]);
+   }
+}
+
+std::vector<std::string> Isovist::getColumnNames(bool simple_version)
+{
+   std::vector<std::string> names = {"Isovist Area"};
+   if (!simple_version) {
+      names.insert(names.end(), {"Isovist Compactness", "Isovist Drift Angle", "Isovist Drift Magnitude",
+                                 "Isovist Min Radial", "Isovist Max Radial", "Isovist Occlusivity",
+                                 "Isovist Perimeter"});
+   }
+   return names;
+}
+
+std::vector<float> Isovist::getColumnValues(bool simple_version)
 {
    // the area / centre of gravity calculation is a duplicate of the SalaPolygon version,
    // included here for general information about the isovist
@@ -305,31 +433,15 @@ void Isovist::setData(AttributeTable& table, AttributeRow& row, bool simple_vers
    driftvec.normalise();
    double driftang = driftvec.angle();
    //
-   int col = table.getOrInsertColumn("Isovist Area");
-   row.setValue(col, float(area));
-
-
+   std::vector<float> values = {float(area)};
    if(!simple_version) {
-       col = table.getOrInsertColumn("Isovist Compactness");
-       row.setValue(col, float(4.0 * M_PI * area / (m_perimeter*m_perimeter)));
-
-       col = table.getOrInsertColumn("Isovist Drift Angle");
-       row.setValue(col, float(180.0*driftang/M_PI));
-
-       col = table.getOrInsertColumn("Isovist Drift Magnitude");
-       row.setValue(col, float(driftmag));
-
-       col = table.getOrInsertColumn("Isovist Min Radial");
-       row.setValue(col, float(m_min_radial));
-
-       col = table.getOrInsertColumn("Isovist Max Radial");
-       row.setValue(col, float(m_max_radial));
-
-       col = table.getOrInsertColumn("Isovist Occlusivity");
-       row.setValue(col, float(m_occluded_perimeter));
-
-       col = table.getOrInsertColumn("Isovist Perimeter");
-       row.setValue(col, float(m_perimeter));
+       values.insert(values.end(), {float(4.0 * M_PI * area / (m_perimeter*m_perimeter)),
+                                    float(180.0*driftang/M_PI),
+                                    float(driftmag),
+                                    float(m_min_radial),
+                                    float(m_max_radial),
+                                    float(m_occluded_perimeter),
+                                    float(m_perimeter)});
    }
-
+   return values;
 }
@@ -23,7 +23,7 @@
 #include "salalib/attributetable.h"
 
 #include "genlib/bsptree.h"
-#include <set>
+#include <vector>
 
 // this is very much like sparksieve:
 
@@ -64,14 +64,21 @@ class Isovist
 {
 protected:
    Point2f m_centre;
-   std::set<IsoSeg> m_blocks;
-   std::set<IsoSeg> m_gaps;
+   // both kept as flat arrays rather than sets, as an isovist rarely has more than a few
+   // dozen gaps and the arrays can be reused from one isovist to the next.
+   // m_gaps is always sorted, m_blocks only once sortBlocks has been called
+   std::vector<IsoSeg> m_blocks;
+   std::vector<IsoSeg> m_gaps;
    std::vector<Point2f> m_poly;
    std::vector<PointDist> m_occlusion_points;
    double m_perimeter;
    double m_occluded_perimeter;
    double m_max_radial;
    double m_min_radial;
+   void start(const Point2f& p, double& startangle, double& endangle, bool& complete, bool& parity);
+   void makePolygon(const QtRegion& region, double startangle, bool complete, bool parity);
+   void sortBlocks();
+   bool missesGaps(const QtRegion& bounds) const;
 public:
    Isovist() {;}
    const std::vector<Point2f>& getPolygon() const { return m_poly; }
@@ -79,10 +86,15 @@ public:
    const Point2f& getCentre() const { return m_centre; }
    //
    void makeit(BSPNode *root, const Point2f& p, const QtRegion& region, double startangle = 0.0, double endangle = 0.0);
+   void makeit(const FlatBSPTree& tree, const Point2f& p, const QtRegion& region, double startangle = 0.0, double endangle = 0.0);
    void make(BSPNode *here);
+   void make(const FlatBSPTree& tree);
    void drawnode(const Line& li, int tag);
    void addBlock(const Line& li, int tag, double startangle, double endangle);
    void setData(AttributeTable &table, AttributeRow &row, bool simple_version);
+   // the columns written by setData (in the order they are inserted) and their values for this isovist
+   static std::vector<std::string> getColumnNames(bool simple_version);
+   std::vector<float> getColumnValues(bool simple_version);
    //
    int getClosestLine(BSPNode *root, const Point2f& p);
 };
@@ -8,7 +8,8 @@
 // convert line layers to an axial map
 
 std::unique_ptr<ShapeGraph> MapConverter::convertDrawingToAxial(Communicator *comm, const std::string& name,
-                                                                const std::vector<SpacePixelFile> &drawingFiles)
+                                                                const std::vector<SpacePixelFile> &drawingFiles,
+                                                                int threads)
 {
     if (comm) {
         comm->CommPostMessage( Communicator::NUM_STEPS, 2 );
@@ -81,7 +82,7 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDrawingToAxial(Communicator *co
         usermap->makeLineShape(line.second.first, false, false, layerAttributes );
     }
 
-    usermap->makeConnections();
+    usermap->makeConnections(KeyVertices(), threads);
 
     return usermap;
 }
@@ -90,7 +91,7 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDrawingToAxial(Communicator *co
 // note that actually should be able to merge this code with the line layers, now both use similar code
 
 std::unique_ptr<ShapeGraph> MapConverter::convertDataToAxial(Communicator *comm, const std::string& name,
-                                                             ShapeMap& shapemap, bool copydata)
+                                                             ShapeMap& shapemap, bool copydata, int threads)
 {
    if (comm) {
       comm->CommPostMessage( Communicator::NUM_STEPS, 2 );
@@ -188,7 +189,7 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDataToAxial(Communicator *comm,
 
    // n.b. make connections also initialises attributes
 
-   usermap->makeConnections();
+   usermap->makeConnections(KeyVertices(), threads);
 
    // if we are inheriting from a mapinfo map, pass on the coordsys and bounds:
    if (shapemap.hasMapInfoData()) {
@@ -286,7 +287,8 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDataToConvex(Communicator *, co
 // create segment map directly from line layers
 
 std::unique_ptr<ShapeGraph> MapConverter::convertDrawingToSegment(Communicator *comm, const std::string& name,
-                                                                  const std::vector<SpacePixelFile> &drawingFiles)
+                                                                  const std::vector<SpacePixelFile> &drawingFiles,
+                                                                  int threads)
 {
    if (comm) {
       comm->CommPostMessage( Communicator::NUM_STEPS, 2 );
@@ -360,7 +362,7 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDrawingToSegment(Communicator *
    }
 
    // make it!
-   usermap->makeNewSegMap(comm);
+   usermap->makeNewSegMap(comm, threads);
 
    return usermap;
 }
@@ -368,7 +370,7 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDrawingToSegment(Communicator *
 // create segment map directly from data maps (ultimately, this will replace the line layers version)
 
 std::unique_ptr<ShapeGraph> MapConverter::convertDataToSegment(Communicator *comm, const std::string& name,
-                                                               ShapeMap& shapemap, bool copydata)
+                                                               ShapeMap& shapemap, bool copydata, int threads)
 {
    if (comm) {
       comm->CommPostMessage( Communicator::NUM_STEPS, 2 );
@@ -475,7 +477,7 @@ std::unique_ptr<ShapeGraph> MapConverter::convertDataToSegment(Communicator *com
    }
 
    // make it!
-   usermap->makeNewSegMap(comm);
+   usermap->makeNewSegMap(comm, threads);
 
    return usermap;
 }
@@ -493,6 +495,7 @@ std::unique_ptr<ShapeGraph> MapConverter::convertAxialToSegment(Communicator *,
     // destroy unnecessary parts of axial map as quickly as possible in order not to overload memory
     if (!keeporiginal) {
        axialMap.getAllShapes().clear();
+       axialMap.invalidateShapeIndex();
        axialMap.getConnections().clear();
     }
 
@@ -52,11 +52,18 @@
 
 #include "genlib/pafmath.h"
 #include "genlib/p2dpoly.h"
+#include "genlib/blockcompression.h"
 #include "genlib/comm.h"
+#include "genlib/memorymappedfile.h"
 
 #include "math.h"
 #include "time.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
 #include <sstream>
 #include <tuple>
 
@@ -261,7 +268,7 @@ bool MetaGraph::clearPoints()
    return b_return;
 }
 
-bool MetaGraph::makeGraph( Communicator *communicator, int algorithm, double maxdist )
+bool MetaGraph::makeGraph( Communicator *communicator, int algorithm, double maxdist, int threads )
 {
    // this is essentially a version tag, and remains for historical reasons:
    m_state |= ANGULARGRAPH;
@@ -270,7 +277,7 @@ bool MetaGraph::makeGraph( Communicator *communicator, int algorithm, double max
    
    try {
       // algorithm is now used for boundary graph option (as a simple boolean)
-      graphMade = getDisplayedPointMap().sparkGraph2(communicator, (algorithm != 0), maxdist);
+      graphMade = getDisplayedPointMap().sparkGraph2(communicator, (algorithm != 0), maxdist, threads);
    } 
    catch (Communicator::CancelledException) {
       graphMade = false;
@@ -344,13 +351,13 @@ bool MetaGraph::analyseGraph( Communicator *communicator, Options options , bool
          }
       }
       else if (options.output_type == Options::OUTPUT_ISOVIST) {
-         analysisCompleted = VGAIsovist().run(communicator, getDisplayedPointMap(), simple_version);
+         analysisCompleted = VGAIsovist(options.threads).run(communicator, getDisplayedPointMap(), simple_version);
       }
       else if (options.output_type == Options::OUTPUT_VISUAL) {
           bool localResult = true;
           bool globalResult = true;
           if (options.local) {
-              localResult = VGAVisualLocal(options.gates_only).run(communicator, getDisplayedPointMap(), simple_version);
+              localResult = VGAVisualLocal(options.gates_only, options.threads).run(communicator, getDisplayedPointMap(), simple_version);
           }
           if (options.global) {
               globalResult = VGAVisualGlobal(options.radius, options.gates_only).run(communicator, getDisplayedPointMap(), simple_version);
@@ -358,10 +365,10 @@ bool MetaGraph::analyseGraph( Communicator *communicator, Options options , bool
           analysisCompleted = globalResult & localResult;
       }
       else if (options.output_type == Options::OUTPUT_METRIC) {
-          analysisCompleted = VGAMetric(options.radius, options.gates_only).run(communicator, getDisplayedPointMap(), simple_version);
+          analysisCompleted = VGAMetric(options.radius, options.gates_only, options.threads).run(communicator, getDisplayedPointMap(), simple_version);
       }
       else if (options.output_type == Options::OUTPUT_ANGULAR) {
-          analysisCompleted = VGAAngular(options.radius, options.gates_only).run(communicator, getDisplayedPointMap(), simple_version);
+          analysisCompleted = VGAAngular(options.radius, options.gates_only, options.threads).run(communicator, getDisplayedPointMap(), simple_version);
       }
       else if (options.output_type == Options::OUTPUT_THRU_VISION) {
           analysisCompleted = VGAThroughVision().run(communicator, getDisplayedPointMap(), simple_version);
@@ -759,7 +766,7 @@ void MetaGraph::removeDisplayedMap()
 //////////////////////////////////////////////////////////////////
 
 
-bool MetaGraph::convertDrawingToAxial(Communicator *comm, std::string layer_name)
+bool MetaGraph::convertDrawingToAxial(Communicator *comm, std::string layer_name, int threads)
 {
    int oldstate = m_state;
 
@@ -768,7 +775,7 @@ bool MetaGraph::convertDrawingToAxial(Communicator *comm, std::string layer_name
    bool converted = true;
    
    try {
-      auto shapeGraph = MapConverter::convertDrawingToAxial( comm, layer_name, m_drawingFiles );
+      auto shapeGraph = MapConverter::convertDrawingToAxial( comm, layer_name, m_drawingFiles, threads );
       int mapref = addShapeGraph(shapeGraph);
       setDisplayedShapeGraphRef(mapref);
    } 
@@ -786,7 +793,7 @@ bool MetaGraph::convertDrawingToAxial(Communicator *comm, std::string layer_name
    return converted;
 }
 
-bool MetaGraph::convertDataToAxial(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues)
+bool MetaGraph::convertDataToAxial(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues, int threads)
 {
    int oldstate = m_state;
 
@@ -795,7 +802,7 @@ bool MetaGraph::convertDataToAxial(Communicator *comm, std::string layer_name, b
    bool converted = true;
    
    try {
-       auto shapeGraph = MapConverter::convertDataToAxial( comm, layer_name, getDisplayedDataMap(), pushvalues );
+       auto shapeGraph = MapConverter::convertDataToAxial( comm, layer_name, getDisplayedDataMap(), pushvalues, threads );
        addShapeGraph(shapeGraph);
 
        m_shapeGraphs.back()->overrideDisplayedAttribute(-2); // <- override if it's already showing
@@ -874,7 +881,7 @@ bool MetaGraph::convertToConvex(Communicator *comm, std::string layer_name, bool
    return converted;
 }
 
-bool MetaGraph::convertDrawingToSegment(Communicator *comm, std::string layer_name)
+bool MetaGraph::convertDrawingToSegment(Communicator *comm, std::string layer_name, int threads)
 {
    int oldstate = m_state;
 
@@ -883,7 +890,7 @@ bool MetaGraph::convertDrawingToSegment(Communicator *comm, std::string layer_na
    bool converted = true;
    
    try {
-       auto shapeGraph = MapConverter::convertDrawingToSegment( comm, layer_name, m_drawingFiles );
+       auto shapeGraph = MapConverter::convertDrawingToSegment( comm, layer_name, m_drawingFiles, threads );
        addShapeGraph(shapeGraph);
 
        setDisplayedShapeGraphRef(int(m_shapeGraphs.size() - 1));
@@ -902,7 +909,7 @@ bool MetaGraph::convertDrawingToSegment(Communicator *comm, std::string layer_na
    return converted;
 }
 
-bool MetaGraph::convertDataToSegment(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues)
+bool MetaGraph::convertDataToSegment(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues, int threads)
 {
    int oldstate = m_state;
 
@@ -911,7 +918,7 @@ bool MetaGraph::convertDataToSegment(Communicator *comm, std::string layer_name,
    bool converted = true;
    
    try {
-       auto shapeGraph = MapConverter::convertDataToSegment( comm, layer_name, getDisplayedDataMap(), pushvalues );
+       auto shapeGraph = MapConverter::convertDataToSegment( comm, layer_name, getDisplayedDataMap(), pushvalues, threads );
        addShapeGraph(shapeGraph);
 
        m_shapeGraphs.back()->overrideDisplayedAttribute( -2 ); // <- override if it's already showing
@@ -1282,7 +1289,7 @@ bool MetaGraph::analyseAxial( Communicator *communicator, Options options, bool
 
    try {
        analysisCompleted = AxialIntegration(options.radius_set, options.weighted_measure_col, options.choice, options.fulloutput,
-                        options.local)
+                        options.local, options.threads)
            .run(communicator, getDisplayedShapeGraph(), false);
    } 
    catch (Communicator::CancelledException) {
@@ -1302,7 +1309,7 @@ bool MetaGraph::analyseSegmentsTulip( Communicator *communicator, Options option
 
    try {
        analysisCompleted = SegmentTulip(options.radius_set, options.sel_only, options.tulip_bins, options.weighted_measure_col,
-                    options.radius_type, options.choice)
+                    options.radius_type, options.choice, false, -1, -1, options.threads)
            .run(communicator, getDisplayedShapeGraph(), false);
    }
    catch (Communicator::CancelledException) {
@@ -1336,18 +1343,15 @@ bool MetaGraph::analyseTopoMetMultipleRadii( Communicator *communicator, Options
 {
    m_state &= ~SHAPEGRAPHS;      // Clear axial map data flag (stops accidental redraw during reload)
 
-   bool analysisCompleted = true;
+   bool analysisCompleted = false;
 
    try {
       // note: "output_type" reused for analysis type (either 0 = topological or 1 = metric)
-      for(size_t r = 0; r < options.radius_set.size(); r++) {
-          if(options.output_type == 0) {
-              if(!SegmentTopological(options.radius, options.sel_only).run(communicator, getDisplayedShapeGraph(), false))
-                  analysisCompleted = false;
-          } else {
-              if(!SegmentMetric(options.radius, options.sel_only).run(communicator, getDisplayedShapeGraph(), false))
-                  analysisCompleted = false;
-          }
+      // all the radii are found in one search out to the largest radius
+      if(options.output_type == 0) {
+          analysisCompleted = SegmentTopological(options.radius_set, options.sel_only).run(communicator, getDisplayedShapeGraph(), false);
+      } else {
+          analysisCompleted = SegmentMetric(options.radius_set, options.sel_only).run(communicator, getDisplayedShapeGraph(), false);
       }
    }
    catch (Communicator::CancelledException) {
@@ -1788,7 +1792,7 @@ void pushValue(double& val, int& count, double thisval, int push_func)
 
 // the full ubercontrol version:
 
-bool MetaGraph::pushValuesToLayer(int sourcetype, int sourcelayer, int desttype, int destlayer, int col_in, int col_out, int push_func, bool count_col)
+bool MetaGraph::pushValuesToLayer(int sourcetype, int sourcelayer, int desttype, int destlayer, int col_in, int col_out, int push_func, bool count_col, int threads)
 {
    AttributeTable& table_in = getAttributeTable(sourcetype, sourcelayer);
    AttributeTable& table_out = getAttributeTable(desttype, destlayer);
@@ -1867,17 +1871,22 @@ bool MetaGraph::pushValuesToLayer(int sourcetype, int sourcelayer, int desttype,
        }
 
        // then collect the polygons and push to vga map
+       std::vector<Point2f> locations;
+       for (auto &valCount : valCounts) {
+           if (isObjectVisible(vgaMap.m_layers, valCount.second.m_row)) {
+               locations.push_back(vgaMap.getPoint(valCount.first.value).m_location);
+           }
+       }
+       std::vector<std::vector<int>> gatelists = sourceMap.pointInPolyLists(locations, threads);
+       auto nextGatelist = gatelists.begin();
        for (auto &valCount : valCounts) {
-           int key_out = valCount.first.value;
            double &val = valCount.second.m_value;
            int &count = valCount.second.m_count;
            AttributeRow &row = valCount.second.m_row;
-           std::vector<int> gatelist;
            if (!isObjectVisible(vgaMap.m_layers, row)) {
                continue;
            }
-           gatelist = sourceMap.pointInPolyList(vgaMap.getPoint(key_out).m_location);
-           for (int gate : gatelist) {
+           for (int gate : *nextGatelist++) {
                AttributeRow &row_in = sourceMap.getAttributeRowFromShapeIndex(gate);
 
                if (isObjectVisible(sourceMap.getLayers(), row_in)) {
@@ -1895,15 +1904,15 @@ bool MetaGraph::pushValuesToLayer(int sourcetype, int sourcelayer, int desttype,
        }
    } else if (sourcetype & VIEWDATA) {
 
+      // find what each destination shape intersects in one go, then push in table order
+      std::vector<const SalaShape *> shapes_out;
       for (auto iter_out = table_out.begin(); iter_out != table_out.end(); iter_out++) {
          int key_out = iter_out->getKey().value;
-         std::vector<int> gatelist;
          if (desttype == VIEWAXIAL) {
              if (!isObjectVisible(m_shapeGraphs[destlayer]->getLayers(), iter_out->getRow())) {
                 continue;
              }
-            auto shapeMap = m_shapeGraphs[destlayer]->getAllShapes();
-            gatelist = m_dataMaps[sourcelayer].shapeInPolyList(shapeMap[key_out]);
+            shapes_out.push_back(&m_shapeGraphs[destlayer]->getAllShapes().at(key_out));
          }
          else if (desttype == VIEWDATA) {
             if (sourcelayer == destlayer) {
@@ -1913,8 +1922,25 @@ bool MetaGraph::pushValuesToLayer(int sourcetype, int sourcelayer, int desttype,
             if (!isObjectVisible(m_dataMaps[destlayer].getLayers(), iter_out->getRow())) {
                continue;
             }
-            auto dataMap = m_dataMaps[destlayer].getAllShapes();
-            gatelist = m_dataMaps[sourcelayer].shapeInPolyList(dataMap[key_out]);
+            shapes_out.push_back(&m_dataMaps[destlayer].getAllShapes().at(key_out));
+         }
+      }
+      std::vector<std::vector<int>> gatelists = m_dataMaps[sourcelayer].shapeInPolyLists(shapes_out, threads);
+
+      auto nextGatelist = gatelists.begin();
+      for (auto iter_out = table_out.begin(); iter_out != table_out.end(); iter_out++) {
+         std::vector<int> gatelist;
+         if (desttype == VIEWAXIAL) {
+             if (!isObjectVisible(m_shapeGraphs[destlayer]->getLayers(), iter_out->getRow())) {
+                continue;
+             }
+            gatelist = std::move(*nextGatelist++);
+         }
+         else if (desttype == VIEWDATA) {
+            if (!isObjectVisible(m_dataMaps[destlayer].getLayers(), iter_out->getRow())) {
+               continue;
+            }
+            gatelist = std::move(*nextGatelist++);
          }
          double val = -1.0;
          int count = 0;
@@ -1948,14 +1974,27 @@ bool MetaGraph::pushValuesToLayer(int sourcetype, int sourcelayer, int desttype,
       }
 
       if (sourcetype & VIEWVGA) {
+         // find the shapes each visible point is in all in one go, then push in table order
+         std::vector<Point2f> locations;
+         for (auto iter_in = table_in.begin(); iter_in != table_in.end(); iter_in++) {
+            if (isObjectVisible(m_pointMaps[sourcelayer].getLayers(), iter_in->getRow())) {
+               locations.push_back(m_pointMaps[size_t(sourcelayer)].getPoint(iter_in->getKey().value).m_location);
+            }
+         }
+         std::vector<std::vector<int>> gatelists;
+         if (desttype == VIEWDATA) {
+            gatelists = m_dataMaps[size_t(destlayer)].pointInPolyLists(locations, threads);
+         } else if (desttype == VIEWAXIAL) {
+            gatelists = m_shapeGraphs[size_t(destlayer)]->pointInPolyLists(locations, threads);
+         }
+         auto nextGatelist = gatelists.begin();
          for (auto iter_in = table_in.begin(); iter_in != table_in.end(); iter_in++) {
-            int pix_in = iter_in->getKey().value;
             if (!isObjectVisible(m_pointMaps[sourcelayer].getLayers(), iter_in->getRow())) {
                continue;
             }
             std::vector<int> gatelist;
             if (desttype == VIEWDATA) {
-                gatelist = m_dataMaps[size_t(destlayer)].pointInPolyList(m_pointMaps[size_t(sourcelayer)].getPoint(pix_in).m_location);
+                gatelist = std::move(*nextGatelist++);
                 double thisval = iter_in->getKey().value;
                 if(col_in != -1) thisval = iter_in->getRow().getValue(col_in);
                 for (int gate: gatelist) {
@@ -1969,7 +2008,7 @@ bool MetaGraph::pushValuesToLayer(int sourcetype, int sourcelayer, int desttype,
                 }
             } else if (desttype == VIEWAXIAL) {
                // note, "axial" could be convex map, and hence this would be a valid operation
-               gatelist = m_shapeGraphs[size_t(destlayer)]->pointInPolyList(m_pointMaps[size_t(sourcelayer)].getPoint(pix_in).m_location);
+               gatelist = std::move(*nextGatelist++);
                double thisval = iter_in->getKey().value;
                if(col_in != -1) thisval = iter_in->getRow().getValue(col_in);
                for (int gate: gatelist) {
@@ -1988,15 +2027,26 @@ bool MetaGraph::pushValuesToLayer(int sourcetype, int sourcelayer, int desttype,
       else if (sourcetype & VIEWAXIAL) {
          // note, in the spirit of mapping fewer objects in the gate list, it is *usually* best to 
          // perform axial -> gate map in this direction
+         std::vector<const SalaShape *> shapes_in;
+         for (auto iter_in = table_in.begin(); iter_in != table_in.end(); iter_in++) {
+            if (isObjectVisible(m_shapeGraphs[size_t(sourcelayer)]->getLayers(),iter_in->getRow())) {
+               shapes_in.push_back(&m_shapeGraphs[size_t(sourcelayer)]->getAllShapes().at(iter_in->getKey().value));
+            }
+         }
+         std::vector<std::vector<int>> gatelists;
+         if (desttype == VIEWDATA) {
+            gatelists = m_dataMaps[size_t(destlayer)].shapeInPolyLists(shapes_in, threads);
+         } else if (desttype == VIEWAXIAL) {
+            gatelists = m_shapeGraphs[size_t(destlayer)]->shapeInPolyLists(shapes_in, threads);
+         }
+         auto nextGatelist = gatelists.begin();
          for (auto iter_in = table_in.begin(); iter_in != table_in.end(); iter_in++) {
-            int key_in = iter_in->getKey().value;
             if (!isObjectVisible(m_shapeGraphs[size_t(sourcelayer)]->getLayers(),iter_in->getRow())) {
                continue;
             }
             std::vector<int> gatelist;
             if (desttype == VIEWDATA) {
-               auto dataMap = m_shapeGraphs[size_t(sourcelayer)]->getAllShapes();
-               gatelist = m_dataMaps[size_t(destlayer)].shapeInPolyList(dataMap[key_in]);
+               gatelist = std::move(*nextGatelist++);
                double thisval = iter_in->getKey().value;
                if(col_in != -1) thisval = iter_in->getRow().getValue(col_in);
                for (int gate: gatelist) {
@@ -2011,8 +2061,7 @@ bool MetaGraph::pushValuesToLayer(int sourcetype, int sourcelayer, int desttype,
                }
             }
             else if (desttype == VIEWAXIAL) {
-               auto shapeMap = m_shapeGraphs[size_t(sourcelayer)]->getAllShapes();
-               gatelist = m_shapeGraphs[size_t(destlayer)]->shapeInPolyList(shapeMap[key_in]);
+               gatelist = std::move(*nextGatelist++);
                double thisval = iter_in->getKey().value;
                if(col_in != -1) thisval = iter_in->getRow().getValue(col_in);
                for (int gate: gatelist) {
@@ -2472,24 +2521,41 @@ const AttributeTableHandle& MetaGraph::getAttributeTableHandle(int type, int lay
    return *tab;
 }
 
-int MetaGraph::readFromFile( const std::string& filename )
+int MetaGraph::readFromFile( const std::string& filename, int readflags )
 {
 
     if (filename.empty()) {
        return NOT_A_GRAPH;
     }
 
+    // mapping the file lets the reader jump over the parts it skips instead of reading
+    // them through a buffer
+    depthmapX::MemoryMappedFile mapped(filename);
+    if (mapped.isOpen() && depthmapX::blockstream::isCompressed(mapped.data(), mapped.size())) {
+       depthmapX::BlockCompressedReadBuf buffer(mapped.data(), mapped.size());
+       if (!buffer.isValid()) {
+          return DAMAGED_FILE;
+       }
+       std::istream stream(&buffer);
+       return readFromStream(stream, filename, readflags);
+    }
+    if (mapped.isOpen()) {
+       depthmapX::MemoryStreamBuf buffer(mapped.data(), mapped.size());
+       std::istream stream(&buffer);
+       return readFromStream(stream, filename, readflags);
+    }
+
  #ifdef _WIN32
     std::ifstream stream( filename.c_str(), std::ios::binary | std::ios::in );
  #else
     std::ifstream stream( filename.c_str(), std::ios::in );
  #endif
-    int result = readFromStream(stream, filename);
+    int result = readFromStream(stream, filename, readflags);
     stream.close();
     return result;
 }
 
-int MetaGraph::readFromStream( std::istream &stream, const std::string& filename )
+int MetaGraph::readFromStream( std::istream &stream, const std::string& filename, int readflags )
 {
    m_state = 0;   // <- clear the state out
 
@@ -2502,6 +2568,17 @@ int MetaGraph::readFromStream( std::istream &stream, const std::string& filename
 
    char header[3];
    stream.read( header, 3 );
+   if (!stream.fail() && depthmapX::blockstream::isCompressed(header, 3)) {
+      // a compressed graph that is not memory mapped has to be held in memory to be read
+      std::string contents(header, 3);
+      contents.append(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+      depthmapX::BlockCompressedReadBuf buffer(contents.data(), contents.size());
+      if (!buffer.isValid()) {
+         return DAMAGED_FILE;
+      }
+      std::istream decompressed(&buffer);
+      return readFromStream(decompressed, filename, readflags);
+   }
    if (stream.fail() || header[0] != 'g' || header[1] != 'r' || header[2] != 'f') {
       return NOT_A_GRAPH;
    }
@@ -2512,16 +2589,7 @@ int MetaGraph::readFromStream( std::istream &stream, const std::string& filename
       return NEWER_VERSION;
    }
    if (version < METAGRAPH_VERSION) {
-       std::unique_ptr<mgraph440::MetaGraph> mgraph(new mgraph440::MetaGraph);
-       auto result = mgraph->read(filename);
-       if ( result != mgraph440::MetaGraph::OK)
-       {
-           return DAMAGED_FILE;
-       }
-       std::stringstream tempstream;
-       mgraph->writeToStream(tempstream, METAGRAPH_VERSION, 0);
-
-       return readFromStream(tempstream, filename);
+       return readOlderVersion(filename, readflags);
    }
 
    // have to use temporary state here as redraw attempt may come too early:
@@ -2544,16 +2612,7 @@ int MetaGraph::readFromStream( std::istream &stream, const std::string& filename
    if (type == 'd') {
        // contains deprecated datalayers. Read through mgraph440 which will
        // convert them into shapemaps
-       std::unique_ptr<mgraph440::MetaGraph> mgraph(new mgraph440::MetaGraph);
-       auto result = mgraph->read(filename);
-       if ( result != mgraph440::MetaGraph::OK)
-       {
-           return DAMAGED_FILE;
-       }
-       std::stringstream tempstream;
-       mgraph->writeToStream(tempstream, METAGRAPH_VERSION, 0);
-
-       return readFromStream(tempstream, filename);
+       return readOlderVersion(filename, readflags);
    }
    if (type == 'x') {
       FileProperties::read(stream);
@@ -2613,7 +2672,7 @@ int MetaGraph::readFromStream( std::istream &stream, const std::string& filename
       }
    }
    if (type == 'p') {
-      readPointMaps( stream );
+      readPointMaps( stream, (readflags & SKIP_VISIBILITY_GRAPHS) != 0 );
       temp_state |= POINTMAPS;
       if (!stream.eof()) {
          stream.read( &type, 1 );         
@@ -2653,9 +2712,68 @@ int MetaGraph::readFromStream( std::istream &stream, const std::string& filename
    return OK;
 }
 
-int MetaGraph::write( const std::string& filename, int version, bool currentlayer )
+// a file name in the temporary directory that no other file has
+static std::string temporaryGraphFilename()
+{
+   static std::atomic<unsigned int> counter(0);
+   std::error_code error;
+   std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+   if (error) {
+      directory = std::filesystem::current_path();
+   }
+   std::filesystem::path filename;
+   do {
+      auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+      filename = directory / ("depthmapX_upgrade_" + std::to_string(now) + "_" + std::to_string(counter++) + ".graph");
+   } while (std::filesystem::exists(filename, error));
+   return filename.string();
+}
+
+int MetaGraph::readOlderVersion( const std::string& filename, int readflags )
 {
-   std::ofstream stream;
+   std::unique_ptr<mgraph440::MetaGraph> mgraph(new mgraph440::MetaGraph);
+   auto result = mgraph->read(filename);
+   if ( result != mgraph440::MetaGraph::OK)
+   {
+       return DAMAGED_FILE;
+   }
+
+   // The upgraded graph is written to a temporary file rather than to memory, so that
+   // the old graph is let go before the upgraded one is read back in, and the upgraded
+   // file is only ever mapped, never copied into a buffer
+   std::string upgradedname = temporaryGraphFilename();
+   {
+      std::ofstream upgraded( upgradedname.c_str(), std::ios::binary | std::ios::out | std::ios::trunc );
+      if (!upgraded.fail()) {
+         mgraph->writeToStream(upgraded, METAGRAPH_VERSION, 0);
+         upgraded.close();
+      }
+      if (upgraded.fail()) {
+         // no room for the temporary file, upgrade in memory instead
+         std::remove(upgradedname.c_str());
+         std::stringstream tempstream;
+         mgraph->writeToStream(tempstream, METAGRAPH_VERSION, 0);
+         mgraph.reset();
+         return readFromStream(tempstream, filename, readflags);
+      }
+   }
+   mgraph.reset();
+
+   int upgradedresult;
+   try {
+      upgradedresult = readFromFile(upgradedname, readflags);
+   }
+   catch (...) {
+      std::remove(upgradedname.c_str());
+      throw;
+   }
+   std::remove(upgradedname.c_str());
+   return upgradedresult;
+}
+
+int MetaGraph::write( const std::string& filename, int version, bool currentlayer, bool compressed )
+{
+   std::ofstream filestream;
 
    int oldstate = m_state;
    m_state = 0;   // <- temporarily clear out state, avoids any potential read / write errors
@@ -2663,14 +2781,24 @@ int MetaGraph::write( const std::string& filename, int version, bool currentlaye
    char type;
 
    // As of MetaGraph version 70 the disk caching has been removed
-   stream.open( filename.c_str(), std::ios::binary | std::ios::out | std::ios::trunc );
-   if (stream.fail()) {
-      if (stream.rdbuf()->is_open()) {
-         stream.close();
+   filestream.open( filename.c_str(), std::ios::binary | std::ios::out | std::ios::trunc );
+   if (filestream.fail()) {
+      if (filestream.rdbuf()->is_open()) {
+         filestream.close();
       }
       m_state = oldstate;
       return DISK_ERROR;  
    }
+
+   // a compressed file goes through a block compressing buffer, and the stream is
+   // flushed before every section below so that each section starts on a new block
+   std::unique_ptr<depthmapX::BlockCompressedWriteBuf> compressor;
+   std::unique_ptr<std::ostream> compressedstream;
+   if (compressed) {
+      compressor.reset(new depthmapX::BlockCompressedWriteBuf(filestream));
+      compressedstream.reset(new std::ostream(compressor.get()));
+   }
+   std::ostream& stream = compressed ? *compressedstream : filestream;
    stream.write("grf", 3);
    m_file_version = version; // <- note, the file may now have an updated file version
    stream.write( (char *) &version, sizeof(version) );
@@ -2705,16 +2833,19 @@ int MetaGraph::write( const std::string& filename, int version, bool currentlaye
    if (currentlayer) {
       if (m_view_class & MetaGraph::VIEWVGA) {
          type = 'p';
+         stream.flush();
          stream.write(&type, 1);
          writePointMaps( stream, true );
       }
       else if (m_view_class & MetaGraph::VIEWAXIAL) {
          type = 'x';
+         stream.flush();
          stream.write(&type, 1);
          writeShapeGraphs( stream, true );
       }
       else if (m_view_class & MetaGraph::VIEWDATA) {
          type = 's';
+         stream.flush();
          stream.write(&type, 1);
          writeDataMaps( stream, true );
       }
@@ -2722,6 +2853,7 @@ int MetaGraph::write( const std::string& filename, int version, bool currentlaye
    else {
       if (oldstate & LINEDATA) {
          type = 'l';
+         stream.flush();
          stream.write(&type, 1);
          dXstring::writeString(stream, m_name);
          stream.write( (char *) &m_region, sizeof(m_region) );
@@ -2735,22 +2867,28 @@ int MetaGraph::write( const std::string& filename, int version, bool currentlaye
       }
       if (oldstate & POINTMAPS) {
          type = 'p';
+         stream.flush();
          stream.write(&type, 1);
          writePointMaps( stream );
       }
       if (oldstate & SHAPEGRAPHS) {
          type = 'x';
+         stream.flush();
          stream.write(&type, 1);
          writeShapeGraphs( stream );
       }
       if (oldstate & DATAMAPS) {
          type = 's';
+         stream.flush();
          stream.write(&type, 1);
          writeDataMaps( stream );
       }
    }
 
-   stream.close();
+   // the last block is written when the compressor goes
+   compressedstream.reset();
+   compressor.reset();
+   filestream.close();
 
    m_state = oldstate;
    return OK;
@@ -2808,19 +2946,19 @@ int MetaGraph::addNewPointMap(const std::string& name)
    return m_pointMaps.size() - 1;
 }
 
-bool MetaGraph::readPointMaps(std::istream& stream)
+bool MetaGraph::readPointMaps(std::istream& stream, bool skipGraphs)
 {
    stream.read((char *) &m_displayed_pointmap, sizeof(m_displayed_pointmap));
    int count;
    stream.read((char *) &count, sizeof(count));
    for (int i = 0; i < count; i++) {
       m_pointMaps.push_back(PointMap(m_region, m_drawingFiles));
-      m_pointMaps.back().read( stream );
+      m_pointMaps.back().read( stream, skipGraphs );
    }
    return true;
 }
 
-bool MetaGraph::writePointMaps(std::ofstream& stream, bool displayedmaponly)
+bool MetaGraph::writePointMaps(std::ostream& stream, bool displayedmaponly)
 {
    if (!displayedmaponly) {
       stream.write((char *) &m_displayed_pointmap, sizeof(m_displayed_pointmap));
@@ -2863,7 +3001,7 @@ bool MetaGraph::readDataMaps(std::istream& stream )
     return true;
 }
 
-bool MetaGraph::writeDataMaps( std::ofstream& stream, bool displayedmaponly )
+bool MetaGraph::writeDataMaps( std::ostream& stream, bool displayedmaponly )
 {
    if (!displayedmaponly) {
       // n.b. -- do not change to size_t as will cause 32-bit to 64-bit conversion problems
@@ -2969,7 +3107,7 @@ bool MetaGraph::readShapeGraphs(std::istream& stream)
     return true;
 }
 
-bool MetaGraph::writeShapeGraphs( std::ofstream& stream, bool displayedmaponly )
+bool MetaGraph::writeShapeGraphs( std::ostream& stream, bool displayedmaponly )
 {
     if (!displayedmaponly) {
         // n.b. -- do not change to size_t as will cause 32-bit to 64-bit conversion problems
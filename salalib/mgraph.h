@@ -125,8 +125,8 @@ private:
        m_pointMaps.erase(m_pointMaps.begin() + i);
    }
 
-   bool readPointMaps(std::istream &stream);
-   bool writePointMaps(std::ofstream& stream, bool displayedmaponly = false );
+   bool readPointMaps(std::istream &stream, bool skipGraphs = false);
+   bool writePointMaps(std::ostream& stream, bool displayedmaponly = false );
 
    std::recursive_mutex mLock;
 public:
@@ -154,7 +154,7 @@ public:
    bool clearPoints();
    bool setGrid( double spacing, const Point2f& offset = Point2f() );                 // override of PointMap
    bool makePoints( const Point2f& p, int semifilled, Communicator *communicator = NULL);  // override of PointMap
-   bool makeGraph( Communicator *communicator, int algorithm, double maxdist );
+   bool makeGraph( Communicator *communicator, int algorithm, double maxdist, int threads = 1 );
    bool unmakeGraph(bool removeLinks);
    bool analyseGraph(Communicator *communicator, Options options , bool simple_version); // <- options copied to keep thread safe
    //
@@ -176,10 +176,11 @@ public:
    void removeDisplayedMap();
    //
    // various map conversions
-   bool convertDrawingToAxial(Communicator *comm, std::string layer_name);  // n.b., name copied for thread safety
-   bool convertDataToAxial(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues);
-   bool convertDrawingToSegment(Communicator *comm, std::string layer_name);
-   bool convertDataToSegment(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues);
+   // threads is the number of threads to make the connections of the new map with (0 for all cores)
+   bool convertDrawingToAxial(Communicator *comm, std::string layer_name, int threads = 1);  // n.b., name copied for thread safety
+   bool convertDataToAxial(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues, int threads = 1);
+   bool convertDrawingToSegment(Communicator *comm, std::string layer_name, int threads = 1);
+   bool convertDataToSegment(Communicator *comm, std::string layer_name, bool keeporiginal, bool pushvalues, int threads = 1);
    bool convertToData(Communicator *, std::string layer_name, bool keeporiginal, int shapeMapType, bool copydata);
    bool convertToDrawing(Communicator *, std::string layer_name, bool fromDisplayedDataMap);
    bool convertToConvex(Communicator *comm, std::string layer_name, bool keeporiginal, int shapeMapType, bool copydata);
@@ -208,7 +209,8 @@ public:
    }
    enum { PUSH_FUNC_MAX = 0, PUSH_FUNC_MIN = 1, PUSH_FUNC_AVG = 2, PUSH_FUNC_TOT = 3};
    bool pushValuesToLayer(int desttype, int destlayer, int push_func, bool count_col = false);
-   bool pushValuesToLayer(int sourcetype, int sourcelayer, int desttype, int destlayer, int col_in, int col_out, int push_func, bool count_col = false);
+   // threads: number of threads to find which shapes intersect each other on (0 to use all available cores)
+   bool pushValuesToLayer(int sourcetype, int sourcelayer, int desttype, int destlayer, int col_in, int col_out, int push_func, bool count_col = false, int threads = 1);
    //
    int getDisplayedMapRef() const;
    //
@@ -269,13 +271,13 @@ public:
    }
 
    bool readShapeGraphs(std::istream &stream);
-   bool writeShapeGraphs(std::ofstream& stream, bool displayedmaponly = false );
+   bool writeShapeGraphs(std::ostream& stream, bool displayedmaponly = false );
 
    std::vector<ShapeMap>& getDataMaps()
    { return m_dataMaps; }
 
    bool readDataMaps(std::istream &stream);
-   bool writeDataMaps(std::ofstream& stream, bool displayedmaponly = false );
+   bool writeDataMaps(std::ostream& stream, bool displayedmaponly = false );
 
    //
    int getDisplayedMapType();
@@ -483,12 +485,21 @@ protected:
 public:
    // a few read-write returns:
    enum { OK, WARN_BUGGY_VERSION, WARN_CONVERTED, NOT_A_GRAPH, DAMAGED_FILE, DISK_ERROR, NEWER_VERSION, DEPRECATED_VERSION };
+   // read flags: SKIP_VISIBILITY_GRAPHS moves past the visibility graph of every point map
+   // without reading it in, for when only the attributes and the shapes are wanted (the
+   // point maps cannot be analysed afterwards)
+   enum { READ_ALL = 0x0, SKIP_VISIBILITY_GRAPHS = 0x1 };
    // likely to use communicator if too slow...
-   int readFromFile( const std::string& filename );
-   int readFromStream( std::istream &stream, const std::string& filename );
-   int write( const std::string& filename, int version, bool currentlayer = false);
+   // the file is memory mapped where the platform allows it
+   int readFromFile( const std::string& filename, int readflags = READ_ALL );
+   int readFromStream( std::istream &stream, const std::string& filename, int readflags = READ_ALL );
+   // compressed writes the graph in blocks compressed one by one, which readFromFile
+   // recognises and reads without decompressing the whole file first
+   int write( const std::string& filename, int version, bool currentlayer = false, bool compressed = false);
    //
    std::vector<SimpleLine> getVisibleDrawingLines();
 protected:
    std::streampos skipVirtualMem(std::istream &stream);
+   // files from older versions are read by mgraph440 and upgraded through a temporary file
+   int readOlderVersion( const std::string& filename, int readflags );
 };
@@ -57,35 +57,6 @@ void Node::make(const PixelRef pix, PixelRefVector *bins, float *bin_far_dists,
    }
 }
 
-void Node::extractUnseen(PixelRefVector& pixels, PointMap *pointdata)
-{
-   for (int i = 0; i < 32; i++) {
-         m_bins[i].extractUnseen(pixels, pointdata, (1 << i));
-   }
-}
-
-void Node::extractMetric(std::set<MetricTriple>& pixels, PointMap *pointdata, const MetricTriple& curs)
-{
-   //if (dist == 0.0f || concaveConnected()) { // increases effiency but is too inaccurate
-   //if (dist == 0.0f || !fullyConnected()) { // increases effiency but can miss lines
-   if (curs.dist == 0.0f || pointdata->getPoint(curs.pixel).blocked() || pointdata->blockedAdjacent(curs.pixel)) { 
-      for (int i = 0; i < 32; i++) {
-         m_bins[i].extractMetric(pixels, pointdata, curs);
-      }
-   }
-}
-
-// based on extract metric
-
-void Node::extractAngular(std::set<AngularTriple>& pixels, PointMap *pointdata, const AngularTriple& curs)
-{
-   if (curs.angle == 0.0f || pointdata->getPoint(curs.pixel).blocked() || pointdata->blockedAdjacent(curs.pixel)) {
-      for (int i = 0; i < 32; i++) {
-         m_bins[i].extractAngular(pixels, pointdata, curs);
-      }
-   }
-}
-
 bool Node::concaveConnected()
 {
    // not quite correct -- sometimes at corners you 'see through' the very first connection
@@ -206,6 +177,22 @@ std::istream& Node::read(std::istream& stream)
    return stream;
 }
 
+std::istream& Node::skip(std::istream& stream)
+{
+   int i;
+   for (i = 0; i < 32; i++) {
+      Bin::skip(stream);
+   }
+
+   for (i = 0; i < 32; i++) {
+      unsigned int size;
+      stream.read( (char *) &size, sizeof(size) );
+      stream.seekg( std::streamoff(size) * std::streamoff(sizeof(PixelRef)), std::ios::cur );
+   }
+
+   return stream;
+}
+
 std::ostream& Node::write(std::ostream& stream)
 {
    int i;
@@ -305,67 +292,6 @@ void Bin::make(const PixelRefVector& pixels, char dir)
 
 ///////////////////////////////////////////////////////////////////////////////////////
 
-void Bin::extractUnseen(PixelRefVector& pixels, PointMap *pointdata, int binmark)
-{
-   for (auto pixVec: m_pixel_vecs) {
-      for (PixelRef pix = pixVec.start(); pix.col(m_dir) <= pixVec.end().col(m_dir); ) {
-         Point& pt = pointdata->getPoint(pix);
-         if (pointdata->getPoint(pix).m_misc == 0) {
-            pixels.push_back(pix);
-            pointdata->getPoint(pix).m_misc |= binmark;
-         }
-         // 10.2.02 revised --- diagonal was breaking this as it was extent in diagonal or horizontal
-         if (!(m_dir & PixelRef::DIAGONAL)) {
-            if (pt.m_extent.col(m_dir) >= pixVec.end().col(m_dir))
-               break;
-            pt.m_extent.col(m_dir) = pixVec.end().col(m_dir);
-         }
-         pix.move(m_dir);
-      }
-   }
-}
-
-///////////////////////////////////////////////////////////////////////////////////////
-
-void Bin::extractMetric(std::set<MetricTriple>& pixels, PointMap *pointdata, const MetricTriple& curs)
-{
-   for (auto pixVec: m_pixel_vecs) {
-      for (PixelRef pix = pixVec.start(); pix.col(m_dir) <= pixVec.end().col(m_dir); ) {
-         Point& pt = pointdata->getPoint(pix);
-         if (pt.m_misc == 0 && 
-            (pt.m_dist == -1.0 || (curs.dist + dist(pix,curs.pixel) < pt.m_dist))) {
-            pt.m_dist = curs.dist + (float) dist(pix,curs.pixel);
-            // n.b. dmap v4.06r now sets angle in range 0 to 4 (1 = 90 degrees)
-            pt.m_cumangle = pointdata->getPoint(curs.pixel).m_cumangle + (curs.lastpixel == NoPixel ? 0.0f : (float) (angle(pix,curs.pixel,curs.lastpixel) / (M_PI * 0.5)));
-            pixels.insert(MetricTriple(pt.m_dist, pix, curs.pixel));
-         }
-         pix.move(m_dir);
-      }
-   }
-}
-
-// based on metric
-
-void Bin::extractAngular(std::set<AngularTriple>& pixels, PointMap *pointdata, const AngularTriple& curs)
-{
-   for (auto pixVec: m_pixel_vecs) {
-      for (PixelRef pix = pixVec.start(); pix.col(m_dir) <= pixVec.end().col(m_dir); ) {
-         Point& pt = pointdata->getPoint(pix);
-         if (pt.m_misc == 0) {
-            // n.b. dmap v4.06r now sets angle in range 0 to 4 (1 = 90 degrees)
-            float ang = (curs.lastpixel == NoPixel) ? 0.0f : (float) (angle(pix,curs.pixel,curs.lastpixel) / (M_PI * 0.5));
-            if (pt.m_cumangle == -1.0 || curs.angle + ang < pt.m_cumangle) {
-               pt.m_cumangle = pointdata->getPoint(curs.pixel).m_cumangle + ang;
-               pixels.insert(AngularTriple(pt.m_cumangle, pix, curs.pixel));
-            }
-         }
-         pix.move(m_dir);
-      }
-   }
-}
-
-///////////////////////////////////////////////////////////////////////////////////////
-
 bool Bin::containsPoint(const PixelRef p) const
 {
    for (auto pixVec: m_pixel_vecs) {
@@ -415,6 +341,20 @@ PixelRef Bin::cursor() const
    return (int) m_curpix;
 }
 
+PixelRef Bin::pixel(int index) const
+{
+   size_t vec = 0;
+   PixelRef pix = m_pixel_vecs[vec].m_start;
+   for (; index > 0; index--) {
+      if (pix.move(m_dir).col(m_dir) > m_pixel_vecs[vec].end().col(m_dir)) {
+         vec++;
+         if (vec < m_pixel_vecs.size())
+            pix = m_pixel_vecs[vec].m_start;
+      }
+   }
+   return pix;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////
 
 std::istream& Bin::read(std::istream& stream)
@@ -444,6 +384,35 @@ std::istream& Bin::read(std::istream& stream)
    return stream;
 }
 
+std::istream& Bin::skip(std::istream& stream)
+{
+   char dir;
+   unsigned short node_count;
+   stream.read( (char *) &dir, sizeof(dir) );
+   stream.read( (char *) &node_count, sizeof(node_count) );
+
+   // distance and occ_distance
+   std::streamoff skipped = 2 * sizeof(float);
+
+   if (node_count) {
+      // the first pixel vec is a start pixel and a run length
+      std::streamoff first = sizeof(PixelRef) + sizeof(unsigned short);
+      if (dir & PixelRef::DIAGONAL) {
+         skipped += first;
+      }
+      else {
+         unsigned short length;
+         stream.seekg( skipped, std::ios::cur );
+         stream.read( (char *) &length, sizeof(length) );
+         // the others are a short and a packed shift and run length each (see PixelVec::write)
+         skipped = first + std::streamoff(length - 1) * std::streamoff(sizeof(short) + sizeof(unsigned short));
+      }
+   }
+   stream.seekg( skipped, std::ios::cur );
+
+   return stream;
+}
+
 std::ostream& Bin::write(std::ostream& stream)
 {
    stream.write( (char *) &m_dir, sizeof(m_dir) );
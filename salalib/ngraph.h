@@ -21,12 +21,12 @@
 
 #include "salalib/pixelref.h"
 
+#include "genlib/radixheap.h"
+
 #include <set>
 
 class PointMap;
 struct MetricPair;
-struct MetricTriple;
-struct AngularTriple;
 
 struct PixelVec
 {
@@ -59,9 +59,6 @@ public:
    { m_dir = PixelRef::NODIR; m_node_count = 0; m_distance = 0.0f; m_occ_distance = 0.0f; }
    //
    void make(const PixelRefVector& pixels, char m_dir);
-   void extractUnseen(PixelRefVector& pixels, PointMap *pointdata, int binmark);
-   void extractMetric(std::set<MetricTriple> &pixels, PointMap *pointdata, const MetricTriple& curs);
-   void extractAngular(std::set<AngularTriple> &pixels, PointMap *pointdata, const AngularTriple& curs);
    //
    int count() const 
    { return m_node_count; }
@@ -85,9 +82,13 @@ public:
    void next() const;
    bool is_tail() const;
    PixelRef cursor() const;
+   // where the cursor would be after first() and index calls to next(), without moving it
+   PixelRef pixel(int index) const;
    //
    std::istream &read(std::istream &stream);
    std::ostream &write(std::ostream &stream);
+   // moves the stream past a bin without reading it in
+   static std::istream &skip(std::istream &stream);
    //
    friend std::ostream& operator << (std::ostream& stream, const Bin& bin);
 };
@@ -103,9 +104,6 @@ public:
 public:
    // Note: this function clears the bins as it goes
    void make(const PixelRef pix, PixelRefVector *bins, float *bin_far_dists, int q_octants);
-   void extractUnseen(PixelRefVector& pixels, PointMap *pointdata);
-   void extractMetric(std::set<MetricTriple> &pixels, PointMap *pointdata, const MetricTriple& curs);
-   void extractAngular(std::set<AngularTriple> &pixels, PointMap *pointdata, const AngularTriple& curs);
    bool concaveConnected();
    bool fullyConnected();
    //
@@ -141,9 +139,13 @@ public:
    void next() const;
    bool is_tail() const;
    PixelRef cursor() const;
+   // where the cursor would be after first() and index calls to next(), without moving it
+   PixelRef pixel(int index) const;
    //
    std::istream &read(std::istream &stream);
    std::ostream &write(std::ostream &stream);
+   // moves the stream past a node without reading it in
+   static std::istream &skip(std::istream &stream);
    //
    friend std::ostream& operator << (std::ostream& stream, const Node& node);
 };
@@ -20,15 +20,125 @@
 #include "dxfp.h"
 
 #include "genlib/comm.h"  // for communicator
-#include "genlib/stringutils.h"
+#include "genlib/memorymappedfile.h"
+#include "genlib/parallel.h"
 
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iterator>
 #include <string>
+#include <string_view>
 
 static int counter = 0;
 
+// Tokens are read straight from the buffer of the stream, and numbers without the locale
+// lookups and copies of std::stoi and std::stod, which take most of the time on large files
+
+// parses a group code as std::stoi does, false if there is no number
+static bool parseCode( const char *begin, const char *end, int& code )
+{
+   while (begin != end && isspace(static_cast<unsigned char>(*begin))) {
+      begin++;
+   }
+   if (end - begin > 1 && begin[0] == '+' && begin[1] != '-') {
+      begin++;
+   }
+   return std::from_chars(begin, end, code).ec == std::errc();
+}
+
+// std::from_chars takes neither leading space nor a plus sign nor hexadecimal, the
+// last is left to std::stod, as are any errors
+static double toDouble( const std::string& text )
+{
+#ifdef __cpp_lib_to_chars
+   const char *begin = text.c_str();
+   const char *end = begin + text.size();
+   while (begin != end && isspace(static_cast<unsigned char>(*begin))) {
+      begin++;
+   }
+   if (end - begin > 1 && begin[0] == '+' && begin[1] != '-') {
+      begin++;
+   }
+   double value;
+   std::from_chars_result result = std::from_chars(begin, end, value);
+   if (result.ec == std::errc() && (result.ptr == end || (*result.ptr != 'x' && *result.ptr != 'X'))) {
+      return value;
+   }
+#endif
+   return std::stod(text);
+}
+
+// reads a line without its line end into text, as std::getline does
+static void readLine( std::istream& stream, std::string& text )
+{
+   text.clear();
+   std::streambuf *buffer = stream.rdbuf();
+   while (true) {
+      std::streambuf::int_type c = buffer->sbumpc();
+      if (c == std::streambuf::traits_type::eof()) {
+         stream.setstate( text.empty() ? std::ios::eofbit | std::ios::failbit : std::ios::eofbit );
+         return;
+      }
+      if (c == '\n') {
+         return;
+      }
+      text.push_back( static_cast<char>(c) );
+   }
+}
+
+// the end of the line starting at pos (the size of the data for the last line)
+static size_t lineEnd( const char *data, size_t size, size_t pos )
+{
+   const char *end = static_cast<const char *>(memchr( data + pos, '\n', size - pos ));
+   return end == NULL ? size : size_t(end - data);
+}
+
+static std::string_view trimCarriageReturns( std::string_view text )
+{
+   while (!text.empty() && text.front() == '\r') {
+      text.remove_prefix(1);
+   }
+   while (!text.empty() && text.back() == '\r') {
+      text.remove_suffix(1);
+   }
+   return text;
+}
+
+namespace {
+   const char PART_END[] = "  0\nENDSEC\n";
+
+   // A part of the entities section followed by the end of the section, for it to be
+   // read on its own by openEntities
+   class DxfPartBuf : public std::streambuf
+   {
+      bool m_ended = false;
+   public:
+      DxfPartBuf( const char *data, size_t size )
+      {
+         // the get area is never written to, streambuf only wants a char *
+         char *begin = const_cast<char *>(data);
+         setg(begin, begin, begin + size);
+      }
+   protected:
+      int_type underflow() override
+      {
+         if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+         }
+         if (m_ended) {
+            return traits_type::eof();
+         }
+         m_ended = true;
+         char *end = const_cast<char *>(PART_END);
+         setg(end, end, end + sizeof(PART_END) - 1);
+         return traits_type::to_int_type(*gptr());
+      }
+   };
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 bool operator > (const DxfTableRow& a, const DxfTableRow& b)  // for hash table
@@ -53,6 +163,10 @@ DxfParser::DxfParser(Communicator *comm /* = NULL */)
    m_communicator = comm;
    m_size = 0;
    m_time = 0;
+   m_data = NULL;
+   m_data_size = 0;
+   m_threads = 1;
+   m_parent = NULL;
 }
 
 const DxfVertex& DxfParser::getExtMin() const
@@ -77,9 +191,7 @@ DxfLayer *DxfParser::getLayer( const std::string& layer_name ) // const <- remov
 
 DxfLineType *DxfParser::getLineType( const std::string& line_type_name )  // const <- removed as m_layers may be changed if DXF is poor
 {
-   static DxfLineType line_type;
-
-   line_type.m_name = line_type_name;
+   DxfLineType line_type( line_type_name );
 
    std::map<std::string, DxfLineType>::iterator lineTypeIter = m_line_types.find(line_type_name);
    if (lineTypeIter == m_line_types.end()) {
@@ -89,6 +201,36 @@ DxfLineType *DxfParser::getLineType( const std::string& line_type_name )  // con
    return &(lineTypeIter->second);
 }
 
+// the parsers of the parts of the entities section look blocks up in the parser of the whole file
+
+DxfBlock *DxfParser::findBlock( const std::string& block_name )
+{
+   DxfParser *parser = m_parent ? m_parent : this;
+   std::map<std::string, DxfBlock>::iterator blockIter = parser->m_blocks.find(block_name);
+   if (blockIter == parser->m_blocks.end()) {
+      return NULL;
+   }
+   return &(blockIter->second);
+}
+
+// inserts within blocks are otherwise flattened the first time the block is inserted,
+// flattening them all first leaves the blocks untouched while the entities are read
+
+void DxfParser::unwindBlocks()
+{
+   for (auto& block : m_blocks) {
+      block.second.unwindInserts( this );
+   }
+}
+
+// the parsers of the parts share the blocks of the whole file between threads, so they only
+// ever read them
+
+bool DxfParser::blocksUnwound() const
+{
+   return m_parent != NULL;
+}
+
 size_t DxfParser::numLayers() const
 {
    return m_layers.size();
@@ -168,7 +310,12 @@ std::istream& DxfParser::open( std::istream& stream )
             section = UNIDENTIFIED;
             break;
          case ENTITIES:
-            openEntities( stream, token ); // I'm adding the token here as before the function was unsafe, but I'm not sure reuse of this token is a good idea AT 29-APR-11
+            if (m_data != NULL && depthmapX::resolveThreadCount(m_threads) > 1) {
+               openEntitiesInParallel( stream );
+            }
+            else {
+               openEntities( stream, token ); // I'm adding the token here as before the function was unsafe, but I'm not sure reuse of this token is a good idea AT 29-APR-11
+            }
             section = UNIDENTIFIED;
             break;
          default:
@@ -201,6 +348,21 @@ std::istream& DxfParser::open( std::istream& stream )
    return stream;
 }
 
+void DxfParser::open( const char *data, size_t size, int threads )
+{
+   depthmapX::MemoryStreamBuf buffer( data, size );
+   std::istream stream( &buffer );
+
+   m_data = data;
+   m_data_size = size;
+   m_threads = threads;
+
+   stream >> *this;
+
+   m_data = NULL;
+   m_data_size = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 void DxfParser::openHeader( std::istream& stream )
@@ -653,6 +815,86 @@ void DxfParser::openEntities( std::istream& stream, DxfToken& token, DxfBlock *b
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// The entities section is cut into parts at the start of entities (but not at the vertices
+// or the end of a polyline, which belong to it) and every part is read by a parser of its
+// own. The layers of the parts are then appended in order, so that each layer holds its
+// entities in the order they are in the file, just as when the section is read in one go
+
+void DxfParser::openEntitiesInParallel( std::istream& stream )
+{
+   const size_t PART_SIZE = 1 << 20;
+
+   std::streamoff start = stream.tellg();
+
+   std::vector<size_t> parts;
+   size_t section_end = 0;
+   size_t value_end = 0;
+   bool ended = false;
+   if (start >= 0) {
+      parts.push_back( size_t(start) );
+      size_t pos = size_t(start);
+      while (pos < m_data_size) {
+         size_t code_end = lineEnd( m_data, m_data_size, pos );
+         if (code_end == m_data_size) {
+            break;
+         }
+         value_end = lineEnd( m_data, m_data_size, code_end + 1 );
+         int code;
+         if (parseCode( m_data + pos, m_data + code_end, code ) && code == 0) {
+            std::string_view value = trimCarriageReturns(
+               std::string_view( m_data + code_end + 1, value_end - code_end - 1 ) );
+            if (value == "ENDSEC" || value == "ENDBLK") {
+               section_end = pos;
+               ended = true;
+               break;
+            }
+            if (pos - parts.back() >= PART_SIZE && value != "VERTEX" && value != "SEQEND") {
+               parts.push_back( pos );
+            }
+         }
+         pos = value_end + 1;
+      }
+   }
+   if (!ended) {
+      // leave a section that runs off the end of the file to be read as it always was
+      DxfToken token;
+      openEntities( stream, token );
+      return;
+   }
+   parts.push_back( section_end );
+
+   unwindBlocks();
+
+   std::vector<DxfParser> part_parsers( parts.size() - 1 );
+   depthmapX::parallelFor( NULL, part_parsers.size(), m_threads, [&](int, size_t part) {
+      if (m_communicator && m_communicator->IsCancelled()) {
+         throw Communicator::CancelledException();
+      }
+      DxfParser& parser = part_parsers[part];
+      parser.m_parent = this;
+      DxfPartBuf buffer( m_data + parts[part], parts[part + 1] - parts[part] );
+      std::istream part_stream( &buffer );
+      DxfToken token;
+      parser.openEntities( part_stream, token );
+   });
+
+   for (DxfParser& parser : part_parsers) {
+      m_line_types.insert( parser.m_line_types.begin(), parser.m_line_types.end() );
+      for (auto& layer : parser.m_layers) {
+         getLayer( layer.first )->append( layer.second );
+      }
+      m_size += parser.m_size;
+   }
+
+   // carry on after the end of the section
+   stream.seekg( std::streamoff(std::min( value_end + 1, m_data_size )) );
+   if (value_end == m_data_size) {
+      stream.setstate( std::ios::eofbit );
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 // Individual parsing of the types
 
 DxfTableRow::DxfTableRow(const std::string& name)
@@ -682,6 +924,8 @@ bool DxfTableRow::parse( const DxfToken& token, DxfParser * )
 DxfEntity::DxfEntity(int tag)
 {
    m_tag = tag;
+   m_p_line_type = NULL;
+   m_p_layer = NULL;
 }
 
 void DxfEntity::clear()
@@ -746,13 +990,13 @@ bool DxfVertex::parse( const DxfToken& token, DxfParser *parser )
 
    switch (token.code) {
       case 10:
-         x = std::stod(token.data);
+         x = toDouble(token.data);
          break;
       case 20:
-         y = std::stod(token.data);
+         y = toDouble(token.data);
          break;
       case 30:
-         z = std::stod(token.data);
+         z = toDouble(token.data);
          break;
       case 0: case 9:   // 0 is standard vertex, 9 is for header section variables
          parsed = true;
@@ -782,22 +1026,22 @@ bool DxfLine::parse( const DxfToken& token, DxfParser *parser )
 
    switch (token.code) {
       case 10:
-         m_start.x = std::stod(token.data);
+         m_start.x = toDouble(token.data);
          break;
       case 20:
-         m_start.y = std::stod(token.data);
+         m_start.y = toDouble(token.data);
          break;
       case 30:
-         m_start.z = std::stod(token.data);
+         m_start.z = toDouble(token.data);
          break;
       case 11:
-         m_end.x = std::stod(token.data);
+         m_end.x = toDouble(token.data);
          break;
       case 21:
-         m_end.y = std::stod(token.data);
+         m_end.y = toDouble(token.data);
          break;
       case 31:
-         m_end.z = std::stod(token.data);
+         m_end.z = toDouble(token.data);
          break;
       case 0:
          add(m_start);  // <- add to region
@@ -832,7 +1076,8 @@ bool DxfPolyLine::parse( const DxfToken& token, DxfParser *parser )
 {
    bool parsed = false;
 
-   static DxfVertex vertex;
+   // kept per thread for the parts of the entities section read in parallel
+   thread_local static DxfVertex vertex;
 
    if (m_vertex_count) {
       if ( vertex.parse( token, parser ) ) {
@@ -902,7 +1147,7 @@ bool DxfLwPolyLine::parse( const DxfToken& token, DxfParser *parser )
 {
    bool parsed = false;
 
-   static DxfVertex vertex;
+   thread_local static DxfVertex vertex;
 
    switch (token.code) {
       case 0:
@@ -961,22 +1206,22 @@ bool DxfArc::parse( const DxfToken& token, DxfParser *parser )
 
    switch (token.code) {
       case 10:
-         m_centre.x = std::stod(token.data);
+         m_centre.x = toDouble(token.data);
          break;
       case 20:
-         m_centre.y = std::stod(token.data);
+         m_centre.y = toDouble(token.data);
          break;
       case 30:
-         m_centre.z = std::stod(token.data);
+         m_centre.z = toDouble(token.data);
          break;
       case 40:
-         m_radius = std::stod(token.data);
+         m_radius = toDouble(token.data);
          break;
       case 50:
-         m_start = std::stod(token.data);
+         m_start = toDouble(token.data);
          break;
       case 51:
-         m_end = std::stod(token.data);
+         m_end = toDouble(token.data);
          break;
       case 0:
          {
@@ -1071,40 +1316,40 @@ bool DxfEllipse::parse( const DxfToken& token, DxfParser *parser )
 
    switch (token.code) {
       case 10:
-         m_centre.x = std::stod(token.data);
+         m_centre.x = toDouble(token.data);
          break;
       case 20:
-         m_centre.y = std::stod(token.data);
+         m_centre.y = toDouble(token.data);
          break;
       case 30:
-         m_centre.z = std::stod(token.data);
+         m_centre.z = toDouble(token.data);
          break;
       case 11:
-         m_majorAxisEndPoint.x = std::stod(token.data);
+         m_majorAxisEndPoint.x = toDouble(token.data);
          break;
       case 21:
-         m_majorAxisEndPoint.y = std::stod(token.data);
+         m_majorAxisEndPoint.y = toDouble(token.data);
          break;
       case 31:
-         m_majorAxisEndPoint.z = std::stod(token.data);
+         m_majorAxisEndPoint.z = toDouble(token.data);
          break;
       case 210:
-         m_extrusionDirection.x = std::stod(token.data);
+         m_extrusionDirection.x = toDouble(token.data);
          break;
       case 220:
-         m_extrusionDirection.y = std::stod(token.data);
+         m_extrusionDirection.y = toDouble(token.data);
          break;
       case 230:
-         m_extrusionDirection.z = std::stod(token.data);
+         m_extrusionDirection.z = toDouble(token.data);
          break;
       case 40:
-         m_minorMajorAxisRatio = std::stod(token.data);
+         m_minorMajorAxisRatio = toDouble(token.data);
          break;
       case 41:
-         m_start = std::stod(token.data);
+         m_start = toDouble(token.data);
          break;
       case 42:
-         m_end = std::stod(token.data);
+         m_end = toDouble(token.data);
          break;
       case 0:
          {
@@ -1207,16 +1452,16 @@ bool DxfCircle::parse( const DxfToken& token, DxfParser *parser )
 
    switch (token.code) {
       case 10:
-         m_centre.x = std::stod(token.data);
+         m_centre.x = toDouble(token.data);
          break;
       case 20:
-         m_centre.y = std::stod(token.data);
+         m_centre.y = toDouble(token.data);
          break;
       case 30:
-         m_centre.z = std::stod(token.data);
+         m_centre.z = toDouble(token.data);
          break;
       case 40:
-         m_radius = std::stod(token.data);
+         m_radius = toDouble(token.data);
          break;
       case 0:
          {
@@ -1286,7 +1531,7 @@ bool DxfSpline::parse( const DxfToken& token, DxfParser *parser )
 {
    bool parsed = false;
 
-   static DxfVertex vertex;
+   thread_local static DxfVertex vertex;
 
    switch (token.code) {
       case 0:
@@ -1302,17 +1547,17 @@ bool DxfSpline::parse( const DxfToken& token, DxfParser *parser )
          m_ctrl_pt_count = std::stoi(token.data);
          break;
       case 40:
-         m_knots.push_back( std::stod(token.data) );
+         m_knots.push_back( toDouble(token.data) );
       case 10:
-         vertex.x = std::stod(token.data);
+         vertex.x = toDouble(token.data);
          m_xyz |= 0x0001;
          break;
       case 20:
-         vertex.y = std::stod(token.data);
+         vertex.y = toDouble(token.data);
          m_xyz |= 0x0010;
          break;
       case 30:
-         vertex.z = std::stod(token.data);
+         vertex.z = toDouble(token.data);
          m_xyz |= 0x0100;
          break;
       default:
@@ -1384,25 +1629,25 @@ bool DxfInsert::parse( const DxfToken& token, DxfParser *parser )
          m_blockName = token.data;
          break;
       case 10:
-         m_translation.x = std::stod(token.data);
+         m_translation.x = toDouble(token.data);
          break;
       case 20:
-         m_translation.y = std::stod(token.data);
+         m_translation.y = toDouble(token.data);
          break;
       case 30:
-         m_translation.z = std::stod(token.data);
+         m_translation.z = toDouble(token.data);
          break;
       case 41:
-         m_scale.x = std::stod(token.data);
+         m_scale.x = toDouble(token.data);
          break;
       case 42:
-         m_scale.y = std::stod(token.data);
+         m_scale.y = toDouble(token.data);
          break;
       case 43:
-         m_scale.z = std::stod(token.data);
+         m_scale.z = toDouble(token.data);
          break;
       case 50:
-         m_rotation = std::stod(token.data);
+         m_rotation = toDouble(token.data);
          break;
       default:
          DxfEntity::parse( token, parser ); // base class parse
@@ -1545,18 +1790,17 @@ void DxfLayer::insert(DxfInsert& insert, DxfParser *parser)
    }
 
    // lookup in blocks table
-   if (!parser->m_blocks.count(insert.m_blockName)) {
-       // throw exception
+   DxfBlock *found = parser->findBlock(insert.m_blockName);
+   if (found == NULL || found == this) {
+       // nothing to add for a missing block, and a block cannot hold itself
+       return;
    }
-   DxfBlock &block = parser->m_blocks[insert.m_blockName];
+   DxfBlock &block = *found;
 
-   // unwind deeper inserts
-   for(i = 0; i < block.m_inserts.size(); i++) {
-       block.insert( block.m_inserts[i], parser);
+   // unwind deeper inserts, unless that was done before the entities were read in parallel
+   if (!parser->blocksUnwound()) {
+      block.unwindInserts(parser);
    }
-   // delete inserts at this level to avoid re-inserting them
-   // if the block is re-inserted
-   block.m_inserts.clear();
 
    for (i = 0; i < block.m_lines.size(); i++) {
       m_lines.push_back(block.m_lines[i]);
@@ -1623,6 +1867,41 @@ void DxfLayer::insert(DxfInsert& insert, DxfParser *parser)
    m_total_line_count += block.m_total_line_count;
 }
 
+void DxfLayer::unwindInserts(DxfParser *parser)
+{
+   // take the inserts at this level out first to avoid re-inserting them
+   // if the block is re-inserted
+   std::vector<DxfInsert> inserts;
+   inserts.swap(m_inserts);
+   for (auto& insert_at : inserts) {
+      insert(insert_at, parser);
+   }
+}
+
+template <typename T>
+static void moveAppend(std::vector<T>& to, std::vector<T>& from)
+{
+   to.insert(to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.end()));
+   from.clear();
+}
+
+void DxfLayer::append(DxfLayer& layer)
+{
+   moveAppend(m_points, layer.m_points);
+   moveAppend(m_lines, layer.m_lines);
+   moveAppend(m_poly_lines, layer.m_poly_lines);
+   moveAppend(m_arcs, layer.m_arcs);
+   moveAppend(m_ellipses, layer.m_ellipses);
+   moveAppend(m_circles, layer.m_circles);
+   moveAppend(m_splines, layer.m_splines);
+   moveAppend(m_inserts, layer.m_inserts);
+   if (!layer.empty()) {
+      DxfRegion::merge(layer); // <- merge bounding box
+   }
+   m_total_point_count += layer.m_total_point_count;
+   m_total_line_count += layer.m_total_line_count;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 DxfBlock::DxfBlock(const std::string& name) : DxfLayer( name )
@@ -1654,15 +1933,16 @@ DxfToken::DxfToken()
 std::istream& operator >> (std::istream& stream, DxfToken& token)
 {
     std::string codeInputLine;
-    std::getline(stream,codeInputLine);
-    token.code = std::stoi(codeInputLine);
-    std::string dataInputLine;
-    std::getline(stream,dataInputLine);
-    dXstring::ltrim(dataInputLine,'\r');
-    dXstring::ltrim(dataInputLine,'\n');
-    dXstring::rtrim(dataInputLine,'\r');
-    dXstring::rtrim(dataInputLine,'\n');
-    token.data = dataInputLine;
+    readLine(stream,codeInputLine);
+    if (!parseCode(codeInputLine.data(), codeInputLine.data() + codeInputLine.size(), token.code)) {
+        throw std::invalid_argument("DXF group code expected, found: " + codeInputLine);
+    }
+    // the data is read into the token to reuse its space
+    readLine(stream,token.data);
+    std::string_view data = trimCarriageReturns(token.data);
+    if (data.size() != token.data.size()) {
+        token.data = std::string(data);
+    }
     token.size = codeInputLine.length() + token.data.length() + 2;   // might be missing a few end line characters --- never mind
     return stream;
 }
@@ -27,6 +27,7 @@
 
 #include <math.h>
 #include <map>
+#include <string>
 #include <vector>
 
 class DxfToken;
@@ -541,6 +542,10 @@ public:
    //
    // this merges an insert (so the insert remains flattened)
    void insert(DxfInsert& insert, DxfParser *parser);
+   // flattens the inserts held back while the layer (a block) was read
+   void unwindInserts(DxfParser *parser);
+   // moves the contents of another layer onto the end of this one
+   void append(DxfLayer& layer);
 protected:
    bool parse( const DxfToken& token, DxfParser *parser );
 };
@@ -582,27 +587,41 @@ protected:
    //
    size_t m_size;
    Communicator *m_communicator;
+   //
+   // the file when it is read from memory, so that the entities can be parsed in parallel
+   const char *m_data;
+   size_t m_data_size;
+   int m_threads;
+   // the parser holding the blocks, for the parsers of the parts of the entities section
+   DxfParser *m_parent;
 public:
    DxfParser(Communicator *comm = NULL);
    //
    std::istream& open( std::istream& stream );
+   // reads a file held in memory (e.g. a MemoryMappedFile), where with more than one
+   // thread (0 for all cores) the entities section is parsed in parallel
+   void open( const char *data, size_t size, int threads = 1 );
    //
    void openHeader( std::istream& stream );
    void openTables( std::istream& stream );
    void openBlocks( std::istream& stream );
    void openEntities( std::istream& stream, DxfToken& token, DxfBlock *block = NULL ); // cannot have a default token: it's a reference.  Removed default to DxfToken() AT 29.04.11
+   void openEntitiesInParallel( std::istream& stream );
    //
    const DxfVertex& getExtMin() const;
    const DxfVertex& getExtMax() const;
    DxfLayer *getLayer( const std::string& layer_name ); // const; <- removed as will have to add layer when DXF hasn't declared one
    DxfLineType *getLineType( const std::string& line_type_name ); // const;
+   DxfBlock *findBlock( const std::string& block_name );
+   void unwindBlocks();
+   bool blocksUnwound() const;
    //
    size_t numLayers() const;
    size_t numLineTypes() const;
    //
    friend std::istream& operator >> (std::istream& stream, DxfParser& dxfp);
 
-   std::map<std::string, DxfLayer> getLayers() { return m_layers; }
+   const std::map<std::string, DxfLayer>& getLayers() const { return m_layers; }
 };
 
 ///////////////////////////////////////////////////////////////////////////////
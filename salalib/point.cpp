@@ -22,7 +22,7 @@ float Point::getBinDistance(int i)
    return m_node->bindistance(i);
 }
 
-std::istream& Point::read(std::istream& stream)
+std::istream& Point::read(std::istream& stream, bool skipNode)
 {
    stream.read( (char *) &m_state, sizeof(m_state) );
    // block is the same size as m_noderef used to be for ease of replacement:
@@ -38,7 +38,10 @@ std::istream& Point::read(std::istream& stream)
    stream.read( (char *) &m_merge, sizeof(m_merge) );
    bool ngraph;
    stream.read( (char *) &ngraph, sizeof(ngraph) );
-   if (ngraph) {
+   if (ngraph && skipNode) {
+       Node::skip(stream);
+   }
+   else if (ngraph) {
        m_node = std::unique_ptr<Node>(new Node());
        m_node->read(stream);
    }
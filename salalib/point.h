@@ -23,7 +23,6 @@
 #include <memory>
 
 class Point {
-   friend class Bin;
    friend class PointMap;
    friend class MetaGraph; // <- for file conversion routines
    friend class PafAgent;
@@ -40,28 +39,26 @@ public:
    enum { CONNECT_E = 0x01, CONNECT_NE = 0x02, CONNECT_N = 0x04, CONNECT_NW = 0x08,
           CONNECT_W = 0x10, CONNECT_SW = 0x20, CONNECT_S = 0x40, CONNECT_SE = 0x80 };
 
-   // TODO: These intermediary variables are only used for storing arbitrary data during the
-   // analysis. They should be made into local variables and removed from this class
-   int m_misc;              // <- undocounter / point seen register / agent reference number, etc
-   float m_dist;            // used to speed up metric analysis
-   float m_cumangle;        // cummulative angle -- used in metric analysis and angular analysis
-   PixelRef m_extent;       // used to speed up graph analysis (not sure whether or not it breaks it!)
+   int m_misc;              // <- undocounter / tag used when making the graph
 
 protected:
-   int m_block;   // not used, unlikely to be used, but kept for time being
+   // the state the analyses look at for every point is kept together at the front,
+   // the search state of an analysis is kept by the analysis itself (see the VGA modules)
+   // rather than on the points, so that several analyses can read the same map
    int m_state;
    char m_grid_connections; // this is a standard set of grid connections, with bits set for E,NE,N,NW,W,SW,S,SE
+   PixelRef m_merge;        // to merge with another point
    std::unique_ptr<Node> m_node;            // graph links
    Point2f m_location;      // note: this is large, but it helps allow loading of non-standard grid points,
                             // whilst allowing them to be displayed as a visibility graph, also speeds up time to
                             // display
+   int m_processflag;
+   int m_block;   // not used, unlikely to be used, but kept for time being
    float m_color;           // although display color for the point now introduced
-   PixelRef m_merge;        // to merge with another point
    // hmm... this is for my 3rd attempt at a quick line intersect algo:
    // every line that goes through the gridsquare -- memory intensive I know, but what can you do:
    // accuracy is imperative here!  Calculated pre-fillpoints / pre-makegraph, and (importantly) it works.
    std::vector<Line> m_lines;
-   int m_processflag;
 public:
    Point()
       { m_state = EMPTY; m_block = 0; m_misc = 0; m_grid_connections = 0; m_node = nullptr; m_processflag = 0; m_merge = NoPixel; m_user_data = NULL; }
@@ -76,9 +73,6 @@ public:
        m_color = p.m_color;
        m_merge = p.m_merge;
        m_color = p.m_color;
-       m_extent = p.m_extent;
-       m_dist = p.m_dist;
-       m_cumangle = p.m_cumangle;
        m_lines = p.m_lines;
        m_processflag = p.m_processflag;
        return *this;
@@ -94,9 +88,6 @@ public:
        m_color = p.m_color;
        m_merge = p.m_merge;
        m_color = p.m_color;
-       m_extent = p.m_extent;
-       m_dist = p.m_dist;
-       m_cumangle = p.m_cumangle;
        m_lines = p.m_lines;
        m_processflag = p.m_processflag;
    }
@@ -151,7 +142,7 @@ public:
    //   { return m_block & 0x06600660; }
    int getState()
       { return m_state; }
-   int getMisc()  // used as: undocounter, in graph construction, and an agent reference, as well as for making axial maps
+   int getMisc()  // used as: undocounter and in graph construction
       { return m_misc; }
    void setMisc(int misc)
       { m_misc = misc; }
@@ -170,7 +161,8 @@ public:
        return m_location;
    }
 public:
-   std::istream &read(std::istream &stream);
+   // skipNode leaves the point without its visibility graph node, the stream is moved past it
+   std::istream &read(std::istream &stream, bool skipNode = false);
    std::ostream& write(std::ostream &stream);
    //
 protected:
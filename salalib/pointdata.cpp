@@ -32,6 +32,7 @@
 #include "genlib/comm.h"  // for communicator
 #include "genlib/stringutils.h"
 #include "genlib/containerutils.h"
+#include "genlib/parallel.h"
 
 #include <math.h>
 #include <unordered_set>
@@ -1070,7 +1071,7 @@ bool PointMap::blockedAdjacent( const PixelRef p ) const
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool PointMap::read(std::istream& stream )
+bool PointMap::read(std::istream& stream, bool skipGraph )
 {
    m_name = dXstring::readString(stream);
 
@@ -1105,7 +1106,7 @@ bool PointMap::read(std::istream& stream )
    
    for (size_t j = 0; j < m_cols; j++) {
       for (size_t k = 0; k < m_rows; k++) {
-         m_points(k, j).read(stream);
+         m_points(k, j).read(stream, skipGraph);
 
          // check if occdistance of any pixel's bin is set, meaning that
          // the isovist analysis was done
@@ -1243,7 +1244,7 @@ int PointMap::tagState(bool settag)
 // Then wouldn't have to 'test twice' for the grid point being blocked...
 // ...perhaps a tweak for a later date!
 
-bool PointMap::sparkGraph2( Communicator *comm, bool boundarygraph, double maxdist )
+bool PointMap::sparkGraph2( Communicator *comm, bool boundarygraph, double maxdist, int threads )
 {
    // Note, graph must be fixed (i.e., having blocking pixels filled in)
 
@@ -1280,7 +1281,8 @@ bool PointMap::sparkGraph2( Communicator *comm, bool boundarygraph, double maxdi
       comm->CommPostMessage( Communicator::NUM_RECORDS, count );
    }
 
-   count = 0;
+   std::vector<PixelRef> cells;
+   cells.reserve(count);
 
    for (size_t i = 0; i < m_cols; i++) {
 
@@ -1292,32 +1294,42 @@ bool PointMap::sparkGraph2( Communicator *comm, bool boundarygraph, double maxdi
 
             getPoint( curs ).m_node = std::unique_ptr<Node>(new Node());
             m_attributes->addRow( AttributeKey(curs) );
-
-            sparkPixel2(curs,1,maxdist); // make flag of 1 suggests make this node, don't set reciprocral process flags on those you can see
-                                         // maxdist controls how far to see out to
-
-            count++;    // <- increment count
-
-            if (comm) {
-               if (qtimer( atime, 500 )) {
-                  if (comm->IsCancelled()) {
-                     tagState( false );         // <- the state field has been used for tagging visited nodes... set back to a state variable
-                     // (well, actually, no it hasn't!)
-                     // Should clear all nodes and attributes here:
-                     // Clear nodes
-                     // Clear attributes
-                     m_attributes->clear();
-                     m_displayed_attribute = -2;
-                     //
-                     throw Communicator::CancelledException();
-                  }
-                  comm->CommPostMessage( Communicator::CURRENT_RECORD, count );
-               }         
-            } // if (comm)
+            cells.push_back(curs);
          } // if ( getPoint( curs ).getState() & Point::FILLED )
       } // rows
    } // cols
 
+   // each pixel only writes to its own point, and the attributes are set afterwards
+   // in order, so that the column stats come out the same with any number of threads
+   std::vector<SparkStats> stats(cells.size());
+   try {
+      depthmapX::parallelForWithScratch(comm, cells.size(), threads,
+            []() { return std::vector<std::vector<PixelRef> >(32); },
+            [&](std::vector<std::vector<PixelRef> >& bins, size_t item) {
+         // make flag of 1 suggests make this node, don't set reciprocral process flags on those you can see
+         // maxdist controls how far to see out to
+         stats[item] = sparkNode(cells[item], 1, maxdist, bins.data());
+      });
+   }
+   catch (Communicator::CancelledException&) {
+      tagState( false );         // <- the state field has been used for tagging visited nodes... set back to a state variable
+      // (well, actually, no it hasn't!)
+      // Should clear all nodes and attributes here:
+      // Clear nodes
+      // Clear attributes
+      m_attributes->clear();
+      m_displayed_attribute = -2;
+      //
+      throw;
+   }
+
+   for (size_t item = 0; item < cells.size(); item++) {
+      AttributeRow& row = m_attributes->getRow( AttributeKey(cells[item]) );
+      row.setValue( "Connectivity", float(stats[item].neighbourhood_size) );
+      row.setValue( "Point First Moment", float(stats[item].total_dist) );
+      row.setValue( "Point Second Moment", float(stats[item].total_dist_sqr) );
+   }
+
    tagState( false );  // <- the state field has been used for tagging visited nodes... set back to a state variable
 
    // keeping lines blocked now is wasteful of memory... free the memory involved
@@ -1380,7 +1392,21 @@ bool PointMap::unmake(bool removeLinks) {
 bool PointMap::sparkPixel2(PixelRef curs, int make, double maxdist)
 {
    static std::vector<PixelRef> bins_b[32];
-   static float far_bin_dists[32];
+   SparkStats stats = sparkNode(curs, make, maxdist, bins_b);
+
+   if (make & 1) {
+      AttributeRow& row = m_attributes->getRow( AttributeKey(curs) );
+      row.setValue( "Connectivity", float(stats.neighbourhood_size) );
+      row.setValue( "Point First Moment", float(stats.total_dist) );
+      row.setValue( "Point Second Moment", float(stats.total_dist_sqr) );
+   }
+
+   return true;
+}
+
+PointMap::SparkStats PointMap::sparkNode(PixelRef curs, int make, double maxdist, std::vector<PixelRef> *bins_b)
+{
+   float far_bin_dists[32];
    for (int i = 0; i < 32; i++) {
       far_bin_dists[i] = 0.0f;
    }
@@ -1491,10 +1517,6 @@ bool PointMap::sparkPixel2(PixelRef curs, int make, double maxdist)
       // The bins are cleared in the make function!
       Point& pt = getPoint( curs );
       pt.m_node->make(curs, bins_b, far_bin_dists, pt.m_processflag);   // note: make clears bins!
-      AttributeRow& row = m_attributes->getRow( AttributeKey(curs) );
-      row.setValue( "Connectivity", float(neighbourhood_size) );
-      row.setValue( "Point First Moment", float(total_dist) );
-      row.setValue( "Point Second Moment", float(total_dist_sqr) );
    }
    else {
       // Clear bins by hand if not using them to make
@@ -1506,7 +1528,11 @@ bool PointMap::sparkPixel2(PixelRef curs, int make, double maxdist)
    // reset process flag
    getPoint(curs).m_processflag = 0;
 
-   return true;
+   SparkStats stats;
+   stats.neighbourhood_size = neighbourhood_size;
+   stats.total_dist = total_dist;
+   stats.total_dist_sqr = total_dist_sqr;
+   return stats;
 }
 
 bool PointMap::sieve2(sparkSieve2& sieve, std::vector<PixelRef>& addlist, int q, int depth, PixelRef curs)
@@ -168,9 +168,18 @@ public:
    void outputPoints(std::ostream& stream, char delim );
    void outputMergeLines(std::ostream& stream, char delim);
    int  tagState(bool settag);
-   bool sparkGraph2(Communicator *comm, bool boundarygraph, double maxdist );
+   // threads: number of pixels to spark concurrently (0 to use all available cores)
+   bool sparkGraph2(Communicator *comm, bool boundarygraph, double maxdist, int threads = 1 );
    bool unmake(bool removeLinks);
    bool sparkPixel2(PixelRef curs, int make, double maxdist = -1.0);
+   struct SparkStats {
+      int neighbourhood_size = 0;
+      double total_dist = 0.0;
+      double total_dist_sqr = 0.0;
+   };
+   // sparkPixel2 without setting the attributes, using the 32 scratch bins passed in,
+   // so that pixels can be sparked on several threads at once (make = 1 only)
+   SparkStats sparkNode(PixelRef curs, int make, double maxdist, std::vector<PixelRef> *bins_b);
    bool sieve2(sparkSieve2& sieve, std::vector<PixelRef>& addlist, int q, int depth, PixelRef curs);
    // bool makeGraph( Graph& graph, int optimization_level = 0, Communicator *comm = NULL);
    //
@@ -341,7 +350,9 @@ public:
    // this is an odd helper function, value in range 0 to 1
    PixelRef pickPixel(double value) const;
 public:
-   bool read(std::istream &stream);
+   // skipGraph reads the points and their attributes but not the visibility graph, so that
+   // the map can only be exported or displayed afterwards
+   bool read(std::istream &stream, bool skipGraph = false);
    bool write(std::ostream &stream);
    void addGridConnections(); // adds grid connections where graph does not include them
    void outputConnectionsAsCSV(std::ostream &myout, std::string delim = ",");
@@ -397,6 +408,9 @@ inline bool operator > (const MetricTriple& mp1, const MetricTriple& mp2)
 { return (mp1.dist > mp2.dist) || (mp1.dist == mp2.dist && mp1.pixel > mp2.pixel); }
 inline bool operator != (const MetricTriple& mp1, const MetricTriple& mp2)
 { return (mp1.dist != mp2.dist) || (mp1.pixel != mp2.pixel); }
+// priority for depthmapX::RadixHeap
+inline float queueKey(const MetricTriple& mp)
+{ return mp.dist; }
 
 // Note: angular triple simply based on metric triple
 
@@ -423,6 +437,9 @@ inline bool operator > (const AngularTriple& mp1, const AngularTriple& mp2)
 { return (mp1.angle > mp2.angle) || (mp1.angle == mp2.angle && mp1.pixel > mp2.pixel); }
 inline bool operator != (const AngularTriple& mp1, const AngularTriple& mp2)
 { return (mp1.angle != mp2.angle) || (mp1.pixel != mp2.pixel); }
+// priority for depthmapX::RadixHeap
+inline float queueKey(const AngularTriple& mp)
+{ return mp.angle; }
 
 // true grads are also similar to generated grads...
 // this scruffy helper function converts a true grad to a bin:
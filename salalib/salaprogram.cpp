@@ -1645,8 +1645,7 @@ SalaObj SalaCommand::connections(SalaObj graphobj, SalaObj param)
       }
    }
    else {
-      int idx = std::distance(graphobj.data.graph.map.shape->getAllShapes().begin(),
-                                graphobj.data.graph.map.shape->getAllShapes().find(graphobj.data.graph.node));
+      int idx = graphobj.data.graph.map.shape->getIndexFromShapeRef(graphobj.data.graph.node);
       const Connector& connector = graphobj.data.graph.map.shape->getConnections()[idx];
       int mode = Connector::CONN_ALL;
       if (graphobj.data.graph.map.shape->isSegmentMap()) {
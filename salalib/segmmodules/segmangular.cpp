@@ -72,9 +72,13 @@ bool SegmentAngular::run(Communicator *comm, ShapeGraph &map, bool) {
         total_col.push_back(attributes.getColumnIndex(total_col_text.c_str()));
     }
 
+    // the rows are filled in by position and written column by column at the end
+    std::vector<AttributeColumnValues> depthValues(radii.size(), AttributeColumnValues(attributes.getNumRows())),
+        countValues(radii.size(), AttributeColumnValues(attributes.getNumRows())),
+        totalValues(radii.size(), AttributeColumnValues(attributes.getNumRows()));
+
     std::vector<bool> covered(map.getShapeCount());
-    size_t i = 0;
-    for (auto & iter : attributes){
+    for (size_t i = 0; i < attributes.getNumRows(); i++) {
         for (size_t j = 0; j < map.getShapeCount(); j++) {
             covered[j] = false;
         }
@@ -134,22 +138,21 @@ bool SegmentAngular::run(Communicator *comm, ShapeGraph &map, bool) {
                 anglebins.erase(iter);
             }
         }
-        AttributeRow &row = iter.getRow();
         // set the attributes for this node:
         int curs_node_count = 0;
         double curs_total_depth = 0.0;
         for (size_t r = 0; r < radii.size(); r++) {
             curs_node_count += node_count[r];
             curs_total_depth += total_depth[r];
-            row.setValue(count_col[r], float(curs_node_count));
+            countValues[r].setValue(i, float(curs_node_count));
             if (curs_node_count > 1) {
                 // note -- node_count includes this one -- mean depth as per p.108 Social Logic of Space
                 double mean_depth = curs_total_depth / double(curs_node_count - 1);
-                row.setValue(depth_col[r], float(mean_depth));
-                row.setValue(total_col[r], float(curs_total_depth));
+                depthValues[r].setValue(i, float(mean_depth));
+                totalValues[r].setValue(i, float(curs_total_depth));
             } else {
-                row.setValue(depth_col[r], -1);
-                row.setValue(total_col[r], -1);
+                depthValues[r].setValue(i, -1);
+                totalValues[r].setValue(i, -1);
             }
         }
         //
@@ -161,7 +164,12 @@ bool SegmentAngular::run(Communicator *comm, ShapeGraph &map, bool) {
                 comm->CommPostMessage(Communicator::CURRENT_RECORD, i);
             }
         }
-        i++;
+    }
+
+    for (size_t r = 0; r < radii.size(); r++) {
+        attributes.setColumnValues(count_col[r], countValues[r]);
+        attributes.setColumnValues(depth_col[r], depthValues[r]);
+        attributes.setColumnValues(total_col[r], totalValues[r]);
     }
 
     map.setDisplayedAttribute(-2); // <- override if it's already showing
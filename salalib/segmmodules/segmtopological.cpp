@@ -49,50 +49,91 @@ bool SegmentTopological::run(Communicator *comm, ShapeGraph &map, bool) {
         }
     }
 
-    std::string prefix, suffix;
+    // note: radius must be sorted lowest to highest, but if -1 occurs ("radius n") it needs to be last...
+    // ...to ensure no mess ups, we'll re-sort here:
+    bool radius_n = false;
+    std::vector<double> radii;
+    for (double radius : m_radius_set) {
+        if (radius == -1.0) {
+            radius_n = true;
+        } else {
+            radii.push_back(radius);
+        }
+    }
+    if (radius_n) {
+        radii.push_back(-1.0);
+    }
+    size_t radiussize = radii.size();
+
+    // the columns are entered in the same order as running each radius in turn would enter them
+    std::string prefix;
     int maxbin;
     prefix = "Topological ";
     maxbin = 2;
-    if (m_radius != -1.0) {
-        suffix = dXstring::formatString(m_radius, " R%.f metric");
+
+    std::vector<int> choice_col(radiussize), w_choice_col(radiussize), mean_depth_col(radiussize),
+        w_mean_depth_col(radiussize), total_depth_col(radiussize), total_col(radiussize), w_total_col(radiussize);
+    for (double radius : m_radius_set) {
+        std::string suffix;
+        if (radius != -1.0) {
+            suffix = dXstring::formatString(radius, " R%.f metric");
+        }
+        size_t r = std::find(radii.begin(), radii.end(), radius) - radii.begin();
+        if (!m_sel_only) {
+            choice_col[r] = attributes.insertOrResetColumn(prefix + "Choice" + suffix);
+            w_choice_col[r] = attributes.insertOrResetColumn(prefix + "Choice [SLW]" + suffix);
+        }
+        mean_depth_col[r] = attributes.insertOrResetColumn(prefix + "Mean Depth" + suffix);
+        w_mean_depth_col[r] = attributes.insertOrResetColumn(prefix + std::string("Mean Depth [SLW]") + suffix);
+        total_depth_col[r] = attributes.insertOrResetColumn(prefix + "Total Depth" + suffix);
+        total_col[r] = attributes.insertOrResetColumn(prefix + "Total Nodes" + suffix);
+        w_total_col[r] = attributes.insertOrResetColumn(prefix + "Total Length" + suffix);
     }
-    std::string choicecol = prefix + "Choice" + suffix;
-    std::string wchoicecol = prefix + "Choice [SLW]" + suffix;
-    std::string meandepthcol = prefix + "Mean Depth" + suffix;
-    std::string wmeandepthcol = prefix + std::string("Mean Depth [SLW]") + suffix;
-    std::string totaldcol = prefix + "Total Depth" + suffix;
-    std::string totalcol = prefix + "Total Nodes" + suffix;
-    std::string wtotalcol = prefix + "Total Length" + suffix;
-    //
-    if (!m_sel_only) {
-        attributes.insertOrResetColumn(choicecol.c_str());
-        attributes.insertOrResetColumn(wchoicecol.c_str());
+
+    // All the radii share one search. A topological step can lead beyond a small radius
+    // while a longer way round stays inside it, so each radius keeps its own seen and audit
+    // trail and every queued segment carries the radii it still has to be expanded for, as
+    // in the tulip analysis. Each radius then sees exactly what a search of its own would.
+    unsigned int radiusmask = 0;
+    for (size_t r = 0; r < radiussize; r++) {
+        radiusmask |= (1 << r);
     }
-    attributes.insertOrResetColumn(meandepthcol.c_str());
-    attributes.insertOrResetColumn(wmeandepthcol.c_str());
-    attributes.insertOrResetColumn(totaldcol.c_str());
-    attributes.insertOrResetColumn(totalcol.c_str());
-    attributes.insertOrResetColumn(wtotalcol.c_str());
     //
-    std::vector<unsigned int> seen(map.getShapeCount());
-    std::vector<TopoMetSegmentRef> audittrail(map.getShapeCount());
-    std::vector<TopoMetSegmentChoice> choicevals(map.getShapeCount());
+    std::vector<unsigned int> seen(map.getShapeCount() * radiussize);
+    std::vector<TopoMetSegmentRef> audittrail(map.getShapeCount() * radiussize);
+    std::vector<TopoMetSegmentChoice> choicevals(map.getShapeCount() * radiussize);
+    std::vector<double> total(radiussize), wtotal(radiussize), wtotaldepth(radiussize), totalsegdepth(radiussize),
+        totalmetdepth(radiussize);
+    // the rows are filled in by shape index and written column by column at the end
+    size_t rowCount = attributes.getNumRows();
+    std::vector<AttributeColumnValues> meanDepthValues(radiussize, AttributeColumnValues(rowCount)),
+        totalDepthValues(radiussize, AttributeColumnValues(rowCount)),
+        wMeanDepthValues(radiussize, AttributeColumnValues(rowCount)),
+        totalValues(radiussize, AttributeColumnValues(rowCount)),
+        wTotalValues(radiussize, AttributeColumnValues(rowCount));
     for (size_t cursor = 0; cursor < map.getShapeCount(); cursor++) {
         AttributeRow& row = map.getAttributeRowFromShapeIndex(cursor);
         if (m_sel_only && !row.isSelected()) {
             continue;
         }
-        for (size_t i = 0; i < map.getShapeCount(); i++) {
+        for (size_t i = 0; i < seen.size(); i++) {
             seen[i] = 0xffffffff;
         }
-        std::vector<int> list[512]; // 512 bins!
+        std::vector<std::pair<int, unsigned int>> list[512]; // 512 bins!
         int bin = 0;
-        list[bin].push_back(cursor);
+        list[bin].push_back(std::make_pair(int(cursor), radiusmask));
         double rootseglength = seglengths[cursor];
-        audittrail[cursor] = TopoMetSegmentRef(cursor, Connector::SEG_CONN_ALL, rootseglength * 0.5, -1);
+        for (size_t r = 0; r < radiussize; r++) {
+            audittrail[cursor * radiussize + r] =
+                TopoMetSegmentRef(cursor, Connector::SEG_CONN_ALL, rootseglength * 0.5, -1);
+        }
         int open = 1;
         unsigned int segdepth = 0;
-        double total = 0.0, wtotal = 0.0, wtotaldepth = 0.0, totalsegdepth = 0.0, totalmetdepth = 0.0;
+        std::fill(total.begin(), total.end(), 0.0);
+        std::fill(wtotal.begin(), wtotal.end(), 0.0);
+        std::fill(wtotaldepth.begin(), wtotaldepth.end(), 0.0);
+        std::fill(totalsegdepth.begin(), totalsegdepth.end(), 0.0);
+        std::fill(totalmetdepth.begin(), totalmetdepth.end(), 0.0);
         while (open != 0) {
             while (list[bin].size() == 0) {
                 bin++;
@@ -102,25 +143,36 @@ bool SegmentTopological::run(Communicator *comm, ShapeGraph &map, bool) {
                 }
             }
             //
-            TopoMetSegmentRef &here = audittrail[list[bin].back()];
+            int ref = list[bin].back().first;
+            unsigned int coverage = list[bin].back().second;
             list[bin].pop_back();
             open--;
             //
-            if (here.done) {
+            double len = seglengths[ref];
+            for (size_t r = 0; r < radiussize; r++) {
+                if (((coverage >> r) & 0x1) == 0) {
+                    continue;
+                }
+                TopoMetSegmentRef &here = audittrail[ref * radiussize + r];
+                if (here.done) {
+                    coverage &= ~(1 << r);
+                    continue;
+                } else {
+                    here.done = true;
+                }
+                //
+                totalsegdepth[r] += segdepth;
+                totalmetdepth[r] += here.dist - len * 0.5; // preloaded with length ahead
+                wtotal[r] += len;
+                wtotaldepth[r] += len * segdepth;
+
+                total[r] += 1;
+            }
+            if (coverage == 0) {
                 continue;
-            } else {
-                here.done = true;
             }
             //
-            double len = seglengths[here.ref];
-            totalsegdepth += segdepth;
-            totalmetdepth += here.dist - len * 0.5; // preloaded with length ahead
-            wtotal += len;
-            wtotaldepth += len * segdepth;
-
-            total += 1;
-            //
-            Connector &axline = map.getConnections().at(here.ref);
+            Connector &axline = map.getConnections().at(ref);
             int connected_cursor = -2;
 
             auto iter = axline.m_back_segconns.begin();
@@ -137,40 +189,52 @@ bool SegmentTopological::run(Communicator *comm, ShapeGraph &map, bool) {
 
                 connected_cursor = iter->first.ref;
 
-                if (seen[connected_cursor] > segdepth && static_cast<size_t>(connected_cursor) != cursor) {
-                    bool seenalready = (seen[connected_cursor] == 0xffffffff) ? false : true;
+                if (static_cast<size_t>(connected_cursor) != cursor) {
                     float length = seglengths[connected_cursor];
                     int axialref = axialrefs[connected_cursor];
-                    audittrail[connected_cursor] =
-                        TopoMetSegmentRef(connected_cursor, here.dir, here.dist + length, here.ref);
-                    seen[connected_cursor] = segdepth;
-                    if (m_radius == -1 || here.dist + length < m_radius) {
-                        // puts in a suitable bin ahead of us...
-                        open++;
-                        //
-                        if (axialrefs[here.ref] == axialref) {
-                            list[bin].push_back(connected_cursor);
-                        } else {
-                            list[(bin + 1) % 2].push_back(connected_cursor);
-                            seen[connected_cursor] =
-                                segdepth + 1; // this is so if another node is connected directly to this one but
-                                              // is found later it is still handled -- note it can result in the
-                                              // connected cursor being added twice
+                    bool samebin = axialrefs[ref] == axialref;
+                    unsigned int pushed = 0;
+                    for (size_t r = 0; r < radiussize; r++) {
+                        size_t c = connected_cursor * radiussize + r;
+                        if (((coverage >> r) & 0x1) == 0 || seen[c] <= segdepth) {
+                            continue;
+                        }
+                        TopoMetSegmentRef &here = audittrail[ref * radiussize + r];
+                        bool seenalready = (seen[c] == 0xffffffff) ? false : true;
+                        audittrail[c] = TopoMetSegmentRef(connected_cursor, here.dir, here.dist + length, ref);
+                        seen[c] = segdepth;
+                        if (radii[r] == -1 || here.dist + length < radii[r]) {
+                            // puts in a suitable bin ahead of us...
+                            pushed |= (1 << r);
+                            //
+                            if (!samebin) {
+                                seen[c] = segdepth + 1; // this is so if another node is connected directly to this one
+                                                        // but is found later it is still handled -- note it can result
+                                                        // in the connected cursor being added twice
+                            }
+                        }
+                        // not sure why this is outside the radius restriction
+                        // (sel_only: with restricted selection set, not all lines will be labelled)
+                        // (seenalready: need to check that we're not doing this twice, given the seen can go twice)
+
+                        // Quick mod - TV
+                        if (!m_sel_only && connected_cursor > int(cursor) &&
+                            !seenalready) { // only one way paths, saves doing this twice
+                            int subcur = connected_cursor;
+                            while (subcur != -1) {
+                                // in this method of choice, start and end lines are included
+                                choicevals[subcur * radiussize + r].choice += 1;
+                                choicevals[subcur * radiussize + r].wchoice += (rootseglength * length);
+                                subcur = audittrail[subcur * radiussize + r].previous;
+                            }
                         }
                     }
-                    // not sure why this is outside the radius restriction
-                    // (sel_only: with restricted selection set, not all lines will be labelled)
-                    // (seenalready: need to check that we're not doing this twice, given the seen can go twice)
-
-                    // Quick mod - TV
-                    if (!m_sel_only && connected_cursor > int(cursor) &&
-                        !seenalready) { // only one way paths, saves doing this twice
-                        int subcur = connected_cursor;
-                        while (subcur != -1) {
-                            // in this method of choice, start and end lines are included
-                            choicevals[subcur].choice += 1;
-                            choicevals[subcur].wchoice += (rootseglength * length);
-                            subcur = audittrail[subcur].previous;
+                    if (pushed != 0) {
+                        open++;
+                        if (samebin) {
+                            list[bin].push_back(std::make_pair(connected_cursor, pushed));
+                        } else {
+                            list[(bin + 1) % 2].push_back(std::make_pair(connected_cursor, pushed));
                         }
                     }
                 }
@@ -178,11 +242,13 @@ bool SegmentTopological::run(Communicator *comm, ShapeGraph &map, bool) {
             }
         }
         // also put in mean depth:
-        row.setValue(meandepthcol.c_str(), totalsegdepth / (total - 1));
-        row.setValue(totaldcol.c_str(), totalsegdepth);
-        row.setValue(wmeandepthcol.c_str(), wtotaldepth / (wtotal - rootseglength));
-        row.setValue(totalcol.c_str(), total);
-        row.setValue(wtotalcol.c_str(), wtotal);
+        for (size_t r = 0; r < radiussize; r++) {
+            meanDepthValues[r].setValue(cursor, totalsegdepth[r] / (total[r] - 1));
+            totalDepthValues[r].setValue(cursor, totalsegdepth[r]);
+            wMeanDepthValues[r].setValue(cursor, wtotaldepth[r] / (wtotal[r] - rootseglength));
+            totalValues[r].setValue(cursor, total[r]);
+            wTotalValues[r].setValue(cursor, wtotal[r]);
+        }
         //
         if (comm) {
             if (qtimer(atime, 500)) {
@@ -194,19 +260,32 @@ bool SegmentTopological::run(Communicator *comm, ShapeGraph &map, bool) {
         }
         reccount++;
     }
+    for (size_t r = 0; r < radiussize; r++) {
+        attributes.setColumnValues(mean_depth_col[r], meanDepthValues[r]);
+        attributes.setColumnValues(total_depth_col[r], totalDepthValues[r]);
+        attributes.setColumnValues(w_mean_depth_col[r], wMeanDepthValues[r]);
+        attributes.setColumnValues(total_col[r], totalValues[r]);
+        attributes.setColumnValues(w_total_col[r], wTotalValues[r]);
+    }
     if (!m_sel_only) {
         // note, I've stopped sel only from calculating choice values:
-        for (size_t cursor = 0; cursor < map.getShapeCount(); cursor++) {
-            AttributeRow& row = map.getAttributeRowFromShapeIndex(cursor);
-            row.setValue(choicecol.c_str(), choicevals[cursor].choice);
-            row.setValue(wchoicecol.c_str(), choicevals[cursor].wchoice);
+        std::vector<float> choice(map.getShapeCount()), wchoice(map.getShapeCount());
+        for (size_t r = 0; r < radiussize; r++) {
+            for (size_t cursor = 0; cursor < map.getShapeCount(); cursor++) {
+                choice[cursor] = choicevals[cursor * radiussize + r].choice;
+                wchoice[cursor] = choicevals[cursor * radiussize + r].wchoice;
+            }
+            attributes.setColumnValues(choice_col[r], choice);
+            attributes.setColumnValues(w_choice_col[r], wchoice);
         }
     }
 
+    // as when running each radius in turn, the last radius entered is displayed
+    size_t lastradius = std::find(radii.begin(), radii.end(), *m_radius_set.rbegin()) - radii.begin();
     if (!m_sel_only) {
-        map.setDisplayedAttribute(attributes.getColumnIndex(choicecol.c_str()));
+        map.setDisplayedAttribute(choice_col[lastradius]);
     } else {
-        map.setDisplayedAttribute(attributes.getColumnIndex(meandepthcol.c_str()));
+        map.setDisplayedAttribute(mean_depth_col[lastradius]);
     }
 
     return retvar;
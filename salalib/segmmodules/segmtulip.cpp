@@ -18,8 +18,11 @@
 
 #include "salalib/segmmodules/segmtulip.h"
 
+#include "genlib/parallel.h"
 #include "genlib/stringutils.h"
 
+#include <mutex>
+
 bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
 
     if (map.getMapType() != ShapeMap::SEGMENTMAP) {
@@ -303,20 +306,8 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
     tulip_bins /= 2; // <- actually use semicircle of tulip bins
     tulip_bins += 1;
 
-    std::vector<std::vector<SegmentData>> bins(tulip_bins);
-
-    // TODO: Replace these with STL
-    AnalysisInfo ***audittrail;
-    unsigned int **uncovered;
-    audittrail = new AnalysisInfo **[map.getConnections().size()];
-    uncovered = new unsigned int *[map.getConnections().size()];
-    for (size_t i = 0; i < map.getConnections().size(); i++) {
-        audittrail[i] = new AnalysisInfo *[radius_unconverted.size()];
-        for (size_t j = 0; j < radius_unconverted.size(); j++) {
-            audittrail[i][j] = new AnalysisInfo[2];
-        }
-        uncovered[i] = new unsigned int[2];
-    }
+    size_t connectionCount = map.getConnections().size();
+
     std::vector<double> radius;
     for (r = 0; r < radius_unconverted.size(); r++) {
         if (m_radius_type == Options::RADIUS_ANGULAR && radius_unconverted[r] != -1) {
@@ -329,7 +320,7 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
     int length_col = attributes.getColumnIndex("Segment Length");
     std::vector<float> lengths;
     if (length_col != -1) {
-        for (size_t i = 0; i < map.getConnections().size(); i++) {
+        for (size_t i = 0; i < connectionCount; i++) {
             AttributeRow& row = map.getAttributeRowFromShapeIndex(i);
             lengths.push_back(row.getValue(length_col));
         }
@@ -341,10 +332,11 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
         radiusmask |= (1 << i);
     }
 
-    for (size_t cursor = 0; cursor < map.getConnections().size(); cursor++) {
-        AttributeRow &row =
-            map.getAttributeRowFromShapeIndex(cursor);
-
+    std::vector<AttributeRow *> rows;
+    std::vector<size_t> origins;
+    for (size_t cursor = 0; cursor < connectionCount; cursor++) {
+        AttributeRow &row = map.getAttributeRowFromShapeIndex(cursor);
+        rows.push_back(&row);
         if (m_sel_only) {
             // could use m_selection_set.searchindex(rowid) to find
             // if this row is selected as m_selection_set is ordered for axial and segment maps, etc
@@ -353,20 +345,80 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                 continue;
             }
         }
+        origins.push_back(cursor);
+    }
+
+    // the audit trail and coverage of a segment, for each radius and each direction
+    auto trailIndex = [radiussize](int ref, int k, int dir) {
+        return (static_cast<size_t>(ref) * radiussize + k) * 2 + dir;
+    };
+
+    // Choice is added up over all the origins. With more than one thread each origin
+    // logs what it adds to the totals and the logs are added in origin order when the
+    // origin is committed, so that the weighted sums come out exactly as in one thread.
+    struct Choice {
+        double choice = 0.0;
+        double weighted_choice = 0.0;
+        double weighted_choice2 = 0.0;
+        void add(const Choice &other) {
+            choice += other.choice;
+            weighted_choice += other.weighted_choice;
+            weighted_choice2 += other.weighted_choice2;
+        }
+    };
+    struct OriginResult {
+        std::vector<std::pair<size_t, Choice>> choices;
+    };
+
+    int threads = depthmapX::resolveThreadCount(m_threads);
+    bool logChoice = m_choice && threads > 1;
+    std::vector<Choice> choiceTotals(m_choice ? connectionCount * radiussize * 2 : 0);
+    std::vector<SearchState> states(static_cast<size_t>(threads));
+    std::vector<OriginResult> results(origins.size());
+
+    // each origin only sets its own row of these, and they are written to the table
+    // column by column at the end, which updates the column stats in row order
+    std::vector<AttributeColumnValues> columnValues(attributes.getNumColumns());
+    for (const std::vector<int> *cols : {&count_col, &integ_col, &w_integ_col, &td_col, &w_td_col, &total_weight_col}) {
+        for (int col : *cols) {
+            columnValues[col] = AttributeColumnValues(connectionCount);
+        }
+    }
+
+    auto analyse = [&](int worker, size_t item) {
+        size_t cursor = origins[item];
+        SearchState &state = states[static_cast<size_t>(worker)];
+        if (state.audittrail.empty()) {
+            state.bins.resize(static_cast<size_t>(tulip_bins));
+            state.audittrail.resize(connectionCount * radiussize * 2);
+            state.uncovered.resize(connectionCount * 2);
+        }
+        std::vector<std::vector<SegmentData>> &bins = state.bins;
+        std::vector<AnalysisInfo> &audittrail = state.audittrail;
+        std::vector<unsigned int> &uncovered = state.uncovered;
+        OriginResult &result = results[item];
+        auto setValue = [&columnValues, cursor](int col, float value) { columnValues[col].setValue(cursor, value); };
+        auto addChoice = [&](size_t index, double choice, double weighted_choice, double weighted_choice2) {
+            Choice addition;
+            addition.choice = choice;
+            addition.weighted_choice = weighted_choice;
+            addition.weighted_choice2 = weighted_choice2;
+            if (logChoice) {
+                result.choices.emplace_back(index, addition);
+            } else {
+                choiceTotals[index].add(addition);
+            }
+        };
 
         for (int k = 0; k < tulip_bins; k++) {
             bins[k].clear();
         }
-        for (size_t j = 0; j < map.getConnections().size(); j++) {
-            for (int dir = 0; dir < 2; dir++) {
-                for (int k = 0; k < radiussize; k++) {
-                    audittrail[j][k][dir].clearLine();
-                }
-                uncovered[j][dir] = radiusmask;
-            }
+        for (auto &info : audittrail) {
+            info.clearLine();
         }
+        std::fill(uncovered.begin(), uncovered.end(), radiusmask);
 
-        double rootseglength = row.getValue(length_col);
+        double rootseglength = rows[cursor]->getValue(length_col);
         double rootweight = (m_weighted_measure_col != -1) ? weights[cursor] : 0.0;
 
         // setup: direction 0 (both ways), segment i, previous -1, segdepth (step depth) 0, metricdepth 0.5 *
@@ -397,28 +449,28 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
 
             int ref = lineindex.ref;
             int dir = (lineindex.dir == 1) ? 0 : 1;
-            int coverage = lineindex.coverage & uncovered[ref][dir];
+            int coverage = lineindex.coverage & uncovered[ref * 2 + dir];
             if (coverage != 0) {
                 int rbin = 0;
                 int rbinbase;
                 if (lineindex.previous.ref != -1) {
-                    uncovered[ref][dir] &= ~coverage;
+                    uncovered[ref * 2 + dir] &= ~coverage;
                     while (((coverage >> rbin) & 0x1) == 0)
                         rbin++;
                     rbinbase = rbin;
                     while (rbin < radiussize) {
                         if (((coverage >> rbin) & 0x1) == 1) {
-                            audittrail[ref][rbin][dir].depth = depthlevel;
-                            audittrail[ref][rbin][dir].previous = lineindex.previous;
-                            audittrail[lineindex.previous.ref][rbin][(lineindex.previous.dir == 1) ? 0 : 1].leaf =
-                                false;
+                            audittrail[trailIndex(ref, rbin, dir)].depth = depthlevel;
+                            audittrail[trailIndex(ref, rbin, dir)].previous = lineindex.previous;
+                            audittrail[trailIndex(lineindex.previous.ref, rbin, (lineindex.previous.dir == 1) ? 0 : 1)]
+                                .leaf = false;
                         }
                         rbin++;
                     }
                 } else {
                     rbinbase = 0;
-                    uncovered[ref][0] &= ~coverage;
-                    uncovered[ref][1] &= ~coverage;
+                    uncovered[ref * 2] &= ~coverage;
+                    uncovered[ref * 2 + 1] &= ~coverage;
                 }
                 Connector &line = map.getConnections()[ref];
                 float seglength;
@@ -427,7 +479,7 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                     for (auto &segconn : line.m_forward_segconns) {
                         rbin = rbinbase;
                         SegmentRef conn = segconn.first;
-                        if ((uncovered[conn.ref][(conn.dir == 1 ? 0 : 1)] & coverage) != 0) {
+                        if ((uncovered[conn.ref * 2 + (conn.dir == 1 ? 0 : 1)] & coverage) != 0) {
                             // EF routeweight*
                             if (routeweight_col != -1) { // EF here we do the weighting of the angular cost by the
                                                          // weight of the next segment
@@ -475,7 +527,7 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                     for (auto &segconn : line.m_back_segconns) {
                         rbin = rbinbase;
                         SegmentRef conn = segconn.first;
-                        if ((uncovered[conn.ref][(conn.dir == 1 ? 0 : 1)] & coverage) != 0) {
+                        if ((uncovered[conn.ref * 2 + (conn.dir == 1 ? 0 : 1)] & coverage) != 0) {
                             // EF routeweight*
                             if (routeweight_col != -1) { // EF here we do the weighting of the angular cost by the
                                                          // weight of the next segment
@@ -527,15 +579,15 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
             double curs_node_count = 0.0, curs_total_depth = 0.0;
             double curs_total_weight = 0.0, curs_total_weighted_depth = 0.0;
             size_t j;
-            for (j = 0; j < map.getConnections().size(); j++) {
+            for (j = 0; j < connectionCount; j++) {
                 // find dir according
-                bool m0 = ((uncovered[j][0] >> k) & 0x1) == 0;
-                bool m1 = ((uncovered[j][1] >> k) & 0x1) == 0;
+                bool m0 = ((uncovered[j * 2] >> k) & 0x1) == 0;
+                bool m1 = ((uncovered[j * 2 + 1] >> k) & 0x1) == 0;
                 if ((m0 | m1) != 0) {
                     int dir;
                     if (m0 & m1) {
                         // dir is the one with the lowest depth:
-                        if (audittrail[j][k][0].depth < audittrail[j][k][1].depth)
+                        if (audittrail[trailIndex(j, k, 0)].depth < audittrail[trailIndex(j, k, 1)].depth)
                             dir = 0;
                         else
                             dir = 1;
@@ -544,11 +596,11 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                         dir = m0 ? 0 : 1;
                     }
                     curs_node_count++;
-                    curs_total_depth += audittrail[j][k][dir].depth;
+                    curs_total_depth += audittrail[trailIndex(j, k, dir)].depth;
                     curs_total_weight += weights[j];
-                    curs_total_weighted_depth += audittrail[j][k][dir].depth * weights[j];
+                    curs_total_weighted_depth += audittrail[trailIndex(j, k, dir)].depth * weights[j];
                     //
-                    if (m_choice && audittrail[j][k][dir].leaf) {
+                    if (m_choice && audittrail[trailIndex(j, k, dir)].leaf) {
                         // note, graph may be directed (e.g., for one way streets), so both ways must be included from
                         // now on:
                         SegmentRef here = SegmentRef(dir == 0 ? 1 : -1, j);
@@ -560,17 +612,14 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                             //*EFEF
                             while (here.ref != static_cast<int>(cursor)) { // not rowid means not the current root for the path
                                 int heredir = (here.dir == 1) ? 0 : 1;
+                                size_t hereindex = trailIndex(here.ref, k, heredir);
                                 // each node has the existing choicecount and choiceweight from previously encountered
                                 // nodes added to it
-                                audittrail[here.ref][k][heredir].choice += choicecount;
                                 // nb, weighted values calculated anyway to save time on 'if'
-                                audittrail[here.ref][k][heredir].weighted_choice += choiceweight;
-                                // EFEF*
-                                audittrail[here.ref][k][heredir].weighted_choice2 += choiceweight2;
-                                //*EFEF
+                                addChoice(hereindex, choicecount, choiceweight, choiceweight2);
                                 // if the node hasn't been encountered before, the choicecount and choiceweight is
                                 // incremented for all remaining nodes to be encountered on the backwards route from it
-                                if (!audittrail[here.ref][k][heredir].choicecovered) {
+                                if (!audittrail[hereindex].choicecovered) {
                                     // this node has not been encountered before: this adds the choicecount and weight
                                     // for this node, and flags it as visited
                                     choicecount++;
@@ -579,30 +628,24 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                                     choiceweight2 += weights2[here.ref] * rootweight; // rootweight!
                                     //*EFEF
 
-                                    audittrail[here.ref][k][heredir].choicecovered = true;
+                                    audittrail[hereindex].choicecovered = true;
                                     // note, for weighted choice, the start and end points have choice added to them:
                                     if (m_weighted_measure_col != -1) {
-                                        audittrail[here.ref][k][heredir].weighted_choice +=
-                                            (weights[here.ref] * rootweight) / 2.0;
                                         // EFEF*
-                                        if (weighting_col2 != -1) {
-                                            audittrail[here.ref][k][heredir].weighted_choice2 +=
-                                                (weights2[here.ref] * rootweight) / 2.0; // rootweight!
-                                        }
+                                        addChoice(hereindex, 0.0, (weights[here.ref] * rootweight) / 2.0,
+                                                  weighting_col2 != -1 ? (weights2[here.ref] * rootweight) / 2.0
+                                                                       : 0.0); // rootweight!
                                         //*EFEF
                                     }
                                 }
-                                here = audittrail[here.ref][k][heredir].previous;
+                                here = audittrail[hereindex].previous;
                             }
                             // note, for weighted choice, the start and end points have choice added to them:
                             // (this is the summed weight for all starting nodes encountered in this path)
                             if (m_weighted_measure_col != -1) {
-                                audittrail[here.ref][k][(here.dir == 1) ? 0 : 1].weighted_choice += choiceweight / 2.0;
                                 // EFEF*
-                                if (weighting_col2 != -1) {
-                                    audittrail[here.ref][k][(here.dir == 1) ? 0 : 1].weighted_choice2 +=
-                                        choiceweight2 / 2.0;
-                                }
+                                addChoice(trailIndex(here.ref, k, (here.dir == 1) ? 0 : 1), 0.0, choiceweight / 2.0,
+                                          weighting_col2 != -1 ? choiceweight2 / 2.0 : 0.0);
                                 //*EFEF
                             }
                         }
@@ -612,75 +655,98 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
             double total_depth_conv = curs_total_depth / ((tulip_bins - 1.0f) * 0.5f);
             double total_weighted_depth_conv = curs_total_weighted_depth / ((tulip_bins - 1.0f) * 0.5f);
             //
-            row.setValue(count_col[k], float(curs_node_count));
+            setValue(count_col[k], float(curs_node_count));
             if (curs_node_count > 1) {
                 // for dmap 8 and above, mean depth simply isn't calculated as for radius measures it is meaningless
-                row.setValue(td_col[k], total_depth_conv);
+                setValue(td_col[k], total_depth_conv);
                 if (m_weighted_measure_col != -1) {
-                    row.setValue(total_weight_col[k], float(curs_total_weight));
-                    row.setValue(w_td_col[k], float(total_weighted_depth_conv));
+                    setValue(total_weight_col[k], float(curs_total_weight));
+                    setValue(w_td_col[k], float(total_weighted_depth_conv));
                 }
             } else {
-                row.setValue(td_col[k], -1);
+                setValue(td_col[k], -1);
                 if (m_weighted_measure_col != -1) {
-                    row.setValue(total_weight_col[k], -1.0f);
-                    row.setValue(w_td_col[k], -1.0f);
+                    setValue(total_weight_col[k], -1.0f);
+                    setValue(w_td_col[k], -1.0f);
                 }
             }
             // for dmap 10 an above, integration is included!
             if (total_depth_conv > 1e-9) {
-                row.setValue(integ_col[k], (float)(curs_node_count * curs_node_count / total_depth_conv));
+                setValue(integ_col[k], (float)(curs_node_count * curs_node_count / total_depth_conv));
                 if (m_weighted_measure_col != -1) {
-                    row.setValue(w_integ_col[k],
-                                 (float)(curs_total_weight * curs_total_weight / total_weighted_depth_conv));
+                    setValue(w_integ_col[k], (float)(curs_total_weight * curs_total_weight / total_weighted_depth_conv));
                 }
             } else {
-                row.setValue(integ_col[k], -1);
+                setValue(integ_col[k], -1);
                 if (m_weighted_measure_col != -1) {
-                    row.setValue(w_integ_col[k], -1.0f);
+                    setValue(w_integ_col[k], -1.0f);
                 }
             }
         }
-        //
-        processed_rows++;
-        //
-        if (comm) {
-            if (qtimer(atime, 500)) {
-                if (comm->IsCancelled()) {
-                    // interactive is usual Depthmap: throw an exception if cancelled
-                    if (interactive) {
-                        for (size_t i = 0; i < map.getConnections().size(); i++) {
-                            for (size_t j = 0; j < size_t(radiussize); j++) {
-                                delete[] audittrail[i][j];
-                            }
-                            delete[] audittrail[i];
-                            delete[] uncovered[i];
-                        }
-                        delete[] audittrail;
-                        delete[] uncovered;
-                        throw Communicator::CancelledException();
-                    } else {
-                        // in non-interactive mode, retain what's been processed already
-                        break;
-                    }
-                }
-                comm->CommPostMessage(Communicator::CURRENT_RECORD, cursor);
+    };
+
+    // origins are committed in order as soon as all the ones before them are done, so that
+    // the choice totals are added up as in a single thread
+    std::mutex commitMutex;
+    std::vector<char> done(origins.size(), 0);
+    size_t committed = 0;
+    auto commit = [&](size_t item) {
+        std::lock_guard<std::mutex> lock(commitMutex);
+        done[item] = 1;
+        for (; committed < origins.size() && done[committed]; committed++) {
+            OriginResult &result = results[committed];
+            for (auto &addition : result.choices) {
+                choiceTotals[addition.first].add(addition.second);
             }
+            std::vector<std::pair<size_t, Choice>>().swap(result.choices);
         }
+    };
+
+    try {
+        // the origins are started in order so that few results wait to be committed
+        depthmapX::parallelFor(
+            comm, origins.size(), threads,
+            [&](int worker, size_t item) {
+                analyse(worker, item);
+                commit(item);
+            },
+            depthmapX::Schedule::IN_ORDER);
+    } catch (Communicator::CancelledException &) {
+        // interactive is usual Depthmap: throw an exception if cancelled
+        if (interactive) {
+            throw;
+        }
+        // in non-interactive mode, retain what's been processed already
     }
+    processed_rows = static_cast<int>(committed);
+    for (size_t item = committed; item < origins.size(); item++) {
+        for (auto &values : columnValues) {
+            if (values.size() != 0) {
+                values.clearValue(origins[item]);
+            }
+        }
+    }
+    for (size_t col = 0; col < columnValues.size(); col++) {
+        if (columnValues[col].size() != 0) {
+            attributes.setColumnValues(col, columnValues[col]);
+        }
+    }
+    std::vector<AttributeColumnValues>().swap(columnValues);
+
     if (m_choice) {
-        for (size_t cursor = 0; cursor < map.getConnections().size(); cursor++) {
-            AttributeRow &row =
-                attributes.getRow(AttributeKey(depthmapX::getMapAtIndex(map.getAllShapes(), cursor)->first));
+        std::vector<std::vector<float>> choiceValues(radius.size(), std::vector<float>(connectionCount)),
+            wChoiceValues(radius.size(), std::vector<float>(connectionCount)),
+            wChoiceValues2(radius.size(), std::vector<float>(connectionCount));
+        for (size_t cursor = 0; cursor < connectionCount; cursor++) {
             for (size_t r = 0; r < radius.size(); r++) {
+                const Choice &forward = choiceTotals[trailIndex(cursor, r, 0)];
+                const Choice &backward = choiceTotals[trailIndex(cursor, r, 1)];
                 // according to Eva's correction, total choice and total weighted choice
                 // should already have been accumulated by radius at this stage
-                double total_choice = audittrail[cursor][r][0].choice + audittrail[cursor][r][1].choice;
-                double total_weighted_choice =
-                    audittrail[cursor][r][0].weighted_choice + audittrail[cursor][r][1].weighted_choice;
+                double total_choice = forward.choice + backward.choice;
+                double total_weighted_choice = forward.weighted_choice + backward.weighted_choice;
                 // EFEF*
-                double total_weighted_choice2 =
-                    audittrail[cursor][r][0].weighted_choice2 + audittrail[cursor][r][1].weighted_choice2;
+                double total_weighted_choice2 = forward.weighted_choice2 + backward.weighted_choice2;
                 //*EFEF
 
                 // normalised choice now excluded for two reasons:
@@ -692,27 +758,29 @@ bool SegmentTulip::run(Communicator *comm, ShapeGraph &map, bool) {
                 // implementation
                 //
                 //
-                row.setValue(choice_col[r], float(total_choice));
+                choiceValues[r][cursor] = float(total_choice);
                 if (m_weighted_measure_col != -1) {
-                    row.setValue(w_choice_col[r], float(total_weighted_choice));
+                    wChoiceValues[r][cursor] = float(total_weighted_choice);
                     // EFEF*
                     if (weighting_col2 != -1) {
-                        row.setValue(w_choice_col2[r], float(total_weighted_choice2));
+                        wChoiceValues2[r][cursor] = float(total_weighted_choice2);
                     }
                     //*EFEF
                 }
             }
         }
-    }
-    for (size_t i = 0; i < map.getConnections().size(); i++) {
-        for (int j = 0; j < radiussize; j++) {
-            delete[] audittrail[i][j];
+        for (size_t r = 0; r < radius.size(); r++) {
+            attributes.setColumnValues(choice_col[r], choiceValues[r]);
+            if (m_weighted_measure_col != -1) {
+                attributes.setColumnValues(w_choice_col[r], wChoiceValues[r]);
+                // EFEF*
+                if (weighting_col2 != -1) {
+                    attributes.setColumnValues(w_choice_col2[r], wChoiceValues2[r]);
+                }
+                //*EFEF
+            }
         }
-        delete[] audittrail[i];
-        delete[] uncovered[i];
     }
-    delete[] audittrail;
-    delete[] uncovered;
 
     map.setDisplayedAttribute(-2); // <- override if it's already showing
     if (m_choice) {
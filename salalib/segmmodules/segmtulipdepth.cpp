@@ -41,7 +41,7 @@ bool SegmentTulipDepth::run(Communicator *, ShapeGraph &map, bool) {
 
     int opencount = 0;
     for (auto& sel: map.getSelSet()) {
-       int row = depthmapX::getMapAtIndex(map.getAllShapes(), sel)->first;
+       int row = map.getShapeRefFromIndex(sel)->first;
        if (row != -1) {
           bins[0].push_back(SegmentData(0,row,SegmentRef(),0,0.0,0));
           opencount++;
@@ -25,6 +25,7 @@
 #include "genlib/comm.h" // for communicator
 #include "genlib/containerutils.h"
 #include "genlib/exceptions.h"
+#include "genlib/parallel.h"
 #include "genlib/stringutils.h"
 
 #include <float.h>
@@ -65,7 +66,7 @@ bool SalaShape::read(std::istream &stream) {
     return true;
 }
 
-bool SalaShape::write(std::ofstream &stream) {
+bool SalaShape::write(std::ostream &stream) {
     stream.write((char *)&m_type, sizeof(m_type));
     stream.write((char *)&m_region, sizeof(m_region));
     stream.write((char *)&m_centroid, sizeof(m_centroid));
@@ -128,8 +129,8 @@ double SalaShape::getAngDev() const {
 
 // the replacement for datalayers
 
-ShapeMap::ShapeMap(const std::string &name, int type)
-    : m_pixel_shapes(0, 0), m_attributes(new AttributeTable()),
+ShapeMap::ShapeMap(const std::string &name, int type, int spatialIndex)
+    : m_pixel_shapes(0, 0), m_spatial_index(spatialIndex), m_attributes(new AttributeTable()),
       m_attribHandle(new AttributeTableHandle(*m_attributes)) {
     m_name = name;
     m_map_type = type;
@@ -182,6 +183,7 @@ void ShapeMap::init(int size, const QtRegion &r) {
     m_tolerance = __max(m_region.width(), m_region.height()) * TOLERANCE_A;
     //
     m_pixel_shapes = depthmapX::ColumnMatrix<std::vector<ShapeRef>>(m_rows, m_cols);
+    invalidateShapeIndex();
 }
 
 // this makes an exact copy, keep the reference numbers and so on:
@@ -189,6 +191,7 @@ void ShapeMap::init(int size, const QtRegion &r) {
 void ShapeMap::copy(const ShapeMap &sourcemap, int copyflags) {
     if ((copyflags & ShapeMap::COPY_GEOMETRY) == ShapeMap::COPY_GEOMETRY) {
         m_shapes.clear();
+        invalidateShapeIndex();
         init(sourcemap.m_shapes.size(), sourcemap.m_region);
         for (auto shape : sourcemap.m_shapes) {
             // using makeShape is actually easier than thinking about a total copy:
@@ -251,6 +254,7 @@ void ShapeMap::clearAll() {
     m_display_shapes.clear();
 
     m_shapes.clear();
+    invalidateShapeIndex();
     m_undobuffer.clear();
     m_connectors.clear();
     m_attributes->clear();
@@ -274,6 +278,7 @@ int ShapeMap::makePointShapeWithRef(const Point2f &point, int shape_ref, bool te
     }
 
     m_shapes.insert(std::make_pair(shape_ref, SalaShape(point)));
+    invalidateShapeIndex();
 
     if (bounds_good) {
         // note: also sets polygon bounding box:
@@ -316,6 +321,7 @@ int ShapeMap::makeLineShapeWithRef(const Line &line, int shape_ref, bool through
 
     // note, shape constructor sets centroid, length etc
     m_shapes.insert(std::make_pair(shape_ref, SalaShape(line)));
+    invalidateShapeIndex();
 
     if (bounds_good) {
         // note: also sets polygon bounding box:
@@ -338,7 +344,7 @@ int ShapeMap::makeLineShapeWithRef(const Line &line, int shape_ref, bool through
     if (through_ui) {
         // manually add connections:
         if (m_hasgraph) {
-            int rowid = depthmapX::findIndexFromKey(m_shapes, shape_ref);
+            int rowid = getIndexFromShapeRef(shape_ref);
             if (isAxialMap()) {
                 connectIntersected(rowid, true); // "true" means line-line intersections only will be applied
             } else {
@@ -404,8 +410,10 @@ int ShapeMap::makePolyShapeWithRef(const std::vector<Point2f> &points, bool open
 
     if (open) {
         m_shapes.insert(std::make_pair(shape_ref, SalaShape(SalaShape::SHAPE_POLY)));
+        invalidateShapeIndex();
     } else {
         m_shapes.insert(std::make_pair(shape_ref, SalaShape(SalaShape::SHAPE_POLY | SalaShape::SHAPE_CLOSED)));
+        invalidateShapeIndex();
     }
     for (i = 0; i < len; i++) {
         m_shapes.rbegin()->second.m_points.push_back(points[i]);
@@ -461,6 +469,7 @@ int ShapeMap::makeShape(const SalaShape &poly, int override_shape_ref, const std
     }
 
     m_shapes.insert(std::make_pair(shape_ref, poly));
+    invalidateShapeIndex();
 
     if (bounds_good) {
         // note: also sets polygon bounding box:
@@ -542,6 +551,7 @@ int ShapeMap::makeShapeFromPointSet(const PointMap &pointmap) {
 
     int new_shape_ref = getNextShapeKey();
     m_shapes.insert(std::make_pair(new_shape_ref, poly));
+    invalidateShapeIndex();
 
     if (bounds_good) {
         // note: also sets polygon bounding box:
@@ -668,7 +678,7 @@ bool ShapeMap::moveShape(int shaperef, const Line &line, bool undoing) {
         }
     }
 
-    int rowid = std::distance(m_shapes.begin(), shapeIter);
+    int rowid = getIndexFromShapeRef(shapeIter->first);
     AttributeRow &row = m_attributes->getRow(AttributeKey(shapeIter->first));
     // change connections:
     if (m_hasgraph) {
@@ -691,7 +701,7 @@ bool ShapeMap::moveShape(int shaperef, const Line &line, bool undoing) {
         row.setValue(conn_col, float(newconnections.size()));
         if (isAxialMap()) {
             leng_col = m_attributes->getOrInsertLockedColumn("Line Length");
-            row.setValue(leng_col, (float)depthmapX::getMapAtIndex(m_shapes, rowid)->second.getLength());
+            row.setValue(leng_col, (float)getShapeRefFromIndex(rowid)->second.getLength());
         }
         //
         // now go through our old connections, and remove ourself:
@@ -775,6 +785,7 @@ int ShapeMap::polyBegin(const Line &line) {
 
     int new_shape_ref = getNextShapeKey();
     m_shapes.insert(std::make_pair(new_shape_ref, SalaShape(line)));
+    invalidateShapeIndex();
     m_shapes.rbegin()->second.m_centroid = line.getCentre();
 
     if (bounds_good) {
@@ -917,7 +928,7 @@ void ShapeMap::removeShape(int shaperef, bool undoing) {
     removePolyPixels(shaperef); // done first, as all interface references use this list
 
     auto shapeIter = m_shapes.find(shaperef);
-    size_t rowid = std::distance(m_shapes.begin(), shapeIter);
+    size_t rowid = size_t(getIndexFromShapeRef(shaperef));
 
     if (!undoing) { // <- if not currently undoing another event, then add to the undo buffer:
         m_undobuffer.push_back(SalaEvent(SalaEvent::SALA_DELETED, shaperef));
@@ -978,6 +989,7 @@ void ShapeMap::removeShape(int shaperef, bool undoing) {
 
     if (shapeIter != m_shapes.end()) {
         shapeIter = m_shapes.erase(shapeIter);
+        invalidateShapeIndex();
     }
     // n.b., shaperef should have been used to create the row in the first place:
     const AttributeKey shapeRefKey(shaperef);
@@ -1003,7 +1015,7 @@ void ShapeMap::undo() {
     } else if (event.m_action == SalaEvent::SALA_DELETED) {
 
         makeShape(event.m_geometry, event.m_shape_ref);
-        int rowid = std::distance(m_shapes.begin(), m_shapes.find(event.m_shape_ref));
+        int rowid = getIndexFromShapeRef(event.m_shape_ref);
         auto &row = m_attributes->getRow(AttributeKey(event.m_shape_ref));
 
         if (rowid != -1 && m_hasgraph) {
@@ -1048,7 +1060,7 @@ void ShapeMap::undo() {
             //
             if (event.m_geometry.isLine()) {
                 int leng_col = m_attributes->getOrInsertLockedColumn("Line Length");
-                row.setValue(leng_col, (float)depthmapX::getMapAtIndex(m_shapes, rowid)->second.getLength());
+                row.setValue(leng_col, (float)getShapeRefFromIndex(rowid)->second.getLength());
             }
             //
             // now go through our connections, and add ourself:
@@ -1078,6 +1090,7 @@ void ShapeMap::undo() {
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void ShapeMap::makePolyPixels(int polyref) {
+    m_rtree.reset();
     ShapeRef shapeRef = ShapeRef(polyref);
     // first add into pixels, and ensure you have a bl, tr for the set (useful for testing later)
     SalaShape &poly = m_shapes.find(polyref)->second;
@@ -1300,6 +1313,7 @@ void ShapeMap::pointPixelBorder(const PointMap &pointmap, std::map<int, int> &re
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
 void ShapeMap::removePolyPixels(int polyref) {
+    m_rtree.reset();
     auto shapeIter = m_shapes.find(polyref);
     if (shapeIter == m_shapes.end()) {
         return;
@@ -1438,6 +1452,93 @@ bool ShapeMap::pointInPoly(const Point2f &p, int polyref) const {
     return false;
 }
 
+// exact geometry helpers for the R-tree queries, where there are no pixel tags to go by
+
+static size_t edgeCount(const SalaShape &shape) {
+    return shape.isClosed() ? shape.m_points.size() : shape.m_points.size() - 1;
+}
+
+static Line edge(const SalaShape &shape, size_t k) {
+    return Line(shape.m_points[k], shape.m_points[(k + 1) % shape.m_points.size()]);
+}
+
+// crossing number test, only closed shapes have an inside
+static bool pointInShape(const Point2f &p, const SalaShape &shape) {
+    if (!shape.isClosed() || shape.m_points.size() < 3 || !shape.getBoundingBox().contains_touch(p)) {
+        return false;
+    }
+    bool inside = false;
+    const std::vector<Point2f> &points = shape.m_points;
+    for (size_t i = 0, j = points.size() - 1; i < points.size(); j = i++) {
+        if ((points[i].y > p.y) != (points[j].y > p.y) &&
+            p.x < (points[j].x - points[i].x) * (p.y - points[i].y) / (points[j].y - points[i].y) + points[i].x) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+static bool edgesIntersect(const SalaShape &shape, const Line &line, double tolerance) {
+    for (size_t k = 0; k < edgeCount(shape); k++) {
+        Line lineb = edge(shape, k);
+        if (intersect_region(line, lineb) && intersect_line(line, lineb, tolerance)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool edgesIntersect(const SalaShape &shape, const SalaShape &shapeb, double tolerance) {
+    for (size_t k = 0; k < edgeCount(shapeb); k++) {
+        Line lineb = edge(shapeb, k);
+        if (intersect_region(shape.getBoundingBox(), lineb) && edgesIntersect(shape, lineb, tolerance)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::vector<std::map<int, SalaShape>::const_iterator> &ShapeMap::getShapeIndex() const {
+    if (!m_shape_index_valid) {
+        // the analyses look shapes up from many threads at once, only one of them makes the index
+        std::lock_guard<std::mutex> lock(m_shape_index_mutex);
+        if (!m_shape_index_valid) {
+            m_shape_index.clear();
+            m_shape_index.reserve(m_shapes.size());
+            for (auto shapeIter = m_shapes.cbegin(); shapeIter != m_shapes.cend(); ++shapeIter) {
+                m_shape_index.push_back(shapeIter);
+            }
+            m_shape_index_valid = true;
+        }
+    }
+    return m_shape_index;
+}
+
+int ShapeMap::getIndexFromShapeRef(int shapeRef) const {
+    const auto &shapeIndex = getShapeIndex();
+    auto iter = std::lower_bound(shapeIndex.begin(), shapeIndex.end(), shapeRef,
+                                 [](std::map<int, SalaShape>::const_iterator shapeIter, int key) {
+                                     return shapeIter->first < key;
+                                 });
+    if (iter == shapeIndex.end() || (*iter)->first != shapeRef) {
+        return -1;
+    }
+    return int(iter - shapeIndex.begin());
+}
+
+void ShapeMap::makeRTree() const {
+    if (m_rtree) {
+        return;
+    }
+    const auto &shapeIndex = getShapeIndex();
+    std::vector<QtRegion> boxes;
+    boxes.reserve(shapeIndex.size());
+    for (auto shapeIter : shapeIndex) {
+        boxes.push_back(shapeIter->second.getBoundingBox());
+    }
+    m_rtree.reset(new depthmapX::PackedRTree(boxes));
+}
+
 // similar to above, but builds a list
 
 std::vector<int> ShapeMap::pointInPolyList(const Point2f &p) const {
@@ -1445,6 +1546,16 @@ std::vector<int> ShapeMap::pointInPolyList(const Point2f &p) const {
     if (!m_region.contains(p)) {
         return shapeindexlist;
     }
+    if (m_spatial_index == PACKED_RTREE) {
+        makeRTree();
+        m_rtree->search(QtRegion(p, p), [&](size_t index) {
+            if (pointInShape(p, getShapeIndex()[index]->second)) {
+                shapeindexlist.push_back(int(index));
+            }
+        });
+        std::sort(shapeindexlist.begin(), shapeindexlist.end());
+        return shapeindexlist;
+    }
     std::vector<size_t> testedshapes;
     PixelRef pix = pixelate(p);
     const std::vector<ShapeRef> &shapes = m_pixel_shapes(static_cast<size_t>(pix.y), static_cast<size_t>(pix.x));
@@ -1481,6 +1592,33 @@ std::vector<int> ShapeMap::lineInPolyList(const Line &li_orig, size_t lineref, d
     std::vector<int> endShapeIndexList = pointInPolyList(li.end());
     shapeindexlist.insert(shapeindexlist.end(), endShapeIndexList.begin(), endShapeIndexList.end());
 
+    if (m_spatial_index == PACKED_RTREE) {
+        // as below, but each polygon edge is only tested once rather than once for every pixel it shares
+        // with the line
+        makeRTree();
+        m_rtree->search(li, [&](size_t index) {
+            auto shapeIter = getShapeIndex()[index];
+            if (static_cast<size_t>(shapeIter->first) == lineref) {
+                return;
+            }
+            const SalaShape &poly = shapeIter->second;
+            if (poly.isLine()) {
+                if (intersect_line(li, poly.m_region, tolerance)) {
+                    shapeindexlist.push_back(int(index));
+                }
+            } else if (poly.m_type & SalaShape::SHAPE_POLY) {
+                for (size_t k = 0; k < edgeCount(poly); k++) {
+                    Line lineb = edge(poly, k);
+                    if (intersect_region(li, lineb) && intersect_line(li, lineb, tolerance)) {
+                        shapeindexlist.push_back(int(index));
+                    }
+                }
+            }
+        });
+        std::sort(shapeindexlist.begin(), shapeindexlist.end());
+        return shapeindexlist;
+    }
+
     // only now pixelate and test for any other shapes:
     PixelRefVector list = pixelateLine(li);
     for (size_t i = 0; i < list.size(); i++) {
@@ -1500,7 +1638,7 @@ std::vector<int> ShapeMap::lineInPolyList(const Line &li_orig, size_t lineref, d
                         if (intersect_region(li, poly.m_region)) {
                             // note: in this case m_region is stored as a line:
                             if (intersect_line(li, poly.m_region, tolerance)) {
-                                shapeindexlist.push_back(int(std::distance(m_shapes.begin(), shapeIter)));
+                                shapeindexlist.push_back(getIndexFromShapeRef(shapeIter->first));
                             }
                         }
                         break;
@@ -1510,7 +1648,7 @@ std::vector<int> ShapeMap::lineInPolyList(const Line &li_orig, size_t lineref, d
                                               poly.m_points[((shape.m_polyrefs[k] + 1) % poly.m_points.size())]);
                             if (intersect_region(li, lineb)) {
                                 if (intersect_line(li, lineb, tolerance)) {
-                                    shapeindexlist.push_back(int(std::distance(m_shapes.begin(), shapeIter)));
+                                    shapeindexlist.push_back(getIndexFromShapeRef(shapeIter->first));
                                 }
                             }
                         }
@@ -1533,6 +1671,9 @@ std::vector<int> ShapeMap::polyInPolyList(int polyref, double tolerance) const {
         return shapeindexlist;
     }
     const SalaShape &poly = shapeIter->second;
+    if (poly.isClosed() && m_spatial_index == PACKED_RTREE) {
+        return rtreePolyInPolyList(poly, polyref, tolerance);
+    }
     if (poly.isClosed()) { // <- it ought to be, you shouldn't be using this function if not!
         std::vector<size_t> testedlist;
         // easiest just to use scan lines to find internal pixels rather than trace a complex border:
@@ -1554,7 +1695,7 @@ std::vector<int> ShapeMap::polyInPolyList(int polyref, double tolerance) const {
                             if (iter == testedlist.end()) {
                                 testedlist.insert(iter, shapeRef.m_shape_ref);
                                 shapeindexlist.push_back(
-                                    int(depthmapX::findIndexFromKey(m_shapes, int(shapeRef.m_shape_ref))));
+                                    getIndexFromShapeRef(int(shapeRef.m_shape_ref)));
                             }
                         }
                     }
@@ -1575,7 +1716,7 @@ std::vector<int> ShapeMap::polyInPolyList(int polyref, double tolerance) const {
                             auto iter = depthmapX::findBinary(testedlist, shaperefb.m_shape_ref);
                             if (shaperef != shaperefb && iter == testedlist.end()) {
                                 auto shapeIter = m_shapes.find(shaperefb.m_shape_ref);
-                                size_t indexb = std::distance(m_shapes.begin(), shapeIter);
+                                size_t indexb = size_t(getIndexFromShapeRef(shapeIter->first));
                                 const SalaShape &polyb = shapeIter->second;
                                 if (polyb.isPoint()) {
                                     if (testPointInPoly(polyb.getPoint(), shaperef) != -1) {
@@ -1676,13 +1817,79 @@ std::vector<int> ShapeMap::polyInPolyList(int polyref, double tolerance) const {
     return shapeindexlist;
 }
 
+// the shapes that intersect the polygon: points inside it, lines and polylines inside or crossing
+// it, and polygons inside, around or crossing it
+
+std::vector<int> ShapeMap::rtreePolyInPolyList(const SalaShape &poly, int polyref, double tolerance) const {
+    std::vector<int> shapeindexlist;
+    makeRTree();
+    m_rtree->search(poly.getBoundingBox(), [&](size_t index) {
+        auto shapeIter = getShapeIndex()[index];
+        if (shapeIter->first == polyref) {
+            return;
+        }
+        const SalaShape &polyb = shapeIter->second;
+        bool intersects;
+        if (polyb.isPoint()) {
+            intersects = pointInShape(polyb.getPoint(), poly);
+        } else if (polyb.isLine()) {
+            intersects = pointInShape(polyb.getLine().start(), poly) || pointInShape(polyb.getLine().end(), poly) ||
+                         edgesIntersect(poly, polyb.getLine(), tolerance);
+        } else if (polyb.isPolyLine()) {
+            intersects = pointInShape(polyb.m_points[0], poly) || edgesIntersect(poly, polyb, tolerance);
+        } else {
+            intersects = pointInShape(polyb.m_points[0], poly) || pointInShape(poly.m_points[0], polyb) ||
+                         edgesIntersect(poly, polyb, tolerance);
+        }
+        if (intersects) {
+            shapeindexlist.push_back(int(index));
+        }
+    });
+    std::sort(shapeindexlist.begin(), shapeindexlist.end());
+    return shapeindexlist;
+}
+
+// no need to add a polygon to the map to test it against the R-tree
+
+std::vector<int> ShapeMap::rtreeShapeInPolyList(const SalaShape &shape) const {
+    if (!intersect_region(m_region, shape.m_region)) {
+        return std::vector<int>();
+    }
+    if (shape.isPoint() || shape.isLine() || shape.isPolyLine()) {
+        return openShapeInPolyList(shape);
+    }
+    return rtreePolyInPolyList(shape, -1, 0.0);
+}
+
 std::vector<int> ShapeMap::shapeInPolyList(const SalaShape &shape) // note: no const due to poly in poly testing
 {
+    if (m_spatial_index == PACKED_RTREE) {
+        return rtreeShapeInPolyList(shape);
+    }
     std::vector<int> shapeindexlist;
     if (!intersect_region(m_region, shape.m_region)) {
         // quick test that actually coincident
         return shapeindexlist;
     }
+    if (shape.isPoint() || shape.isLine() || shape.isPolyLine()) {
+        shapeindexlist = openShapeInPolyList(shape);
+    } else {
+        // first *add* the poly temporarily (note this may grow pixel set):
+        int ref = makePolyShape(shape.m_points, false, true); // false is closed poly, true is temporary shape
+        // do test:
+        shapeindexlist = polyInPolyList(ref);
+        // clean up:
+        removePolyPixels(ref);
+        m_shapes.erase(m_shapes.find(ref));
+        invalidateShapeIndex();
+    }
+    return shapeindexlist;
+}
+
+// points, lines and polylines, which can be tested without changing the map
+
+std::vector<int> ShapeMap::openShapeInPolyList(const SalaShape &shape) const {
+    std::vector<int> shapeindexlist;
     if (shape.isPoint()) {
         shapeindexlist = pointInPolyList(shape.getPoint());
     } else if (shape.isLine()) {
@@ -1692,18 +1899,73 @@ std::vector<int> ShapeMap::shapeInPolyList(const SalaShape &shape) // note: no c
             Line li(shape.m_points[i], shape.m_points[i - 1]);
             shapeindexlist = lineInPolyList(li);
         }
-    } else {
-        // first *add* the poly temporarily (note this may grow pixel set):
-        int ref = makePolyShape(shape.m_points, false, true); // false is closed poly, true is temporary shape
-        // do test:
-        shapeindexlist = polyInPolyList(ref);
-        // clean up:
-        removePolyPixels(ref);
-        m_shapes.erase(m_shapes.find(ref));
     }
     return shapeindexlist;
 }
 
+std::vector<std::vector<int>> ShapeMap::pointInPolyLists(const std::vector<Point2f> &points, int threads) const {
+    std::vector<std::vector<int>> shapeindexlists(points.size());
+    if (m_spatial_index == PACKED_RTREE) {
+        makeRTree();
+    }
+    depthmapX::parallelFor(nullptr, points.size(), threads,
+                           [&](int, size_t item) { shapeindexlists[item] = pointInPolyList(points[item]); });
+    return shapeindexlists;
+}
+
+// Points, lines and polylines are tested without changing the map, so they are shared between
+// the threads. Polygons are added to the map for their test and are done first on this thread,
+// which gives the same lists as long as the map is left as it was afterwards. That is not the
+// case for a polygon that is not within the map region (the pixel grid is made again to fit
+// it), so if there is one of those all the shapes are tested one after the other instead
+
+std::vector<std::vector<int>> ShapeMap::shapeInPolyLists(const std::vector<const SalaShape *> &shapes, int threads) {
+    std::vector<std::vector<int>> shapeindexlists(shapes.size());
+    if (m_spatial_index == PACKED_RTREE) {
+        // nothing is added to the map, so all the shapes can be shared out
+        makeRTree();
+        depthmapX::parallelFor(nullptr, shapes.size(), threads, [&](int, size_t item) {
+            shapeindexlists[item] = rtreeShapeInPolyList(*shapes[item]);
+        });
+        return shapeindexlists;
+    }
+
+    bool inOrder = false;
+    std::vector<size_t> readOnly;
+    for (size_t i = 0; i < shapes.size(); i++) {
+        const SalaShape &shape = *shapes[i];
+        if (shape.isPoint() || shape.isLine() || shape.isPolyLine() || !intersect_region(m_region, shape.m_region)) {
+            readOnly.push_back(i);
+        } else if (shape.m_points.size() < 3 || !m_region.contains_touch(shape.m_region.bottom_left) ||
+                   !m_region.contains_touch(shape.m_region.top_right)) {
+            inOrder = true;
+            break;
+        }
+    }
+    if (inOrder) {
+        for (size_t i = 0; i < shapes.size(); i++) {
+            shapeindexlists[i] = shapeInPolyList(*shapes[i]);
+        }
+        return shapeindexlists;
+    }
+
+    size_t next = 0;
+    for (size_t i = 0; i < shapes.size(); i++) {
+        if (next < readOnly.size() && readOnly[next] == i) {
+            next++;
+        } else {
+            shapeindexlists[i] = shapeInPolyList(*shapes[i]);
+        }
+    }
+    depthmapX::parallelFor(nullptr, readOnly.size(), threads, [&](int, size_t item) {
+        const SalaShape &shape = *shapes[readOnly[item]];
+        if (intersect_region(m_region, shape.m_region)) {
+            shapeindexlists[readOnly[item]] = openShapeInPolyList(shape);
+        }
+    });
+    return shapeindexlists;
+}
+
 // helper for point in poly --
 // currently needs slight rewrite to avoid problem if point is in line with a vertex
 // (counter incremented twice on touching implies not in poly when is)
@@ -1852,7 +2114,7 @@ int ShapeMap::testPointInPoly(const Point2f &p, const ShapeRef &shape) const {
             }
         }
     }
-    return (shapeIter == m_shapes.end()) ? -1 : std::distance(m_shapes.begin(), shapeIter); // note convert to -1
+    return (shapeIter == m_shapes.end()) ? -1 : getIndexFromShapeRef(shapeIter->first); // note convert to -1
 }
 
 // also note that you may want to find a close poly line or point
@@ -1901,7 +2163,7 @@ int ShapeMap::getClosestOpenGeom(const Point2f &p) const {
         }
     }
 
-    return (shapeIter == m_shapes.end()) ? -1 : std::distance(m_shapes.begin(), shapeIter); // note conversion to -1
+    return (shapeIter == m_shapes.end()) ? -1 : getIndexFromShapeRef(shapeIter->first); // note conversion to -1
 }
 
 Point2f ShapeMap::getClosestVertex(const Point2f &p) const {
@@ -1965,6 +2227,15 @@ Point2f ShapeMap::getClosestVertex(const Point2f &p) const {
 #include "isovist.h"
 
 int ShapeMap::getClosestLine(const Point2f &p) const {
+    if (m_spatial_index == PACKED_RTREE) {
+        // the closest line is always visible from the point, so there is no need for the isovist
+        makeRTree();
+        int index = m_rtree->nearest(p, [&](size_t index) {
+            const SalaShape &shape = getShapeIndex()[index]->second;
+            return shape.isLine() ? dist(p, shape.getLine()) : -1.0;
+        });
+        return index == -1 ? -1 : getShapeIndex()[size_t(index)]->first;
+    }
     // not the best place to check this, but we must all the same:
     if (m_newshape) {
         m_bsp_tree = false;
@@ -1986,7 +2257,7 @@ int ShapeMap::getClosestLine(const Point2f &p) const {
 
 // code to add intersections when shapes are added to the graph one by one:
 int ShapeMap::connectIntersected(int rowid, bool linegraph) {
-    auto shaperefIter = depthmapX::getMapAtIndex(m_shapes, rowid);
+    auto shaperefIter = getShapeRefFromIndex(rowid);
     int conn_col = m_attributes->getOrInsertLockedColumn("Connectivity");
     int leng_col = -1;
     if (linegraph) {
@@ -2022,10 +2293,10 @@ int ShapeMap::connectIntersected(int rowid, bool linegraph) {
 // use the other version, getShapeConnections for arbitrary shape-shape connections
 // note, connections are listed by rowid in list, *not* reference number
 // (so they may vary: must be checked carefully when shapes are removed / added)
-std::vector<int> ShapeMap::getLineConnections(int lineref, double tolerance) {
+std::vector<int> ShapeMap::getLineConnections(int lineref, double tolerance) const {
     std::vector<int> connections;
 
-    SalaShape &poly = m_shapes.find(lineref)->second;
+    const SalaShape &poly = m_shapes.find(lineref)->second;
     if (!poly.isLine()) {
         return std::vector<int>();
     }
@@ -2057,8 +2328,7 @@ std::vector<int> ShapeMap::getLineConnections(int lineref, double tolerance) {
                 // n.b. originally this followed the logic that we must normalise intersect_line properly: tolerance *
                 // line length one * line length two in fact, works better if it's just line.length() * tolerance...
                 if (intersect_line(line, l, line.length() * tolerance)) {
-                    depthmapX::insert_sorted(connections,
-                                             depthmapX::findIndexFromKey(m_shapes, int(shape.m_shape_ref)));
+                    depthmapX::insert_sorted(connections, getIndexFromShapeRef(int(shape.m_shape_ref)));
                 }
             }
         }
@@ -2068,7 +2338,7 @@ std::vector<int> ShapeMap::getLineConnections(int lineref, double tolerance) {
 }
 
 // this is only problematic as there is lots of legacy code with shape-in-shape testing,
-std::vector<int> ShapeMap::getShapeConnections(int shaperef, double tolerance) {
+std::vector<int> ShapeMap::getShapeConnections(int shaperef, double tolerance) const {
     // In versions prior to 10, note that unlike getLineConnections, self-connection is excluded by all of the
     // following functions As of version 10, both getShapeConnections and getLineConnections exclude self-connection
 
@@ -2076,7 +2346,7 @@ std::vector<int> ShapeMap::getShapeConnections(int shaperef, double tolerance) {
 
     auto shapeIter = m_shapes.find(shaperef);
     if (shapeIter != m_shapes.end()) {
-        SalaShape &shape = shapeIter->second;
+        const SalaShape &shape = shapeIter->second;
         if (shape.isPoint()) {
             // a point is simple, it never intersects itself:
             connections = pointInPolyList(shape.getPoint());
@@ -2098,8 +2368,25 @@ std::vector<int> ShapeMap::getShapeConnections(int shaperef, double tolerance) {
     return connections;
 }
 
+// The shapes are only read, so they can be shared out between the threads. The lists are
+// kept by shape, which gives the same result as making them one after the other
+
+std::vector<std::vector<int>> ShapeMap::getAllConnections(bool linegraph, double tolerance, int threads) const {
+    // make the index (and R-tree) here rather than have the threads wait on each other for it
+    const auto &shapeIndex = getShapeIndex();
+    if (m_spatial_index == PACKED_RTREE) {
+        makeRTree();
+    }
+    std::vector<std::vector<int>> connections(shapeIndex.size());
+    depthmapX::parallelFor(nullptr, shapeIndex.size(), threads, [&](int, size_t item) {
+        int key = shapeIndex[item]->first;
+        connections[item] = linegraph ? getLineConnections(key, tolerance) : getShapeConnections(key, tolerance);
+    });
+    return connections;
+}
+
 // for any geometry, not just line to lines
-void ShapeMap::makeShapeConnections() {
+void ShapeMap::makeShapeConnections(int threads) {
     if (m_hasgraph) {
         m_connectors.clear();
         m_attributes->clear();
@@ -2109,15 +2396,16 @@ void ShapeMap::makeShapeConnections() {
         // note, expects these to be numbered 0, 1...
         int conn_col = m_attributes->insertOrResetLockedColumn("Connectivity");
 
+        std::vector<std::vector<int>> connections =
+            getAllConnections(false, TOLERANCE_B * __max(m_region.height(), m_region.width()), threads);
         int i = -1;
-        for (auto shape : m_shapes) {
+        for (const auto &shape : m_shapes) {
             i++;
             int key = shape.first;
             auto &row = m_attributes->addRow(AttributeKey(key));
             // all indices should match...
             m_connectors.push_back(Connector());
-            m_connectors[i].m_connections =
-                getShapeConnections(key, TOLERANCE_B * __max(m_region.height(), m_region.width()));
+            m_connectors[i].m_connections = std::move(connections[i]);
             row.setValue(conn_col, float(m_connectors[i].m_connections.size()));
         }
 
@@ -2148,9 +2436,9 @@ double ShapeMap::getLocationValue(const Point2f &point) const {
     return (x == -1) ? -2.0 : val; // -2.0 is returned when point cannot be associated with a poly
 }
 
-const std::map<int, SalaShape> ShapeMap::getShapesInRegion(const QtRegion &r) const {
+void ShapeMap::getShapesInRegion(const QtRegion &r, std::vector<size_t> &shapeIndices) const {
 
-    std::map<int, SalaShape> shapesInRegion;
+    shapeIndices.clear();
 
     if (r.bottom_left == r.top_right) {
         // note: uses index not key
@@ -2160,8 +2448,12 @@ const std::map<int, SalaShape> ShapeMap::getShapesInRegion(const QtRegion &r) co
             index = getClosestOpenGeom(r.bottom_left);
         }
         if (index != -1) {
-            shapesInRegion.insert(*getShapeRefFromIndex(index));
+            shapeIndices.push_back(size_t(index));
         }
+    } else if (m_spatial_index == PACKED_RTREE) {
+        // shapes with a bounding box that touches the region
+        makeRTree();
+        m_rtree->search(r, [&](size_t index) { shapeIndices.push_back(index); });
     } else {
         PixelRef bl = pixelate(r.bottom_left);
         PixelRef tr = pixelate(r.top_right);
@@ -2170,17 +2462,18 @@ const std::map<int, SalaShape> ShapeMap::getShapesInRegion(const QtRegion &r) co
                 const std::vector<ShapeRef> &shapeRefs =
                     m_pixel_shapes(static_cast<size_t>(j), static_cast<size_t>(i));
                 for (const ShapeRef &shapeRef : shapeRefs) {
-                    // relies on indices of shapes and attributes being aligned
-                    auto shape = m_shapes.find(shapeRef.m_shape_ref);
-                    if(shape != m_shapes.end()) {
-                        shapesInRegion.insert(*shape);
+                    int index = getIndexFromShapeRef(int(shapeRef.m_shape_ref));
+                    if (index != -1) {
+                        shapeIndices.push_back(size_t(index));
                     }
                 }
             }
         }
     }
 
-    return shapesInRegion;
+    // a shape is listed once for every pixel it is in
+    std::sort(shapeIndices.begin(), shapeIndices.end());
+    shapeIndices.erase(std::unique(shapeIndices.begin(), shapeIndices.end()), shapeIndices.end());
 }
 
 bool ShapeMap::setCurSel(QtRegion &r, bool add) {
@@ -2188,11 +2481,12 @@ bool ShapeMap::setCurSel(QtRegion &r, bool add) {
         clearSel();
     }
 
-    std::map<int, SalaShape> shapesInRegion = getShapesInRegion(r);
-    for (auto shape: shapesInRegion) {
-        shape.second.m_selected = true;
-        if (m_selection_set.insert(shape.first).second) {
-            auto &row = m_attributes->getRow(AttributeKey(shape.first));
+    std::vector<size_t> shapesInRegion;
+    getShapesInRegion(r, shapesInRegion);
+    for (size_t index : shapesInRegion) {
+        int key = getShapeRefFromIndex(index)->first;
+        if (m_selection_set.insert(key).second) {
+            auto &row = m_attributes->getRow(AttributeKey(key));
             row.setSelection(true);
         }
     }
@@ -2283,6 +2577,7 @@ bool ShapeMap::read(std::istream &stream) {
     // clear old:
     m_display_shapes.clear();
     m_shapes.clear();
+    invalidateShapeIndex();
     m_attributes->clear();
     m_connectors.clear();
     m_links.clear();
@@ -2321,6 +2616,7 @@ bool ShapeMap::read(std::istream &stream) {
         int key;
         stream.read((char *)&key, sizeof(key));
         auto iter = m_shapes.insert(std::make_pair(key, SalaShape())).first;
+        invalidateShapeIndex();
         iter->second.read(stream);
     }
 
@@ -2382,7 +2678,7 @@ bool ShapeMap::read(std::istream &stream) {
     return true;
 }
 
-bool ShapeMap::write(std::ofstream &stream) {
+bool ShapeMap::write(std::ostream &stream) {
     // name
     dXstring::writeString(stream, m_name);
 
@@ -2693,7 +2989,7 @@ void ShapeMap::makeViewportShapes(const QtRegion &viewport) const {
             const std::vector<ShapeRef> &shapeRefs = m_pixel_shapes(static_cast<size_t>(j), static_cast<size_t>(i));
             for (const ShapeRef &shape : shapeRefs) {
                 // copy the index to the correct draworder position (draworder is formatted on display attribute)
-                int x = std::distance(m_shapes.begin(), m_shapes.find(shape.m_shape_ref));
+                int x = getIndexFromShapeRef(shape.m_shape_ref);
                 AttributeKey shapeRefKey(shape.m_shape_ref);
                 if (isObjectVisible(m_layers, m_attributes->getRow(shapeRefKey))) {
                     m_display_shapes[m_attribHandle->findInIndex(shapeRefKey)] = x;
@@ -2727,7 +3023,7 @@ bool ShapeMap::findNextShape(bool &nextlayer) const {
 const SalaShape &ShapeMap::getNextShape() const {
     int x = m_display_shapes[m_current]; // x has display order in it
     m_display_shapes[m_current] = -1;    // you've drawn it
-    return depthmapX::getMapAtIndex(m_shapes, x)->second;
+    return getShapeRefFromIndex(x)->second;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -2832,7 +3128,7 @@ bool ShapeMap::linkShapes(const Point2f &p) {
     if (m_selection_set.size() != 1) {
         return false;
     }
-    int index1 = std::distance(m_shapes.begin(), m_shapes.find(*m_selection_set.begin()));
+    int index1 = getIndexFromShapeRef(*m_selection_set.begin());
     // note: uses rowid not key
     int index2 = pointInPoly(p);
     if (index2 == -1) {
@@ -2850,8 +3146,8 @@ bool ShapeMap::linkShapes(const Point2f &p) {
 }
 
 bool ShapeMap::linkShapesFromRefs(int ref1, int ref2, bool refresh) {
-    int index1 = depthmapX::findIndexFromKey(m_shapes, ref1);
-    int index2 = depthmapX::findIndexFromKey(m_shapes, ref2);
+    int index1 = getIndexFromShapeRef(ref1);
+    int index2 = getIndexFromShapeRef(ref2);
     return linkShapes(index1, index2, refresh);
 }
 
@@ -2924,7 +3220,7 @@ bool ShapeMap::unlinkShapes(const Point2f &p) {
     if (m_selection_set.size() != 1) {
         return false;
     }
-    int index1 = std::distance(m_shapes.begin(), m_shapes.find(*m_selection_set.begin()));
+    int index1 = getIndexFromShapeRef(*m_selection_set.begin());
     int index2 = pointInPoly(p);
     if (index2 == -1) {
         // try looking for a polyline instead
@@ -2941,8 +3237,8 @@ bool ShapeMap::unlinkShapes(const Point2f &p) {
 }
 
 bool ShapeMap::unlinkShapesFromRefs(int ref1, int ref2, bool refresh) {
-    int index1 = depthmapX::findIndexFromKey(m_shapes, ref1);
-    int index2 = depthmapX::findIndexFromKey(m_shapes, ref2);
+    int index1 = getIndexFromShapeRef(ref1);
+    int index2 = getIndexFromShapeRef(ref2);
     return unlinkShapes(index1, index2, refresh);
 }
 
@@ -2992,8 +3288,8 @@ bool ShapeMap::unlinkShapesByKey(int key1, int key2, bool refresh) {
     int conn_col = m_attributes->getColumnIndex("Connectivity");
     bool update = false;
 
-    int index1 = std::distance(m_shapes.begin(), m_shapes.find(key1));
-    int index2 = std::distance(m_shapes.begin(), m_shapes.find(key2));
+    int index1 = getIndexFromShapeRef(key1);
+    int index2 = getIndexFromShapeRef(key2);
 
     if (key1 != key2) {
         // unlink these shapes...
@@ -3113,8 +3409,8 @@ bool ShapeMap::findNextLinkLine() const {
 Line ShapeMap::getNextLinkLine() const {
     // note, links are stored directly by rowid, not by key:
     if (m_curlinkline < (int)m_links.size()) {
-        return Line(depthmapX::getMapAtIndex(m_shapes, m_links[m_curlinkline].a)->second.getCentroid(),
-                    depthmapX::getMapAtIndex(m_shapes, m_links[m_curlinkline].b)->second.getCentroid());
+        return Line(getShapeRefFromIndex(m_links[m_curlinkline].a)->second.getCentroid(),
+                    getShapeRefFromIndex(m_links[m_curlinkline].b)->second.getCentroid());
     }
     return Line();
 }
@@ -3122,8 +3418,8 @@ Line ShapeMap::getNextLinkLine() const {
 std::vector<SimpleLine> ShapeMap::getAllLinkLines() {
     std::vector<SimpleLine> linkLines;
     for (size_t i = 0; i < m_links.size(); i++) {
-        linkLines.push_back(SimpleLine(depthmapX::getMapAtIndex(m_shapes, m_links[i].a)->second.getCentroid(),
-                                       depthmapX::getMapAtIndex(m_shapes, m_links[i].b)->second.getCentroid()));
+        linkLines.push_back(SimpleLine(getShapeRefFromIndex(m_links[i].a)->second.getCentroid(),
+                                       getShapeRefFromIndex(m_links[i].b)->second.getCentroid()));
     }
     return linkLines;
 }
@@ -3140,8 +3436,8 @@ bool ShapeMap::findNextUnlinkPoint() const {
 Point2f ShapeMap::getNextUnlinkPoint() const {
     // note, links are stored directly by rowid, not by key:
     if (m_curunlinkpoint < (int)m_unlinks.size()) {
-        return intersection_point(depthmapX::getMapAtIndex(m_shapes, m_unlinks[m_curunlinkpoint].a)->second.getLine(),
-                                  depthmapX::getMapAtIndex(m_shapes, m_unlinks[m_curunlinkpoint].b)->second.getLine(),
+        return intersection_point(getShapeRefFromIndex(m_unlinks[m_curunlinkpoint].a)->second.getLine(),
+                                  getShapeRefFromIndex(m_unlinks[m_curunlinkpoint].b)->second.getLine(),
                                   TOLERANCE_A);
     }
     return Point2f();
@@ -3149,8 +3445,8 @@ Point2f ShapeMap::getNextUnlinkPoint() const {
 std::vector<Point2f> ShapeMap::getAllUnlinkPoints() {
     std::vector<Point2f> unlinkPoints;
     for (size_t i = 0; i < m_unlinks.size(); i++) {
-        unlinkPoints.push_back(intersection_point(depthmapX::getMapAtIndex(m_shapes, m_unlinks[i].a)->second.getLine(),
-                                                  depthmapX::getMapAtIndex(m_shapes, m_unlinks[i].b)->second.getLine(),
+        unlinkPoints.push_back(intersection_point(getShapeRefFromIndex(m_unlinks[i].a)->second.getLine(),
+                                                  getShapeRefFromIndex(m_unlinks[i].b)->second.getLine(),
                                                   TOLERANCE_A));
     }
     return unlinkPoints;
@@ -3163,8 +3459,8 @@ void ShapeMap::outputUnlinkPoints(std::ofstream &stream, char delim) {
     for (size_t i = 0; i < m_unlinks.size(); i++) {
         // note, links are stored directly by rowid, not by key:
         Point2f p =
-            intersection_point(depthmapX::getMapAtIndex(m_shapes, m_unlinks[i].a)->second.getLine(),
-                               depthmapX::getMapAtIndex(m_shapes, m_unlinks[i].b)->second.getLine(), TOLERANCE_A);
+            intersection_point(getShapeRefFromIndex(m_unlinks[i].a)->second.getLine(),
+                               getShapeRefFromIndex(m_unlinks[i].b)->second.getLine(), TOLERANCE_A);
         stream << p.x << delim << p.y << std::endl;
     }
 }
@@ -30,10 +30,13 @@
 #include "genlib/bsptree.h"
 #include "genlib/containerutils.h"
 #include "genlib/p2dpoly.h"
+#include "genlib/packedrtree.h"
 #include "genlib/readwritehelpers.h"
 #include "genlib/stringutils.h"
 
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -165,7 +168,7 @@ class SalaShape {
     std::vector<SalaEdgeU> getClippingSet(QtRegion &clipframe) const;
     //
     bool read(std::istream &stream);
-    bool write(std::ofstream &stream);
+    bool write(std::ostream &stream);
 
     std::vector<Line> getAsLines() const {
         std::vector<Line> lines;
@@ -228,6 +231,9 @@ class ShapeMap : public PixelBase {
         COPY_GRAPH = 0x0008,
         COPY_ALL = 0x000f
     };
+    // the index the shape queries (point, line and poly in poly lists, closest line and shapes in
+    // region) are answered from. The pixel grid is kept up to date in either case
+    enum { PIXEL_GRID = 0, PACKED_RTREE = 1 };
 
   protected:
     std::string m_name;
@@ -244,8 +250,20 @@ class ShapeMap : public PixelBase {
     mutable BSPNode *m_bsp_root = nullptr;
     mutable bool m_bsp_tree = false;
     //
+    // packed R-tree over the shape bounding boxes, made on first use and dropped when the geometry changes
+    int m_spatial_index;
+    mutable std::unique_ptr<depthmapX::PackedRTree> m_rtree;
+    //
     std::map<int, SalaShape> m_shapes;
     //
+    // the shapes in key order, so that the shape at an index (the row of the shape in the
+    // attribute table and connectors) is found without walking the map. It is made on first
+    // use and dropped whenever a shape is added or removed (see invalidateShapeIndex)
+    mutable std::vector<std::map<int, SalaShape>::const_iterator> m_shape_index;
+    mutable std::atomic<bool> m_shape_index_valid{false};
+    mutable std::mutex m_shape_index_mutex;
+    const std::vector<std::map<int, SalaShape>::const_iterator> &getShapeIndex() const;
+    //
     std::vector<SalaEvent> m_undobuffer;
     //
     std::unique_ptr<AttributeTable> m_attributes;
@@ -280,10 +298,13 @@ private:
         m_cols = other.m_cols;
         m_region = std::move(other.m_region);
         m_map_type = other.m_map_type;
+        m_spatial_index = other.m_spatial_index;
+        invalidateShapeIndex();
+        other.invalidateShapeIndex();
     }
 
   public:
-    ShapeMap(const std::string &name = std::string(), int type = EMPTYMAP);
+    ShapeMap(const std::string &name = std::string(), int type = EMPTYMAP, int spatialIndex = PIXEL_GRID);
     virtual ~ShapeMap();
     void copy(const ShapeMap &shapemap, int copyflags = 0);
 
@@ -312,7 +333,19 @@ private:
     // that still use them are the connections of the axial/segment maps and the point
     // in polygon functions.
     const std::map<int, SalaShape>::const_iterator getShapeRefFromIndex(size_t index) const {
-        return depthmapX::getMapAtIndex(m_shapes, index);
+        return getShapeIndex()[index];
+    }
+    std::map<int, SalaShape>::iterator getShapeRefFromIndex(size_t index) {
+        auto iter = getShapeIndex()[index];
+        // an empty erase turns the const_iterator into an iterator without walking the map
+        return m_shapes.erase(iter, iter);
+    }
+    // the index of the shape with the key, or -1 if there is no such shape
+    int getIndexFromShapeRef(int shapeRef) const;
+    // call after adding or removing shapes, the R-tree is dropped with it as its items are indices
+    void invalidateShapeIndex() {
+        m_shape_index_valid = false;
+        m_rtree.reset();
     }
     AttributeRow &getAttributeRowFromShapeIndex(size_t index) {
         return m_attributes->getRow(AttributeKey(getShapeRefFromIndex(index)->first));
@@ -327,10 +360,10 @@ private:
     // num shapes for this object (note, request by object rowid
     // -- on interrogation, this is what you will usually receive)
     size_t getShapeCount(int rowid) const {
-        return depthmapX::getMapAtIndex(m_shapes, rowid)->second.m_points.size();
+        return getShapeRefFromIndex(rowid)->second.m_points.size();
     }
     //
-    int getIndex(int rowid) const { return depthmapX::getMapAtIndex(m_shapes, rowid)->first; }
+    int getIndex(int rowid) const { return getShapeRefFromIndex(rowid)->first; }
     //
     // add shape tools
     void makePolyPixels(int shaperef);
@@ -402,6 +435,15 @@ private:
     std::vector<int> lineInPolyList(const Line &li, size_t lineref = -1, double tolerance = 0.0) const;
     std::vector<int> polyInPolyList(int polyref, double tolerance = 0.0) const;
     std::vector<int> shapeInPolyList(const SalaShape &shape);
+    // the same lists for many points or shapes at once (in the order given), see shapeInPolyLists
+    std::vector<std::vector<int>> pointInPolyLists(const std::vector<Point2f> &points, int threads = 1) const;
+    std::vector<std::vector<int>> shapeInPolyLists(const std::vector<const SalaShape *> &shapes, int threads = 1);
+  private:
+    std::vector<int> openShapeInPolyList(const SalaShape &shape) const;
+    // the R-tree versions test the actual geometry of the shapes found through their bounding boxes
+    std::vector<int> rtreePolyInPolyList(const SalaShape &poly, int polyref, double tolerance) const;
+    std::vector<int> rtreeShapeInPolyList(const SalaShape &shape) const;
+  public:
     // helper to make actual test of point in shape:
     int testPointInPoly(const Point2f &p, const ShapeRef &shape) const;
     // also allow look for a close polyline:
@@ -413,13 +455,18 @@ private:
     // Connect a particular shape into the graph
     int connectIntersected(int rowid, bool linegraph);
     // Get the connections for a particular line
-    std::vector<int> getLineConnections(int lineref, double tolerance);
+    std::vector<int> getLineConnections(int lineref, double tolerance) const;
     // Get arbitrary shape connections for a particular shape
-    std::vector<int> getShapeConnections(int polyref, double tolerance);
+    std::vector<int> getShapeConnections(int polyref, double tolerance) const;
+    // Get the line (linegraph) or shape connections of all the shapes, in the order of the shapes
+    std::vector<std::vector<int>> getAllConnections(bool linegraph, double tolerance, int threads = 1) const;
     // Make all connections
-    void makeShapeConnections();
+    void makeShapeConnections(int threads = 1);
     //
     bool makeBSPtree() const;
+    // makes the R-tree if it is not there yet (do this before querying a PACKED_RTREE map from several threads)
+    void makeRTree() const;
+    int getSpatialIndex() const { return m_spatial_index; }
     //
     const std::vector<Connector> &getConnections() const { return m_connectors; }
     std::vector<Connector> &getConnections() { return m_connectors; }
@@ -515,7 +562,8 @@ private:
   public:
     // Selection
     bool hasSelectedElements() const { return !m_selection_set.empty(); }
-    const std::map<int, SalaShape> getShapesInRegion(const QtRegion &r) const;
+    // fills shapeIndices with the indices of the shapes in the region, in order and each once
+    void getShapesInRegion(const QtRegion &r, std::vector<size_t> &shapeIndices) const;
     bool setCurSel(QtRegion &r, bool add = false);
     bool setCurSel(const std::vector<int> &selset, bool add = false);
     bool setCurSelDirect(const std::vector<int> &selset, bool add = false);
@@ -554,7 +602,7 @@ private:
         ;
     }
     bool getShapeSelected() const {
-        return depthmapX::getMapAtIndex(m_shapes, m_display_shapes[m_current])->second.m_selected;
+        return getShapeRefFromIndex(m_display_shapes[m_current])->second.m_selected;
     }
     //
     double getLocationValue(const Point2f &point) const;
@@ -578,7 +626,7 @@ private:
   public:
     // file
     bool read(std::istream &stream);
-    bool write(std::ofstream &stream);
+    bool write(std::ostream &stream);
     //
     bool output(std::ofstream &stream, char delimiter = '\t');
     //
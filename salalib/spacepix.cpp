@@ -765,7 +765,7 @@ bool SpacePixel::read(std::istream &stream) {
     return true;
 }
 
-bool SpacePixel::write(std::ofstream &stream) {
+bool SpacePixel::write(std::ostream &stream) {
     // write name:
     dXstring::writeString(stream, m_name);
     stream.write((char *)&m_show, sizeof(m_show));
@@ -155,7 +155,7 @@ class SpacePixel : public PixelBase {
 
   public:
     virtual bool read(std::istream &stream);
-    virtual bool write(std::ofstream &stream);
+    virtual bool write(std::ostream &stream);
     friend bool operator==(const SpacePixel &a, const SpacePixel &b);
 };
 
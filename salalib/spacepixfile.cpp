@@ -42,7 +42,7 @@ bool SpacePixelFile::read( std::istream& stream )
    return true;
 }
 
-bool SpacePixelFile::write( std::ofstream& stream )
+bool SpacePixelFile::write( std::ostream& stream )
 {
    dXstring::writeString(stream, m_name);
    stream.write( (char *) &m_region, sizeof(m_region) );
@@ -53,5 +53,5 @@ public:
    //
 public:
    bool read(std::istream &stream);
-   bool write(std::ofstream& stream);
+   bool write(std::ostream& stream);
 };
@@ -18,12 +18,11 @@
 
 #include "salalib/vgamodules/vgaangular.h"
 
+#include "genlib/parallel.h"
 #include "genlib/stringutils.h"
 
 bool VGAAngular::run(Communicator *comm, PointMap &map, bool) {
-    time_t atime = 0;
     if (comm) {
-        qtimer(atime, 0);
         comm->CommPostMessage(Communicator::NUM_RECORDS, map.getFilledPointCount());
     }
 
@@ -51,83 +50,135 @@ bool VGAAngular::run(Communicator *comm, PointMap &map, bool) {
     // TODO: Binary compatibility. Remove in re-examination
     total_depth_col = attributes.getOrInsertColumn(total_detph_col_text.c_str());
 
-    int count = 0;
+    AttributeColumnValues meanDepthValues(attributes.getNumRows()), totalDepthValues(attributes.getNumRows()),
+        countValues(attributes.getNumRows());
 
-    for (size_t i = 0; i < map.getCols(); i++) {
-        for (size_t j = 0; j < map.getRows(); j++) {
-            PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
+    if (!m_gates_only) {
+        std::vector<PixelRef> origins;
+        for (size_t i = 0; i < map.getCols(); i++) {
+            for (size_t j = 0; j < map.getRows(); j++) {
+                PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
+                if (map.getPoint(curs).filled()) {
+                    origins.push_back(curs);
+                }
+            }
+        }
 
-            if (map.getPoint(curs).filled()) {
+        // as in VGAMetric each worker searches with its own state and the results are
+        // written in origin order afterwards
+        std::vector<AngularResult> results(origins.size());
+        depthmapX::parallelForWithScratch(
+            comm, origins.size(), m_threads, [&]() { return SearchState(map.getRows(), map.getCols()); },
+            [&](SearchState &state, size_t item) { results[item] = searchFrom(map, origins[item], state); });
+
+        for (size_t item = 0; item < origins.size(); item++) {
+            const AngularResult &result = results[item];
+            size_t row = attributes.getRowPosition(AttributeKey(origins[item]));
+            if (result.total_nodes > 0) {
+                meanDepthValues.setValue(row, float(double(result.total_angle) / double(result.total_nodes)));
+            }
+            totalDepthValues.setValue(row, result.total_angle);
+            countValues.setValue(row, float(result.total_nodes));
+        }
+    }
 
-                if (m_gates_only) {
-                    count++;
-                    continue;
-                }
+    attributes.setColumnValues(mean_depth_col, meanDepthValues);
+    attributes.setColumnValues(total_depth_col, totalDepthValues);
+    attributes.setColumnValues(count_col, countValues);
 
-                // TODO: Break out miscs/dist/cumangle into local variables and remove from Point class
-                for (auto &point : map.getPoints()) {
-                    point.m_misc = 0;
-                    point.m_dist = 0.0f;
-                    point.m_cumangle = -1.0f;
-                }
+    map.setDisplayedAttribute(-2);
+    map.setDisplayedAttribute(mean_depth_col);
 
-                float total_angle = 0.0f;
-                int total_nodes = 0;
-
-                // note that m_misc is used in a different manner to analyseGraph / PointDepth
-                // here it marks the node as used in calculation only
-
-                std::set<AngularTriple> search_list;
-                search_list.insert(AngularTriple(0.0f, curs, NoPixel));
-                map.getPoint(curs).m_cumangle = 0.0f;
-                while (search_list.size()) {
-                    std::set<AngularTriple>::iterator it = search_list.begin();
-                    AngularTriple here = *it;
-                    search_list.erase(it);
-                    if (m_radius != -1.0 && here.angle > m_radius) {
-                        break;
-                    }
-                    Point &p = map.getPoint(here.pixel);
-                    // nb, the filled check is necessary as diagonals seem to be stored with 'gaps' left in
-                    if (p.filled() && p.m_misc != ~0) {
-                        p.getNode().extractAngular(search_list, &map, here);
-                        p.m_misc = ~0;
-                        if (!p.getMergePixel().empty()) {
-                            Point &p2 = map.getPoint(p.getMergePixel());
-                            if (p2.m_misc != ~0) {
-                                p2.m_cumangle = p.m_cumangle;
-                                p2.getNode().extractAngular(search_list, &map,
-                                                            AngularTriple(here.angle, p.getMergePixel(), NoPixel));
-                                p2.m_misc = ~0;
-                            }
-                        }
-                        total_angle += p.m_cumangle;
-                        total_nodes += 1;
-                    }
-                }
+    return true;
+}
 
-                AttributeRow &row = map.getAttributeTable().getRow(AttributeKey(curs));
-                if (total_nodes > 0) {
-                    row.setValue(mean_depth_col, float(double(total_angle) / double(total_nodes)));
-                }
-                row.setValue(total_depth_col, total_angle);
-                row.setValue(count_col, float(total_nodes));
+VGAAngular::SearchState::SearchState(size_t rows, size_t cols) : miscs(rows, cols), cumangles(rows, cols) {
+    miscs.initialiseValues(0);
+    cumangles.initialiseValues(-1.0f);
+}
 
-                count++; // <- increment count
-            }
-            if (comm) {
-                if (qtimer(atime, 500)) {
-                    if (comm->IsCancelled()) {
-                        throw Communicator::CancelledException();
-                    }
-                    comm->CommPostMessage(Communicator::CURRENT_RECORD, count);
+void VGAAngular::SearchState::touch(PixelRef pix) { touched.push_back(pix); }
+
+void VGAAngular::SearchState::reset() {
+    // only the pixels reached by the last search need to be cleared
+    for (PixelRef pix : touched) {
+        miscs(pix.y, pix.x) = 0;
+        cumangles(pix.y, pix.x) = -1.0f;
+    }
+    touched.clear();
+}
+
+VGAAngular::AngularResult VGAAngular::searchFrom(PointMap &map, PixelRef curs, SearchState &state) const {
+    AngularResult result;
+
+    // note that misc is used in a different manner to analyseGraph / PointDepth
+    // here it marks the node as used in calculation only
+
+    depthmapX::RadixHeap<AngularTriple> &search_list = state.search_list;
+    search_list.push(AngularTriple(0.0f, curs, NoPixel));
+    state.cumangles(curs.y, curs.x) = 0.0f;
+    state.touch(curs);
+    while (!search_list.empty()) {
+        AngularTriple here = search_list.pop();
+        if (m_radius != -1.0 && here.angle > m_radius) {
+            break;
+        }
+        Point &p = map.getPoint(here.pixel);
+        int &misc = state.miscs(here.pixel.y, here.pixel.x);
+        // nb, the filled check is necessary as diagonals seem to be stored with 'gaps' left in
+        if (p.filled() && misc != ~0) {
+            extractAngular(p.getNode(), search_list, map, here, state);
+            misc = ~0;
+            state.touch(here.pixel);
+            PixelRef merge = p.getMergePixel();
+            if (!merge.empty()) {
+                int &misc2 = state.miscs(merge.y, merge.x);
+                if (misc2 != ~0) {
+                    state.cumangles(merge.y, merge.x) = state.cumangles(here.pixel.y, here.pixel.x);
+                    extractAngular(map.getPoint(merge).getNode(), search_list, map,
+                                   AngularTriple(here.angle, merge, NoPixel), state);
+                    misc2 = ~0;
+                    state.touch(merge);
                 }
             }
+            result.total_angle += state.cumangles(here.pixel.y, here.pixel.x);
+            result.total_nodes += 1;
         }
     }
+    search_list.clear();
+    state.reset();
 
-    map.setDisplayedAttribute(-2);
-    map.setDisplayedAttribute(mean_depth_col);
+    return result;
+}
 
-    return true;
+void VGAAngular::extractAngular(Node &node, depthmapX::RadixHeap<AngularTriple> &pixels, PointMap &map,
+                                const AngularTriple &curs, SearchState &state) const {
+    // the search of the old Node::extractAngular, but on the worker state
+    if (curs.angle == 0.0f || map.getPoint(curs.pixel).blocked() || map.blockedAdjacent(curs.pixel)) {
+        for (int i = 0; i < 32; i++) {
+            Bin &bin = node.bin(i);
+            for (auto pixVec : bin.m_pixel_vecs) {
+                for (PixelRef pix = pixVec.start(); pix.col(bin.m_dir) <= pixVec.end().col(bin.m_dir);) {
+                    if (state.miscs(pix.y, pix.x) == 0) {
+                        // n.b. dmap v4.06r now sets angle in range 0 to 4 (1 = 90 degrees)
+                        float ang = (curs.lastpixel == NoPixel)
+                                        ? 0.0f
+                                        : (float)(angle(pix, curs.pixel, curs.lastpixel) / (M_PI * 0.5));
+                        float &cumangle = state.cumangles(pix.y, pix.x);
+                        if (cumangle == -1.0 || curs.angle + ang < cumangle) {
+                            float lastangle = cumangle;
+                            if (cumangle == -1.0) {
+                                state.touch(pix);
+                            }
+                            cumangle = state.cumangles(curs.pixel.y, curs.pixel.x) + ang;
+                            if (cumangle != lastangle) {
+                                pixels.push(AngularTriple(cumangle, pix, curs.pixel));
+                            }
+                        }
+                    }
+                    pix.move(bin.m_dir);
+                }
+            }
+        }
+    }
 }
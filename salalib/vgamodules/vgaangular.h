@@ -22,13 +22,38 @@
 #include "salalib/pixelref.h"
 #include "salalib/pointdata.h"
 
+#include "genlib/simplematrix.h"
+
 class VGAAngular : IVGA {
   private:
     double m_radius;
     bool m_gates_only;
+    int m_threads;
+
+    // search state for one worker, kept out of the shared Point so that several
+    // origins can be searched at the same time
+    struct SearchState {
+        depthmapX::RowMatrix<int> miscs;
+        depthmapX::RowMatrix<float> cumangles;
+        PixelRefVector touched;
+        depthmapX::RadixHeap<AngularTriple> search_list;
+        SearchState(size_t rows, size_t cols);
+        void touch(PixelRef pix);
+        void reset();
+    };
+    struct AngularResult {
+        float total_angle = 0.0f;
+        int total_nodes = 0;
+    };
+
+    AngularResult searchFrom(PointMap &map, PixelRef curs, SearchState &state) const;
+    void extractAngular(Node &node, depthmapX::RadixHeap<AngularTriple> &pixels, PointMap &map,
+                        const AngularTriple &curs, SearchState &state) const;
 
   public:
     std::string getAnalysisName() const override { return "Angular Analysis"; }
-    bool run(Communicator *, PointMap &map, bool) override;
-    VGAAngular(double radius, bool gates_only) : m_radius(radius), m_gates_only(gates_only) {}
+    bool run(Communicator *comm, PointMap &map, bool) override;
+    // threads: number of origins to search concurrently (0 to use all available cores)
+    VGAAngular(double radius, bool gates_only, int threads = 1)
+        : m_radius(radius), m_gates_only(gates_only), m_threads(threads) {}
 };
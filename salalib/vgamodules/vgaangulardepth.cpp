@@ -27,42 +27,42 @@ bool VGAAngularDepth::run(Communicator *, PointMap &map, bool) {
     // n.b., insert columns sets values to -1 if the column already exists
     int path_angle_col = attributes.insertOrResetColumn("Angular Step Depth");
 
-    for (auto iter = attributes.begin(); iter != attributes.end(); iter++) {
-        PixelRef pix = iter->getKey().value;
-        map.getPoint(pix).m_misc = 0;
-        map.getPoint(pix).m_dist = 0.0f;
-        map.getPoint(pix).m_cumangle = -1.0f;
-    }
+    // the search state is kept here rather than on the points so the map is not changed
+    depthmapX::RowMatrix<int> miscs(map.getRows(), map.getCols());
+    depthmapX::RowMatrix<float> cumangles(map.getRows(), map.getCols());
+    miscs.initialiseValues(0);
+    cumangles.initialiseValues(-1.0f);
 
-    std::set<AngularTriple> search_list; // contains root point
+    depthmapX::RadixHeap<AngularTriple> search_list; // contains root point
 
     for (auto &sel : map.getSelSet()) {
-        search_list.insert(AngularTriple(0.0f, sel, NoPixel));
-        map.getPoint(sel).m_cumangle = 0.0f;
+        search_list.push(AngularTriple(0.0f, sel, NoPixel));
+        PixelRef pix = sel;
+        cumangles(pix.y, pix.x) = 0.0f;
     }
 
-    // note that m_misc is used in a different manner to analyseGraph / PointDepth
+    // note that misc is used in a different manner to analyseGraph / PointDepth
     // here it marks the node as used in calculation only
-    while (search_list.size()) {
-        std::set<AngularTriple>::iterator it = search_list.begin();
-        AngularTriple here = *it;
-        search_list.erase(it);
+    while (!search_list.empty()) {
+        AngularTriple here = search_list.pop();
         Point &p = map.getPoint(here.pixel);
         // nb, the filled check is necessary as diagonals seem to be stored with 'gaps' left in
-        if (p.filled() && p.m_misc != ~0) {
-            p.getNode().extractAngular(search_list, &map, here);
-            p.m_misc = ~0;
+        int &misc = miscs(here.pixel.y, here.pixel.x);
+        if (p.filled() && misc != ~0) {
+            extractAngular(p.getNode(), search_list, map, here, miscs, cumangles);
+            misc = ~0;
             AttributeRow &row = map.getAttributeTable().getRow(AttributeKey(here.pixel));
-            row.setValue(path_angle_col, float(p.m_cumangle));
-            if (!p.getMergePixel().empty()) {
-                Point &p2 = map.getPoint(p.getMergePixel());
-                if (p2.m_misc != ~0) {
-                    p2.m_cumangle = p.m_cumangle;
-                    AttributeRow &mergePixelRow = map.getAttributeTable().getRow(AttributeKey(p.getMergePixel()));
-                    mergePixelRow.setValue(path_angle_col, float(p2.m_cumangle));
-                    p2.getNode().extractAngular(search_list, &map,
-                                                AngularTriple(here.angle, p.getMergePixel(), NoPixel));
-                    p2.m_misc = ~0;
+            row.setValue(path_angle_col, float(cumangles(here.pixel.y, here.pixel.x)));
+            PixelRef merge = p.getMergePixel();
+            if (!merge.empty()) {
+                int &misc2 = miscs(merge.y, merge.x);
+                if (misc2 != ~0) {
+                    cumangles(merge.y, merge.x) = cumangles(here.pixel.y, here.pixel.x);
+                    AttributeRow &mergePixelRow = map.getAttributeTable().getRow(AttributeKey(merge));
+                    mergePixelRow.setValue(path_angle_col, float(cumangles(merge.y, merge.x)));
+                    extractAngular(map.getPoint(merge).getNode(), search_list, map,
+                                   AngularTriple(here.angle, merge, NoPixel), miscs, cumangles);
+                    misc2 = ~0;
                 }
             }
         }
@@ -73,3 +73,32 @@ bool VGAAngularDepth::run(Communicator *, PointMap &map, bool) {
 
     return true;
 }
+
+void VGAAngularDepth::extractAngular(Node &node, depthmapX::RadixHeap<AngularTriple> &pixels, PointMap &map,
+                                     const AngularTriple &curs, depthmapX::RowMatrix<int> &miscs,
+                                     depthmapX::RowMatrix<float> &cumangles) {
+    if (curs.angle == 0.0f || map.getPoint(curs.pixel).blocked() || map.blockedAdjacent(curs.pixel)) {
+        for (int i = 0; i < 32; i++) {
+            Bin &bin = node.bin(i);
+            for (auto pixVec : bin.m_pixel_vecs) {
+                for (PixelRef pix = pixVec.start(); pix.col(bin.m_dir) <= pixVec.end().col(bin.m_dir);) {
+                    if (miscs(pix.y, pix.x) == 0) {
+                        // n.b. dmap v4.06r now sets angle in range 0 to 4 (1 = 90 degrees)
+                        float ang = (curs.lastpixel == NoPixel)
+                                        ? 0.0f
+                                        : (float)(angle(pix, curs.pixel, curs.lastpixel) / (M_PI * 0.5));
+                        float &cumangle = cumangles(pix.y, pix.x);
+                        if (cumangle == -1.0 || curs.angle + ang < cumangle) {
+                            float lastangle = cumangle;
+                            cumangle = cumangles(curs.pixel.y, curs.pixel.x) + ang;
+                            if (cumangle != lastangle) {
+                                pixels.push(AngularTriple(cumangle, pix, curs.pixel));
+                            }
+                        }
+                    }
+                    pix.move(bin.m_dir);
+                }
+            }
+        }
+    }
+}
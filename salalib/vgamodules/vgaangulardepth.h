@@ -22,7 +22,14 @@
 #include "salalib/pixelref.h"
 #include "salalib/pointdata.h"
 
+#include "genlib/simplematrix.h"
+
 class VGAAngularDepth : IVGA {
+  private:
+    void extractAngular(Node &node, depthmapX::RadixHeap<AngularTriple> &pixels, PointMap &map,
+                        const AngularTriple &curs, depthmapX::RowMatrix<int> &miscs,
+                        depthmapX::RowMatrix<float> &cumangles);
+
   public:
     std::string getAnalysisName() const override { return "Angular Depth"; }
     bool run(Communicator *comm, PointMap &map, bool) override;
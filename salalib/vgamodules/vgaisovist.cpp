@@ -19,6 +19,7 @@
 #include "salalib/vgamodules/vgaisovist.h"
 #include "salalib/isovist.h"
 
+#include "genlib/parallel.h"
 #include "genlib/stringutils.h"
 
 bool VGAIsovist::run(Communicator *comm, PointMap &map, bool simple_version) {
@@ -29,59 +30,68 @@ bool VGAIsovist::run(Communicator *comm, PointMap &map, bool simple_version) {
         comm->CommPostMessage(Communicator::NUM_STEPS, 2);
         comm->CommPostMessage(Communicator::CURRENT_STEP, 1);
     }
-    BSPNode bspRoot = makeBSPtree(comm, map.getDrawingFiles());
+    FlatBSPTree bspTree = BSPTree::flatten(makeBSPtree(comm, map.getDrawingFiles()));
 
     AttributeTable &attributes = map.getAttributeTable();
 
     if(comm) comm->CommPostMessage(Communicator::CURRENT_STEP, 2);
 
-    time_t atime = 0;
-    if (comm) {
-        qtimer(atime, 0);
-        comm->CommPostMessage(Communicator::NUM_RECORDS, map.getFilledPointCount());
-    }
-    int count = 0;
-
+    std::vector<PixelRef> origins;
     for (size_t i = 0; i < map.getCols(); i++) {
         for (size_t j = 0; j < map.getRows(); j++) {
             PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
-            if (map.getPoint(curs).filled()) {
-                count++;
-                if (map.getPoint(curs).contextfilled() && !curs.iseven()) {
-                    continue;
-                }
-                Isovist isovist;
-                isovist.makeit(&bspRoot, map.depixelate(curs), map.getRegion(), 0, 0);
-
-                AttributeRow &row = attributes.getRow(AttributeKey(curs));
-                isovist.setData(attributes, row, simple_version);
-                Node &node = map.getPoint(curs).getNode();
-                std::vector<PixelRef> *occ = node.m_occlusion_bins;
-                for (size_t k = 0; k < 32; k++) {
-                    occ[k].clear();
-                    node.bin(static_cast<int>(k)).setOccDistance(0.0f);
-                }
-                for (size_t k = 0; k < isovist.getOcclusionPoints().size(); k++) {
-                    const PointDist &pointdist = isovist.getOcclusionPoints().at(k);
-                    int bin = whichbin(pointdist.m_point - map.depixelate(curs));
-                    // only occlusion bins with a certain distance recorded (arbitrary scale note!)
-                    if (pointdist.m_dist > 1.5) {
-                        PixelRef pix = map.pixelate(pointdist.m_point);
-                        if (pix != curs) {
-                            occ[bin].push_back(pix);
-                        }
-                    }
-                    node.bin(bin).setOccDistance(static_cast<float>(pointdist.m_dist));
-                }
+            if (map.getPoint(curs).filled() && !(map.getPoint(curs).contextfilled() && !curs.iseven())) {
+                origins.push_back(curs);
             }
-            if (comm) {
-                if (qtimer(atime, 500)) {
-                    if (comm->IsCancelled()) {
-                        throw Communicator::CancelledException();
-                    }
-                    comm->CommPostMessage(Communicator::CURRENT_RECORD, count);
+        }
+    }
+    if (comm) {
+        comm->CommPostMessage(Communicator::NUM_RECORDS, static_cast<int>(origins.size()));
+    }
+
+    // each worker makes isovists with its own scratch, and only writes to the node of the origin pixel,
+    // while the attribute values are gathered per column and written in one go afterwards
+    std::vector<std::string> colNames = Isovist::getColumnNames(simple_version);
+    std::vector<size_t> rows(origins.size());
+    for (size_t item = 0; item < origins.size(); item++) {
+        rows[item] = attributes.getRowPosition(AttributeKey(origins[item]));
+    }
+    std::vector<AttributeColumnValues> colValues(colNames.size(), AttributeColumnValues(attributes.getNumRows()));
+
+    depthmapX::parallelForWithScratch(comm, origins.size(), m_threads, []() { return Isovist(); },
+                                      [&](Isovist &isovist, size_t item) {
+        PixelRef curs = origins[item];
+        isovist.makeit(bspTree, map.depixelate(curs), map.getRegion(), 0, 0);
+
+        std::vector<float> values = isovist.getColumnValues(simple_version);
+        for (size_t k = 0; k < values.size(); k++) {
+            colValues[k].setValue(rows[item], values[k]);
+        }
+        Node &node = map.getPoint(curs).getNode();
+        std::vector<PixelRef> *occ = node.m_occlusion_bins;
+        for (size_t k = 0; k < 32; k++) {
+            occ[k].clear();
+            node.bin(static_cast<int>(k)).setOccDistance(0.0f);
+        }
+        for (size_t k = 0; k < isovist.getOcclusionPoints().size(); k++) {
+            const PointDist &pointdist = isovist.getOcclusionPoints().at(k);
+            int bin = whichbin(pointdist.m_point - map.depixelate(curs));
+            // only occlusion bins with a certain distance recorded (arbitrary scale note!)
+            if (pointdist.m_dist > 1.5) {
+                PixelRef pix = map.pixelate(pointdist.m_point);
+                if (pix != curs) {
+                    occ[bin].push_back(pix);
                 }
             }
+            node.bin(bin).setOccDistance(static_cast<float>(pointdist.m_dist));
+        }
+    });
+
+    // columns are only added once there is an isovist to fill them with, as before
+    if (!origins.empty()) {
+        for (size_t k = 0; k < colNames.size(); k++) {
+            size_t col = attributes.getOrInsertColumn(colNames[k]);
+            attributes.setColumnValues(col, colValues[k]);
         }
     }
     map.m_hasIsovistAnalysis = true;
@@ -23,8 +23,13 @@
 #include "salalib/pointdata.h"
 
 class VGAIsovist : IVGA {
+  private:
+    int m_threads;
+
   public:
     std::string getAnalysisName() const override { return "Isovist Analysis"; }
+    // threads: number of isovists to make concurrently (0 to use all available cores)
+    VGAIsovist(int threads = 1) : m_threads(threads) {}
     bool run(Communicator *comm, PointMap &map, bool simple_version) override;
     BSPNode makeBSPtree(Communicator *communicator, const std::vector<SpacePixelFile> &drawingFiles);
 };
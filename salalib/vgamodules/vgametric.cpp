@@ -18,15 +18,14 @@
 
 #include "salalib/vgamodules/vgametric.h"
 
+#include "genlib/parallel.h"
 #include "genlib/stringutils.h"
 
 // This is a slow algorithm, but should give the correct answer
 // for demonstrative purposes
 
 bool VGAMetric::run(Communicator *comm, PointMap &map, bool) {
-    time_t atime = 0;
     if (comm) {
-        qtimer(atime, 0);
         comm->CommPostMessage(Communicator::NUM_RECORDS, map.getFilledPointCount());
     }
 
@@ -52,85 +51,136 @@ bool VGAMetric::run(Communicator *comm, PointMap &map, bool) {
     std::string count_col_text = std::string("Metric Node Count") + radius_text;
     int count_col = attributes.insertOrResetColumn(count_col_text.c_str());
 
-    int count = 0;
+    if (!m_gates_only) {
+        std::vector<PixelRef> origins;
+        for (size_t i = 0; i < map.getCols(); i++) {
+            for (size_t j = 0; j < map.getRows(); j++) {
+                PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
+                if (map.getPoint(curs).filled()) {
+                    origins.push_back(curs);
+                }
+            }
+        }
 
-    for (size_t i = 0; i < map.getCols(); i++) {
-        for (size_t j = 0; j < map.getRows(); j++) {
-            PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
+        // each worker searches with its own state, and the results are written
+        // in origin order afterwards so that the table is the same for any thread count
+        std::vector<MetricResult> results(origins.size());
+        depthmapX::parallelForWithScratch(
+            comm, origins.size(), m_threads, [&]() { return SearchState(map.getRows(), map.getCols()); },
+            [&](SearchState &state, size_t item) { results[item] = searchFrom(map, origins[item], state); });
+
+        AttributeColumnValues mspaValues(attributes.getNumRows()), msplValues(attributes.getNumRows()),
+            distValues(attributes.getNumRows()), countValues(attributes.getNumRows());
+        for (size_t item = 0; item < origins.size(); item++) {
+            const MetricResult &result = results[item];
+            size_t row = attributes.getRowPosition(AttributeKey(origins[item]));
+            mspaValues.setValue(row, float(double(result.total_angle) / double(result.total_nodes)));
+            msplValues.setValue(row, float(double(result.total_depth) / double(result.total_nodes)));
+            distValues.setValue(row, float(double(result.euclid_depth) / double(result.total_nodes)));
+            countValues.setValue(row, float(result.total_nodes));
+        }
+        attributes.setColumnValues(mspa_col, mspaValues);
+        attributes.setColumnValues(mspl_col, msplValues);
+        attributes.setColumnValues(dist_col, distValues);
+        attributes.setColumnValues(count_col, countValues);
+    }
 
-            if (map.getPoint(curs).filled()) {
+    map.overrideDisplayedAttribute(-2);
+    map.setDisplayedAttribute(mspl_col);
 
-                if (m_gates_only) {
-                    count++;
-                    continue;
-                }
+    return true;
+}
 
-                // TODO: Break out miscs/dist/cumangle into local variables and remove from Point class
-                for (auto &point : map.getPoints()) {
-                    point.m_misc = 0;
-                    point.m_dist = -1.0f;
-                    point.m_cumangle = 0.0f;
-                }
+VGAMetric::SearchState::SearchState(size_t rows, size_t cols)
+    : miscs(rows, cols), dists(rows, cols), cumangles(rows, cols) {
+    miscs.initialiseValues(0);
+    dists.initialiseValues(-1.0f);
+    cumangles.initialiseValues(0.0f);
+}
 
-                float euclid_depth = 0.0f;
-                float total_depth = 0.0f;
-                float total_angle = 0.0f;
-                int total_nodes = 0;
-
-                // note that m_misc is used in a different manner to analyseGraph / PointDepth
-                // here it marks the node as used in calculation only
-
-                std::set<MetricTriple> search_list;
-                search_list.insert(MetricTriple(0.0f, curs, NoPixel));
-                while (search_list.size()) {
-                    std::set<MetricTriple>::iterator it = search_list.begin();
-                    MetricTriple here = *it;
-                    search_list.erase(it);
-                    if (m_radius != -1.0 && (here.dist * map.getSpacing()) > m_radius) {
-                        break;
-                    }
-                    Point &p = map.getPoint(here.pixel);
-                    // nb, the filled check is necessary as diagonals seem to be stored with 'gaps' left in
-                    if (p.filled() && p.m_misc != ~0) {
-                        p.getNode().extractMetric(search_list, &map, here);
-                        p.m_misc = ~0;
-                        if (!p.getMergePixel().empty()) {
-                            Point &p2 = map.getPoint(p.getMergePixel());
-                            if (p2.m_misc != ~0) {
-                                p2.m_cumangle = p.m_cumangle;
-                                p2.getNode().extractMetric(search_list, &map,
-                                                           MetricTriple(here.dist, p.getMergePixel(), NoPixel));
-                                p2.m_misc = ~0;
-                            }
-                        }
-                        total_depth += float(here.dist * map.getSpacing());
-                        total_angle += p.m_cumangle;
-                        euclid_depth += float(map.getSpacing() * dist(here.pixel, curs));
-                        total_nodes += 1;
-                    }
-                }
+void VGAMetric::SearchState::touch(PixelRef pix) { touched.push_back(pix); }
+
+void VGAMetric::SearchState::reset() {
+    // only the pixels reached by the last search need to be cleared
+    for (PixelRef pix : touched) {
+        miscs(pix.y, pix.x) = 0;
+        dists(pix.y, pix.x) = -1.0f;
+        cumangles(pix.y, pix.x) = 0.0f;
+    }
+    touched.clear();
+}
 
-                AttributeRow &row = attributes.getRow(AttributeKey(curs));
-                row.setValue(mspa_col, float(double(total_angle) / double(total_nodes)));
-                row.setValue(mspl_col, float(double(total_depth) / double(total_nodes)));
-                row.setValue(dist_col, float(double(euclid_depth) / double(total_nodes)));
-                row.setValue(count_col, float(total_nodes));
+VGAMetric::MetricResult VGAMetric::searchFrom(PointMap &map, PixelRef curs, SearchState &state) const {
+    MetricResult result;
 
-                count++; // <- increment count
-            }
-            if (comm) {
-                if (qtimer(atime, 500)) {
-                    if (comm->IsCancelled()) {
-                        throw Communicator::CancelledException();
-                    }
-                    comm->CommPostMessage(Communicator::CURRENT_RECORD, count);
+    // note that misc is used in a different manner to analyseGraph / PointDepth
+    // here it marks the node as used in calculation only
+
+    depthmapX::RadixHeap<MetricTriple> &search_list = state.search_list;
+    search_list.push(MetricTriple(0.0f, curs, NoPixel));
+    while (!search_list.empty()) {
+        MetricTriple here = search_list.pop();
+        if (m_radius != -1.0 && (here.dist * map.getSpacing()) > m_radius) {
+            break;
+        }
+        Point &p = map.getPoint(here.pixel);
+        int &misc = state.miscs(here.pixel.y, here.pixel.x);
+        // nb, the filled check is necessary as diagonals seem to be stored with 'gaps' left in
+        if (p.filled() && misc != ~0) {
+            extractMetric(p.getNode(), search_list, map, here, state);
+            misc = ~0;
+            state.touch(here.pixel);
+            PixelRef merge = p.getMergePixel();
+            if (!merge.empty()) {
+                int &misc2 = state.miscs(merge.y, merge.x);
+                if (misc2 != ~0) {
+                    state.cumangles(merge.y, merge.x) = state.cumangles(here.pixel.y, here.pixel.x);
+                    extractMetric(map.getPoint(merge).getNode(), search_list, map,
+                                  MetricTriple(here.dist, merge, NoPixel), state);
+                    misc2 = ~0;
+                    state.touch(merge);
                 }
             }
+            result.total_depth += float(here.dist * map.getSpacing());
+            result.total_angle += state.cumangles(here.pixel.y, here.pixel.x);
+            result.euclid_depth += float(map.getSpacing() * dist(here.pixel, curs));
+            result.total_nodes += 1;
         }
     }
+    search_list.clear();
+    state.reset();
 
-    map.overrideDisplayedAttribute(-2);
-    map.setDisplayedAttribute(mspl_col);
+    return result;
+}
 
-    return true;
+void VGAMetric::extractMetric(Node &node, depthmapX::RadixHeap<MetricTriple> &pixels, PointMap &map, const MetricTriple &curs,
+                              SearchState &state) const {
+    // the search of the old Node::extractMetric, but on the worker state
+    if (curs.dist == 0.0f || map.getPoint(curs.pixel).blocked() || map.blockedAdjacent(curs.pixel)) {
+        for (int i = 0; i < 32; i++) {
+            Bin &bin = node.bin(i);
+            for (auto pixVec : bin.m_pixel_vecs) {
+                for (PixelRef pix = pixVec.start(); pix.col(bin.m_dir) <= pixVec.end().col(bin.m_dir);) {
+                    float &pdist = state.dists(pix.y, pix.x);
+                    if (state.miscs(pix.y, pix.x) == 0 &&
+                        (pdist == -1.0 || (curs.dist + dist(pix, curs.pixel) < pdist))) {
+                        float lastdist = pdist;
+                        if (pdist == -1.0) {
+                            state.touch(pix);
+                        }
+                        pdist = curs.dist + (float)dist(pix, curs.pixel);
+                        // n.b. dmap v4.06r now sets angle in range 0 to 4 (1 = 90 degrees)
+                        state.cumangles(pix.y, pix.x) =
+                            state.cumangles(curs.pixel.y, curs.pixel.x) +
+                            (curs.lastpixel == NoPixel ? 0.0f
+                                                       : (float)(angle(pix, curs.pixel, curs.lastpixel) / (M_PI * 0.5)));
+                        if (pdist != lastdist) {
+                            pixels.push(MetricTriple(pdist, pix, curs.pixel));
+                        }
+                    }
+                    pix.move(bin.m_dir);
+                }
+            }
+        }
+    }
 }
@@ -22,13 +22,41 @@
 #include "salalib/pixelref.h"
 #include "salalib/pointdata.h"
 
+#include "genlib/simplematrix.h"
+
 class VGAMetric : IVGA {
   private:
     double m_radius;
     bool m_gates_only;
+    int m_threads;
+
+    // search state for one worker, kept out of the shared Point so that several
+    // origins can be searched at the same time
+    struct SearchState {
+        depthmapX::RowMatrix<int> miscs;
+        depthmapX::RowMatrix<float> dists;
+        depthmapX::RowMatrix<float> cumangles;
+        PixelRefVector touched;
+        depthmapX::RadixHeap<MetricTriple> search_list;
+        SearchState(size_t rows, size_t cols);
+        void touch(PixelRef pix);
+        void reset();
+    };
+    struct MetricResult {
+        float total_angle = 0.0f;
+        float total_depth = 0.0f;
+        float euclid_depth = 0.0f;
+        int total_nodes = 0;
+    };
+
+    MetricResult searchFrom(PointMap &map, PixelRef curs, SearchState &state) const;
+    void extractMetric(Node &node, depthmapX::RadixHeap<MetricTriple> &pixels, PointMap &map, const MetricTriple &curs,
+                       SearchState &state) const;
 
   public:
     std::string getAnalysisName() const override { return "Metric Analysis"; }
     bool run(Communicator *comm, PointMap &map, bool) override;
-    VGAMetric(double radius, bool gates_only) : m_radius(radius), m_gates_only(gates_only) {}
+    // threads: number of origins to search concurrently (0 to use all available cores)
+    VGAMetric(double radius, bool gates_only, int threads = 1)
+        : m_radius(radius), m_gates_only(gates_only), m_threads(threads) {}
 };
@@ -33,53 +33,54 @@ bool VGAMetricDepth::run(Communicator *, PointMap &map, bool) {
         dist_col = attributes.insertOrResetColumn("Metric Straight-Line Distance");
     }
 
-    for (auto iter = attributes.begin(); iter != attributes.end(); iter++) {
-        PixelRef pix = iter->getKey().value;
-        map.getPoint(pix).m_misc = 0;
-        map.getPoint(pix).m_dist = -1.0f;
-        map.getPoint(pix).m_cumangle = 0.0f;
-    }
+    // the search state is kept here rather than on the points so the map is not changed
+    depthmapX::RowMatrix<int> miscs(map.getRows(), map.getCols());
+    depthmapX::RowMatrix<float> dists(map.getRows(), map.getCols());
+    depthmapX::RowMatrix<float> cumangles(map.getRows(), map.getCols());
+    miscs.initialiseValues(0);
+    dists.initialiseValues(-1.0f);
+    cumangles.initialiseValues(0.0f);
 
     // in order to calculate Penn angle, the MetricPair becomes a metric triple...
-    std::set<MetricTriple> search_list; // contains root point
+    depthmapX::RadixHeap<MetricTriple> search_list; // contains root point
 
     for (auto &sel : map.getSelSet()) {
-        search_list.insert(MetricTriple(0.0f, sel, NoPixel));
+        search_list.push(MetricTriple(0.0f, sel, NoPixel));
     }
 
-    // note that m_misc is used in a different manner to analyseGraph / PointDepth
+    // note that misc is used in a different manner to analyseGraph / PointDepth
     // here it marks the node as used in calculation only
-    while (search_list.size()) {
-        std::set<MetricTriple>::iterator it = search_list.begin();
-        MetricTriple here = *it;
-        search_list.erase(it);
+    while (!search_list.empty()) {
+        MetricTriple here = search_list.pop();
         Point &p = map.getPoint(here.pixel);
         // nb, the filled check is necessary as diagonals seem to be stored with 'gaps' left in
-        if (p.filled() && p.m_misc != ~0) {
-            p.getNode().extractMetric(search_list, &map, here);
-            p.m_misc = ~0;
+        int &misc = miscs(here.pixel.y, here.pixel.x);
+        if (p.filled() && misc != ~0) {
+            extractMetric(p.getNode(), search_list, map, here, miscs, dists, cumangles);
+            misc = ~0;
             AttributeRow &row = map.getAttributeTable().getRow(AttributeKey(here.pixel));
             row.setValue(path_length_col, float(map.getSpacing() * here.dist));
-            row.setValue(path_angle_col, float(p.m_cumangle));
+            row.setValue(path_angle_col, float(cumangles(here.pixel.y, here.pixel.x)));
             if (map.getSelSet().size() == 1) {
                 // Note: Euclidean distance is currently only calculated from a single point
                 row.setValue(dist_col, float(map.getSpacing() * dist(here.pixel, *map.getSelSet().begin())));
             }
-            if (!p.getMergePixel().empty()) {
-                Point &p2 = map.getPoint(p.getMergePixel());
-                if (p2.m_misc != ~0) {
-                    p2.m_cumangle = p.m_cumangle;
-                    AttributeRow &mergePixelRow =
-                        map.getAttributeTable().getRow(AttributeKey(p.getMergePixel()));
+            PixelRef merge = p.getMergePixel();
+            if (!merge.empty()) {
+                int &misc2 = miscs(merge.y, merge.x);
+                if (misc2 != ~0) {
+                    cumangles(merge.y, merge.x) = cumangles(here.pixel.y, here.pixel.x);
+                    AttributeRow &mergePixelRow = map.getAttributeTable().getRow(AttributeKey(merge));
                     mergePixelRow.setValue(path_length_col, float(map.getSpacing() * here.dist));
-                    mergePixelRow.setValue(path_angle_col, float(p2.m_cumangle));
+                    mergePixelRow.setValue(path_angle_col, float(cumangles(merge.y, merge.x)));
                     if (map.getSelSet().size() == 1) {
                         // Note: Euclidean distance is currently only calculated from a single point
-                        mergePixelRow.setValue(
-                            dist_col, float(map.getSpacing() * dist(p.getMergePixel(), *map.getSelSet().begin())));
+                        mergePixelRow.setValue(dist_col,
+                                               float(map.getSpacing() * dist(merge, *map.getSelSet().begin())));
                     }
-                    p2.getNode().extractMetric(search_list, &map, MetricTriple(here.dist, p.getMergePixel(), NoPixel));
-                    p2.m_misc = ~0;
+                    extractMetric(map.getPoint(merge).getNode(), search_list, map, MetricTriple(here.dist, merge, NoPixel),
+                                  miscs, dists, cumangles);
+                    misc2 = ~0;
                 }
             }
         }
@@ -90,3 +91,31 @@ bool VGAMetricDepth::run(Communicator *, PointMap &map, bool) {
 
     return true;
 }
+
+void VGAMetricDepth::extractMetric(Node &node, depthmapX::RadixHeap<MetricTriple> &pixels, PointMap &map,
+                                   const MetricTriple &curs, depthmapX::RowMatrix<int> &miscs,
+                                   depthmapX::RowMatrix<float> &dists, depthmapX::RowMatrix<float> &cumangles) {
+    if (curs.dist == 0.0f || map.getPoint(curs.pixel).blocked() || map.blockedAdjacent(curs.pixel)) {
+        for (int i = 0; i < 32; i++) {
+            Bin &bin = node.bin(i);
+            for (auto pixVec : bin.m_pixel_vecs) {
+                for (PixelRef pix = pixVec.start(); pix.col(bin.m_dir) <= pixVec.end().col(bin.m_dir);) {
+                    float &pdist = dists(pix.y, pix.x);
+                    if (miscs(pix.y, pix.x) == 0 && (pdist == -1.0 || (curs.dist + dist(pix, curs.pixel) < pdist))) {
+                        float lastdist = pdist;
+                        pdist = curs.dist + (float)dist(pix, curs.pixel);
+                        // n.b. dmap v4.06r now sets angle in range 0 to 4 (1 = 90 degrees)
+                        cumangles(pix.y, pix.x) =
+                            cumangles(curs.pixel.y, curs.pixel.x) +
+                            (curs.lastpixel == NoPixel ? 0.0f
+                                                       : (float)(angle(pix, curs.pixel, curs.lastpixel) / (M_PI * 0.5)));
+                        if (pdist != lastdist) {
+                            pixels.push(MetricTriple(pdist, pix, curs.pixel));
+                        }
+                    }
+                    pix.move(bin.m_dir);
+                }
+            }
+        }
+    }
+}
@@ -22,7 +22,14 @@
 #include "salalib/pixelref.h"
 #include "salalib/pointdata.h"
 
+#include "genlib/simplematrix.h"
+
 class VGAMetricDepth : IVGA {
+  private:
+    void extractMetric(Node &node, depthmapX::RadixHeap<MetricTriple> &pixels, PointMap &map, const MetricTriple &curs,
+                       depthmapX::RowMatrix<int> &miscs, depthmapX::RowMatrix<float> &dists,
+                       depthmapX::RowMatrix<float> &cumangles);
+
   public:
     std::string getAnalysisName() const override { return "Metric Depth"; }
     bool run(Communicator *, PointMap &map, bool) override;
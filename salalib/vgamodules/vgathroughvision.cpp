@@ -19,6 +19,7 @@
 #include "salalib/vgamodules/vgathroughvision.h"
 #include "salalib/agents/agenthelpers.h"
 
+#include "genlib/simplematrix.h"
 #include "genlib/stringutils.h"
 
 // This is a slow algorithm, but should give the correct answer
@@ -34,12 +35,9 @@ bool VGAThroughVision::run(Communicator *comm, PointMap &map, bool) {
     AttributeTable &attributes = map.getAttributeTable();
 
     // current version (not sure of differences!)
-    for (size_t i = 0; i < map.getCols(); i++) {
-        for (size_t j = 0; j < map.getRows(); j++) {
-            PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
-            map.getPoint(curs).m_misc = 0;
-        }
-    }
+    // the number of lines of sight through each pixel, kept here rather than on the points
+    depthmapX::RowMatrix<int> counts(map.getRows(), map.getCols());
+    counts.initialiseValues(0);
 
     bool hasGateColumn = map.getAttributeTable().hasColumn(g_col_gate);
 
@@ -56,7 +54,7 @@ bool VGAThroughVision::run(Communicator *comm, PointMap &map, bool) {
                     PixelRefVector pixels = map.quickPixelateLine(x, curs);
                     for (size_t k = 1; k < pixels.size() - 1; k++) {
                         PixelRef key = pixels[k];
-                        map.getPoint(key).m_misc += 1;
+                        counts(key.y, key.x) += 1;
 
                         // TODO: Undocumented functionality. Shows how many times a gate is passed?
                         if (hasGateColumn) {
@@ -91,11 +89,13 @@ bool VGAThroughVision::run(Communicator *comm, PointMap &map, bool) {
 
     int col = attributes.getOrInsertColumn("Through vision");
 
+    std::vector<float> values;
+    values.reserve(attributes.getNumRows());
     for (auto iter = attributes.begin(); iter != attributes.end(); iter++) {
         PixelRef pix = iter->getKey().value;
-        iter->getRow().setValue(col, static_cast<float>(map.getPoint(pix).m_misc));
-        map.getPoint(pix).m_misc = 0;
+        values.push_back(static_cast<float>(counts(pix.y, pix.x)));
     }
+    attributes.setColumnValues(col, values);
 
     map.overrideDisplayedAttribute(-2);
     map.setDisplayedAttribute(col);
@@ -20,6 +20,21 @@
 
 #include "genlib/stringutils.h"
 
+namespace {
+    int lowestBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(word);
+#else
+        int bit = 0;
+        while (!(word & 1)) {
+            word >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+} // namespace
+
 bool VGAVisualGlobal::run(Communicator *comm, PointMap &map, bool simple_version) {
     time_t atime = 0;
     if (comm) {
@@ -62,6 +77,116 @@ bool VGAVisualGlobal::run(Communicator *comm, PointMap &map, bool simple_version
     }
 #endif
 
+    size_t rowCount = attributes.getNumRows();
+    AttributeColumnValues entropyValues(rowCount), relEntropyValues(rowCount), integDvValues(rowCount),
+        integPvValues(rowCount), integTkValues(rowCount), depthValues(rowCount), countValues(rowCount);
+
+    auto setValues = [&](PixelRef curs, const DepthResult &result) {
+        int total_depth = result.total_depth;
+        int total_nodes = result.total_nodes;
+        const std::vector<int> &distribution = result.distribution;
+        size_t row = attributes.getRowPosition(AttributeKey(curs));
+        // only set to single float precision after divide
+        // note -- total_nodes includes this one -- mean depth as per p.108 Social Logic of Space
+        if (!simple_version) {
+            countValues.setValue(row, float(total_nodes)); // note: total nodes includes this one
+        }
+        // ERROR !!!!!!
+        if (total_nodes > 1) {
+            double mean_depth = double(total_depth) / double(total_nodes - 1);
+            if (!simple_version) {
+                depthValues.setValue(row, float(mean_depth));
+            }
+            // total nodes > 2 to avoid divide by 0 (was > 3)
+            if (total_nodes > 2 && mean_depth > 1.0) {
+                double ra = 2.0 * (mean_depth - 1.0) / double(total_nodes - 2);
+                // d-value / p-values from Depthmap 4 manual, note: node_count includes this one
+                double rra_d = ra / dvalue(total_nodes);
+                double rra_p = ra / pvalue(total_nodes);
+                double integ_tk = teklinteg(total_nodes, total_depth);
+                integDvValues.setValue(row, float(1.0 / rra_d));
+                if (!simple_version) {
+                    integPvValues.setValue(row, float(1.0 / rra_p));
+                }
+                if (total_depth - total_nodes + 1 > 1) {
+                    if (!simple_version) {
+                        integTkValues.setValue(row, float(integ_tk));
+                    }
+                } else {
+                    if (!simple_version) {
+                        integTkValues.setValue(row, -1.0f);
+                    }
+                }
+            } else {
+                integDvValues.setValue(row, (float)-1);
+                if (!simple_version) {
+                    integPvValues.setValue(row, (float)-1);
+                    integTkValues.setValue(row, (float)-1);
+                }
+            }
+            double entropy = 0.0, rel_entropy = 0.0, factorial = 1.0;
+            // n.b., this distribution contains the root node itself in distribution[0]
+            // -> chopped from entropy to avoid divide by zero if only one node
+            for (size_t k = 1; k < distribution.size(); k++) {
+                if (distribution[k] > 0) {
+                    double prob = double(distribution[k]) / double(total_nodes - 1);
+                    entropy -= prob * log2(prob);
+                    // Formula from Turner 2001, "Depthmap"
+                    factorial *= double(k + 1);
+                    double q = (pow(mean_depth, double(k)) / double(factorial)) * exp(-mean_depth);
+                    rel_entropy += (float)prob * log2(prob / q);
+                }
+            }
+            if (!simple_version) {
+                entropyValues.setValue(row, float(entropy));
+                relEntropyValues.setValue(row, float(rel_entropy));
+            }
+        } else {
+            if (!simple_version) {
+                depthValues.setValue(row, (float)-1);
+                entropyValues.setValue(row, (float)-1);
+                relEntropyValues.setValue(row, (float)-1);
+            }
+        }
+    };
+
+    auto writeColumns = [&]() {
+        attributes.setColumnValues(integ_dv_col, integDvValues);
+        if (!simple_version) {
+            attributes.setColumnValues(entropy_col, entropyValues);
+            attributes.setColumnValues(rel_entropy_col, relEntropyValues);
+            attributes.setColumnValues(integ_pv_col, integPvValues);
+            attributes.setColumnValues(integ_tk_col, integTkValues);
+            attributes.setColumnValues(depth_col, depthValues);
+            attributes.setColumnValues(count_col, countValues);
+        }
+    };
+
+    CellIndex cells(map);
+
+    if (!m_legacy_search && canSearchInBatches(cells)) {
+        std::vector<int> origins;
+        std::vector<DepthResult> results;
+        for (size_t i = 0; i < cells.graph.size(); i++) {
+            if (!m_gates_only && !cells.contextodd[i]) {
+                origins.push_back(static_cast<int>(i));
+            }
+            if (origins.size() == BATCH || (i + 1 == cells.graph.size() && !origins.empty())) {
+                searchBatch(comm, atime, cells, origins, results);
+                for (size_t k = 0; k < origins.size(); k++) {
+                    setValues(cells.graph.cell(origins[k]), results[k]);
+                }
+                origins.clear();
+                if (comm) {
+                    comm->CommPostMessage(Communicator::CURRENT_RECORD, static_cast<int>(i + 1));
+                }
+            }
+        }
+        writeColumns();
+        map.setDisplayedAttribute(integ_dv_col);
+        return true;
+    }
+
     int count = 0;
 
     depthmapX::RowMatrix<int> miscs(map.getRows(), map.getCols());
@@ -77,120 +202,8 @@ bool VGAVisualGlobal::run(Communicator *comm, PointMap &map, bool simple_version
                     continue;
                 }
 
-                for (size_t ii = 0; ii < map.getCols(); ii++) {
-                    for (size_t jj = 0; jj < map.getRows(); jj++) {
-                        miscs(jj, ii) = 0;
-                        extents(jj, ii) = PixelRef(ii, jj);
-                    }
-                }
+                setValues(curs, searchFrom(map, curs, miscs, extents));
 
-                int total_depth = 0;
-                int total_nodes = 0;
-
-                std::vector<int> distribution;
-                std::vector<PixelRefVector> search_tree;
-                search_tree.push_back(PixelRefVector());
-                search_tree.back().push_back(curs);
-
-                int level = 0;
-                while (search_tree[level].size()) {
-                    search_tree.push_back(PixelRefVector());
-                    const PixelRefVector &searchTreeAtLevel = search_tree[level];
-                    distribution.push_back(0);
-                    for (auto currLvlIter = searchTreeAtLevel.rbegin(); currLvlIter != searchTreeAtLevel.rend();
-                         currLvlIter++) {
-                        int &pmisc = miscs(currLvlIter->y, currLvlIter->x);
-                        Point &p = map.getPoint(*currLvlIter);
-                        if (p.filled() && pmisc != ~0) {
-                            total_depth += level;
-                            total_nodes += 1;
-                            distribution.back() += 1;
-                            if ((int)m_radius == -1 ||
-                                (level < (int)m_radius &&
-                                    (!p.contextfilled() || currLvlIter->iseven()))) {
-                                extractUnseen(p.getNode(), search_tree[level + 1], miscs, extents);
-                                pmisc = ~0;
-                                if (!p.getMergePixel().empty()) {
-                                    PixelRef mergePixel = p.getMergePixel();
-                                    int &p2misc = miscs(mergePixel.y, mergePixel.x);
-                                    Point &p2 = map.getPoint(mergePixel);
-                                    if (p2misc != ~0) {
-                                        extractUnseen(p2.getNode(), search_tree[level + 1], miscs,
-                                                      extents); // did say p.misc
-                                        p2misc = ~0;
-                                    }
-                                }
-                            } else {
-                                pmisc = ~0;
-                            }
-                        }
-                        search_tree[level].pop_back();
-                    }
-                    level++;
-                }
-                AttributeRow &row = attributes.getRow(AttributeKey(curs));
-                // only set to single float precision after divide
-                // note -- total_nodes includes this one -- mean depth as per p.108 Social Logic of Space
-                if (!simple_version) {
-                    row.setValue(count_col, float(total_nodes)); // note: total nodes includes this one
-                }
-                // ERROR !!!!!!
-                if (total_nodes > 1) {
-                    double mean_depth = double(total_depth) / double(total_nodes - 1);
-                    if (!simple_version) {
-                        row.setValue(depth_col, float(mean_depth));
-                    }
-                    // total nodes > 2 to avoid divide by 0 (was > 3)
-                    if (total_nodes > 2 && mean_depth > 1.0) {
-                        double ra = 2.0 * (mean_depth - 1.0) / double(total_nodes - 2);
-                        // d-value / p-values from Depthmap 4 manual, note: node_count includes this one
-                        double rra_d = ra / dvalue(total_nodes);
-                        double rra_p = ra / pvalue(total_nodes);
-                        double integ_tk = teklinteg(total_nodes, total_depth);
-                        row.setValue(integ_dv_col, float(1.0 / rra_d));
-                        if (!simple_version) {
-                            row.setValue(integ_pv_col, float(1.0 / rra_p));
-                        }
-                        if (total_depth - total_nodes + 1 > 1) {
-                            if (!simple_version) {
-                                row.setValue(integ_tk_col, float(integ_tk));
-                            }
-                        } else {
-                            if (!simple_version) {
-                                row.setValue(integ_tk_col, -1.0f);
-                            }
-                        }
-                    } else {
-                        row.setValue(integ_dv_col, (float)-1);
-                        if (!simple_version) {
-                            row.setValue(integ_pv_col, (float)-1);
-                            row.setValue(integ_tk_col, (float)-1);
-                        }
-                    }
-                    double entropy = 0.0, rel_entropy = 0.0, factorial = 1.0;
-                    // n.b., this distribution contains the root node itself in distribution[0]
-                    // -> chopped from entropy to avoid divide by zero if only one node
-                    for (size_t k = 1; k < distribution.size(); k++) {
-                        if (distribution[k] > 0) {
-                            double prob = double(distribution[k]) / double(total_nodes - 1);
-                            entropy -= prob * log2(prob);
-                            // Formula from Turner 2001, "Depthmap"
-                            factorial *= double(k + 1);
-                            double q = (pow(mean_depth, double(k)) / double(factorial)) * exp(-mean_depth);
-                            rel_entropy += (float)prob * log2(prob / q);
-                        }
-                    }
-                    if (!simple_version) {
-                        row.setValue(entropy_col, float(entropy));
-                        row.setValue(rel_entropy_col, float(rel_entropy));
-                    }
-                } else {
-                    if (!simple_version) {
-                        row.setValue(depth_col, (float)-1);
-                        row.setValue(entropy_col, (float)-1);
-                        row.setValue(rel_entropy_col, (float)-1);
-                    }
-                }
                 count++; // <- increment count
                 if (comm) {
                     if (qtimer(atime, 500)) {
@@ -203,18 +216,213 @@ bool VGAVisualGlobal::run(Communicator *comm, PointMap &map, bool simple_version
             }
         }
     }
-    for (size_t i = 0; i < map.getCols(); i++) {
-        for (size_t j = 0; j < map.getRows(); j++) {
-            PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
-            map.getPoint(curs).m_misc = miscs(j, i);
-            map.getPoint(curs).m_extent = extents(j, i);
+    writeColumns();
+    map.setDisplayedAttribute(integ_dv_col);
+
+    return true;
+}
+
+VGAVisualGlobal::DepthResult VGAVisualGlobal::searchFrom(PointMap &map, PixelRef curs, depthmapX::RowMatrix<int> &miscs,
+                                                         depthmapX::RowMatrix<PixelRef> &extents) {
+    for (size_t ii = 0; ii < map.getCols(); ii++) {
+        for (size_t jj = 0; jj < map.getRows(); jj++) {
+            miscs(jj, ii) = 0;
+            extents(jj, ii) = PixelRef(ii, jj);
         }
     }
-    map.setDisplayedAttribute(integ_dv_col);
 
+    DepthResult result;
+    std::vector<PixelRefVector> search_tree;
+    search_tree.push_back(PixelRefVector());
+    search_tree.back().push_back(curs);
+
+    int level = 0;
+    while (search_tree[level].size()) {
+        search_tree.push_back(PixelRefVector());
+        const PixelRefVector &searchTreeAtLevel = search_tree[level];
+        result.distribution.push_back(0);
+        for (auto currLvlIter = searchTreeAtLevel.rbegin(); currLvlIter != searchTreeAtLevel.rend(); currLvlIter++) {
+            int &pmisc = miscs(currLvlIter->y, currLvlIter->x);
+            Point &p = map.getPoint(*currLvlIter);
+            if (p.filled() && pmisc != ~0) {
+                result.total_depth += level;
+                result.total_nodes += 1;
+                result.distribution.back() += 1;
+                if ((int)m_radius == -1 ||
+                    (level < (int)m_radius && (!p.contextfilled() || currLvlIter->iseven()))) {
+                    extractUnseen(p.getNode(), search_tree[level + 1], miscs, extents);
+                    pmisc = ~0;
+                    if (!p.getMergePixel().empty()) {
+                        PixelRef mergePixel = p.getMergePixel();
+                        int &p2misc = miscs(mergePixel.y, mergePixel.x);
+                        Point &p2 = map.getPoint(mergePixel);
+                        if (p2misc != ~0) {
+                            extractUnseen(p2.getNode(), search_tree[level + 1], miscs,
+                                          extents); // did say p.misc
+                            p2misc = ~0;
+                        }
+                    }
+                } else {
+                    pmisc = ~0;
+                }
+            }
+            search_tree[level].pop_back();
+        }
+        level++;
+    }
+    return result;
+}
+
+VGAVisualGlobal::CellIndex::CellIndex(PointMap &map) : graph(map) {
+    merges.assign(graph.size(), -1);
+    for (size_t i = 0; i < graph.size(); i++) {
+        PixelRef curs = graph.cell(i);
+        contextodd.push_back(map.getPoint(curs).contextfilled() && !curs.iseven());
+        PixelRef mergePixel = map.getPoint(curs).getMergePixel();
+        if (!mergePixel.empty()) {
+            merges[i] = graph.index(mergePixel);
+        }
+    }
+}
+
+// The batched search treats the cells reached at each level as a set, which is what
+// the one-origin search computes as long as the order in which it walks a level does
+// not matter. It only does where a merged pair is found at the same level with just one
+// of the two allowed to expand, so leave maps with such pairs to the legacy search.
+bool VGAVisualGlobal::canSearchInBatches(const CellIndex &cells) const {
+    for (size_t i = 0; i < cells.graph.size(); i++) {
+        int merge = cells.merges[i];
+        if (merge == -1) {
+            continue;
+        }
+        if (cells.merges[merge] != static_cast<int>(i)) {
+            return false;
+        }
+        if ((int)m_radius != -1 && cells.contextodd[i] != cells.contextodd[merge]) {
+            return false;
+        }
+    }
     return true;
 }
 
+// Breadth first search from up to BATCH origins at once. Each cell holds a block of bits,
+// one per origin, for the origins that reach it at the current level (frontier), for the
+// ones that reached it at any level so far (visited) and for the ones it will be reached
+// by at the next level (next), so a level is a pass over the cells in the frontier that
+// ORs their block into the blocks of everything they see, followed by an AND-NOT with
+// visited. There is nothing to reset between origins, and the fixed size block loops
+// are left for the compiler to vectorise.
+void VGAVisualGlobal::searchBatch(Communicator *comm, time_t &atime, const CellIndex &cells,
+                                  const std::vector<int> &origins, std::vector<DepthResult> &results) const {
+    size_t cellCount = cells.graph.size();
+    std::vector<uint64_t> frontier(cellCount * WORDS, 0);
+    std::vector<uint64_t> visited(cellCount * WORDS, 0);
+    std::vector<uint64_t> next(cellCount * WORDS, 0);
+
+    results.assign(origins.size(), DepthResult());
+    for (size_t k = 0; k < origins.size(); k++) {
+        uint64_t bit = uint64_t(1) << (k % 64);
+        frontier[origins[k] * WORDS + k / 64] |= bit;
+        visited[origins[k] * WORDS + k / 64] |= bit;
+    }
+
+    auto isEmpty = [](const uint64_t *block) {
+        uint64_t any = 0;
+        for (size_t w = 0; w < WORDS; w++) {
+            any |= block[w];
+        }
+        return any == 0;
+    };
+    auto count = [&results](const Block &bits, int level) {
+        for (size_t w = 0; w < WORDS; w++) {
+            for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+                DepthResult &result = results[w * 64 + lowestBit(word)];
+                result.total_depth += level;
+                result.total_nodes += 1;
+                if (result.distribution.size() <= size_t(level)) {
+                    result.distribution.resize(level + 1, 0);
+                }
+                result.distribution[level] += 1;
+            }
+        }
+    };
+
+    int radius = (int)m_radius;
+    bool any = true;
+    for (int level = 0; any; level++) {
+        for (size_t i = 0; i < cellCount; i++) {
+            int merge = cells.merges[i];
+            if (merge != -1 && merge < static_cast<int>(i)) {
+                continue; // searched together with its merge partner
+            }
+            const uint64_t *here = &frontier[i * WORDS];
+            const uint64_t *there = merge == -1 ? nullptr : &frontier[merge * WORDS];
+            if (isEmpty(here) && (there == nullptr || isEmpty(there))) {
+                continue;
+            }
+            bool expand = radius == -1 || (level < radius && !cells.contextodd[i]);
+            if (there == nullptr || !expand) {
+                // n.b. if a merged pair cannot expand they are both counted
+                Block bits;
+                std::copy(here, here + WORDS, bits);
+                count(bits, level);
+                if (expand) {
+                    expandBatch(i, bits, cells, next);
+                }
+                if (there != nullptr) {
+                    std::copy(there, there + WORDS, bits);
+                    count(bits, level);
+                }
+                continue;
+            }
+            // the first of a merged pair to be reached is counted, and both are expanded
+            // from, for the origins that have not already been through the other one
+            uint64_t *hereVisited = &visited[i * WORDS];
+            uint64_t *thereVisited = &visited[merge * WORDS];
+            Block hereBits, thereBits, thereCounted;
+            for (size_t w = 0; w < WORDS; w++) {
+                hereBits[w] = here[w] | (there[w] & ~hereVisited[w]);
+                thereBits[w] = there[w] | (here[w] & ~thereVisited[w]);
+                thereCounted[w] = there[w] & ~here[w];
+            }
+            Block hereCounted;
+            std::copy(here, here + WORDS, hereCounted);
+            count(hereCounted, level);
+            count(thereCounted, level);
+            for (size_t w = 0; w < WORDS; w++) {
+                hereVisited[w] |= hereBits[w];
+                thereVisited[w] |= thereBits[w];
+            }
+            expandBatch(i, hereBits, cells, next);
+            expandBatch(merge, thereBits, cells, next);
+        }
+        any = false;
+        for (size_t i = 0; i < cellCount * WORDS; i += WORDS) {
+            uint64_t reached = 0;
+            for (size_t w = 0; w < WORDS; w++) {
+                frontier[i + w] = next[i + w] & ~visited[i + w];
+                visited[i + w] |= frontier[i + w];
+                next[i + w] = 0;
+                reached |= frontier[i + w];
+            }
+            any = any || reached != 0;
+        }
+        if (comm && qtimer(atime, 500) && comm->IsCancelled()) {
+            throw Communicator::CancelledException();
+        }
+    }
+}
+
+void VGAVisualGlobal::expandBatch(size_t cell, const Block &bits, const CellIndex &cells,
+                                  std::vector<uint64_t> &next) const {
+    for (const unsigned int *iter = cells.graph.begin(cell); iter != cells.graph.end(cell); ++iter) {
+        uint64_t *block = &next[*iter * WORDS];
+        for (size_t w = 0; w < WORDS; w++) {
+            block[w] |= bits[w];
+        }
+    }
+}
+
 void VGAVisualGlobal::extractUnseen(Node &node, PixelRefVector &pixels, depthmapX::RowMatrix<int> &miscs,
                                     depthmapX::RowMatrix<PixelRef> &extents) {
     for (int i = 0; i < 32; i++) {
@@ -18,21 +18,54 @@
 
 #pragma once
 
+#include "salalib/csrvisibilitygraph.h"
 #include "salalib/ivga.h"
 #include "salalib/pixelref.h"
 #include "salalib/pointdata.h"
 
 #include "genlib/simplematrix.h"
 
+#include <cstdint>
+
 class VGAVisualGlobal : IVGA {
   private:
     double m_radius;
     bool m_gates_only;
+    bool m_legacy_search;
+
+    struct DepthResult {
+        int total_depth = 0;
+        int total_nodes = 0;
+        std::vector<int> distribution;
+    };
+
+    // the visibility graph with the merge partner of each cell and whether a cell
+    // may be expanded from when a radius is set
+    struct CellIndex {
+        CSRVisibilityGraph graph;
+        std::vector<int> merges;
+        std::vector<bool> contextodd;
+        CellIndex(PointMap &map);
+    };
+
+    // origins searched together by searchBatch, one bit each in a block of WORDS words per cell
+    static const size_t WORDS = 4;
+    static const size_t BATCH = WORDS * 64;
+    typedef uint64_t Block[WORDS];
+
+    bool canSearchInBatches(const CellIndex &cells) const;
+    void searchBatch(Communicator *comm, time_t &atime, const CellIndex &cells, const std::vector<int> &origins,
+                     std::vector<DepthResult> &results) const;
+    void expandBatch(size_t cell, const Block &bits, const CellIndex &cells, std::vector<uint64_t> &next) const;
+    DepthResult searchFrom(PointMap &map, PixelRef curs, depthmapX::RowMatrix<int> &miscs,
+                           depthmapX::RowMatrix<PixelRef> &extents);
 
   public:
     std::string getAnalysisName() const override { return "Global Visibility Analysis"; }
     bool run(Communicator *comm, PointMap &map, bool simple_version) override;
     void extractUnseen(Node &node, PixelRefVector &pixels, depthmapX::RowMatrix<int> &miscs,
                        depthmapX::RowMatrix<PixelRef> &extents);
-    VGAVisualGlobal(double radius, bool gates_only) : m_radius(radius), m_gates_only(gates_only) {}
+    // legacy_search: search one origin at a time over the whole grid as older versions did
+    VGAVisualGlobal(double radius, bool gates_only, bool legacy_search = false)
+        : m_radius(radius), m_gates_only(gates_only), m_legacy_search(legacy_search) {}
 };
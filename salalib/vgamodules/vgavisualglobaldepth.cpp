@@ -27,10 +27,14 @@ bool VGAVisualGlobalDepth::run(Communicator *, PointMap &map, bool) {
     // n.b., insert columns sets values to -1 if the column already exists
     int col = attributes.insertOrResetColumn("Visual Step Depth");
 
-    for (auto iter = attributes.begin(); iter != attributes.end(); iter++) {
-        PixelRef pix = iter->getKey().value;
-        map.getPoint(pix).m_misc = 0;
-        map.getPoint(pix).m_extent = pix;
+    // the search state is kept here rather than on the points so the map is not changed
+    depthmapX::RowMatrix<int> miscs(map.getRows(), map.getCols());
+    depthmapX::RowMatrix<PixelRef> extents(map.getRows(), map.getCols());
+    for (size_t ii = 0; ii < map.getCols(); ii++) {
+        for (size_t jj = 0; jj < map.getRows(); jj++) {
+            miscs(jj, ii) = 0;
+            extents(jj, ii) = PixelRef(static_cast<short>(ii), static_cast<short>(jj));
+        }
     }
 
     std::vector<PixelRefVector> search_tree;
@@ -46,23 +50,27 @@ bool VGAVisualGlobalDepth::run(Communicator *, PointMap &map, bool) {
         const PixelRefVector& searchTreeAtLevel = search_tree[level];
         for (auto currLvlIter = searchTreeAtLevel.rbegin(); currLvlIter != searchTreeAtLevel.rend(); currLvlIter++) {
             Point &p = map.getPoint(*currLvlIter);
-            if (p.filled() && p.m_misc != ~0) {
+            int &pmisc = miscs(currLvlIter->y, currLvlIter->x);
+            if (p.filled() && pmisc != ~0) {
                 AttributeRow &row = attributes.getRow(AttributeKey(*currLvlIter));
                 row.setValue(col, float(level));
                 if (!p.contextfilled() || currLvlIter->iseven() || level == 0) {
-                    p.getNode().extractUnseen(search_tree[level + 1], &map);
-                    p.m_misc = ~0;
-                    if (!p.getMergePixel().empty()) {
-                        Point &p2 = map.getPoint(p.getMergePixel());
-                        if (p2.m_misc != ~0) {
-                            AttributeRow &mergePixelRow = attributes.getRow(AttributeKey(p.getMergePixel()));
+                    extractUnseen(p.getNode(), search_tree[level + 1], miscs, extents);
+                    pmisc = ~0;
+                    PixelRef mergePixel = p.getMergePixel();
+                    if (!mergePixel.empty()) {
+                        Point &p2 = map.getPoint(mergePixel);
+                        int &p2misc = miscs(mergePixel.y, mergePixel.x);
+                        if (p2misc != ~0) {
+                            AttributeRow &mergePixelRow = attributes.getRow(AttributeKey(mergePixel));
                             mergePixelRow.setValue(col, float(level));
-                            p2.getNode().extractUnseen(search_tree[level + 1], &map); // did say p.misc
-                            p2.m_misc = ~0;
+                            extractUnseen(p2.getNode(), search_tree[level + 1], miscs,
+                                          extents); // did say p.misc
+                            p2misc = ~0;
                         }
                     }
                 } else {
-                    p.m_misc = ~0;
+                    pmisc = ~0;
                 }
             }
         }
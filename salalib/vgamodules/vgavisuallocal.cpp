@@ -18,99 +18,112 @@
 
 #include "salalib/vgamodules/vgavisuallocal.h"
 
+#include "salalib/csrvisibilitygraph.h"
+
+#include "genlib/parallel.h"
 #include "genlib/stringutils.h"
 
 bool VGAVisualLocal::run(Communicator *comm, PointMap &map, bool simple_version) {
-    time_t atime = 0;
     if (comm) {
-        qtimer(atime, 0);
         comm->CommPostMessage(Communicator::NUM_RECORDS, map.getFilledPointCount());
     }
 
+    AttributeTable &attributes = map.getAttributeTable();
+
     int cluster_col = -1, control_col = -1, controllability_col = -1;
     if (!simple_version) {
-        cluster_col = map.getAttributeTable().insertOrResetColumn("Visual Clustering Coefficient");
-        control_col = map.getAttributeTable().insertOrResetColumn("Visual Control");
-        controllability_col = map.getAttributeTable().insertOrResetColumn("Visual Controllability");
+        cluster_col = attributes.insertOrResetColumn("Visual Clustering Coefficient");
+        control_col = attributes.insertOrResetColumn("Visual Control");
+        controllability_col = attributes.insertOrResetColumn("Visual Controllability");
     }
 
-    int count = 0;
+    CSRVisibilityGraph graph(map);
 
-    for (size_t i = 0; i < map.getCols(); i++) {
-        for (size_t j = 0; j < map.getRows(); j++) {
-            PixelRef curs = PixelRef(static_cast<short>(i), static_cast<short>(j));
-            if (map.getPoint(curs).filled()) {
-                if ((map.getPoint(curs).contextfilled() && !curs.iseven()) || (m_gates_only)) {
-                    count++;
-                    continue;
-                }
-                AttributeRow &row = map.getAttributeTable().getRow(AttributeKey(curs));
-
-                // This is much easier to do with a straight forward list:
-                PixelRefVector neighbourhood;
-                PixelRefVector totalneighbourhood;
-                map.getPoint(curs).getNode().contents(neighbourhood);
-
-                // only required to match previous non-stl output. Without this
-                // the output differs by the last digit of the float
-                std::sort(neighbourhood.begin(), neighbourhood.end());
-
-                int cluster = 0;
-                float control = 0.0f;
-
-                for (size_t i = 0; i < neighbourhood.size(); i++) {
-                    int intersect_size = 0, retro_size = 0;
-                    Point &retpt = map.getPoint(neighbourhood[i]);
-                    if (retpt.filled() && retpt.hasNode()) {
-                        retpt.getNode().first();
-                        while (!retpt.getNode().is_tail()) {
-                            retro_size++;
-                            if (std::find(neighbourhood.begin(), neighbourhood.end(), retpt.getNode().cursor()) !=
-                                neighbourhood.end()) {
-                                intersect_size++;
-                            }
-                            if (std::find(totalneighbourhood.begin(), totalneighbourhood.end(),
-                                          retpt.getNode().cursor()) == totalneighbourhood.end()) {
-                                totalneighbourhood.push_back(
-                                    retpt.getNode().cursor()); // <- note add does nothing if member already exists
-                            }
-                            retpt.getNode().next();
-                        }
-                        control += 1.0f / float(retro_size);
-                        cluster += intersect_size;
+    // cells marked with the number of the origin whose neighbourhood or total
+    // neighbourhood they are in, so that nothing has to be cleared between origins
+    struct Scratch {
+        std::vector<int> inNeighbourhood;
+        std::vector<int> inTotalNeighbourhood;
+        std::vector<unsigned int> neighbourhood;
+        Scratch(size_t size) : inNeighbourhood(size, -1), inTotalNeighbourhood(size, -1) {}
+    };
+
+    AttributeColumnValues clusterValues(attributes.getNumRows()), controlValues(attributes.getNumRows()),
+        controllabilityValues(attributes.getNumRows());
+    auto setValues = [&](size_t row, float clusterValue, float controlValue, float controllabilityValue) {
+        clusterValues.setValue(row, clusterValue);
+        controlValues.setValue(row, controlValue);
+        controllabilityValues.setValue(row, controllabilityValue);
+    };
+
+    // the rows are looked up before the workers start, as looking one up may sort the table
+    std::vector<size_t> rows(graph.size());
+    std::vector<bool> skip(graph.size());
+    for (size_t origin = 0; origin < graph.size(); origin++) {
+        PixelRef curs = graph.cell(origin);
+        skip[origin] = (map.getPoint(curs).contextfilled() && !curs.iseven()) || (m_gates_only);
+        if (!skip[origin]) {
+            rows[origin] = attributes.getRowPosition(AttributeKey(curs));
+        }
+    }
+
+    // each origin only sets its own row of the values
+    depthmapX::parallelForWithScratch(
+        comm, graph.size(), m_threads, [&]() { return Scratch(graph.size()); },
+        [&](Scratch &scratch, size_t origin) {
+            if (skip[origin]) {
+                return;
+            }
+            size_t row = rows[origin];
+
+            std::vector<unsigned int> &neighbourhood = scratch.neighbourhood;
+            neighbourhood.assign(graph.begin(origin), graph.end(origin));
+            for (unsigned int cell : neighbourhood) {
+                scratch.inNeighbourhood[cell] = static_cast<int>(origin);
+            }
+            size_t totalNeighbourhoodSize = 0;
+
+            // only required to match previous non-stl output. Without this
+            // the output differs by the last digit of the float
+            std::sort(neighbourhood.begin(), neighbourhood.end(),
+                      [&graph](unsigned int a, unsigned int b) { return graph.cell(a) < graph.cell(b); });
+
+            int cluster = 0;
+            float control = 0.0f;
+
+            for (unsigned int cell : neighbourhood) {
+                int intersect_size = 0;
+                for (const unsigned int *iter = graph.begin(cell); iter != graph.end(cell); ++iter) {
+                    if (scratch.inNeighbourhood[*iter] == static_cast<int>(origin)) {
+                        intersect_size++;
                     }
-                }
-#ifndef _COMPILE_dX_SIMPLE_VERSION
-                if (!simple_version) {
-                    if (neighbourhood.size() > 1) {
-                        row.setValue(cluster_col,
-                                     float(cluster / double(neighbourhood.size() * (neighbourhood.size() - 1.0))));
-                        row.setValue(control_col, float(control));
-                        row.setValue(controllability_col,
-                                     float(double(neighbourhood.size()) / double(totalneighbourhood.size())));
-                    } else {
-                        row.setValue(cluster_col, -1);
-                        row.setValue(control_col, -1);
-                        row.setValue(controllability_col, -1);
+                    if (scratch.inTotalNeighbourhood[*iter] != static_cast<int>(origin)) {
+                        scratch.inTotalNeighbourhood[*iter] = static_cast<int>(origin);
+                        totalNeighbourhoodSize++;
                     }
                 }
-#endif
-                count++; // <- increment count
+                control += 1.0f / float(graph.degree(cell));
+                cluster += intersect_size;
             }
-            if (comm) {
-                if (qtimer(atime, 500)) {
-                    if (comm->IsCancelled()) {
-                        throw Communicator::CancelledException();
-                    }
-                    comm->CommPostMessage(Communicator::CURRENT_RECORD, count);
+#ifndef _COMPILE_dX_SIMPLE_VERSION
+            if (!simple_version) {
+                if (neighbourhood.size() > 1) {
+                    setValues(row, float(cluster / double(neighbourhood.size() * (neighbourhood.size() - 1.0))),
+                              float(control), float(double(neighbourhood.size()) / double(totalNeighbourhoodSize)));
+                } else {
+                    setValues(row, -1, -1, -1);
                 }
             }
-        }
-    }
+#endif
+        });
 
 #ifndef _COMPILE_dX_SIMPLE_VERSION
-    if (!simple_version)
+    if (!simple_version) {
+        attributes.setColumnValues(cluster_col, clusterValues);
+        attributes.setColumnValues(control_col, controlValues);
+        attributes.setColumnValues(controllability_col, controllabilityValues);
         map.setDisplayedAttribute(cluster_col);
+    }
 #endif
 
     return true;
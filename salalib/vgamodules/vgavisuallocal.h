@@ -25,9 +25,11 @@
 class VGAVisualLocal : IVGA {
   private:
     bool m_gates_only;
+    int m_threads;
 
   public:
     std::string getAnalysisName() const override { return "Local Visibility Analysis"; }
     bool run(Communicator *comm, PointMap &map, bool simple_version) override;
-    VGAVisualLocal(bool gates_only) : m_gates_only(gates_only) {}
+    // threads: number of origins to work on concurrently (0 to use all available cores)
+    VGAVisualLocal(bool gates_only, int threads = 1) : m_gates_only(gates_only), m_threads(threads) {}
 };